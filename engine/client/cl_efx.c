@@ -32,6 +32,21 @@ static particle_t	*cl_particles = NULL;	// particle pool
 static vec3_t	cl_avelocities[NUMVERTEXNORMALS];
 static float	cl_lasttimewarn = 0.0f;
 
+// per-frame simulation scratch space, particles are
+// grouped by type and stored as structure of arrays
+typedef struct partsim_s
+{
+	particle_t	**parts;	// gathered particles in list order
+	particle_t	**sorted;	// same particles, grouped by type
+	float		*org[3];
+	float		*vel[3];
+	float		*ramp;
+	int		first[pt_clientcustom];
+	int		count[pt_clientcustom];
+} partsim_t;
+
+static partsim_t	cl_partsim;
+
 // expand debugging BBOX particle hulls by this many units.
 #define BOX_GAP	0.0f
 
@@ -95,6 +110,18 @@ void CL_InitParticles( void )
 	cl_particles = Mem_Calloc( cls.mempool, sizeof( particle_t ) * GI->max_particles );
 	CL_ClearParticles ();
 
+	cl_partsim.parts = Mem_Malloc( cls.mempool, sizeof( particle_t * ) * GI->max_particles * 2 );
+	cl_partsim.sorted = cl_partsim.parts + GI->max_particles;
+	cl_partsim.org[0] = Mem_Malloc( cls.mempool, sizeof( float ) * GI->max_particles * 7 );
+
+	for( i = 1; i < 3; i++ )
+		cl_partsim.org[i] = cl_partsim.org[i - 1] + GI->max_particles;
+
+	for( i = 0; i < 3; i++ )
+		cl_partsim.vel[i] = cl_partsim.org[0] + GI->max_particles * ( 3 + i );
+
+	cl_partsim.ramp = cl_partsim.org[0] + GI->max_particles * 6;
+
 	// this is used for EF_BRIGHTFIELD
 	for( i = 0; i < NUMVERTEXNORMALS; i++ )
 	{
@@ -141,6 +168,14 @@ void CL_FreeParticles( void )
 	if( cl_particles )
 		Mem_Free( cl_particles );
 	cl_particles = NULL;
+
+	if( cl_partsim.parts )
+		Mem_Free( cl_partsim.parts );
+
+	if( cl_partsim.org[0] )
+		Mem_Free( cl_partsim.org[0] );
+
+	memset( &cl_partsim, 0, sizeof( cl_partsim ));
 }
 
 /*
@@ -1988,43 +2023,34 @@ Free particles that time has expired
 */
 void R_FreeDeadParticles( particle_t **ppparticles )
 {
-	particle_t	*p, *kill;
+	particle_t	*p, **link = ppparticles;
+	particle_t	*killed = NULL, *lastkilled = NULL;
 
-	// kill all the ones hanging direcly off the base pointer
-	while( 1 )
+	// unlink all expired particles in one pass
+	while(( p = *link ) != NULL )
 	{
-		kill = *ppparticles;
-		if( kill && kill->die < cl.time )
+		if( p->die < cl.time )
 		{
-			if( kill->deathfunc )
-				kill->deathfunc( kill );
-			kill->deathfunc = NULL;
-			*ppparticles = kill->next;
-			kill->next = cl_free_particles;
-			cl_free_particles = kill;
+			if( p->deathfunc )
+				p->deathfunc( p );
+			p->deathfunc = NULL;
+			*link = p->next;
+
+			if( !killed )
+				lastkilled = p;
+			p->next = killed;
+			killed = p;
 			continue;
 		}
-		break;
+
+		link = &p->next;
 	}
 
-	// kill off all the others
-	for( p = *ppparticles; p; p = p->next )
+	// and give them back to the pool at once
+	if( killed )
 	{
-		while( 1 )
-		{
-			kill = p->next;
-			if( kill && kill->die < cl.time )
-			{
-				if( kill->deathfunc )
-					kill->deathfunc( kill );
-				kill->deathfunc = NULL;
-				p->next = kill->next;
-				kill->next = cl_free_particles;
-				cl_free_particles = kill;
-				continue;
-			}
-			break;
-		}
+		lastkilled->next = cl_free_particles;
+		cl_free_particles = killed;
 	}
 }
 
@@ -2138,14 +2164,24 @@ void CL_DrawEFX( float time, qboolean fTrans )
 	{
 		R_FreeDeadParticles( &cl_active_particles );
 		if( cl_draw_particles.value )
+		{
 			ref.dllFuncs.CL_DrawParticles( time, cl_active_particles, PART_SIZE );
+			CL_ThinkParticles( time, cl_active_particles );
+		}
 		R_FreeDeadParticles( &cl_active_tracers );
 		if( cl_draw_tracers.value )
 			ref.dllFuncs.CL_DrawTracers( time, cl_active_tracers );
 	}
 }
 
-void CL_ThinkParticle( double frametime, particle_t *p )
+/*
+================
+CL_ParticleTypeThink
+
+per-type particle physics, position must be already updated
+================
+*/
+static void CL_ParticleTypeThink( double frametime, particle_t *p )
 {
 	float		time3 = 15.0f * frametime;
 	float		time2 = 10.0f * frametime;
@@ -2153,13 +2189,6 @@ void CL_ThinkParticle( double frametime, particle_t *p )
 	float		dvel = 4.0f * frametime;
 	float		grav = frametime * clgame.movevars.gravity * 0.05f;
 
-
-	if( p->type != pt_clientcustom )
-	{
-		// update position.
-		VectorMA( p->org, frametime, p->vel, p->org );
-	}
-
 	switch( p->type )
 	{
 	case pt_static:
@@ -2229,3 +2258,212 @@ void CL_ThinkParticle( double frametime, particle_t *p )
 		break;
 	}
 }
+
+/*
+================
+CL_ThinkParticle
+
+reference single particle update, kept for renderers
+================
+*/
+void CL_ThinkParticle( double frametime, particle_t *p )
+{
+	if( p->type != pt_clientcustom )
+	{
+		// update position.
+		VectorMA( p->org, frametime, p->vel, p->org );
+	}
+
+	CL_ParticleTypeThink( frametime, p );
+}
+
+/*
+================
+CL_ParticleRamp
+
+particle group kernels, loops are kept simple so compiler could vectorize them
+================
+*/
+static void CL_ParticleRamp( partsim_t *sim, ptype_t type, float step )
+{
+	float	*ramp = &sim->ramp[sim->first[type]];
+	int	i, count = sim->count[type];
+
+	for( i = 0; i < count; i++ )
+		ramp[i] += step;
+}
+
+static void CL_ParticleGravity( partsim_t *sim, ptype_t type, float grav )
+{
+	float	*vz = &sim->vel[2][sim->first[type]];
+	int	i, count = sim->count[type];
+
+	for( i = 0; i < count; i++ )
+		vz[i] -= grav;
+}
+
+static void CL_ParticleScaleVel( partsim_t *sim, ptype_t type, float scale )
+{
+	float	*vx = &sim->vel[0][sim->first[type]];
+	float	*vy = &sim->vel[1][sim->first[type]];
+	float	*vz = &sim->vel[2][sim->first[type]];
+	int	i, count = sim->count[type];
+
+	for( i = 0; i < count; i++ )
+	{
+		vx[i] = vx[i] + scale * vx[i];
+		vy[i] = vy[i] + scale * vy[i];
+		vz[i] = vz[i] + scale * vz[i];
+	}
+}
+
+static void CL_ParticleDampVel( partsim_t *sim, ptype_t type, double frametime )
+{
+	float	*vx = &sim->vel[0][sim->first[type]];
+	float	*vy = &sim->vel[1][sim->first[type]];
+	float	*vz = &sim->vel[2][sim->first[type]];
+	int	i, count = sim->count[type];
+
+	// same as VectorMA with double precision scale
+	for( i = 0; i < count; i++ )
+	{
+		vx[i] = vx[i] + -frametime * vx[i];
+		vy[i] = vy[i] + -frametime * vy[i];
+		vz[i] = vz[i] + -frametime * vz[i];
+	}
+}
+
+static void CL_ParticleMove( partsim_t *sim, int count, double frametime )
+{
+	float	*ox = sim->org[0], *oy = sim->org[1], *oz = sim->org[2];
+	float	*vx = sim->vel[0], *vy = sim->vel[1], *vz = sim->vel[2];
+	int	i;
+
+	for( i = 0; i < count; i++ )
+	{
+		ox[i] = ox[i] + frametime * vx[i];
+		oy[i] = oy[i] + frametime * vy[i];
+		oz[i] = oz[i] + frametime * vz[i];
+	}
+}
+
+static void CL_ParticleApplyRamp( partsim_t *sim, ptype_t type, const int *colors, float maxramp )
+{
+	int	i, end = sim->first[type] + sim->count[type];
+
+	for( i = sim->first[type]; i < end; i++ )
+	{
+		particle_t *p = sim->sorted[i];
+
+		if( p->ramp >= maxramp ) p->die = -1.0f;
+		else p->color = colors[(int)p->ramp];
+	}
+}
+
+/*
+================
+CL_ThinkParticles
+
+batched version of CL_ThinkParticle for whole particle list
+particles are gathered into per-type arrays, updated and written back
+================
+*/
+void CL_ThinkParticles( double frametime, particle_t *particles )
+{
+	partsim_t	*sim = &cl_partsim;
+	float		time3 = 15.0f * frametime;
+	float		time2 = 10.0f * frametime;
+	float		time1 = 5.0f * frametime;
+	float		dvel = 4.0f * frametime;
+	float		grav = frametime * clgame.movevars.gravity * 0.05f;
+	int		i, j, numparts = 0;
+	particle_t	*p;
+
+	if( !particles || !sim->parts )
+		return;
+
+	memset( sim->count, 0, sizeof( sim->count ));
+
+	// custom particles are handled by their owners, gather all others
+	for( p = particles; p && numparts < GI->max_particles; p = p->next )
+	{
+		if( p->type == pt_clientcustom )
+		{
+			if( p->callback )
+				p->callback( p, frametime );
+			continue;
+		}
+
+		// unknown types are only moved
+		if( (uint)p->type >= pt_clientcustom )
+			sim->count[pt_static]++;
+		else sim->count[p->type]++;
+
+		sim->parts[numparts++] = p;
+	}
+
+	for( i = 0, j = 0; i < pt_clientcustom; i++ )
+	{
+		sim->first[i] = j;
+		j += sim->count[i];
+		sim->count[i] = 0;
+	}
+
+	// counting sort by type and convert into structure of arrays
+	for( i = 0; i < numparts; i++ )
+	{
+		ptype_t type;
+
+		p = sim->parts[i];
+		type = (uint)p->type >= pt_clientcustom ? pt_static : p->type;
+		j = sim->first[type] + sim->count[type]++;
+
+		sim->sorted[j] = p;
+		sim->org[0][j] = p->org[0];
+		sim->org[1][j] = p->org[1];
+		sim->org[2][j] = p->org[2];
+		sim->vel[0][j] = p->vel[0];
+		sim->vel[1][j] = p->vel[1];
+		sim->vel[2][j] = p->vel[2];
+		sim->ramp[j] = p->ramp;
+	}
+
+	CL_ParticleMove( sim, numparts, frametime );
+
+	CL_ParticleRamp( sim, pt_fire, time1 );
+	CL_ParticleGravity( sim, pt_fire, -grav );
+
+	CL_ParticleRamp( sim, pt_explode, time2 );
+	CL_ParticleScaleVel( sim, pt_explode, dvel );
+	CL_ParticleGravity( sim, pt_explode, grav );
+
+	CL_ParticleRamp( sim, pt_explode2, time3 );
+	CL_ParticleDampVel( sim, pt_explode2, frametime );
+	CL_ParticleGravity( sim, pt_explode2, grav );
+
+	CL_ParticleGravity( sim, pt_grav, grav * 20.0f );
+	CL_ParticleGravity( sim, pt_slowgrav, grav );
+	CL_ParticleGravity( sim, pt_vox_grav, grav * 8.0f );
+	CL_ParticleGravity( sim, pt_vox_slowgrav, grav * 4.0f );
+
+	// write back
+	for( i = 0; i < numparts; i++ )
+	{
+		p = sim->sorted[i];
+		p->org[0] = sim->org[0][i];
+		p->org[1] = sim->org[1][i];
+		p->org[2] = sim->org[2][i];
+		p->vel[0] = sim->vel[0][i];
+		p->vel[1] = sim->vel[1][i];
+		p->vel[2] = sim->vel[2][i];
+		p->ramp = sim->ramp[i];
+	}
+
+	CL_ParticleApplyRamp( sim, pt_fire, ramp3, 6.0f );
+	CL_ParticleApplyRamp( sim, pt_explode, ramp1, 8.0f );
+	CL_ParticleApplyRamp( sim, pt_explode2, ramp2, 8.0f );
+
+	// blobs are randomly changing their type, so keep them scalar
+	for( i = sim->first[pt_blob]; i < sim->first[pt_blob2] + sim->count[pt_blob2]; i++ )
+		CL_ParticleTypeThink( frametime, sim->sorted[i] );
+}
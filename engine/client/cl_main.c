@@ -3490,6 +3490,7 @@ static void CL_InitLocal( void )
 	Cmd_AddCommand ("togglemenu", CL_Escape_f, "toggle between game and menu" );
 	Cmd_AddCommand ("pointfile", CL_ReadPointFile_f, "show leaks on a map (if present of course)" );
 	Cmd_AddCommand ("linefile", CL_ReadLineFile_f, "show leaks on a map (if present of course)" );
+	Cmd_AddCommand ("tentstats", CL_TempEntStats_f, "print temporary entities allocation statistics" );
 	Cmd_AddCommand ("fullserverinfo", CL_FullServerinfo_f, "sent by server when serverinfo changes" );
 	Cmd_AddCommand ("upload", CL_BeginUpload_f, "uploading file to the server" );
 
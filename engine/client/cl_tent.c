@@ -39,6 +39,27 @@ static TEMPENTITY *cl_active_tents;
 static TEMPENTITY *cl_free_tents;
 static TEMPENTITY *cl_tempents = NULL;		// entities pool
 
+// client.dll owns the lists while in HUD_TempEntUpdate, so engine keeps
+// index-based shadow links that are rebuilt after every update
+typedef struct tentpool_s
+{
+	int	*prev;		// previous tent in active list, -1 for head
+	int	*lowstack;	// active low priority tents, top is nearest to list head
+	int	numlow;
+	qboolean	clientowned;	// inside HUD_TempEntUpdate, shadow links are stale
+
+	// allocation pressure counters
+	int	numactive;
+	int	peakactive;
+	uint	allocs;
+	uint	allocs_high;
+	uint	overflows;
+	uint	evicted;
+	uint	culled;		// rejected by PVS in last update
+} tentpool_t;
+
+static tentpool_t cl_tentpool;
+
 static model_t *cl_sprite_muzzleflash[MAX_MUZZLEFLASH];	// muzzle flashes
 static model_t *cl_sprite_ricochet = NULL;
 static model_t *cl_sprite_glow = NULL;
@@ -190,6 +211,8 @@ static void CL_ClearTempEnts( void )
 	cl_tempents[GI->max_tents-1].next = NULL;
 	cl_free_tents = cl_tempents;
 	cl_active_tents = NULL;
+	cl_tentpool.numlow = 0;
+	cl_tentpool.numactive = 0;
 }
 
 /*
@@ -201,6 +224,8 @@ CL_InitTempents
 void CL_InitTempEnts( void )
 {
 	cl_tempents = Mem_Calloc( cls.mempool, sizeof( TEMPENTITY ) * GI->max_tents );
+	cl_tentpool.prev = Mem_Malloc( cls.mempool, sizeof( int ) * GI->max_tents * 2 );
+	cl_tentpool.lowstack = cl_tentpool.prev + GI->max_tents;
 	CL_ClearTempEnts();
 
 	// load tempent sprites (glowshell, muzzleflashes etc)
@@ -218,6 +243,118 @@ void CL_FreeTempEnts( void )
 	if( cl_tempents )
 		Mem_Free( cl_tempents );
 	cl_tempents = NULL;
+
+	if( cl_tentpool.prev )
+		Mem_Free( cl_tentpool.prev );
+	memset( &cl_tentpool, 0, sizeof( cl_tentpool ));
+}
+
+/*
+==============
+CL_TempEntLinkActive
+
+put tent at the head of active list
+==============
+*/
+static void CL_TempEntLinkActive( TEMPENTITY *pTemp )
+{
+	int	idx = pTemp - cl_tempents;
+
+	if( cl_tentpool.clientowned )
+	{
+		// links are rebuilt when client is done with the list
+		pTemp->next = cl_active_tents;
+		cl_active_tents = pTemp;
+		cl_tentpool.numactive++;
+		cl_tentpool.peakactive = Q_max( cl_tentpool.peakactive, cl_tentpool.numactive );
+		return;
+	}
+
+	cl_tentpool.prev[idx] = -1;
+	if( cl_active_tents )
+		cl_tentpool.prev[cl_active_tents - cl_tempents] = idx;
+
+	pTemp->next = cl_active_tents;
+	cl_active_tents = pTemp;
+
+	if( pTemp->priority == TENTPRIORITY_LOW )
+		cl_tentpool.lowstack[cl_tentpool.numlow++] = idx;
+
+	cl_tentpool.numactive++;
+	cl_tentpool.peakactive = Q_max( cl_tentpool.peakactive, cl_tentpool.numactive );
+}
+
+/*
+==============
+CL_TempEntUnlinkActive
+
+remove tent from active list without walking it
+==============
+*/
+static void CL_TempEntUnlinkActive( TEMPENTITY *pTemp )
+{
+	int	idx = pTemp - cl_tempents;
+	int	prev = cl_tentpool.prev[idx];
+
+	if( prev < 0 ) cl_active_tents = pTemp->next;
+	else cl_tempents[prev].next = pTemp->next;
+
+	if( pTemp->next )
+		cl_tentpool.prev[pTemp->next - cl_tempents] = prev;
+
+	cl_tentpool.numactive--;
+}
+
+/*
+==============
+CL_TempEntRebuildLinks
+
+sync shadow links with lists that client.dll has changed
+==============
+*/
+static void CL_TempEntRebuildLinks( void )
+{
+	TEMPENTITY	*pTemp;
+	int		i, prev = -1;
+
+	cl_tentpool.numlow = 0;
+	cl_tentpool.numactive = 0;
+
+	for( pTemp = cl_active_tents; pTemp; pTemp = pTemp->next )
+	{
+		int idx = pTemp - cl_tempents;
+
+		cl_tentpool.prev[idx] = prev;
+		prev = idx;
+
+		if( pTemp->priority == TENTPRIORITY_LOW )
+			cl_tentpool.lowstack[cl_tentpool.numlow++] = idx;
+
+		cl_tentpool.numactive++;
+	}
+
+	// reverse, so most recently allocated tents will be on top
+	for( i = 0; i < cl_tentpool.numlow / 2; i++ )
+	{
+		int tmp = cl_tentpool.lowstack[i];
+		cl_tentpool.lowstack[i] = cl_tentpool.lowstack[cl_tentpool.numlow - 1 - i];
+		cl_tentpool.lowstack[cl_tentpool.numlow - 1 - i] = tmp;
+	}
+}
+
+/*
+==============
+CL_TempEntStats_f
+
+==============
+*/
+void CL_TempEntStats_f( void )
+{
+	Con_Printf( "tempents: %i active, %i peak, %i max\n", cl_tentpool.numactive, cl_tentpool.peakactive, GI->max_tents );
+	Con_Printf( "low priority: %i\n", cl_tentpool.numlow );
+	Con_Printf( "allocations: %u, high priority: %u\n", cl_tentpool.allocs, cl_tentpool.allocs_high );
+	Con_Printf( "overflows: %u, evicted low priority: %u\n", cl_tentpool.overflows, cl_tentpool.evicted );
+	Con_Printf( "culled by PVS in last update: %u\n", cl_tentpool.culled );
 }
 
 /*
@@ -381,6 +518,8 @@ static int CL_TempEntAddEntity( cl_entity_t *pEntity )
 		return 1;
 	}
 
+	cl_tentpool.culled++;
+
 	return 0;
 }
 
@@ -397,38 +536,66 @@ void CL_TempEntUpdate( void )
 	double	ft = cl.time - cl.oldtime;
 	float	gravity = clgame.movevars.gravity;
 
+	cl_tentpool.culled = 0;
+
+	cl_tentpool.clientowned = true;
 	clgame.dllFuncs.pfnTempEntUpdate( ft, cl.time, gravity, &cl_free_tents, &cl_active_tents, CL_TempEntAddEntity, CL_TempEntPlaySound );
+	cl_tentpool.clientowned = false;
+
+	CL_TempEntRebuildLinks();
 }
 
 /*
 ==============
-CL_TEntAddEntity
+CL_FreeLowPriorityTempEnt
 
-free the first low priority tempent it finds.
+free the most recent low priority tempent
 ==============
 */
 static qboolean CL_FreeLowPriorityTempEnt( void )
 {
-	TEMPENTITY	*pActive = cl_active_tents;
-	TEMPENTITY	*pPrev = NULL;
-
-	while( pActive )
+	if( cl_tentpool.clientowned )
 	{
-		if( pActive->priority == TENTPRIORITY_LOW )
+		TEMPENTITY	*pActive = cl_active_tents;
+		TEMPENTITY	*pPrev = NULL;
+
+		// client is relinking the list right now, walk it
+		for( ; pActive; pPrev = pActive, pActive = pActive->next )
 		{
-			// remove from the active list.
+			if( pActive->priority != TENTPRIORITY_LOW )
+				continue;
+
 			if( pPrev ) pPrev->next = pActive->next;
 			else cl_active_tents = pActive->next;
 
-			// add to the free list.
 			pActive->next = cl_free_tents;
 			cl_free_tents = pActive;
+			cl_tentpool.numactive--;
+			cl_tentpool.evicted++;
 
 			return true;
 		}
 
-		pPrev = pActive;
-		pActive = pActive->next;
+		return false;
+	}
+
+	while( cl_tentpool.numlow > 0 )
+	{
+		TEMPENTITY *pActive = &cl_tempents[cl_tentpool.lowstack[--cl_tentpool.numlow]];
+
+		// client may raise priority after allocation
+		if( pActive->priority != TENTPRIORITY_LOW )
+			continue;
+
+		// remove from the active list.
+		CL_TempEntUnlinkActive( pActive );
+
+		// add to the free list.
+		pActive->next = cl_free_tents;
+		cl_free_tents = pActive;
+		cl_tentpool.evicted++;
+
+		return true;
 	}
 
 	return false;
@@ -448,6 +615,7 @@ TEMPENTITY *CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 
 	if( !cl_free_tents )
 	{
+		cl_tentpool.overflows++;
 		if( cl_lasttimewarn < host.realtime )
 		{
 			Con_DPrintf( "Overflow %d temporary ents!\n", GI->max_tents );
@@ -464,8 +632,8 @@ TEMPENTITY *CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 	pTemp->priority = TENTPRIORITY_LOW;
 	if( org ) VectorCopy( org, pTemp->entity.origin );
 
-	pTemp->next = cl_active_tents;
-	cl_active_tents = pTemp;
+	CL_TempEntLinkActive( pTemp );
+	cl_tentpool.allocs++;
 
 	return pTemp;
 }
@@ -492,6 +660,7 @@ TEMPENTITY *CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 	{
 		// didn't find anything? The tent list is either full of high-priority tents
 		// or all tents in the list are still due to live for > 10 seconds.
+		cl_tentpool.overflows++;
 		Con_DPrintf( "Couldn't alloc a high priority TENT!\n" );
 		return NULL;
 	}
@@ -505,8 +674,8 @@ TEMPENTITY *CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 	pTemp->priority = TENTPRIORITY_HIGH;
 	if( org ) VectorCopy( org, pTemp->entity.origin );
 
-	pTemp->next = cl_active_tents;
-	cl_active_tents = pTemp;
+	CL_TempEntLinkActive( pTemp );
+	cl_tentpool.allocs_high++;
 
 	return pTemp;
 }
@@ -1075,6 +1075,7 @@ void CL_FreeParticles( void );
 void CL_InitTempEnts( void );
 void CL_FreeTempEnts( void );
 void CL_TempEntUpdate( void );
+void CL_TempEntStats_f( void );
 void CL_InitViewBeams( void );
 void CL_ClearViewBeams( void );
 void CL_FreeViewBeams( void );
@@ -1085,6 +1086,7 @@ void CL_LoadClientSprites( void );
 void CL_ReadPointFile_f( void );
 void CL_DrawEFX( float time, qboolean fTrans );
 void CL_ThinkParticle( double frametime, particle_t *p );
+void CL_ThinkParticles( double frametime, particle_t *particles );
 void CL_ReadLineFile_f( void );
 
 //
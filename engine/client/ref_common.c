@@ -437,6 +437,9 @@ static const ref_api_t gEngfuncs =
 	XVK_GetInstanceExtensions,
 	XVK_GetVkGetInstanceProcAddr,
 	XVK_CreateSurface,
+
+	COM_ParallelFor,
+	COM_NumJobThreads,
 };
 
 static void R_UnloadProgs( void )
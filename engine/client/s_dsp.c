@@ -190,6 +190,12 @@ static int			sxmod1cur, sxmod2cur;
 static int			sxmod1, sxmod2;
 static int			sxhires;
 
+// settings for the mixer, it may run on its own thread and must not read cvars
+static qboolean			sxactive;
+static qboolean			sxalpha;	// alpha 0.52 reverb level
+static qboolean			sxlowpass;
+static qboolean			sxmodulate;
+
 static portable_samplepair_t	*paintto = NULL;
 
 static dly_t			rgsxdly[MAXDLY]; // stereo is last
@@ -720,7 +726,7 @@ static void RVB_DoReverb( int count )
 		voutm = RVB_DoReverbForOneDly( dly1, vlr, paint );
 		voutm += RVB_DoReverbForOneDly( dly2, vlr, paint );
 
-		if( dsp_coeff_table.value == 1.0f )
+		if( sxalpha )
 			voutm /= 6; // alpha
 		else voutm = (11 * voutm) >> 6;
 
@@ -740,14 +746,14 @@ static void RVB_DoAMod( int count )
 {
 	portable_samplepair_t	*paint = paintto;
 
-	if( !sxmod_lowpass.value && !sxmod_mod.value )
+	if( !sxlowpass && !sxmodulate )
 		return;
 
 	for( ; count; count--, paint++ )
 	{
 		portable_samplepair_t	res = *paint;
 
-		if( sxmod_lowpass.value )
+		if( sxlowpass )
 		{
 			res.left  = rgsxlp[0] + rgsxlp[1] + rgsxlp[2] + rgsxlp[3] + rgsxlp[4] + res.left;
 			res.right = rgsxlp[5] + rgsxlp[6] + rgsxlp[7] + rgsxlp[8] + rgsxlp[9] + res.right;
@@ -769,7 +775,7 @@ static void RVB_DoAMod( int count )
 			rgsxlp[8] = rgsxlp[9];
 		}
 
-		if( sxmod_mod.value )
+		if( sxmodulate )
 		{
 			if( --sxmod1cur < 0 )
 				sxmod1cur = sxmod1;
@@ -811,7 +817,7 @@ DSP_Process
 */
 void DSP_Process( portable_samplepair_t *pbfront, int sampleCount )
 {
-	if( dsp_off.value || room_off.value || !sampleCount )
+	if( !sxactive || !sampleCount )
 		return;
 
 	// preset is already installed by CheckNewDspPresets
@@ -836,16 +842,33 @@ void DSP_ClearState( void )
 	SX_ReloadRoomFX();
 }
 
+/*
+===========
+SX_UpdateMixerState
+
+copies cvars used while painting
+===========
+*/
+static void SX_UpdateMixerState( void )
+{
+	sxalpha = ptable == rgsxpre_hlalpha052;
+	sxlowpass = sxmod_lowpass.value != 0.0f;
+	sxmodulate = sxmod_mod.value != 0.0f;
+}
+
 /*
 ===========
 CheckNewDspPresets
 
 (xash dsp interface)
+must be called by main thread with sound lock held
 ===========
 */
 void CheckNewDspPresets( void )
 {
-	if( dsp_off.value || room_off.value )
+	sxactive = !dsp_off.value && !room_off.value;
+
+	if( !sxactive )
 		return;
 
 	if( FBitSet( dsp_coeff_table.flags, FCVAR_CHANGED ))
@@ -883,7 +906,10 @@ void CheckNewDspPresets( void )
 	}
 
 	if( idsp_room == room_typeprev && idsp_room == 0 )
+	{
+		SX_UpdateMixerState();
 		return;
+	}
 
 	if( idsp_room != room_typeprev )
 	{
@@ -911,6 +937,8 @@ void CheckNewDspPresets( void )
 	ClearBits( sxrvb_size.flags, FCVAR_CHANGED );
 	ClearBits( sxdly_delay.flags, FCVAR_CHANGED );
 	ClearBits( sxste_delay.flags, FCVAR_CHANGED );
+
+	SX_UpdateMixerState();
 }
 
 static void SX_Profiling_f( void )
@@ -926,6 +954,9 @@ static void SX_Profiling_f( void )
 		testbuffer[i].right = COM_RandomLong( 0, 3000 );
 	}
 
+	// keep mixer thread away from delay lines
+	S_LockSound();
+
 	if( Cmd_Argc() > 1 )
 	{
 		Cvar_DirectSetValue( &room_type, Q_atof( Cmd_Argv( 1 )));
@@ -950,4 +981,6 @@ static void SX_Profiling_f( void )
 		SX_ReloadRoomFX();
 		CheckNewDspPresets();
 	}
+
+	S_UnlockSound();
 }
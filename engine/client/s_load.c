@@ -24,15 +24,22 @@ GNU General Public License for more details.
 #define MAX_SFX		8192
 #define MAX_SFX_HASH	(MAX_SFX/4)
 
+// bump when S_NormalizeSound output changes
+#define SOUND_CACHE_VARIANT	1
+
 static int	s_numSfx = 0;
 static sfx_t	s_knownSfx[MAX_SFX];
 static sfx_t	*s_sfxHashList[MAX_SFX_HASH];
 static string	s_sentenceImmediateName;	// keep dummy sentence name
 qboolean		s_registering = false;
 
+static size_t	s_cachedBytes = 0;	// decoded sound data currently resident
+
 /*
 =================
 S_SoundList_f
+
+R - resident, E - evicted to fit into s_cachesize, D - deferred until first play
 =================
 */
 void S_SoundList_f( void )
@@ -40,10 +47,14 @@ void S_SoundList_f( void )
 	sfx_t		*sfx;
 	wavdata_t		*sc;
 	int		i, totalSfx = 0;
-	int		totalSize = 0;
+	int		totalEvicted = 0;
+	size_t		totalSize = 0;
 
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
+		const char	*prefix;
+		char		state;
+
 		if( !sfx->name[0] )
 			continue;
 
@@ -51,23 +62,40 @@ void S_SoundList_f( void )
 		if( sc )
 		{
 			totalSize += sc->size;
+			totalSfx++;
+			state = 'R';
+		}
+		else if( sfx->evictions )
+		{
+			totalEvicted++;
+			state = 'E';
+		}
+		else if( sfx->deferred )
+			state = 'D';
+		else state = ' ';
 
-			if( FBitSet( sc->flags, SOUND_LOOPED ))
-				Con_Printf( "L" );
-			else
-				Con_Printf( " " );
+		if( sfx->name[0] == '*' || !Q_strncmp( sfx->name, DEFAULT_SOUNDPATH, sizeof( DEFAULT_SOUNDPATH ) - 1 ))
+			prefix = "";
+		else prefix = DEFAULT_SOUNDPATH;
 
-			if( sfx->name[0] == '*' || !Q_strncmp( sfx->name, DEFAULT_SOUNDPATH, sizeof( DEFAULT_SOUNDPATH ) - 1 ))
-				Con_Printf( " (%2db) %s : %s\n", sc->width * 8, Q_memprint( sc->size ), sfx->name );
-			else Con_Printf( " (%2db) %s : " DEFAULT_SOUNDPATH "%s\n", sc->width * 8, Q_memprint( sc->size ), sfx->name );
-			totalSfx++;
+		if( sc )
+		{
+			Con_Printf( "%c %c (%2db) %s %3i/%-3i : %s%s\n", FBitSet( sc->flags, SOUND_LOOPED ) ? 'L' : ' ', state,
+				sc->width * 8, Q_memprint( sc->size ), sfx->loads, sfx->evictions, prefix, sfx->name );
+		}
+		else
+		{
+			Con_Printf( "  %c ( --) %s %3i/%-3i : %s%s\n", state,
+				sfx->size ? Q_memprint( sfx->size ) : "  unknown", sfx->loads, sfx->evictions, prefix, sfx->name );
 		}
 	}
 
 	Con_Printf( "-------------------------------------------\n" );
-	Con_Printf( "%i total sounds\n", totalSfx );
-	Con_Printf( "%s total memory\n", Q_memprint( totalSize ));
-	Con_Printf( "\n" );
+	Con_Printf( "%i total sounds, %i evicted\n", totalSfx, totalEvicted );
+	Con_Printf( "%s total memory", Q_memprint( totalSize ));
+	if( s_cachesize.value > 0.0f )
+		Con_Printf( " of %s budget", Q_memprint( s_cachesize.value * 1024 * 1024 ));
+	Con_Printf( "\n\n" );
 }
 
 // return true if char 'c' is one of 1st 2 characters in pch
@@ -123,9 +151,180 @@ static wavdata_t *S_CreateDefaultSound( void )
 	return sc;
 }
 
+/*
+=================
+S_SoundFileSize
+
+size of sound file on disk, -1 if it's missing
+=================
+*/
+static fs_offset_t S_SoundFileSize( const sfx_t *sfx )
+{
+	const char	*name = sfx->name;
+	fs_offset_t	size;
+
+	if( name[0] == '*' )
+		name++;
+
+	size = FS_FileSize( va( DEFAULT_SOUNDPATH "%s", name ), false );
+	if( size < 0 )
+		size = FS_FileSize( name, false );
+
+	return size;
+}
+
+/*
+=================
+S_TrimSoundCache
+
+unloads least recently used sounds until decoded data fits
+into s_cachesize, never touches sounds referenced by channels
+=================
+*/
+static void S_TrimSoundCache( void )
+{
+	channel_t	*ch;
+	size_t	budget;
+	int	i, j;
+
+	if( s_cachesize.value <= 0.0f )
+		return;
+
+	budget = s_cachesize.value * 1024 * 1024;
+
+	if( s_cachedBytes <= budget )
+		return;
+
+	S_LockSound();
+
+	// sounds used during this frame are kept, including the one
+	// that was just loaded, so mark everything channels are holding on to
+	for( i = 0, ch = channels; i < total_channels; i++, ch++ )
+	{
+		if( !ch->sfx )
+			continue;
+
+		ch->sfx->lastused = host.realtime;
+
+		if( !ch->isSentence )
+			continue;
+
+		for( j = 0; j < ARRAYSIZE( ch->words ) && ch->words[j].sfx; j++ )
+			ch->words[j].sfx->lastused = host.realtime;
+	}
+
+	while( s_cachedBytes > budget )
+	{
+		sfx_t	*sfx, *victim = NULL;
+
+		// entry 0 is default sound, it's never unloaded
+		for( i = 1, sfx = s_knownSfx + 1; i < s_numSfx; i++, sfx++ )
+		{
+			if( !sfx->cache || sfx->lastused >= host.realtime )
+				continue;
+
+			if( !victim || sfx->lastused < victim->lastused )
+				victim = sfx;
+		}
+
+		// everything left is playing
+		if( !victim )
+			break;
+
+		S_UnloadSound( victim );
+		victim->evictions++;
+	}
+
+	S_UnlockSound();
+}
+
+/*
+=================
+S_NormalizeSound
+
+bring sound to one of the rates mixer works with
+=================
+*/
+static qboolean S_NormalizeSound( wavdata_t **sc )
+{
+	int rate = (*sc)->rate;
+
+	if( rate < SOUND_11k ) // some bad sounds
+		return Sound_Process( sc, SOUND_11k, (*sc)->width, (*sc)->channels, SOUND_RESAMPLE );
+	else if( rate > SOUND_11k && rate < SOUND_22k ) // some bad sounds
+		return Sound_Process( sc, SOUND_22k, (*sc)->width, (*sc)->channels, SOUND_RESAMPLE );
+	else if( rate > SOUND_22k && rate != SOUND_44k ) // some bad sounds
+		return Sound_Process( sc, SOUND_44k, (*sc)->width, (*sc)->channels, SOUND_RESAMPLE );
+
+	return false;
+}
+
+/*
+=================
+S_LoadSoundFile
+
+decodes and normalizes sound, going through decoded
+sound cache if it's enabled. Plain wav files that don't
+need resampling aren't stored, reading them is as fast as
+reading cache entry
+=================
+*/
+static wavdata_t *S_LoadSoundFile( const char *name )
+{
+	const char	*ext = COM_FileExtension( name );
+	string		loadname;
+	uint32_t		key[2];
+	fs_offset_t	filesize;
+	qboolean		cacheable;
+	wavdata_t		*sc;
+	byte		*buffer;
+
+	if( !COM_CheckStringEmpty( ext ))
+	{
+		sc = FS_LoadSound( name, NULL, 0 );
+		if( sc ) S_NormalizeSound( &sc );
+		return sc;
+	}
+
+	buffer = FS_LoadFile( va( DEFAULT_SOUNDPATH "%s", name ), &filesize, false );
+	if( !buffer )
+		buffer = FS_LoadFile( name, &filesize, false );
+
+	if( !buffer )
+		return NULL;
+
+	cacheable = Sound_CacheKey( ext, buffer, filesize, SOUND_CACHE_VARIANT, key );
+
+	if( cacheable && ( sc = Sound_CacheLoad( key )) != NULL )
+	{
+		Mem_Free( buffer );
+		return sc;
+	}
+
+	// '#' makes soundlib use the buffer as is
+	Q_snprintf( loadname, sizeof( loadname ), "#%s", name );
+	sc = FS_LoadSound( loadname, buffer, filesize );
+	Mem_Free( buffer );
+
+	if( !sc )
+		return NULL;
+
+	if( S_NormalizeSound( &sc ) || Q_stricmp( ext, "wav" ))
+	{
+		if( cacheable )
+			Sound_CacheStore( key, sc );
+	}
+
+	return sc;
+}
+
 /*
 =================
 S_LoadSound
+
+sound is decoded without holding the sound lock, it's only taken
+to publish the result, so main thread must not hold it while calling
+this for a sound that may not be loaded yet
 =================
 */
 wavdata_t *S_LoadSound( sfx_t *sfx )
@@ -134,6 +333,8 @@ wavdata_t *S_LoadSound( sfx_t *sfx )
 
 	if( !sfx ) return NULL;
 
+	sfx->lastused = host.realtime;
+
 	// see if still in memory
 	if( sfx->cache )
 		return sfx->cache;
@@ -145,28 +346,76 @@ wavdata_t *S_LoadSound( sfx_t *sfx )
 	if( Q_stricmp( sfx->name, "*default" ))
 	{
 		// load it from disk
-		if( s_warn_late_precache.value > 0 && cls.state == ca_active )
+		if( s_warn_late_precache.value > 0 && cls.state == ca_active && !sfx->loads && !sfx->deferred )
 			Con_Printf( S_WARN "%s: late precache of %s\n", __func__, sfx->name );
 
 		if( sfx->name[0] == '*' )
-			sc = FS_LoadSound( sfx->name + 1, NULL, 0 );
-		else sc = FS_LoadSound( sfx->name, NULL, 0 );
+			sc = S_LoadSoundFile( sfx->name + 1 );
+		else sc = S_LoadSoundFile( sfx->name );
 	}
 
 	if( !sc ) sc = S_CreateDefaultSound();
 
-	if( sc->rate < SOUND_11k ) // some bad sounds
-		Sound_Process( &sc, SOUND_11k, sc->width, sc->channels, SOUND_RESAMPLE );
-	else if( sc->rate > SOUND_11k && sc->rate < SOUND_22k ) // some bad sounds
-		Sound_Process( &sc, SOUND_22k, sc->width, sc->channels, SOUND_RESAMPLE );
-	else if( sc->rate > SOUND_22k && sc->rate != SOUND_44k ) // some bad sounds
-		Sound_Process( &sc, SOUND_44k, sc->width, sc->channels, SOUND_RESAMPLE );
-
+	S_LockSound();
 	sfx->cache = sc;
+	sfx->size = sc->size;
+	sfx->loads++;
+	s_cachedBytes += sc->size;
+	S_UnlockSound();
+
+	S_TrimSoundCache();
 
 	return sfx->cache;
 }
 
+/*
+=================
+S_UnloadSound
+
+drops decoded data, sound stays registered
+and will be loaded again on next use
+=================
+*/
+void S_UnloadSound( sfx_t *sfx )
+{
+	if( !sfx || !sfx->cache )
+		return;
+
+	S_LockSound();
+
+	s_cachedBytes -= sfx->cache->size;
+	FS_FreeSound( sfx->cache );
+	sfx->cache = NULL;
+
+	S_UnlockSound();
+}
+
+/*
+=================
+S_ShouldPreloadSound
+=================
+*/
+static qboolean S_ShouldPreloadSound( const sfx_t *sfx )
+{
+	if( sfx->cache || sfx->name[0] == '*' )
+		return true;
+
+	// leave the rest for on demand loading
+	if( s_cachesize.value > 0.0f && s_cachedBytes >= s_cachesize.value * 1024 * 1024 )
+		return false;
+
+	if( s_largesound.value > 0.0f )
+	{
+		// prefer decoded size if it was loaded before
+		if( sfx->size )
+			return sfx->size <= s_largesound.value * 1024;
+
+		return S_SoundFileSize( sfx ) <= s_largesound.value * 1024;
+	}
+
+	return true;
+}
+
 // =======================================================================
 // Load a sound
 // =======================================================================
@@ -262,8 +511,7 @@ void S_FreeSound( sfx_t *sfx )
 		prev = &hashSfx->hashNext;
 	}
 
-	if( sfx->cache )
-		FS_FreeSound( sfx->cache );
+	S_UnloadSound( sfx );
 	memset( sfx, 0, sizeof( *sfx ));
 }
 
@@ -301,11 +549,13 @@ S_EndRegistration
 void S_EndRegistration( void )
 {
 	sfx_t	*sfx;
-	int	i;
+	int	i, deferred = 0;
 
 	if( !s_registering || !dma.initialized )
 		return;
 
+	S_LockSound();
+
 	// free any sounds not from this registration sequence
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
@@ -316,14 +566,26 @@ void S_EndRegistration( void )
 			S_FreeSound( sfx ); // don't need this sound
 	}
 
-	// load everything in
+	S_UnlockSound();
+
+	// load everything in, large sounds and what doesn't fit
+	// into cache budget will be loaded on first play, mixer
+	// keeps running meanwhile
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
 		if( !sfx->name[0] )
 			continue;
-		S_LoadSound( sfx );
+
+		sfx->deferred = !S_ShouldPreloadSound( sfx );
+
+		if( sfx->deferred )
+			deferred++;
+		else S_LoadSound( sfx );
 	}
 	s_registering = false;
+
+	if( deferred )
+		Con_Reportf( "%s: %i sounds deferred, %s resident\n", __func__, deferred, Q_memprint( s_cachedBytes ));
 }
 
 /*
@@ -349,10 +611,18 @@ sound_t S_RegisterSound( const char *name )
 	if( name[0] == '/' || name[0] == '\\' ) name++;
 	if( name[0] == '/' || name[0] == '\\' ) name++;
 
+	S_LockSound();
+
 	sfx = S_FindName( name, NULL );
-	if( !sfx ) return -1;
+	if( !sfx )
+	{
+		S_UnlockSound();
+		return -1;
+	}
 
 	sfx->servercount = cl.servercount;
+	S_UnlockSound();
+
 	if( !s_registering ) S_LoadSound( sfx );
 
 	return sfx - s_knownSfx;
@@ -386,6 +656,9 @@ void S_InitSounds( void )
 	s_knownSfx->hashNext = s_sfxHashList[s_knownSfx->hashValue];
 	s_sfxHashList[s_knownSfx->hashValue] = s_knownSfx;
 	s_knownSfx->cache = S_CreateDefaultSound();
+	s_knownSfx->size = s_knownSfx->cache->size;
+	s_knownSfx->loads = 1;
+	s_cachedBytes += s_knownSfx->size;
 	s_numSfx = 1;
 }
 
@@ -402,6 +675,8 @@ void S_FreeSounds( void )
 	if( !dma.initialized )
 		return;
 
+	S_LockSound();
+
 	// stop all sounds
 	S_StopAllSounds( true );
 
@@ -413,4 +688,7 @@ void S_FreeSounds( void )
 	memset( s_sfxHashList, 0, sizeof( s_sfxHashList ));
 
 	s_numSfx = 0;
+	s_cachedBytes = 0;
+
+	S_UnlockSound();
 }
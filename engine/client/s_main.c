@@ -37,9 +37,11 @@ int   		paintedtime; 	// sample PAIRS
 
 static CVAR_DEFINE( s_volume, "volume", "0.7", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "sound volume" );
 CVAR_DEFINE( s_musicvolume, "MP3Volume", "1.0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "background music volume" );
-static CVAR_DEFINE( s_mixahead, "_snd_mixahead", "0.12", FCVAR_FILTERABLE, "how much sound to mix ahead of time" );
+CVAR_DEFINE( s_mixahead, "_snd_mixahead", "0.12", FCVAR_FILTERABLE, "how much sound to mix ahead of time" );
 static CVAR_DEFINE_AUTO( s_show, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "show playing sounds" );
 CVAR_DEFINE_AUTO( s_lerping, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "apply interpolation to sound output" );
+CVAR_DEFINE_AUTO( s_mix_simd, "1", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "use vectorized mixing code when available" );
+static CVAR_DEFINE_AUTO( s_mixthread, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "mix sound in a separate thread, allows lower _snd_mixahead" );
 static CVAR_DEFINE( s_ambient_level, "ambient_level", "0.3", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "volume of environment noises (water and wind)" );
 static CVAR_DEFINE( s_ambient_fade, "ambient_fade", "1000", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "rate of volume fading when client is moving" );
 static CVAR_DEFINE_AUTO( s_combine_sounds, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "combine channels with same sounds" );
@@ -47,6 +49,8 @@ CVAR_DEFINE_AUTO( snd_mute_losefocus, "1", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "sile
 CVAR_DEFINE_AUTO( s_test, "0", 0, "engine developer cvar for quick testing new features" );
 CVAR_DEFINE_AUTO( s_samplecount, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "sample count (0 for default value)" );
 CVAR_DEFINE_AUTO( s_warn_late_precache, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "warn about late precached sounds on client-side" );
+CVAR_DEFINE_AUTO( s_cachesize, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "sound cache budget in megabytes, unused sounds are unloaded above it (0 is unlimited)" );
+CVAR_DEFINE_AUTO( s_largesound, "0", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "sound files larger than this many kilobytes are loaded on first play instead of level start (0 to disable)" );
 
 /*
 =============================================================================
@@ -537,6 +541,25 @@ static void SND_Spatialize( channel_t *ch )
 	VOX_SetChanVol( ch );
 }
 
+/*
+=================
+S_PreloadSound
+
+loads sound data before sound lock is taken, so mixer
+thread doesn't wait for the disk, without mixer thread
+sounds are loaded on demand as usual
+=================
+*/
+static void S_PreloadSound( sfx_t *sfx )
+{
+	if( !S_MixerThreadActive( ))
+		return;
+
+	if( S_TestSoundChar( sfx->name, '!' ))
+		VOX_PreloadSound( S_SkipSoundChar( sfx->name ));
+	else S_LoadSound( sfx );
+}
+
 /*
 ====================
 S_StartSound
@@ -568,12 +591,19 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 	vol = bound( 0, fvol * 255, 255 );
 	if( pitch <= 1 ) pitch = PITCH_NORM; // Invasion issues
 
+	if( !FBitSet( flags, SND_STOP ))
+		S_PreloadSound( sfx );
+
+	S_LockSound();
+
 	if( flags & ( SND_STOP|SND_CHANGE_VOL|SND_CHANGE_PITCH ))
 	{
-		if( S_AlterChannel( ent, chan, sfx, vol, pitch, flags ))
+		if( S_AlterChannel( ent, chan, sfx, vol, pitch, flags ) || ( flags & SND_STOP ))
+		{
+			S_UnlockSound();
 			return;
+		}
 
-		if( flags & SND_STOP ) return;
 		// fall through - if we're not trying to stop the sound,
 		// and we didn't find it (it's not playing), go ahead and start it up
 	}
@@ -589,6 +619,8 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 
 	if( !target_chan )
 	{
+		S_UnlockSound();
+
 		if( !bIgnore )
 			Con_DPrintf( S_ERROR "dropped sound \"" DEFAULT_SOUNDPATH "%s\"\n", sfx->name );
 		return;
@@ -633,6 +665,7 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 	if( !pSource )
 	{
 		S_FreeChannel( target_chan );
+		S_UnlockSound();
 		return;
 	}
 
@@ -650,6 +683,7 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 			if( chan != CHAN_STREAM )
 			{
 				S_FreeChannel( target_chan );
+				S_UnlockSound();
 				return; // not audible at all
 			}
 		}
@@ -657,6 +691,8 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 
 	// Init client entity mouth movement vars
 	SND_InitMouth( ent, chan );
+
+	S_UnlockSound();
 }
 
 /*
@@ -681,12 +717,19 @@ void S_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float
 	vol = bound( 0, fvol * 255, 255 );
 	if( pitch <= 1 ) pitch = PITCH_NORM; // Invasion issues
 
+	if( !FBitSet( flags, SND_STOP ))
+		S_PreloadSound( sfx );
+
+	S_LockSound();
+
 	// pick a channel to play on
 	if( chan == CHAN_STATIC ) target_chan = SND_PickStaticChannel( pos, sfx );
 	else target_chan = SND_PickDynamicChannel( ent, chan, sfx, &bIgnore );
 
 	if( !target_chan )
 	{
+		S_UnlockSound();
+
 		if( !bIgnore )
 			Con_DPrintf( S_ERROR "dropped sound \"" DEFAULT_SOUNDPATH "%s\"\n", sfx->name );
 		return;
@@ -749,6 +792,7 @@ void S_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float
 	if( !pSource )
 	{
 		S_FreeChannel( target_chan );
+		S_UnlockSound();
 		return;
 	}
 
@@ -763,6 +807,8 @@ void S_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float
 
 	// Init client entity mouth movement vars
 	SND_InitMouth( ent, chan );
+
+	S_UnlockSound();
 }
 
 /*
@@ -793,16 +839,27 @@ void S_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, floa
 	vol = bound( 0, fvol * 255, 255 );
 	if( pitch <= 1 ) pitch = PITCH_NORM; // Invasion issues
 
+	if( !FBitSet( flags, SND_STOP ))
+		S_PreloadSound( sfx );
+
+	S_LockSound();
+
 	if( flags & (SND_STOP|SND_CHANGE_VOL|SND_CHANGE_PITCH))
 	{
-		if( S_AlterChannel( ent, CHAN_STATIC, sfx, vol, pitch, flags ))
+		if( S_AlterChannel( ent, CHAN_STATIC, sfx, vol, pitch, flags ) || ( flags & SND_STOP ))
+		{
+			S_UnlockSound();
 			return;
-		if( flags & SND_STOP ) return;
+		}
 	}
 
 	// pick a channel to play on from the static area
 	ch = SND_PickStaticChannel( pos, sfx );
-	if( !ch ) return;
+	if( !ch )
+	{
+		S_UnlockSound();
+		return;
+	}
 
 	VectorCopy( pos, ch->origin );
 	ch->entnum = ent;
@@ -835,6 +892,7 @@ void S_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, floa
 	if( !pSource )
 	{
 		S_FreeChannel( ch );
+		S_UnlockSound();
 		return;
 	}
 
@@ -850,6 +908,8 @@ void S_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, floa
 	ch->basePitch = pitch;
 
 	SND_Spatialize( ch );
+
+	S_UnlockSound();
 }
 
 /*
@@ -885,6 +945,8 @@ int S_GetCurrentStaticSounds( soundlist_t *pout, int size )
 	if( !dma.initialized )
 		return 0;
 
+	S_LockSound();
+
 	for( i = MAX_DYNAMIC_CHANNELS; i < total_channels && sounds_left; i++ )
 	{
 		if( channels[i].entchannel == CHAN_STATIC && channels[i].sfx && channels[i].sfx->name[0] )
@@ -908,6 +970,8 @@ int S_GetCurrentStaticSounds( soundlist_t *pout, int size )
 		}
 	}
 
+	S_UnlockSound();
+
 	return ( size - sounds_left );
 }
 
@@ -926,6 +990,8 @@ int S_GetCurrentDynamicSounds( soundlist_t *pout, int size )
 	if( !dma.initialized )
 		return 0;
 
+	S_LockSound();
+
 	for( i = 0; i < MAX_CHANNELS && sounds_left; i++ )
 	{
 		if( !channels[i].sfx || !channels[i].sfx->name[0] || !Q_stricmp( channels[i].sfx->name, "*default" ))
@@ -954,6 +1020,8 @@ int S_GetCurrentDynamicSounds( soundlist_t *pout, int size )
 		pout++;
 	}
 
+	S_UnlockSound();
+
 	return ( size - sounds_left );
 }
 
@@ -1184,13 +1252,20 @@ void S_RawEntSamples( int entnum, uint samples, uint rate, word width, word chan
 	if( snd_vol < 0 )
 		snd_vol = 0;
 
+	S_LockSound();
+
 	if( !( ch = S_FindRawChannel( entnum, true )))
+	{
+		S_UnlockSound();
 		return;
+	}
 
 	ch->master_vol = snd_vol;
 	ch->dist_mult = (ATTN_NONE / SND_CLIP_DISTANCE);
 	ch->s_rawend = S_RawSamplesStereo( ch->rawsamples, ch->s_rawend, ch->max_samples, samples, rate, width, channels, data );
 	ch->leftvol = ch->rightvol = snd_vol;
+
+	S_UnlockSound();
 }
 
 /*
@@ -1359,8 +1434,11 @@ void GAME_EXPORT S_StopSound( int entnum, int channel, const char *soundname )
 	sfx_t	*sfx;
 
 	if( !dma.initialized ) return;
+
+	S_LockSound();
 	sfx = S_FindName( soundname, NULL );
 	S_AlterChannel( entnum, channel, sfx, 0, 0, SND_STOP );
+	S_UnlockSound();
 }
 
 /*
@@ -1373,6 +1451,9 @@ void S_StopAllSounds( qboolean ambient )
 	int	i;
 
 	if( !dma.initialized ) return;
+
+	S_LockSound();
+
 	total_channels = MAX_DYNAMIC_CHANNELS;	// no statics
 
 	for( i = 0; i < MAX_CHANNELS; i++ )
@@ -1393,6 +1474,8 @@ void S_StopAllSounds( qboolean ambient )
 
 	// clear any remaining soundfade
 	memset( &soundfade, 0, sizeof( soundfade ));
+
+	S_UnlockSound();
 }
 
 /*
@@ -1435,7 +1518,7 @@ static int S_GetSoundtime( void )
 }
 
 //=============================================================================
-static void S_UpdateChannels( void )
+void S_UpdateChannels( void )
 {
 	uint	endtime;
 	int	samps;
@@ -1478,6 +1561,11 @@ Don't let sound skip if going slow
 void S_ExtraUpdate( void )
 {
 	if( !dma.initialized ) return;
+
+	// mixer thread doesn't depend on frame time
+	if( S_MixerThreadActive( ))
+		return;
+
 	S_UpdateChannels ();
 }
 
@@ -1498,6 +1586,73 @@ void S_UpdateFrame( struct ref_viewpass_s *rvp )
 	s_listener.entnum = rvp->viewentity; // can be camera entity too
 }
 
+/*
+============
+S_UpdateThreadedChannels
+
+does the work mixer thread isn't allowed to do: loads missing
+sounds, frees finished channels and moves mouths. Must be called
+without sound lock held, sounds are loaded while mixer keeps running
+============
+*/
+static void S_UpdateThreadedChannels( void )
+{
+	sfx_t	*missing[MAX_CHANNELS];
+	int	i, nummissing = 0;
+	channel_t	*ch;
+	wavdata_t	*pSource;
+
+	// sounds are normally loaded before they get to channels,
+	// this only catches the ones that failed to preload
+	S_LockSound();
+	for( i = 0, ch = channels; i < total_channels; i++, ch++ )
+	{
+		if( ch->sfx && !ch->sfx->cache )
+			missing[nummissing++] = ch->sfx;
+	}
+	S_UnlockSound();
+
+	for( i = 0; i < nummissing; i++ )
+		S_LoadSound( missing[i] );
+
+	S_LockSound();
+
+	for( i = 0, ch = channels; i < total_channels; i++, ch++ )
+	{
+		if( !ch->sfx ) continue;
+
+		if( !( pSource = ch->sfx->cache ) || !S_ShouldContinueMixing( ch ))
+		{
+			S_FreeChannel( ch );
+			continue;
+		}
+
+		if( CL_GetEntityByIndex( ch->entnum ) && ( ch->entchannel == CHAN_VOICE || ch->entchannel == CHAN_STREAM ))
+		{
+			int count = s_listener.frametime * pSource->rate;
+
+			if( pSource->width == 1 )
+				SND_MoveMouth8( ch, pSource, count );
+			else SND_MoveMouth16( ch, pSource, count );
+		}
+	}
+
+	for( i = 0; i < MAX_RAW_CHANNELS; i++ )
+	{
+		rawchan_t	*rawch = raw_channels[i];
+		int	pos, count;
+
+		if( !rawch || rawch->entnum <= 0 )
+			continue;
+
+		pos = paintedtime & ( rawch->max_samples - 1 );
+		count = Q_min((int)( rawch->s_rawend - paintedtime ), (int)( s_listener.frametime * SOUND_DMA_SPEED ));
+		SND_MoveMouthRaw( rawch, &rawch->rawsamples[pos], bound( 0, rawch->max_samples - pos, count ));
+	}
+
+	S_UnlockSound();
+}
+
 /*
 ============
 SND_UpdateSound
@@ -1513,6 +1668,17 @@ void SND_UpdateSound( void )
 
 	if( !dma.initialized ) return;
 
+	if( FBitSet( s_mixthread.flags, FCVAR_CHANGED ))
+	{
+		if( s_mixthread.value )
+			S_StartMixerThread();
+		else S_StopMixerThread();
+
+		ClearBits( s_mixthread.flags, FCVAR_CHANGED );
+	}
+
+	S_LockSound();
+
 	// if the loading plaque is up, clear everything
 	// out to make sure we aren't looping a dirty
 	// dma buffer while loading
@@ -1526,7 +1692,14 @@ void SND_UpdateSound( void )
 	s_listener.waterlevel = cl.local.waterlevel;
 	s_listener.active = CL_IsInGame();
 	s_listener.inmenu = cls.key_dest == key_menu;
+	s_listener.inconsole = cls.key_dest == key_console;
 	s_listener.paused = cl.paused;
+	s_listener.background = cl.background;
+	s_listener.localgame = Host_IsLocalGame();
+	s_listener.timescale = sys_timescale.value;
+
+	// room presets are applied here, mixer only uses the results
+	CheckNewDspPresets();
 
 	// update general area ambient sound sources
 	S_UpdateAmbientSounds();
@@ -1609,11 +1782,16 @@ void SND_UpdateSound( void )
 		Con_NXPrintf( &info, "room_type: %i (%s) ----(%i)---- painted: %i\n", idsp_room, Cvar_VariableString( "dsp_coeff_table" ), total - 1, paintedtime );
 	}
 
+	S_UnlockSound();
+
+	// music is decoded and sounds are loaded without the lock
 	S_StreamBackgroundTrack ();
 	S_StreamSoundTrack ();
 
 	// mix some sound
-	S_UpdateChannels ();
+	if( S_MixerThreadActive( ))
+		S_UpdateThreadedChannels();
+	else S_UpdateChannels ();
 }
 
 /*
@@ -1805,6 +1983,7 @@ void S_SoundInfo_f( void )
 	Con_Printf( "%5d total_channels\n", total_channels );
 
 	S_PrintBackgroundTrackState ();
+	S_PrintMixerThreadState ();
 }
 
 /*
@@ -1846,6 +2025,8 @@ qboolean S_Init( void )
 	Cvar_RegisterVariable( &s_mixahead );
 	Cvar_RegisterVariable( &s_show );
 	Cvar_RegisterVariable( &s_lerping );
+	Cvar_RegisterVariable( &s_mix_simd );
+	Cvar_RegisterVariable( &s_mixthread );
 	Cvar_RegisterVariable( &s_ambient_level );
 	Cvar_RegisterVariable( &s_ambient_fade );
 	Cvar_RegisterVariable( &s_combine_sounds );
@@ -1853,6 +2034,8 @@ qboolean S_Init( void )
 	Cvar_RegisterVariable( &s_test );
 	Cvar_RegisterVariable( &s_samplecount );
 	Cvar_RegisterVariable( &s_warn_late_precache );
+	Cvar_RegisterVariable( &s_cachesize );
+	Cvar_RegisterVariable( &s_largesound );
 
 	if( Sys_CheckParm( "-nosound" ))
 	{
@@ -1868,6 +2051,7 @@ qboolean S_Init( void )
 	Cmd_AddCommandWithFlags( "music", S_Music_f, "starting a background track", CMD_OVERRIDABLE );
 	Cmd_AddCommand( "soundlist", S_SoundList_f, "display loaded sounds" );
 	Cmd_AddCommand( "s_info", S_SoundInfo_f, "print sound system information" );
+	Cmd_AddCommand( "s_mixbench", S_MixBenchmark_f, "measure mixing speed, usage: s_mixbench [channels] [seconds]" );
 	Cmd_AddCommand( "s_fade", S_SoundFade_f, "fade all sounds then stop all" );
 	Cmd_AddCommand( "+voicerecord", S_VoiceRecordStart_f, "start voice recording" );
 	Cmd_AddCommand( "-voicerecord", S_VoiceRecordStop_f, "stop voice recording" );
@@ -1885,6 +2069,7 @@ qboolean S_Init( void )
 
 	soundtime = 0;
 	paintedtime = 0;
+	s_listener.timescale = 1.0f;
 
 	// clear ambient sounds
 	memset( ambient_sfx, 0, sizeof( ambient_sfx ));
@@ -1896,6 +2081,10 @@ qboolean S_Init( void )
 	S_InitSounds ();
 	VOX_Init ();
 
+	if( s_mixthread.value )
+		S_StartMixerThread();
+	ClearBits( s_mixthread.flags, FCVAR_CHANGED );
+
 	return true;
 }
 
@@ -1906,6 +2095,8 @@ void S_Shutdown( void )
 {
 	if( !dma.initialized ) return;
 
+	S_StopMixerThread ();
+
 	Cmd_RemoveCommand( "play" );
 	Cmd_RemoveCommand( "playvol" );
 	Cmd_RemoveCommand( "stopsound" );
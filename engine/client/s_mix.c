@@ -17,6 +17,17 @@ GNU General Public License for more details.
 #include "sound.h"
 #include "client.h"
 
+// vectorized mixing kernels, scalar code below is kept as the reference
+#if XASH_LITTLE_ENDIAN && ( defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_AMD64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ))
+#include <emmintrin.h>
+#define XASH_MIX_SSE2 1
+#define XASH_MIX_SIMD 1
+#elif XASH_LITTLE_ENDIAN && ( defined( __ARM_NEON ) || defined( __ARM_NEON__ ))
+#include <arm_neon.h>
+#define XASH_MIX_NEON 1
+#define XASH_MIX_SIMD 1
+#endif
+
 enum
 {
 	IPAINTBUFFER = 0,
@@ -41,6 +52,7 @@ enum
 // sound mixing buffer
 #define CPAINTFILTERMEM 3
 #define CPAINTFILTERS   4 // maximum number of consecutive upsample passes per paintbuffer
+#define MIX_GATHER_SAMPLES 256 // resampled input is gathered and mixed in blocks of this size
 
 // fixed point stuff for real-time resampling
 #define FIX_BITS             28
@@ -65,6 +77,7 @@ static portable_samplepair_t  paintbuffer[(PAINTBUFFER_SIZE+1)];
 static portable_samplepair_t  roombuffer[(PAINTBUFFER_SIZE+1)];
 static portable_samplepair_t  temppaintbuffer[(PAINTBUFFER_SIZE+1)];
 static paintbuffer_t          paintbuffers[CPAINTBUFFERS];
+static qboolean               mix_simd; // use vectorized kernels, synced with s_mix_simd every paint
 
 static int snd_scaletable[SND_SCALE_LEVELS][256];
 void S_InitScaletable( void )
@@ -78,6 +91,333 @@ void S_InitScaletable( void )
 	}
 }
 
+/*
+===============================================================================
+
+VECTORIZED KERNELS
+
+each kernel processes as many samples as it can in whole vectors
+and returns the count, caller finishes the tail with the scalar code.
+8-bit scaletable lookups are replaced by multiplication, as
+snd_scaletable[vol >> 1][x] == (signed char)x * ( vol & ~1 )
+
+===============================================================================
+*/
+#if XASH_MIX_SSE2
+#define MIX_SIMD_NAME "SSE2"
+
+#define S_SIMD_DIV2N( x, n ) _mm_srai_epi32( _mm_add_epi32(( x ), _mm_srli_epi32( _mm_srai_epi32(( x ), 31 ), 32 - ( n ))), ( n ))
+
+static inline void S_SIMD_Accum( int *out, __m128i lo, __m128i hi )
+{
+	_mm_storeu_si128( (__m128i *)out, _mm_add_epi32( _mm_loadu_si128( (__m128i *)out ), lo ));
+	_mm_storeu_si128( (__m128i *)( out + 4 ), _mm_add_epi32( _mm_loadu_si128( (__m128i *)( out + 4 )), hi ));
+}
+
+// add 8 products which fit in 16 bits
+static inline void S_SIMD_Accum16( int *out, __m128i p )
+{
+	S_SIMD_Accum( out, _mm_srai_epi32( _mm_unpacklo_epi16( p, p ), 16 ), _mm_srai_epi32( _mm_unpackhi_epi16( p, p ), 16 ));
+}
+
+// add 8 full 32-bit products of 16-bit samples and volumes, shifted down by 8
+static inline void S_SIMD_AccumScaled16( int *out, __m128i s, __m128i vol )
+{
+	__m128i plo = _mm_mullo_epi16( s, vol );
+	__m128i phi = _mm_mulhi_epi16( s, vol );
+
+	S_SIMD_Accum( out, _mm_srai_epi32( _mm_unpacklo_epi16( plo, phi ), 8 ), _mm_srai_epi32( _mm_unpackhi_epi16( plo, phi ), 8 ));
+}
+
+// SSE2 has no 32-bit mullo, emulate it with two 32x32->64 multiplies
+static inline __m128i S_SIMD_MulLo32( __m128i a, __m128i b )
+{
+	__m128i even = _mm_mul_epu32( a, b );
+	__m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ));
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 )), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 )));
+}
+
+static int S_PaintMonoFrom8_SIMD( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int outCount )
+{
+	const __m128i vol = _mm_set_epi16( volume[1] & ~1, volume[0] & ~1, volume[1] & ~1, volume[0] & ~1,
+		volume[1] & ~1, volume[0] & ~1, volume[1] & ~1, volume[0] & ~1 );
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 8 <= outCount; i += 8, out += 16 )
+	{
+		__m128i s = _mm_loadl_epi64( (const __m128i *)( pData + i ));
+
+		s = _mm_srai_epi16( _mm_unpacklo_epi8( s, s ), 8 );
+		S_SIMD_Accum16( out, _mm_mullo_epi16( _mm_unpacklo_epi16( s, s ), vol ));
+		S_SIMD_Accum16( out + 8, _mm_mullo_epi16( _mm_unpackhi_epi16( s, s ), vol ));
+	}
+
+	return i;
+}
+
+static int S_PaintStereoFrom8_SIMD( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int outCount )
+{
+	const __m128i vol = _mm_set_epi16( volume[1] & ~1, volume[0] & ~1, volume[1] & ~1, volume[0] & ~1,
+		volume[1] & ~1, volume[0] & ~1, volume[1] & ~1, volume[0] & ~1 );
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 8 <= outCount; i += 8, out += 16 )
+	{
+		__m128i s = _mm_loadu_si128( (const __m128i *)( pData + i * 2 ));
+
+		S_SIMD_Accum16( out, _mm_mullo_epi16( _mm_srai_epi16( _mm_unpacklo_epi8( s, s ), 8 ), vol ));
+		S_SIMD_Accum16( out + 8, _mm_mullo_epi16( _mm_srai_epi16( _mm_unpackhi_epi8( s, s ), 8 ), vol ));
+	}
+
+	return i;
+}
+
+static int S_PaintMonoFrom16_SIMD( portable_samplepair_t *pbuf, const int *volume, const short *pData, int outCount )
+{
+	const __m128i vol = _mm_set_epi16( volume[1], volume[0], volume[1], volume[0], volume[1], volume[0], volume[1], volume[0] );
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 8 <= outCount; i += 8, out += 16 )
+	{
+		__m128i s = _mm_loadu_si128( (const __m128i *)( pData + i ));
+
+		S_SIMD_AccumScaled16( out, _mm_unpacklo_epi16( s, s ), vol );
+		S_SIMD_AccumScaled16( out + 8, _mm_unpackhi_epi16( s, s ), vol );
+	}
+
+	return i;
+}
+
+static int S_PaintStereoFrom16_SIMD( portable_samplepair_t *pbuf, const int *volume, const short *pData, int outCount )
+{
+	const __m128i vol = _mm_set_epi16( volume[1], volume[0], volume[1], volume[0], volume[1], volume[0], volume[1], volume[0] );
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 8 <= outCount; i += 8, out += 16 )
+	{
+		S_SIMD_AccumScaled16( out, _mm_loadu_si128( (const __m128i *)( pData + i * 2 )), vol );
+		S_SIMD_AccumScaled16( out + 8, _mm_loadu_si128( (const __m128i *)( pData + i * 2 + 8 )), vol );
+	}
+
+	return i;
+}
+
+static int MIX_MixPaintbuffers_SIMD( portable_samplepair_t *pbuf1, portable_samplepair_t *pbuf2, portable_samplepair_t *pbuf3, int count, int gain )
+{
+	const __m128i vgain = _mm_set1_epi32( gain );
+	int i;
+
+	for( i = 0; i + 2 <= count; i += 2 )
+	{
+		__m128i a = _mm_loadu_si128( (const __m128i *)&pbuf1[i] );
+		__m128i b = _mm_loadu_si128( (const __m128i *)&pbuf2[i] );
+
+		b = _mm_srai_epi32( S_SIMD_MulLo32( b, vgain ), 8 );
+		_mm_storeu_si128( (__m128i *)&pbuf3[i], _mm_add_epi32( a, b ));
+	}
+
+	return i;
+}
+
+static int S_TransferPaintBuffer_SIMD( short *snd_out, const int *snd_p, int count )
+{
+	const __m128i vmin = _mm_set1_epi16( -32760 );
+	const __m128i vmax = _mm_set1_epi16( 32760 );
+	int i;
+
+	for( i = 0; i + 8 <= count; i += 8 )
+	{
+		__m128i v = _mm_packs_epi32( _mm_loadu_si128( (const __m128i *)( snd_p + i )), _mm_loadu_si128( (const __m128i *)( snd_p + i + 4 )));
+
+		v = _mm_min_epi16( _mm_max_epi16( v, vmin ), vmax );
+		_mm_storeu_si128( (__m128i *)( snd_out + i ), v );
+	}
+
+	return i;
+}
+
+// two stereo samples per vector, writes original and interpolated samples interleaved
+static int S_Interpolate2xCubic_SIMD( portable_samplepair_t *pout, const portable_samplepair_t *window, int count )
+{
+	int i;
+
+	for( i = 0; i + 2 <= count; i += 2 )
+	{
+		__m128i xm1 = _mm_loadu_si128( (const __m128i *)&window[i+0] );
+		__m128i x0 = _mm_loadu_si128( (const __m128i *)&window[i+1] );
+		__m128i x1 = _mm_loadu_si128( (const __m128i *)&window[i+2] );
+		__m128i x2 = _mm_loadu_si128( (const __m128i *)&window[i+3] );
+		__m128i a, b, c, t, y;
+
+		t = _mm_sub_epi32( x0, x1 );
+		t = _mm_add_epi32( _mm_add_epi32( t, t ), t );
+		a = S_SIMD_DIV2N( _mm_add_epi32( _mm_sub_epi32( t, xm1 ), x2 ), 1 );
+
+		t = _mm_add_epi32( _mm_add_epi32( _mm_slli_epi32( x0, 2 ), x0 ), x2 );
+		b = _mm_sub_epi32( _mm_add_epi32( _mm_add_epi32( x1, x1 ), xm1 ), S_SIMD_DIV2N( t, 1 ));
+
+		c = S_SIMD_DIV2N( _mm_sub_epi32( x1, xm1 ), 1 );
+
+		y = _mm_add_epi32( S_SIMD_DIV2N( a, 3 ), S_SIMD_DIV2N( b, 2 ));
+		y = _mm_add_epi32( _mm_add_epi32( y, S_SIMD_DIV2N( c, 1 )), x0 );
+
+		_mm_storeu_si128( (__m128i *)&pout[i*2+0], _mm_unpacklo_epi64( x0, y ));
+		_mm_storeu_si128( (__m128i *)&pout[i*2+2], _mm_unpackhi_epi64( x0, y ));
+	}
+
+	return i;
+}
+#elif XASH_MIX_NEON
+#define MIX_SIMD_NAME "NEON"
+
+#define S_SIMD_DIV2N( x, n ) vshrq_n_s32( vaddq_s32(( x ), vreinterpretq_s32_u32( vshrq_n_u32( vreinterpretq_u32_s32( vshrq_n_s32(( x ), 31 )), 32 - ( n )))), ( n ))
+
+// add 8 products which fit in 16 bits
+static inline void S_SIMD_Accum16( int *out, int16x8_t p )
+{
+	vst1q_s32( out, vaddq_s32( vld1q_s32( out ), vmovl_s16( vget_low_s16( p ))));
+	vst1q_s32( out + 4, vaddq_s32( vld1q_s32( out + 4 ), vmovl_s16( vget_high_s16( p ))));
+}
+
+// add 4 full 32-bit products of 16-bit samples and volumes, shifted down by 8
+static inline void S_SIMD_AccumScaled16( int *out, int16x4_t s, int16x4_t vol )
+{
+	vst1q_s32( out, vaddq_s32( vld1q_s32( out ), vshrq_n_s32( vmull_s16( s, vol ), 8 )));
+}
+
+static int S_PaintMonoFrom8_SIMD( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int outCount )
+{
+	const int16x8_t vol = vreinterpretq_s16_s32( vdupq_n_s32(( volume[0] & ~1 ) | (( volume[1] & ~1 ) << 16 )));
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 8 <= outCount; i += 8, out += 16 )
+	{
+		int16x8_t s = vmovl_s8( vreinterpret_s8_u8( vld1_u8( pData + i )));
+		int16x8x2_t d = vzipq_s16( s, s );
+
+		S_SIMD_Accum16( out, vmulq_s16( d.val[0], vol ));
+		S_SIMD_Accum16( out + 8, vmulq_s16( d.val[1], vol ));
+	}
+
+	return i;
+}
+
+static int S_PaintStereoFrom8_SIMD( portable_samplepair_t *pbuf, const int *volume, const byte *pData, int outCount )
+{
+	const int16x8_t vol = vreinterpretq_s16_s32( vdupq_n_s32(( volume[0] & ~1 ) | (( volume[1] & ~1 ) << 16 )));
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 8 <= outCount; i += 8, out += 16 )
+	{
+		int8x16_t s = vreinterpretq_s8_u8( vld1q_u8( pData + i * 2 ));
+
+		S_SIMD_Accum16( out, vmulq_s16( vmovl_s8( vget_low_s8( s )), vol ));
+		S_SIMD_Accum16( out + 8, vmulq_s16( vmovl_s8( vget_high_s8( s )), vol ));
+	}
+
+	return i;
+}
+
+static int S_PaintMonoFrom16_SIMD( portable_samplepair_t *pbuf, const int *volume, const short *pData, int outCount )
+{
+	const int16x4_t vol = vreinterpret_s16_s32( vdup_n_s32(( volume[0] & 0xFFFF ) | ( volume[1] << 16 )));
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 4 <= outCount; i += 4, out += 8 )
+	{
+		int16x4_t s = vld1_s16( pData + i );
+		int16x4x2_t d = vzip_s16( s, s );
+
+		S_SIMD_AccumScaled16( out, d.val[0], vol );
+		S_SIMD_AccumScaled16( out + 4, d.val[1], vol );
+	}
+
+	return i;
+}
+
+static int S_PaintStereoFrom16_SIMD( portable_samplepair_t *pbuf, const int *volume, const short *pData, int outCount )
+{
+	const int16x4_t vol = vreinterpret_s16_s32( vdup_n_s32(( volume[0] & 0xFFFF ) | ( volume[1] << 16 )));
+	int *out = (int *)pbuf;
+	int i;
+
+	for( i = 0; i + 4 <= outCount; i += 4, out += 8 )
+	{
+		S_SIMD_AccumScaled16( out, vld1_s16( pData + i * 2 ), vol );
+		S_SIMD_AccumScaled16( out + 4, vld1_s16( pData + i * 2 + 4 ), vol );
+	}
+
+	return i;
+}
+
+static int MIX_MixPaintbuffers_SIMD( portable_samplepair_t *pbuf1, portable_samplepair_t *pbuf2, portable_samplepair_t *pbuf3, int count, int gain )
+{
+	const int32x4_t vgain = vdupq_n_s32( gain );
+	int i;
+
+	for( i = 0; i + 2 <= count; i += 2 )
+	{
+		int32x4_t a = vld1q_s32( &pbuf1[i].left );
+		int32x4_t b = vld1q_s32( &pbuf2[i].left );
+
+		vst1q_s32( &pbuf3[i].left, vaddq_s32( a, vshrq_n_s32( vmulq_s32( b, vgain ), 8 )));
+	}
+
+	return i;
+}
+
+static int S_TransferPaintBuffer_SIMD( short *snd_out, const int *snd_p, int count )
+{
+	const int32x4_t vmin = vdupq_n_s32( -32760 );
+	const int32x4_t vmax = vdupq_n_s32( 32760 );
+	int i;
+
+	for( i = 0; i + 4 <= count; i += 4 )
+		vst1_s16( snd_out + i, vmovn_s32( vminq_s32( vmaxq_s32( vld1q_s32( snd_p + i ), vmin ), vmax )));
+
+	return i;
+}
+
+// two stereo samples per vector, writes original and interpolated samples interleaved
+static int S_Interpolate2xCubic_SIMD( portable_samplepair_t *pout, const portable_samplepair_t *window, int count )
+{
+	int i;
+
+	for( i = 0; i + 2 <= count; i += 2 )
+	{
+		int32x4_t xm1 = vld1q_s32( &window[i+0].left );
+		int32x4_t x0 = vld1q_s32( &window[i+1].left );
+		int32x4_t x1 = vld1q_s32( &window[i+2].left );
+		int32x4_t x2 = vld1q_s32( &window[i+3].left );
+		int32x4_t a, b, c, t, y;
+
+		t = vmulq_n_s32( vsubq_s32( x0, x1 ), 3 );
+		a = S_SIMD_DIV2N( vaddq_s32( vsubq_s32( t, xm1 ), x2 ), 1 );
+
+		t = vaddq_s32( vmulq_n_s32( x0, 5 ), x2 );
+		b = vsubq_s32( vaddq_s32( vaddq_s32( x1, x1 ), xm1 ), S_SIMD_DIV2N( t, 1 ));
+
+		c = S_SIMD_DIV2N( vsubq_s32( x1, xm1 ), 1 );
+
+		y = vaddq_s32( S_SIMD_DIV2N( a, 3 ), S_SIMD_DIV2N( b, 2 ));
+		y = vaddq_s32( vaddq_s32( y, S_SIMD_DIV2N( c, 1 )), x0 );
+
+		vst1q_s32( &pout[i*2+0].left, vcombine_s32( vget_low_s32( x0 ), vget_low_s32( y )));
+		vst1q_s32( &pout[i*2+2].left, vcombine_s32( vget_high_s32( x0 ), vget_high_s32( y )));
+	}
+
+	return i;
+}
+#endif // XASH_MIX_NEON
+
 /*
 ===================
 S_TransferPaintBuffer
@@ -109,22 +449,21 @@ static void S_TransferPaintBuffer( int endtime )
 			snd_linear_count = endtime - lpaintedtime;
 
 		snd_linear_count <<= 1;
+		i = 0;
+
+#if XASH_MIX_SIMD
+		if( mix_simd )
+			i = S_TransferPaintBuffer_SIMD( snd_out, snd_p, snd_linear_count );
+#endif
 
-		// write a linear blast of samples
-		for( i = 0; i < snd_linear_count; i += 2 )
+		// write a linear blast of samples, clipping them down to 16 bit
+		for( ; i < snd_linear_count; i += 2 )
 		{
-			val = (snd_p[i+0] * 256) >> 8;
-
-			if( val > 0x7fff ) snd_out[i+0] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+0] = (short)0x8000;
-			else snd_out[i+0] = val;
-
-			val = (snd_p[i+1] * 256) >> 8;
-			if( val > 0x7fff ) snd_out[i+1] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+1] = (short)0x8000;
-			else snd_out[i+1] = val;
+			val = snd_p[i+0];
+			snd_out[i+0] = CLIP( val );
+
+			val = snd_p[i+1];
+			snd_out[i+1] = CLIP( val );
 		}
 
 		snd_p += snd_linear_count;
@@ -195,12 +534,6 @@ static portable_samplepair_t *MIX_GetPFrontFromIPaint( int ipaintbuffer )
 	return paintbuffers[ipaintbuffer].pbuf;
 }
 
-static paintbuffer_t *MIX_GetPPaintFromIPaint( int ipaint )
-{
-	Assert( ipaint < CPAINTBUFFERS );
-	return &paintbuffers[ipaint];
-}
-
 void MIX_FreeAllPaintbuffers( void )
 {
 	// clear paintbuffer structs
@@ -234,8 +567,14 @@ static void S_PaintMonoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pD
 
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
+	i = 0;
 
-	for( i = 0; i < outCount; i++ )
+#if XASH_MIX_SIMD
+	if( mix_simd )
+		i = S_PaintMonoFrom8_SIMD( pbuf, volume, pData, outCount );
+#endif
+
+	for( ; i < outCount; i++ )
 	{
 		data = pData[i];
 		pbuf[i].left += lscale[data];
@@ -253,8 +592,17 @@ static void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
 	data = (word *)pData;
+	i = 0;
+
+#if XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		i = S_PaintStereoFrom8_SIMD( pbuf, volume, pData, outCount );
+		data += i;
+	}
+#endif
 
-	for( i = 0; i < outCount; i++, data++ )
+	for( ; i < outCount; i++, data++ )
 	{
 		left = (byte)((*data & 0x00FF));
 		right = (byte)((*data & 0xFF00) >> 8);
@@ -266,9 +614,14 @@ static void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *
 static void S_PaintMonoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
 {
 	int	left, right;
-	int	i, data;
+	int	i = 0, data;
 
-	for( i = 0; i < outCount; i++ )
+#if XASH_MIX_SIMD
+	if( mix_simd )
+		i = S_PaintMonoFrom16_SIMD( pbuf, volume, pData, outCount );
+#endif
+
+	for( ; i < outCount; i++ )
 	{
 		data = pData[i];
 		left = ( data * volume[0]) >> 8;
@@ -285,8 +638,17 @@ static void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short
 	int	i;
 
 	data = (uint *)pData;
+	i = 0;
+
+#if XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		i = S_PaintStereoFrom16_SIMD( pbuf, volume, pData, outCount );
+		data += i;
+	}
+#endif
 
-	for( i = 0; i < outCount; i++, data++ )
+	for( ; i < outCount; i++, data++ )
 	{
 		left = (signed short)((*data & 0x0000FFFF));
 		right = (signed short)((*data & 0xFFFF0000) >> 16);
@@ -299,6 +661,81 @@ static void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short
 	}
 }
 
+#if XASH_MIX_SIMD
+/*
+===================
+S_MixResampled
+
+gathers pitched samples into a block and mixes it with fixed-rate kernels
+===================
+*/
+static void S_MixResampled( portable_samplepair_t *pbuf, int *volume, const void *pData, int width, int channels, uint sampleFrac, uint rateScale, int outCount )
+{
+	union
+	{
+		byte  b[MIX_GATHER_SAMPLES * 2];
+		short s[MIX_GATHER_SAMPLES * 2];
+	} block;
+	const byte *pData8 = pData;
+	const short *pData16 = pData;
+	int sampleIndex = 0;
+	int i, count;
+
+	while( outCount > 0 )
+	{
+		count = Q_min( outCount, MIX_GATHER_SAMPLES );
+
+		for( i = 0; i < count; i++ )
+		{
+			if( width == 1 )
+			{
+				if( channels == 1 )
+				{
+					block.b[i] = pData8[sampleIndex];
+				}
+				else
+				{
+					block.b[i*2+0] = pData8[sampleIndex*2+0];
+					block.b[i*2+1] = pData8[sampleIndex*2+1];
+				}
+			}
+			else
+			{
+				if( channels == 1 )
+				{
+					block.s[i] = pData16[sampleIndex];
+				}
+				else
+				{
+					block.s[i*2+0] = pData16[sampleIndex*2+0];
+					block.s[i*2+1] = pData16[sampleIndex*2+1];
+				}
+			}
+
+			sampleFrac += rateScale;
+			sampleIndex += FIX_INTPART( sampleFrac );
+			sampleFrac = FIX_FRACPART( sampleFrac );
+		}
+
+		if( width == 1 )
+		{
+			if( channels == 1 )
+				S_PaintMonoFrom8( pbuf, volume, block.b, count );
+			else S_PaintStereoFrom8( pbuf, volume, block.b, count );
+		}
+		else
+		{
+			if( channels == 1 )
+				S_PaintMonoFrom16( pbuf, volume, block.s, count );
+			else S_PaintStereoFrom16( pbuf, volume, block.s, count );
+		}
+
+		pbuf += count;
+		outCount -= count;
+	}
+}
+#endif // XASH_MIX_SIMD
+
 static void S_Mix8MonoTimeCompress( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount, int timecompress )
 {
 }
@@ -322,6 +759,14 @@ static void S_Mix8Mono( portable_samplepair_t *pbuf, int *volume, byte *pData, i
 		return;
 	}
 
+#if XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		S_MixResampled( pbuf, volume, pData, 1, 1, inputOffset, rateScale, outCount );
+		return;
+	}
+#endif
+
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
 
@@ -348,6 +793,14 @@ static void S_Mix8Stereo( portable_samplepair_t *pbuf, int *volume, byte *pData,
 		return;
 	}
 
+#if XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		S_MixResampled( pbuf, volume, pData, 1, 2, inputOffset, rateScale, outCount );
+		return;
+	}
+#endif
+
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
 
@@ -373,6 +826,14 @@ static void S_Mix16Mono( portable_samplepair_t *pbuf, int *volume, short *pData,
 		return;
 	}
 
+#if XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		S_MixResampled( pbuf, volume, pData, 2, 1, inputOffset, rateScale, outCount );
+		return;
+	}
+#endif
+
 	for( i = 0; i < outCount; i++ )
 	{
 		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex] ))>>8;
@@ -395,6 +856,14 @@ static void S_Mix16Stereo( portable_samplepair_t *pbuf, int *volume, short *pDat
 		return;
 	}
 
+#if XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		S_MixResampled( pbuf, volume, pData, 2, 2, inputOffset, rateScale, outCount );
+		return;
+	}
+#endif
+
 	for( i = 0; i < outCount; i++ )
 	{
 		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex+0] ))>>8;
@@ -522,7 +991,7 @@ int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outRate, int ou
 	return outOffset - startingOffset;
 }
 
-static qboolean S_ShouldContinueMixing( channel_t *ch )
+qboolean S_ShouldContinueMixing( channel_t *ch )
 {
 	if( ch->isSentence )
 	{
@@ -549,7 +1018,7 @@ static void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate
 	wavdata_t	*pSource;
 	int	i, sampleCount;
 	qboolean	bZeroVolume;
-	qboolean local = Host_IsLocalGame();
+	qboolean threaded = S_MixerThreadActive();
 
 	// mix each channel into paintbuffer
 	ch = channels;
@@ -570,13 +1039,13 @@ static void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate
 		if( !ch->sfx ) continue;
 
 		// NOTE: background map is allow both type sounds: menu and game
-		if( !cl.background )
+		if( !s_listener.background )
 		{
-			if( cls.key_dest == key_console && ch->localsound )
+			if( s_listener.inconsole && ch->localsound )
 			{
 				// play, playvol
 			}
-			else if(( s_listener.inmenu || s_listener.paused ) && !ch->localsound && local )
+			else if(( s_listener.inmenu || s_listener.paused ) && !ch->localsound && s_listener.localgame )
 			{
 				// play only local sounds, keep pause for other
 				continue;
@@ -587,10 +1056,13 @@ static void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate
 				continue;
 			}
 		}
-		else if( cls.key_dest == key_console )
+		else if( s_listener.inconsole )
 			continue;	// silent mode in console
 
-		pSource = S_LoadSound( ch->sfx );
+		// mixer thread can't load sounds, SND_UpdateSound frees channels it can't play
+		if( threaded )
+			pSource = ch->sfx->cache;
+		else pSource = S_LoadSound( ch->sfx );
 
 		// Don't mix sound data for sounds with zero volume. If it's a non-looping sound,
 		// just remove the sound when its volume goes to zero.
@@ -608,7 +1080,8 @@ static void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate
 		{
 			if( !pSource )
 			{
-				S_FreeChannel( ch );
+				if( !threaded )
+					S_FreeChannel( ch );
 				continue;
 			}
 		}
@@ -634,9 +1107,9 @@ static void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate
 			ch->pitch = VOX_ModifyPitch( ch, ch->basePitch * 0.01f );
 		else ch->pitch = ch->basePitch * 0.01f;
 
-		ch->pitch *= ( sys_timescale.value + 1 ) / 2;
+		ch->pitch *= ( s_listener.timescale + 1 ) / 2;
 
-		if( CL_GetEntityByIndex( ch->entnum ) && ( ch->entchannel == CHAN_VOICE || ch->entchannel == CHAN_STREAM ))
+		if( !threaded && CL_GetEntityByIndex( ch->entnum ) && ( ch->entchannel == CHAN_VOICE || ch->entchannel == CHAN_STREAM ))
 		{
 			if( pSource->width == 1 )
 				SND_MoveMouth8( ch, pSource, sampleCount );
@@ -649,7 +1122,7 @@ static void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate
 			VOX_MixDataToDevice( ch, sampleCount, outputRate, 0 );
 		else S_MixDataToDevice( ch, sampleCount, outputRate, 0, 0 );
 
-		if( !S_ShouldContinueMixing( ch ))
+		if( !threaded && !S_ShouldContinueMixing( ch ))
 		{
 			S_FreeChannel( ch );
 		}
@@ -669,6 +1142,18 @@ static portable_samplepair_t *S_GetNextpFilter( int i, portable_samplepair_t *pb
 	return (&(pbuffer[(i-2) * 2 + 1]));
 }
 
+#if XASH_MIX_SIMD
+// cubic interpolation of the midpoint between x0 and x1, see S_Interpolate2xCubic
+static inline int S_CubicSample( int xm1, int x0, int x1, int x2 )
+{
+	int a = (3 * (x0-x1) - xm1 + x2) / 2;
+	int b = 2*x1 + xm1 - (5*x0 + x2) / 2;
+	int c = (x1 - xm1) / 2;
+
+	return a/8 + b/4 + c/2 + x0;
+}
+#endif
+
 // pass forward over passed in buffer and cubic interpolate all odd samples
 // pbuffer: buffer to filter (in place)
 // prevfilter:  filter memory. NOTE: this must match the filtertype ie: filtercubic[] for FILTERTYPE_CUBIC
@@ -706,6 +1191,36 @@ static void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_sampl
 	portable_samplepair_t *psamp3;
 	int outpos = 0;
 
+#if XASH_MIX_SIMD
+	if( mix_simd && count >= 3 && count * 2 <= PAINTBUFFER_SIZE )
+	{
+		portable_samplepair_t *window = temppaintbuffer;
+
+		Assert( cfltmem >= 3 );
+
+		// line up filter memory and source samples, so output can go straight to pbuffer
+		window[0] = pfiltermem[0];
+		window[1] = pfiltermem[1];
+		window[2] = pfiltermem[2];
+
+		for( i = 0; i < count; i++ )
+			window[i+3] = pbuffer[i*2+1];
+
+		// save last 3 samples from paintbuffer
+		pfiltermem[0] = window[count+0];
+		pfiltermem[1] = window[count+1];
+		pfiltermem[2] = window[count+2];
+
+		for( i = S_Interpolate2xCubic_SIMD( pbuffer, window, count ); i < count; i++ )
+		{
+			pbuffer[i*2+0] = window[i+1];
+			pbuffer[i*2+1].left = S_CubicSample( window[i].left, window[i+1].left, window[i+2].left, window[i+3].left );
+			pbuffer[i*2+1].right = S_CubicSample( window[i].right, window[i+1].right, window[i+2].right, window[i+3].right );
+		}
+		return;
+	}
+#endif
+
 	// pfiltermem holds 6 samples from previous buffer pass
 	// process 'count' samples
 	for( i = 0; i < count; i++)
@@ -881,7 +1396,14 @@ static void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, flo
 	// pb1 (4ch->2ch) + pb2 (4ch->2ch)	-> pb3 2ch
 
 	// mix front channels
-	for( i = 0; i < count; i++ )
+	i = 0;
+
+#if XASH_MIX_SIMD
+	if( mix_simd )
+		i = MIX_MixPaintbuffers_SIMD( pbuf1, pbuf2, pbuf3, count, gain );
+#endif
+
+	for( ; i < count; i++ )
 	{
 		pbuf3[i].left = pbuf1[i].left;
 		pbuf3[i].right = pbuf1[i].right;
@@ -890,22 +1412,6 @@ static void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, flo
 	}
 }
 
-static void MIX_CompressPaintbuffer( int ipaint, int count )
-{
-	portable_samplepair_t	*pbuf;
-	paintbuffer_t		*ppaint;
-	int			i;
-
-	ppaint = MIX_GetPPaintFromIPaint( ipaint );
-	pbuf = ppaint->pbuf;
-
-	for( i = 0; i < count; i++, pbuf++ )
-	{
-		pbuf->left = CLIP( pbuf->left );
-		pbuf->right = CLIP( pbuf->right );
-	}
-}
-
 static void S_MixUpsample( int sampleCount, int filtertype )
 {
 	paintbuffer_t	*ppaint = MIX_GetCurrentPaintbufferPtr();
@@ -954,7 +1460,7 @@ static void MIX_MixRawSamplesBuffer( int end )
 			pbuf[j-paintedtime].right += ( ch->rawsamples[j & ( ch->max_samples - 1 )].right * ch->rightvol ) >> 8;
 		}
 
-		if( ch->entnum > 0 )
+		if( ch->entnum > 0 && !S_MixerThreadActive( ))
 		{
 			int pos = paintedtime & ( ch->max_samples - 1 );
 
@@ -1020,7 +1526,9 @@ void MIX_PaintChannels( int endtime )
 {
 	int	end, count;
 
-	CheckNewDspPresets();
+#if XASH_MIX_SIMD
+	mix_simd = s_mix_simd.value != 0.0f;
+#endif
 
 	while( paintedtime < endtime )
 	{
@@ -1038,7 +1546,7 @@ void MIX_PaintChannels( int endtime )
 		MIX_UpsampleAllPaintbuffers( end, count );
 
 		// process all sounds with DSP
-		if( cls.key_dest != key_menu )
+		if( !s_listener.inmenu )
 			DSP_Process( MIX_GetPFrontFromIPaint( IROOMBUFFER ), count );
 
 		// add music or soundtrack from movie (no dsp)
@@ -1047,10 +1555,7 @@ void MIX_PaintChannels( int endtime )
 		// add music or soundtrack from movie (no dsp)
 		MIX_MixPaintbuffers( IPAINTBUFFER, ISTREAMBUFFER, IPAINTBUFFER, count, S_GetMusicVolume() );
 
-		// clip all values > 16 bit down to 16 bit
-		MIX_CompressPaintbuffer( IPAINTBUFFER, count );
-
-		// transfer IPAINTBUFFER paintbuffer out to DMA buffer
+		// transfer IPAINTBUFFER paintbuffer out to DMA buffer, clipping all values > 16 bit down to 16 bit
 		MIX_SetCurrentPaintbuffer( IPAINTBUFFER );
 
 		// transfer out according to DMA format
@@ -1058,3 +1563,212 @@ void MIX_PaintChannels( int endtime )
 		paintedtime = end;
 	}
 }
+
+/*
+===================
+S_MixBenchmark_f
+
+mixes synthetic channels into a private buffer,
+doesn't touch the sound device, so works headless
+===================
+*/
+void S_MixBenchmark_f( void )
+{
+	portable_samplepair_t fltmem[CPAINTFILTERMEM];
+	portable_samplepair_t *pbuf;
+	double time[2] = { 0.0, 0.0 };
+	int numchannels, seconds, passes;
+	int i, j, k, pass;
+	byte *data;
+
+	numchannels = Cmd_Argc() > 1 ? bound( 1, Q_atoi( Cmd_Argv( 1 )), 1024 ) : 128;
+	seconds = Cmd_Argc() > 2 ? bound( 1, Q_atoi( Cmd_Argv( 2 )), 60 ) : 1;
+	passes = seconds * SOUND_DMA_SPEED / PAINTBUFFER_SIZE;
+
+	// kernels share temporary buffers with the mixer
+	S_LockSound();
+
+	// enough 16-bit stereo data for pitched channels
+	data = Mem_Malloc( sndpool, PAINTBUFFER_SIZE * 2 * sizeof( short ) * 2 );
+	pbuf = Mem_Malloc( sndpool, sizeof( *pbuf ) * ( PAINTBUFFER_SIZE + 1 ));
+
+	for( i = 0; i < PAINTBUFFER_SIZE * 2 * sizeof( short ) * 2; i++ )
+		data[i] = COM_RandomLong( 0, 255 );
+
+#if XASH_MIX_SIMD
+	for( pass = 0; pass < 2; pass++ )
+#else
+	for( pass = 0; pass < 1; pass++ )
+#endif
+	{
+		double start = Sys_DoubleTime();
+
+		mix_simd = pass != 0;
+		memset( fltmem, 0, sizeof( fltmem ));
+
+		for( i = 0; i < passes; i++ )
+		{
+			memset( pbuf, 0, sizeof( *pbuf ) * ( PAINTBUFFER_SIZE + 1 ));
+
+			// paint at 22k, then upsample to 44k, like a typical game mix
+			for( j = 0; j < numchannels; j++ )
+			{
+				int volume[CCHANVOLUMES] = { 128 + j % 127, 255 - j % 127 };
+				uint rate = FBitSet( j, 4 ) ? FIX_FLOAT( 1.25 ) : FIX( 1 );
+
+				k = PAINTBUFFER_SIZE / 2;
+
+				switch( j & 3 )
+				{
+				case 0: S_Mix8Mono( pbuf, volume, data, 0, rate, k, 0 ); break;
+				case 1: S_Mix8Stereo( pbuf, volume, data, 0, rate, k ); break;
+				case 2: S_Mix16Mono( pbuf, volume, (short *)data, 0, rate, k ); break;
+				case 3: S_Mix16Stereo( pbuf, volume, (short *)data, 0, rate, k ); break;
+				}
+			}
+
+			S_MixBufferUpsample2x( PAINTBUFFER_SIZE / 2, pbuf, fltmem, CPAINTFILTERMEM, FILTERTYPE_CUBIC );
+		}
+
+		time[pass] = Sys_DoubleTime() - start;
+	}
+
+#if XASH_MIX_SIMD
+	mix_simd = s_mix_simd.value != 0.0f;
+	Con_Printf( "%d channels, %d sec of audio: scalar %.2f ms, " MIX_SIMD_NAME " %.2f ms (%.2fx)\n",
+		numchannels, seconds, time[0] * 1000.0, time[1] * 1000.0, time[1] > 0.0 ? time[0] / time[1] : 0.0 );
+#else
+	Con_Printf( "%d channels, %d sec of audio: scalar %.2f ms, no vectorized kernels in this build\n",
+		numchannels, seconds, time[0] * 1000.0 );
+#endif
+
+	S_UnlockSound();
+
+	Mem_Free( data );
+	Mem_Free( pbuf );
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+#define TEST_MIX_SAMPLES ( PAINTBUFFER_SIZE / 2 - 3 ) // odd count, to hit scalar tails too
+
+static void Test_MixCompare( int width, int channels, uint rate, const byte *data )
+{
+	static portable_samplepair_t ref[PAINTBUFFER_SIZE + 1], out[PAINTBUFFER_SIZE + 1];
+	int volume[CCHANVOLUMES] = { 255, 93 };
+	int pass;
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		portable_samplepair_t *pbuf = pass ? out : ref;
+		int i;
+
+		mix_simd = pass != 0;
+
+		// start from a non-empty buffer, as channels are summed
+		for( i = 0; i < ARRAYSIZE( ref ); i++ )
+		{
+			pbuf[i].left = i * 7 - 3000;
+			pbuf[i].right = 5000 - i * 11;
+		}
+
+		if( width == 1 )
+		{
+			if( channels == 1 )
+				S_Mix8Mono( pbuf, volume, (byte *)data, 0, rate, TEST_MIX_SAMPLES, 0 );
+			else S_Mix8Stereo( pbuf, volume, (byte *)data, 0, rate, TEST_MIX_SAMPLES );
+		}
+		else
+		{
+			if( channels == 1 )
+				S_Mix16Mono( pbuf, volume, (short *)data, 0, rate, TEST_MIX_SAMPLES );
+			else S_Mix16Stereo( pbuf, volume, (short *)data, 0, rate, TEST_MIX_SAMPLES );
+		}
+	}
+
+	TASSERT( !memcmp( ref, out, sizeof( ref )));
+}
+
+static void Test_MixUpsampleCompare( const byte *data )
+{
+	static portable_samplepair_t ref[PAINTBUFFER_SIZE + 1], out[PAINTBUFFER_SIZE + 1];
+	portable_samplepair_t reffilter[CPAINTFILTERMEM], outfilter[CPAINTFILTERMEM];
+	const short *samples = (const short *)data;
+	int i, j;
+
+	memset( reffilter, 0, sizeof( reffilter ));
+	memset( outfilter, 0, sizeof( outfilter ));
+
+	// run two passes to check filter memory carries over the same way
+	for( i = 0; i < 2; i++ )
+	{
+		for( j = 0; j < PAINTBUFFER_SIZE; j++ )
+		{
+			ref[j].left = out[j].left = samples[j * 2 + 0] * 3;
+			ref[j].right = out[j].right = samples[j * 2 + 1] * 3;
+		}
+
+		mix_simd = false;
+		S_MixBufferUpsample2x( TEST_MIX_SAMPLES, ref, reffilter, CPAINTFILTERMEM, FILTERTYPE_CUBIC );
+		mix_simd = true;
+		S_MixBufferUpsample2x( TEST_MIX_SAMPLES, out, outfilter, CPAINTFILTERMEM, FILTERTYPE_CUBIC );
+
+		TASSERT( !memcmp( ref, out, sizeof( *ref ) * TEST_MIX_SAMPLES * 2 ));
+		TASSERT( !memcmp( reffilter, outfilter, sizeof( reffilter )));
+	}
+}
+
+#if XASH_MIX_SIMD
+static void Test_MixTransferCompare( const byte *data )
+{
+	short ref[PAINTBUFFER_SIZE], out[PAINTBUFFER_SIZE];
+	int in[PAINTBUFFER_SIZE];
+	int i;
+
+	// make sure values go beyond 16 bit in both directions
+	for( i = 0; i < PAINTBUFFER_SIZE; i++ )
+	{
+		in[i] = ((const short *)data)[i] * 4;
+		ref[i] = CLIP( in[i] );
+	}
+
+	i = S_TransferPaintBuffer_SIMD( out, in, PAINTBUFFER_SIZE - 3 );
+	for( ; i < PAINTBUFFER_SIZE; i++ )
+		out[i] = CLIP( in[i] );
+
+	TASSERT( !memcmp( ref, out, sizeof( ref )));
+}
+#endif // XASH_MIX_SIMD
+
+void Test_RunMixer( void )
+{
+	static byte data[PAINTBUFFER_SIZE * 2 * sizeof( short ) * 2];
+	qboolean saved_simd = mix_simd;
+	int i;
+
+	S_InitScaletable();
+
+	for( i = 0; i < sizeof( data ); i++ )
+		data[i] = COM_RandomLong( 0, 255 );
+
+	// full scale samples
+	data[0] = data[1] = 0x80;
+	data[2] = data[3] = 0x7f;
+
+	TRUN( Test_MixCompare( 1, 1, FIX( 1 ), data ));
+	TRUN( Test_MixCompare( 1, 2, FIX( 1 ), data ));
+	TRUN( Test_MixCompare( 2, 1, FIX( 1 ), data ));
+	TRUN( Test_MixCompare( 2, 2, FIX( 1 ), data ));
+	TRUN( Test_MixCompare( 1, 1, FIX_FLOAT( 0.77 ), data ));
+	TRUN( Test_MixCompare( 1, 2, FIX_FLOAT( 1.5 ), data ));
+	TRUN( Test_MixCompare( 2, 1, FIX_FLOAT( 1.33 ), data ));
+	TRUN( Test_MixCompare( 2, 2, FIX_FLOAT( 0.5 ), data ));
+	TRUN( Test_MixUpsampleCompare( data ));
+#if XASH_MIX_SIMD
+	TRUN( Test_MixTransferCompare( data ));
+#endif
+
+	mix_simd = saved_simd;
+}
+#endif // XASH_ENGINE_TESTS
@@ -174,6 +174,34 @@ qboolean S_StreamGetCurrentState( char *currentTrack, size_t currentTrackSize, c
 	return true;
 }
 
+/*
+=================
+S_RawChannelSpace
+
+returns how many samples raw channel can take right now, music is
+decoded without sound lock held, it's only taken to look at the channel
+=================
+*/
+static int S_RawChannelSpace( int entnum )
+{
+	rawchan_t	*ch;
+	int	space = 0;
+
+	S_LockSound();
+
+	if(( ch = S_FindRawChannel( entnum, true )) != NULL )
+	{
+		if( ch->s_rawend < soundtime )
+			ch->s_rawend = soundtime;
+
+		space = ch->max_samples - ( ch->s_rawend - soundtime );
+	}
+
+	S_UnlockSound();
+
+	return space;
+}
+
 /*
 =================
 S_StreamBackgroundTrack
@@ -185,7 +213,6 @@ void S_StreamBackgroundTrack( void )
 	int	fileSamples;
 	byte	raw[MAX_RAW_SAMPLES];
 	int	r, fileBytes;
-	rawchan_t	*ch = NULL;
 
 	if( !dma.initialized || !s_bgTrack.stream || s_listener.streaming )
 		return;
@@ -203,20 +230,11 @@ void S_StreamBackgroundTrack( void )
 	else if( cls.key_dest == key_console )
 		return;
 
-	ch = S_FindRawChannel( S_RAW_SOUND_BACKGROUNDTRACK, true );
-
-	Assert( ch != NULL );
-
 	// see how many samples should be copied into the raw buffer
-	if( ch->s_rawend < soundtime )
-		ch->s_rawend = soundtime;
-
-	while( ch->s_rawend < soundtime + ch->max_samples )
+	while(( bufferSamples = S_RawChannelSpace( S_RAW_SOUND_BACKGROUNDTRACK )) > 0 )
 	{
 		const stream_t *info = s_bgTrack.stream;
 
-		bufferSamples = ch->max_samples - (ch->s_rawend - soundtime);
-
 		// decide how much data needs to be read from the file
 		fileSamples = bufferSamples * ((float)info->rate / SOUND_DMA_SPEED );
 		if( fileSamples <= 1 ) return; // no more samples need
@@ -299,27 +317,17 @@ void S_StreamSoundTrack( void )
 	int	fileSamples;
 	byte	raw[MAX_RAW_SAMPLES];
 	int	r, fileBytes;
-	rawchan_t	*ch = NULL;
 
 	if( !dma.initialized || !s_listener.streaming || s_listener.paused )
 		return;
 
-	ch = S_FindRawChannel( S_RAW_SOUND_SOUNDTRACK, true );
-
-	Assert( ch != NULL );
-
 	// see how many samples should be copied into the raw buffer
-	if( ch->s_rawend < soundtime )
-		ch->s_rawend = soundtime;
-
-	while( ch->s_rawend < soundtime + ch->max_samples )
+	while(( bufferSamples = S_RawChannelSpace( S_RAW_SOUND_SOUNDTRACK )) > 0 )
 	{
 		wavdata_t	*info = SCR_GetMovieInfo();
 
 		if( !info ) break;	// bad soundtrack?
 
-		bufferSamples = ch->max_samples - (ch->s_rawend - soundtime);
-
 		// decide how much data needs to be read from the file
 		fileSamples = bufferSamples * ((float)info->rate / SOUND_DMA_SPEED );
 		if( fileSamples <= 1 ) return; // no more samples need
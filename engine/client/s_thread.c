@@ -0,0 +1,207 @@
+/*
+s_thread.c - sound mixer thread
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "sound.h"
+#include "platform/platform.h"
+
+/*
+===============================================================================
+
+MIXER THREAD
+
+With s_mixthread enabled, paint passes run on their own thread at a steady
+rate, so long frames don't drain the DMA buffer and s_mixahead can be lowered.
+
+Every piece of sound state is guarded by a single recursive lock. The mixer
+thread holds it for one paint pass, the main thread takes it in the public
+entry points that modify channels. While the thread is running the mixer never
+loads or frees sound data, and doesn't touch client entities, this is left
+to SND_UpdateSound on the main thread. Sounds and music are decoded before
+the lock is taken and client state mixer needs is copied to s_listener, so
+the mixer never waits for the disk.
+
+===============================================================================
+*/
+#if XASH_THREADS
+static struct
+{
+	sys_mutex_t  *lock;
+	sys_thread_t *thread;
+	qboolean     active; // only changed by the main thread while it doesn't hold the lock
+	qboolean     quit;   // guarded by lock
+	uint         passes; // guarded by lock
+} snd_thread;
+
+/*
+=================
+S_MixerThreadLoop
+=================
+*/
+static void S_MixerThreadLoop( void *unused )
+{
+	while( 1 )
+	{
+		int msec;
+
+		Sys_LockMutex( snd_thread.lock );
+
+		if( snd_thread.quit )
+		{
+			Sys_UnlockMutex( snd_thread.lock );
+			break;
+		}
+
+		S_UpdateChannels();
+		snd_thread.passes++;
+
+		// wake up a few times per mixahead interval
+		msec = bound( 1, (int)( s_mixahead.value * 1000.0f / 4.0f ), 10 );
+
+		Sys_UnlockMutex( snd_thread.lock );
+
+		Platform_Sleep( msec );
+	}
+}
+#endif // XASH_THREADS
+
+/*
+=================
+S_StartMixerThread
+
+must be called by main thread without holding the sound lock
+=================
+*/
+qboolean S_StartMixerThread( void )
+{
+#if XASH_THREADS
+	if( snd_thread.active )
+		return true;
+
+	// main thread takes the lock again from nested entry points
+	if( !( snd_thread.lock = Sys_CreateMutex( true )))
+	{
+		Con_Printf( S_ERROR "%s: can't create mutex\n", __func__ );
+		return false;
+	}
+
+	snd_thread.quit = false;
+	snd_thread.passes = 0;
+
+	// set it before thread starts, so main thread begins locking right away
+	snd_thread.active = true;
+
+	if( !( snd_thread.thread = Sys_CreateThread( "Sound mixer thread", S_MixerThreadLoop, NULL )))
+	{
+		Con_Printf( S_ERROR "%s: can't create thread\n", __func__ );
+		snd_thread.active = false;
+		Sys_DestroyMutex( snd_thread.lock );
+		snd_thread.lock = NULL;
+		return false;
+	}
+
+	Con_Reportf( "Audio: mixing in separate thread\n" );
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+=================
+S_StopMixerThread
+
+must be called by main thread without holding the sound lock
+=================
+*/
+void S_StopMixerThread( void )
+{
+#if XASH_THREADS
+	if( !snd_thread.active )
+		return;
+
+	Sys_LockMutex( snd_thread.lock );
+	snd_thread.quit = true;
+	Sys_UnlockMutex( snd_thread.lock );
+
+	Sys_JoinThread( snd_thread.thread );
+	snd_thread.thread = NULL;
+
+	snd_thread.active = false;
+	Sys_DestroyMutex( snd_thread.lock );
+	snd_thread.lock = NULL;
+#endif
+}
+
+/*
+=================
+S_MixerThreadActive
+=================
+*/
+qboolean S_MixerThreadActive( void )
+{
+#if XASH_THREADS
+	return snd_thread.active;
+#else
+	return false;
+#endif
+}
+
+/*
+=================
+S_LockSound
+
+guards channels, raw channels and sound cache from the mixer thread,
+can be nested and does nothing if thread isn't running
+=================
+*/
+void S_LockSound( void )
+{
+#if XASH_THREADS
+	if( snd_thread.active )
+		Sys_LockMutex( snd_thread.lock );
+#endif
+}
+
+void S_UnlockSound( void )
+{
+#if XASH_THREADS
+	if( snd_thread.active )
+		Sys_UnlockMutex( snd_thread.lock );
+#endif
+}
+
+/*
+=================
+S_PrintMixerThreadState
+=================
+*/
+void S_PrintMixerThreadState( void )
+{
+#if XASH_THREADS
+	if( snd_thread.active )
+	{
+		uint passes;
+
+		Sys_LockMutex( snd_thread.lock );
+		passes = snd_thread.passes;
+		Sys_UnlockMutex( snd_thread.lock );
+
+		Con_Printf( "mixer thread: running, %u passes\n", passes );
+		return;
+	}
+#endif
+	Con_Printf( "mixer thread: not running\n" );
+}
@@ -207,8 +207,7 @@ void VOX_FreeWord( channel_t *ch )
 	if( !word->sfx || word->fKeepCached )
 		return;
 
-	FS_FreeSound( word->sfx->cache );
-	word->sfx->cache = NULL;
+	S_UnloadSound( word->sfx );
 	word->sfx = NULL;
 }
 
@@ -456,37 +455,45 @@ static qboolean VOX_ParseWordParams( char *psz, voxword_t *pvoxword, qboolean fF
 	return true;
 }
 
-void VOX_LoadSound( channel_t *ch, const char *pszin )
+/*
+=================
+VOX_ParseSentence
+
+fills words of a sentence and finds their sounds,
+returns number of words or -1 if sentence is broken
+=================
+*/
+static int VOX_ParseSentence( const char *pszin, voxword_t *words, qboolean verbose )
 {
 	char buffer[512] = { 0 }, szpath[32] = { 0 };
 	char *rgpparseword[CVOXWORDMAX] = { 0 };
 	const char *psz;
 	int i, j;
 
-	if( !pszin )
-		return;
-
 	psz = VOX_LookupString( pszin );
 
 	if( !psz )
 	{
 		// sometimes modders remove sentences but entities continue to use them, so it's a warning, not an error
-		Con_Printf( S_WARN "%s: no sentence named %s\n", __func__, pszin );
-		return;
+		if( verbose )
+			Con_Printf( S_WARN "%s: no sentence named %s\n", __func__, pszin );
+		return -1;
 	}
 
 	psz = VOX_GetDirectory( szpath, psz, sizeof( szpath ));
 
 	if( !psz )
 	{
-		Con_Printf( S_ERROR "%s: failed getting directory for %s\n", __func__, pszin );
-		return;
+		if( verbose )
+			Con_Printf( S_ERROR "%s: failed getting directory for %s\n", __func__, pszin );
+		return -1;
 	}
 
 	if( Q_strlen( psz ) >= sizeof( buffer ) )
 	{
-		Con_Printf( S_ERROR "%s: sentence is too long %s\n", __func__, psz );
-		return;
+		if( verbose )
+			Con_Printf( S_ERROR "%s: sentence is too long %s\n", __func__, psz );
+		return -1;
 	}
 
 	Q_strncpy( buffer, psz, sizeof( buffer ));
@@ -496,21 +503,46 @@ void VOX_LoadSound( channel_t *ch, const char *pszin )
 	{
 		char pathbuffer[MAX_SYSPATH];
 
-		if( !VOX_ParseWordParams( rgpparseword[i], &ch->words[j], i == 0 ))
+		if( !VOX_ParseWordParams( rgpparseword[i], &words[j], i == 0 ))
 			continue;
 
 		if( Q_snprintf( pathbuffer, sizeof( pathbuffer ), "%s%s", szpath, rgpparseword[i] ) < 0 )
 		{
-			Con_Printf( S_ERROR "%s: path to word in sentence %s is too long\n", __func__, pszin );
-			return;
+			if( verbose )
+				Con_Printf( S_ERROR "%s: path to word in sentence %s is too long\n", __func__, pszin );
+			return -1;
 		}
 
-		ch->words[j].sfx = S_FindName( pathbuffer, &ch->words[j].fKeepCached );
-
+		words[j].sfx = S_FindName( pathbuffer, &words[j].fKeepCached );
 		j++;
 	}
 
-	ch->words[j].sfx = NULL;
+	return j;
+}
+
+void VOX_LoadSound( channel_t *ch, const char *pszin )
+{
+	int i, count;
+
+	if( !pszin )
+		return;
+
+	count = VOX_ParseSentence( pszin, ch->words, true );
+
+	if( count < 0 )
+		return;
+
+	// mixer thread advances words on its own, so it must never load or free them
+	if( S_MixerThreadActive( ))
+	{
+		for( i = 0; i < count; i++ )
+		{
+			if( S_LoadSound( ch->words[i].sfx ))
+				ch->words[i].fKeepCached = true;
+		}
+	}
+
+	ch->words[count].sfx = NULL;
 	ch->sfx = ch->words[0].sfx;
 	ch->wordIndex = 0;
 	ch->isSentence = true;
@@ -518,6 +550,28 @@ void VOX_LoadSound( channel_t *ch, const char *pszin )
 	VOX_LoadWord( ch );
 }
 
+/*
+=================
+VOX_PreloadSound
+
+loads every word of a sentence, must be called without sound
+lock held, so VOX_LoadSound finds them in memory afterwards
+=================
+*/
+void VOX_PreloadSound( const char *pszin )
+{
+	voxword_t words[CVOXWORDMAX];
+	int i, count;
+
+	if( !pszin )
+		return;
+
+	count = VOX_ParseSentence( pszin, words, false );
+
+	for( i = 0; i < count; i++ )
+		S_LoadSound( words[i].sfx );
+}
+
 static void VOX_ReadSentenceFile_( byte *buf, fs_offset_t size )
 {
 	char *p, *last;
@@ -55,6 +55,11 @@ typedef struct sfx_s
 {
 	char          name[MAX_QPATH];
 	wavdata_t    *cache;
+	double        lastused;  // host.realtime of last S_LoadSound, for LRU eviction
+	size_t        size;      // decoded size, remembered after eviction
+	int           loads;     // times decoded from disk
+	int           evictions; // times dropped to fit into s_cachesize
+	qboolean      deferred;  // skipped at registration, loaded on first play
 
 	int           servercount;
 	uint          hashValue;
@@ -157,7 +162,11 @@ typedef struct
 	float    frametime;     // used for sound fade
 	qboolean active;
 	qboolean inmenu;        // listener in-menu ?
+	qboolean inconsole;     // console is open, only local sounds are played
 	qboolean paused;
+	qboolean background;    // background map plays both menu and game sounds
+	qboolean localgame;     // pausing menu stops world sounds
+	float    timescale;     // sys_timescale copy for mixer thread
 	qboolean streaming;     // playing AVI-file
 	qboolean stream_paused; // pause only background track
 } listener_t;
@@ -191,14 +200,19 @@ extern int        idsp_room;
 extern dma_t      dma;
 
 extern convar_t s_musicvolume;
+extern convar_t s_mixahead;
 extern convar_t s_lerping;
+extern convar_t s_mix_simd;
 extern convar_t s_test;  // cvar to test new effects
 extern convar_t s_samplecount;
 extern convar_t s_warn_late_precache;
+extern convar_t s_cachesize;
+extern convar_t s_largesound;
 extern convar_t snd_mute_losefocus;
 
 void S_InitScaletable( void );
 wavdata_t *S_LoadSound( sfx_t *sfx );
+void S_UnloadSound( sfx_t *sfx );
 float S_GetMasterVolume( void );
 float S_GetMusicVolume( void );
 
@@ -206,6 +220,7 @@ float S_GetMusicVolume( void );
 // s_main.c
 //
 void S_FreeChannel( channel_t *ch );
+void S_UpdateChannels( void );
 
 //
 // s_mix.c
@@ -215,6 +230,8 @@ void MIX_ClearAllPaintBuffers( int SampleCount, qboolean clearFilters );
 void MIX_InitAllPaintbuffers( void );
 void MIX_FreeAllPaintbuffers( void );
 void MIX_PaintChannels( int endtime );
+qboolean S_ShouldContinueMixing( channel_t *ch );
+void S_MixBenchmark_f( void );
 
 // s_load.c
 qboolean S_TestSoundChar( const char *pch, char c );
@@ -269,6 +286,16 @@ void S_StreamBackgroundTrack( void );
 void S_PrintBackgroundTrackState( void );
 void S_FadeMusicVolume( float fadePercent );
 
+//
+// s_thread.c
+//
+qboolean S_StartMixerThread( void );
+void S_StopMixerThread( void );
+qboolean S_MixerThreadActive( void );
+void S_LockSound( void );
+void S_UnlockSound( void );
+void S_PrintMixerThreadState( void );
+
 //
 // s_utils.c
 //
@@ -284,6 +311,7 @@ void VOX_Init( void );
 void VOX_Shutdown( void );
 void VOX_SetChanVol( channel_t *ch );
 void VOX_LoadSound( channel_t *pchan, const char *psz );
+void VOX_PreloadSound( const char *psz );
 float VOX_ModifyPitch( channel_t *ch, float pitch );
 int VOX_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int outputOffset );
 
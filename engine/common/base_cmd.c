@@ -218,7 +218,7 @@ initialize base command hashmap system
 */
 void BaseCmd_Init( void )
 {
-	basecmd_pool = Mem_AllocPool( "BaseCmd" );
+	basecmd_pool = Mem_AllocPoolExt( "BaseCmd", MEMPOOL_SLAB );
 	memset( hashed_cmds, 0, sizeof( hashed_cmds ) );
 }
 
@@ -375,6 +375,9 @@ typedef void (*xcommand_t)( void );
 //
 // zone.c
 //
+#define MEMPOOL_SLAB  BIT( 0 ) // small allocations are served from per size class slabs
+#define MEMPOOL_ARENA BIT( 1 ) // bump allocator, memory is reclaimed by Mem_EmptyPool
+
 void Memory_Init( void );
 void _Mem_Free( void *data, const char *filename, int fileline );
 void *_Mem_Realloc( poolhandle_t poolptr, void *memptr, size_t size, qboolean clear, const char *filename, int fileline )
@@ -383,6 +386,8 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 	ALLOC_CHECK( 2 ) MALLOC_LIKE( _Mem_Free, 1 ) WARN_UNUSED_RESULT;
 poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int fileline )
 	WARN_UNUSED_RESULT;
+poolhandle_t _Mem_AllocPoolExt( const char *name, int flags, const char *filename, int fileline )
+	WARN_UNUSED_RESULT;
 void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline );
 void _Mem_EmptyPool( poolhandle_t poolptr, const char *filename, int fileline );
 void _Mem_Check( const char *filename, int fileline );
@@ -395,6 +400,7 @@ void Mem_PrintStats( void );
 #define Mem_Realloc( pool, ptr, size ) _Mem_Realloc( pool, ptr, size, true, __FILE__, __LINE__ )
 #define Mem_Free( mem ) _Mem_Free( mem, __FILE__, __LINE__ )
 #define Mem_AllocPool( name ) _Mem_AllocPool( name, __FILE__, __LINE__ )
+#define Mem_AllocPoolExt( name, flags ) _Mem_AllocPoolExt( name, flags, __FILE__, __LINE__ )
 #define Mem_FreePool( pool ) _Mem_FreePool( pool, __FILE__, __LINE__ )
 #define Mem_EmptyPool( pool ) _Mem_EmptyPool( pool, __FILE__, __LINE__ )
 #define Mem_IsAllocated( mem ) Mem_IsAllocatedExt( NULL, mem )
@@ -472,6 +478,7 @@ void Cmd_Escape( char *newCommand, const char *oldCommand, int len );
 void Image_Setup( void );
 void Image_Init( void );
 void Image_Shutdown( void );
+void Image_CacheInit( void );
 void Image_AddCmdFlags( uint flags );
 void FS_FreeImage( rgbdata_t *pack );
 rgbdata_t *FS_LoadImage( const char *filename, const byte *buffer, size_t size ) MALLOC_LIKE( FS_FreeImage, 1 ) WARN_UNUSED_RESULT;
@@ -544,6 +551,10 @@ int FS_GetStreamPos( stream_t *stream );
 qboolean Sound_Process( wavdata_t **wav, int rate, int width, int channels, uint flags );
 uint Sound_GetApproxWavePlayLen( const char *filepath );
 qboolean Sound_SupportedFileFormat( const char *fileext );
+void Sound_CacheInit( void );
+qboolean Sound_CacheKey( const char *ext, const byte *buffer, fs_offset_t filesize, uint32_t variant, uint32_t key[2] );
+wavdata_t *Sound_CacheLoad( const uint32_t key[2] ) MALLOC_LIKE( FS_FreeSound, 1 ) WARN_UNUSED_RESULT;
+void Sound_CacheStore( const uint32_t key[2], const wavdata_t *sc );
 
 //
 // host.c
@@ -667,6 +678,15 @@ void Con_CompleteCommand( field_t *field );
 void Cmd_AutoComplete( char *complete_string );
 void Cmd_AutoCompleteClear( void );
 
+//
+// jobs.c
+//
+typedef void (*pfnJobRange)( void *ctx, int start, int end );
+void COM_InitJobs( void );
+void COM_ShutdownJobs( void );
+void COM_ParallelFor( int count, int batch, pfnJobRange func, void *ctx );
+int COM_NumJobThreads( void );
+
 //
 // custom.c
 //
@@ -43,109 +43,424 @@ static con_autocomplete_t		con;
 /*
 =======================================================================
 
-			FILENAME AUTOCOMPLETION
+			MAP INFO CACHE
+
+	parsing every map for maps.lst and map name completion means
+	reading whole entity lump of each bsp, so results are kept in
+	a table keyed by path, size and modification time of the map and
+	its .ent override, stored in the game directory between sessions.
+	only new or changed maps are parsed again
 
 =======================================================================
 */
+#define MAPCACHE_IDENT     (('C'<<24)+('P'<<16)+('A'<<8)+'M') // little-endian "MAPC"
+#define MAPCACHE_VERSION   2
+#define MAPCACHE_FILE      "maps.cache"
+#define MAPCACHE_HASH_SIZE 1024
+
+#define MAPINFO_GAMEDIRONLY BIT( 0 ) // part of the key, map was opened from game directory only
+#define MAPINFO_VALID       BIT( 1 ) // passed Mod_TestBmodelLumps
+#define MAPINFO_ENTITIES    BIT( 2 ) // entity lump or .ent file was parsed
+#define MAPINFO_WORLDSPAWN  BIT( 3 ) // worldspawn entity is complete
+#define MAPINFO_MPENTITY    BIT( 4 ) // has multiplayer spawn point entity
+#define MAPINFO_MESSAGE     BIT( 5 ) // worldspawn has a message key
+#define MAPINFO_SEEN        BIT( 31 ) // runtime only, entry was checked in this session
+
+typedef struct mapcache_header_s
+{
+	uint32_t ident;
+	uint32_t version;
+	uint32_t entrysize;
+	uint32_t numentries;
+	uint32_t mp_entity;  // crc of GI->mp_entity, spawn point flag depends on it
+} mapcache_header_t;
+
+typedef struct mapinfo_s
+{
+	char     name[MAX_QPATH];
+	int64_t  size;
+	int32_t  filetime;
+	int32_t  enttime;    // -1 if there is no .ent file
+	int32_t  version;    // -1 if map can't be opened
+	int32_t  extversion; // XashXT extra header
+	uint32_t flags;
+	char     message[MAX_STRING];
+	char     compiler[MAX_QPATH];
+	char     generator[MAX_QPATH];
+} mapinfo_t;
+
+static struct
+{
+	mapinfo_t *entries;
+	int       *hashnext;  // index + 1
+	int       hashfirst[MAPCACHE_HASH_SIZE];
+	int       numentries;
+	int       maxentries;
+	qboolean  loaded;
+	qboolean  dirty;
+	char      gamedir[MAX_QPATH];
+
+	// stats for last update
+	int       numchecked;
+	int       numparsed;
+} mapcache;
+
 /*
 =====================================
-Cmd_ListMaps
+Cmd_MapCacheEntityKey
 
+whole mp_entity name, whatever its length is
 =====================================
 */
-int Cmd_ListMaps( search_t *t, char *lastmapname, size_t len )
+static uint32_t Cmd_MapCacheEntityKey( void )
+{
+	uint32_t crc;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, GI->mp_entity, Q_strnlen( GI->mp_entity, sizeof( GI->mp_entity )));
+
+	return CRC32_Final( crc );
+}
+
+/*
+=====================================
+Cmd_MapCacheInsert
+
+=====================================
+*/
+static mapinfo_t *Cmd_MapCacheInsert( const char *name, uint32_t flags )
 {
-	byte   buf[MAX_SYSPATH]; // 1 kb
+	mapinfo_t *info;
+	uint hash;
+
+	if( mapcache.numentries == mapcache.maxentries )
+	{
+		mapcache.maxentries = Q_max( 256, mapcache.maxentries * 2 );
+		mapcache.entries = Mem_Realloc( host.mempool, mapcache.entries, mapcache.maxentries * sizeof( *mapcache.entries ));
+		mapcache.hashnext = Mem_Realloc( host.mempool, mapcache.hashnext, mapcache.maxentries * sizeof( *mapcache.hashnext ));
+	}
+
+	info = &mapcache.entries[mapcache.numentries];
+	memset( info, 0, sizeof( *info ));
+	Q_strncpy( info->name, name, sizeof( info->name ));
+	info->flags = flags & MAPINFO_GAMEDIRONLY;
+
+	hash = COM_HashKey( info->name, MAPCACHE_HASH_SIZE );
+	mapcache.hashnext[mapcache.numentries] = mapcache.hashfirst[hash];
+	mapcache.hashfirst[hash] = ++mapcache.numentries;
+
+	return info;
+}
+
+/*
+=====================================
+Cmd_MapCacheFind
+
+=====================================
+*/
+static mapinfo_t *Cmd_MapCacheFind( const char *name, uint32_t flags )
+{
+	int i;
+
+	for( i = mapcache.hashfirst[COM_HashKey( name, MAPCACHE_HASH_SIZE )]; i; i = mapcache.hashnext[i - 1] )
+	{
+		mapinfo_t *info = &mapcache.entries[i - 1];
+
+		if(( info->flags & MAPINFO_GAMEDIRONLY ) == ( flags & MAPINFO_GAMEDIRONLY ) && !Q_stricmp( info->name, name ))
+			return info;
+	}
+
+	return NULL;
+}
+
+/*
+=====================================
+Cmd_MapCacheClear
+
+=====================================
+*/
+static void Cmd_MapCacheClear( void )
+{
+	memset( mapcache.hashfirst, 0, sizeof( mapcache.hashfirst ));
+	mapcache.numentries = 0;
+	mapcache.dirty = false;
+}
+
+/*
+=====================================
+Cmd_MapCacheLoad
+
+reads cache of current game on first use
+=====================================
+*/
+static void Cmd_MapCacheLoad( void )
+{
+	mapcache_header_t hdr;
 	file_t *f;
-	int i, nummaps;
-	string mapname, message, compiler, generator;
+	uint i;
 
-	for( i = 0, nummaps = 0; i < t->numfilenames; i++ )
+	if( mapcache.loaded && !Q_strcmp( mapcache.gamedir, GI->gamefolder ))
+		return;
+
+	Cmd_MapCacheClear();
+	Q_strncpy( mapcache.gamedir, GI->gamefolder, sizeof( mapcache.gamedir ));
+	mapcache.loaded = true;
+
+	if( !( f = FS_Open( MAPCACHE_FILE, "rb", true )))
+		return;
+
+	if( FS_Read( f, &hdr, sizeof( hdr )) != sizeof( hdr )
+		|| hdr.ident != MAPCACHE_IDENT || hdr.version != MAPCACHE_VERSION
+		|| hdr.entrysize != sizeof( mapinfo_t ) || hdr.mp_entity != Cmd_MapCacheEntityKey( ))
 	{
-		char		entfilename[MAX_QPATH];
-		const char	*ext = COM_FileExtension( t->filenames[i] );
-		int		ver = -1, lumpofs = 0, lumplen = 0;
-		char		*ents = NULL, *pfile;
-		int		version = 0;
-		string	version_description;
+		// outdated, will be rewritten on next update
+		FS_Close( f );
+		return;
+	}
 
-		if( Q_stricmp( ext, "bsp" )) continue;
-		Q_strncpy( message, "^1error^7", sizeof( message ));
-		compiler[0] = '\0';
-		generator[0] = '\0';
+	for( i = 0; i < hdr.numentries; i++ )
+	{
+		mapinfo_t entry, *info;
 
-		f = FS_Open( t->filenames[i], "rb", con_gamemaps.value );
+		if( FS_Read( f, &entry, sizeof( entry )) != sizeof( entry ))
+			break;
 
-		if( f )
-		{
-			dheader_t *header;
-			dextrahdr_t	*hdrext;
-			dlump_t entities;
+		entry.name[sizeof( entry.name ) - 1] = 0;
+		entry.message[sizeof( entry.message ) - 1] = 0;
+		entry.compiler[sizeof( entry.compiler ) - 1] = 0;
+		entry.generator[sizeof( entry.generator ) - 1] = 0;
+		ClearBits( entry.flags, MAPINFO_SEEN );
 
-			memset( buf, 0, sizeof( buf ));
-			FS_Read( f, buf, sizeof( buf ));
-			header = (dheader_t *)buf;
-			ver = header->version;
+		if( Cmd_MapCacheFind( entry.name, entry.flags ))
+			continue;
 
-			// check all the lumps and some other errors
-			if( Mod_TestBmodelLumps( f, t->filenames[i], buf, true, &entities ))
-			{
-				lumpofs = entities.fileofs;
-				lumplen = entities.filelen;
-				ver = header->version;
-			}
+		info = Cmd_MapCacheInsert( entry.name, entry.flags );
+		*info = entry;
+	}
+
+	FS_Close( f );
+}
+
+/*
+=====================================
+Cmd_MapCacheSave
 
-			hdrext = (dextrahdr_t *)((byte *)buf + sizeof( dheader_t ));
-			if( hdrext->id == IDEXTRAHEADER ) version = hdrext->version;
+writes cache back if anything has changed,
+maps that were removed since are dropped
+=====================================
+*/
+static void Cmd_MapCacheSave( void )
+{
+	mapcache_header_t hdr;
+	file_t *f;
+	int i;
 
-			Q_strncpy( entfilename, t->filenames[i], sizeof( entfilename ));
-			COM_ReplaceExtension( entfilename, ".ent", sizeof( entfilename ));
-			ents = (char *)FS_LoadFile( entfilename, NULL, true );
+	if( !mapcache.dirty )
+		return;
 
-			if( !ents && lumplen >= 10 )
-			{
-				FS_Seek( f, lumpofs, SEEK_SET );
-				ents = (char *)Mem_Calloc( host.mempool, lumplen + 1 );
-				FS_Read( f, ents, lumplen );
-			}
+	if( !( f = FS_Open( MAPCACHE_FILE, "wb", true )))
+		return;
 
-			if( ents )
-			{
-				// if there are entities to parse, a missing message key just
-				// means there is no title, so clear the message string now
-				char	token[2048];
+	memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = MAPCACHE_IDENT;
+	hdr.version = MAPCACHE_VERSION;
+	hdr.entrysize = sizeof( mapinfo_t );
+	hdr.mp_entity = Cmd_MapCacheEntityKey();
+	FS_Write( f, &hdr, sizeof( hdr ));
 
-				message[0] = 0; // remove 'error'
-				pfile = ents;
+	for( i = 0; i < mapcache.numentries; i++ )
+	{
+		mapinfo_t entry = mapcache.entries[i];
 
-				while(( pfile = COM_ParseFile( pfile, token, sizeof( token ))) != NULL )
-				{
-					if( !Q_strcmp( token, "{" )) continue;
-					else if( !Q_strcmp( token, "}" )) break;
-					else if( !Q_strcmp( token, "message" ))
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, message, sizeof( message ));
-					}
-					else if( !Q_strcmp( token, "compiler" ) || !Q_strcmp( token, "_compiler" ))
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, compiler, sizeof( compiler ));
-					}
-					else if( !Q_strcmp( token, "generator" ) || !Q_strcmp( token, "_generator" ))
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, generator, sizeof( generator ));
-					}
-				}
-				Mem_Free( ents );
-			}
+		if( !FBitSet( entry.flags, MAPINFO_SEEN ) && FS_FileTime( entry.name, FBitSet( entry.flags, MAPINFO_GAMEDIRONLY )) == -1 )
+			continue;
+
+		ClearBits( entry.flags, MAPINFO_SEEN );
+		FS_Write( f, &entry, sizeof( entry ));
+		hdr.numentries++;
+	}
+
+	FS_Seek( f, 0, SEEK_SET );
+	FS_Write( f, &hdr, sizeof( hdr ));
+	FS_Close( f );
+
+	mapcache.dirty = false;
+}
+
+/*
+=====================================
+Cmd_ParseMapInfo
+
+reads everything maps.lst and map listing need
+=====================================
+*/
+static void Cmd_ParseMapInfo( mapinfo_t *info, qboolean gamedironly )
+{
+	byte        buf[MAX_SYSPATH]; // 1 kb
+	char        token[MAX_TOKEN];
+	char        entfilename[MAX_QPATH];
+	qboolean    worldspawn = true;
+	char        *ents = NULL, *pfile;
+	dextrahdr_t *hdrext;
+	dlump_t     entities;
+	qboolean    valid;
+	file_t      *f;
+
+	info->version = -1;
+	info->extversion = 0;
+	info->flags &= MAPINFO_GAMEDIRONLY|MAPINFO_SEEN;
+	info->message[0] = info->compiler[0] = info->generator[0] = 0;
+
+	if( !( f = FS_Open( info->name, "rb", gamedironly )))
+		return;
+
+	memset( buf, 0, sizeof( buf ));
+	FS_Read( f, buf, sizeof( buf ));
+	info->version = ((dheader_t *)buf)->version;
+
+	hdrext = (dextrahdr_t *)( buf + sizeof( dheader_t ));
+	if( hdrext->id == IDEXTRAHEADER ) info->extversion = hdrext->version;
+
+	// check all the lumps and some other errors
+	valid = Mod_TestBmodelLumps( f, info->name, buf, true, &entities );
+	if( valid ) SetBits( info->flags, MAPINFO_VALID );
+
+	Q_strncpy( entfilename, info->name, sizeof( entfilename ));
+	COM_ReplaceExtension( entfilename, ".ent", sizeof( entfilename ));
+	ents = (char *)FS_LoadFile( entfilename, NULL, true );
+
+	if( !ents && valid && entities.filelen >= 10 )
+	{
+		FS_Seek( f, entities.fileofs, SEEK_SET );
+		ents = (char *)Mem_Calloc( host.mempool, entities.filelen + 1 );
+		FS_Read( f, ents, entities.filelen );
+	}
+
+	FS_Close( f );
+
+	if( !ents )
+		return;
+
+	SetBits( info->flags, MAPINFO_ENTITIES );
+	pfile = ents;
+
+	while(( pfile = COM_ParseFile( pfile, token, sizeof( token ))) != NULL )
+	{
+		if( token[0] == '}' && worldspawn )
+		{
+			worldspawn = false;
+			SetBits( info->flags, MAPINFO_WORLDSPAWN );
+		}
+		else if( !Q_strcmp( token, "message" ) && worldspawn )
+		{
+			// get the message contents
+			pfile = COM_ParseFile( pfile, info->message, sizeof( info->message ));
+			SetBits( info->flags, MAPINFO_MESSAGE );
 		}
+		else if(( !Q_strcmp( token, "compiler" ) || !Q_strcmp( token, "_compiler" )) && worldspawn )
+		{
+			pfile = COM_ParseFile( pfile, info->compiler, sizeof( info->compiler ));
+		}
+		else if(( !Q_strcmp( token, "generator" ) || !Q_strcmp( token, "_generator" )) && worldspawn )
+		{
+			pfile = COM_ParseFile( pfile, info->generator, sizeof( info->generator ));
+		}
+		else if( !Q_strcmp( token, "classname" ))
+		{
+			pfile = COM_ParseFile( pfile, token, sizeof( token ));
+
+			if( !Q_strcmp( token, GI->mp_entity ))
+				SetBits( info->flags, MAPINFO_MPENTITY );
+		}
+
+		// nothing else to look for
+		if( !worldspawn && FBitSet( info->flags, MAPINFO_MPENTITY ))
+			break;
+	}
+
+	Mem_Free( ents );
+}
+
+/*
+=====================================
+Cmd_GetMapInfo
+
+returns cached map info, parses the map
+again if it was changed since
+=====================================
+*/
+static const mapinfo_t *Cmd_GetMapInfo( const char *name, qboolean gamedironly )
+{
+	uint32_t flags = gamedironly ? MAPINFO_GAMEDIRONLY : 0;
+	char entfilename[MAX_QPATH];
+	int filetime, enttime;
+	fs_offset_t size;
+	mapinfo_t *info;
+
+	Cmd_MapCacheLoad();
+
+	Q_strncpy( entfilename, name, sizeof( entfilename ));
+	COM_ReplaceExtension( entfilename, ".ent", sizeof( entfilename ));
+
+	filetime = FS_FileTime( name, gamedironly );
+	enttime = FS_FileTime( entfilename, true );
+	size = FS_FileSize( name, gamedironly );
+	mapcache.numchecked++;
+
+	info = Cmd_MapCacheFind( name, flags );
+
+	if( info && info->size == size && info->filetime == filetime && info->enttime == enttime )
+	{
+		SetBits( info->flags, MAPINFO_SEEN );
+		return info;
+	}
+
+	if( !info )
+		info = Cmd_MapCacheInsert( name, flags );
+
+	info->size = size;
+	info->filetime = filetime;
+	info->enttime = enttime;
+	SetBits( info->flags, MAPINFO_SEEN );
 
-		if( f ) FS_Close(f);
+	Cmd_ParseMapInfo( info, gamedironly );
+	mapcache.numparsed++;
+	mapcache.dirty = true;
+
+	return info;
+}
+
+/*
+=======================================================================
+
+			FILENAME AUTOCOMPLETION
+
+=======================================================================
+*/
+/*
+=====================================
+Cmd_ListMaps
+
+=====================================
+*/
+int Cmd_ListMaps( search_t *t, char *lastmapname, size_t len )
+{
+	int i, nummaps;
+	string mapname;
+
+	for( i = 0, nummaps = 0; i < t->numfilenames; i++ )
+	{
+		const mapinfo_t *info;
+		const char	*message;
+		string	version_description;
+
+		if( Q_stricmp( COM_FileExtension( t->filenames[i] ), "bsp" )) continue;
+
+		info = Cmd_GetMapInfo( t->filenames[i], con_gamemaps.value );
+		message = FBitSet( info->flags, MAPINFO_ENTITIES ) ? info->message : "^1error^7";
 		COM_FileBase( t->filenames[i], mapname, sizeof( mapname ));
 
-		switch( ver )
+		switch( info->version )
 		{
 		case Q1BSP_VERSION:
 			Q_strncpy( version_description, "Quake", sizeof( version_description ));
@@ -154,7 +469,7 @@ int Cmd_ListMaps( search_t *t, char *lastmapname, size_t len )
 			Q_strncpy( version_description, "Darkplaces BSP2", sizeof( version_description ));
 			break;
 		case HLBSP_VERSION:
-			switch( version )
+			switch( info->extversion )
 			{
 			case 1: Q_strncpy( version_description, "XashXT old format", sizeof( version_description )); break;
 			case 2: Q_strncpy( version_description, "Paranoia 2: Savior", sizeof( version_description )); break;
@@ -165,10 +480,12 @@ int Cmd_ListMaps( search_t *t, char *lastmapname, size_t len )
 		default:	Q_strncpy( version_description, "??", sizeof( version_description )); break;
 		}
 
-		Con_Printf( "%16s (%s) ^3%s^7 ^2%s %s^7\n", mapname, version_description, message, compiler, generator );
+		Con_Printf( "%16s (%s) ^3%s^7 ^2%s %s^7\n", mapname, version_description, message, info->compiler, info->generator );
 		nummaps++;
 	}
 
+	Cmd_MapCacheSave();
+
 	if( lastmapname && len )
 		Q_strncpy( lastmapname, mapname, len );
 
@@ -851,14 +1168,11 @@ static qboolean Cmd_GetCDList( const char *s, char *completedname, int length )
 static qboolean Cmd_CheckMapsList_R( qboolean fRefresh, qboolean onlyingamedir )
 {
 	qboolean	use_filter = false;
-	byte	buf[MAX_SYSPATH];
 	string	mpfilter;
 	char	*buffer;
 	size_t	buffersize;
-	string	result;
 	int	i, size;
 	search_t	*t;
-	file_t	*f;
 
 	if( FS_FileSize( "maps.lst", onlyingamedir ) > 0 && !fRefresh )
 		return true; // exist
@@ -877,15 +1191,16 @@ static qboolean Cmd_CheckMapsList_R( qboolean fRefresh, qboolean onlyingamedir )
 		return false;
 	}
 
-	buffersize = t->numfilenames * 2 * sizeof( result );
+	buffersize = t->numfilenames * 2 * sizeof( string );
 	buffer = Mem_Calloc( host.mempool, buffersize );
 	use_filter = COM_CheckStringEmpty( GI->mp_filter ) ? true : false;
+	mapcache.numchecked = mapcache.numparsed = 0;
 
-	for( i = 0; i < t->numfilenames; i++ )
+	for( i = 0, size = 0; i < t->numfilenames; i++ )
 	{
-		char		*ents = NULL, *pfile;
-		int		lumpofs = 0, lumplen = 0;
-		string		mapname, message, entfilename;
+		const mapinfo_t	*info;
+		qboolean		have_spawnpoints;
+		string		mapname;
 
 		if( Q_stricmp( COM_FileExtension( t->filenames[i] ), "bsp" ))
 			continue;
@@ -893,99 +1208,33 @@ static qboolean Cmd_CheckMapsList_R( qboolean fRefresh, qboolean onlyingamedir )
 		if( use_filter && Q_stristr( t->filenames[i], mpfilter ))
 			continue;
 
-		f = FS_Open( t->filenames[i], "rb", onlyingamedir );
-		COM_FileBase( t->filenames[i], mapname, sizeof( mapname ));
+		info = Cmd_GetMapInfo( t->filenames[i], onlyingamedir );
 
-		if( f )
-		{
-			qboolean  have_spawnpoints = false;
-			dlump_t   entities;
-
-			memset( buf, 0, MAX_SYSPATH );
-			FS_Read( f, buf, MAX_SYSPATH );
-
-			// check all the lumps and some other errors
-			if( !Mod_TestBmodelLumps( f, t->filenames[i], buf, true, &entities ))
-			{
-				FS_Close( f );
-				continue;
-			}
-
-			// after call Mod_TestBmodelLumps we gurantee what map is valid
-			lumpofs = entities.fileofs;
-			lumplen = entities.filelen;
-
-			Q_strncpy( entfilename, t->filenames[i], sizeof( entfilename ));
-			COM_ReplaceExtension( entfilename, ".ent", sizeof( entfilename ));
-			ents = (char *)FS_LoadFile( entfilename, NULL, true );
-
-			if( !ents && lumplen >= 10 )
-			{
-				FS_Seek( f, lumpofs, SEEK_SET );
-				ents = Z_Calloc( lumplen + 1 );
-				FS_Read( f, ents, lumplen );
-			}
-
-			if( ents )
-			{
-				// if there are entities to parse, a missing message key just
-				// means there is no title, so clear the message string now
-				char	token[MAX_TOKEN];
-				qboolean	worldspawn = true;
+		// after call Mod_TestBmodelLumps we gurantee what map is valid
+		if( !FBitSet( info->flags, MAPINFO_VALID ) || !FBitSet( info->flags, MAPINFO_ENTITIES ))
+			continue;
 
-				Q_strncpy( message, "No Title", sizeof( message ));
-				pfile = ents;
+		have_spawnpoints = FBitSet( info->flags, MAPINFO_MPENTITY ) ? true : false;
 
-				while(( pfile = COM_ParseFile( pfile, token, sizeof( token ))) != NULL )
-				{
-					if( token[0] == '}' && worldspawn )
-					{
-						worldspawn = false;
-
-						// if mod has mp_filter set up, then it's a mod that
-						// might not have valid mp_entity set in GI
-						// if mod is multiplayer only, assume all maps are valid
-						if( use_filter || GI->gamemode == GAME_MULTIPLAYER_ONLY )
-						{
-							have_spawnpoints = true;
-							break;
-						}
-					}
-					else if( !Q_strcmp( token, "message" ) && worldspawn )
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, message, sizeof( message ));
-					}
-					else if( !Q_strcmp( token, "classname" ))
-					{
-						pfile = COM_ParseFile( pfile, token, sizeof( token ));
-
-						if( !Q_strcmp( token, GI->mp_entity ))
-						{
-							have_spawnpoints = true;
-							break;
-						}
-					}
-
-					if( have_spawnpoints )
-						break; // valid map
-				}
-				Mem_Free( ents );
-			}
+		// if mod has mp_filter set up, then it's a mod that
+		// might not have valid mp_entity set in GI
+		// if mod is multiplayer only, assume all maps are valid
+		if( FBitSet( info->flags, MAPINFO_WORLDSPAWN ) && ( use_filter || GI->gamemode == GAME_MULTIPLAYER_ONLY ))
+			have_spawnpoints = true;
 
-			if( f ) FS_Close( f );
+		if( !have_spawnpoints )
+			continue;
 
-			if( have_spawnpoints )
-			{
-				// format: mapname "maptitle"\n
-				Q_snprintf( result, sizeof( result ), "%s \"%s\"\n", mapname, message );
-				Q_strncat( buffer, result, buffersize ); // add new string
-			}
-		}
+		// format: mapname "maptitle"\n
+		COM_FileBase( t->filenames[i], mapname, sizeof( mapname ));
+		size += Q_snprintf( buffer + size, buffersize - size, "%s \"%s\"\n", mapname,
+			FBitSet( info->flags, MAPINFO_MESSAGE ) ? info->message : "No Title" );
 	}
 
 	if( t ) Mem_Free( t ); // free search result
-	size = Q_strlen( buffer );
+	Cmd_MapCacheSave();
+
+	Con_Reportf( "%s: %d maps checked, %d parsed\n", __func__, mapcache.numchecked, mapcache.numparsed );
 
 	if( !size )
 	{
@@ -1335,7 +1335,7 @@ Reads in all archived cvars
 */
 void Cvar_Init( void )
 {
-	cvar_pool = Mem_AllocPool( "Console Variables" );
+	cvar_pool = Mem_AllocPoolExt( "Console Variables", MEMPOOL_SLAB );
 	cvar_vars = NULL;
 	cvar_active_filter_quirks = NULL;
 	Cvar_RegisterVariable( &cmd_scripting );
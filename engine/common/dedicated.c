@@ -187,4 +187,10 @@ byte LightToTexGamma( byte b )
 	return b;
 }
 
+void FS_FreeSound( wavdata_t *pack )
+{
+	// sound cache can still be loaded from
+	Mem_Free( pack );
+}
+
 #endif // XASH_DEDICATED
@@ -0,0 +1,348 @@
+/*
+diskcache.c - persistent cache of decoded resources
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "xash3d_mathlib.h"
+#include "diskcache.h"
+
+static const char *DiskCache_GameDir( void )
+{
+	return ( FI && GI ) ? GI->gamefolder : "";
+}
+
+static qboolean DiskCache_GameDirOnly( void )
+{
+	// before game is mounted we can only use root directory
+	return FI && GI;
+}
+
+static void DiskCache_EntryPath( const diskcache_t *dc, char *path, size_t size, const uint32_t key[2] )
+{
+	Q_snprintf( path, size, "%s/%08x%08x.%s", dc->dir, key[0], key[1], dc->ext );
+}
+
+static int DiskCache_FindEntry( const diskcache_t *dc, const uint32_t key[2] )
+{
+	int i;
+
+	for( i = 0; i < dc->numentries; i++ )
+	{
+		if( dc->entries[i].key[0] == key[0] && dc->entries[i].key[1] == key[1] )
+			return i;
+	}
+
+	return -1;
+}
+
+static void DiskCache_RemoveEntry( diskcache_t *dc, int idx )
+{
+	dc->totalsize -= dc->entries[idx].filesize;
+	dc->numentries--;
+
+	if( idx != dc->numentries )
+		dc->entries[idx] = dc->entries[dc->numentries];
+}
+
+static int DiskCache_SortByTime( const void *a, const void *b )
+{
+	const diskcache_entry_t *ea = a, *eb = b;
+
+	// at scan time lastused holds file time
+	if( ea->lastused < eb->lastused )
+		return -1;
+	return ea->lastused > eb->lastused;
+}
+
+/*
+=================
+DiskCache_BuildIndex
+
+scans cache directory, oldest files will be evicted first
+=================
+*/
+static void DiskCache_BuildIndex( diskcache_t *dc )
+{
+	char pattern[MAX_QPATH];
+	search_t *t;
+	int i;
+
+	dc->numentries = 0;
+	dc->totalsize = 0;
+	dc->sequence = 0;
+	dc->indexed = true;
+	Q_strncpy( dc->gamedir, DiskCache_GameDir(), sizeof( dc->gamedir ));
+
+	if( !dc->entries )
+		dc->entries = Mem_Malloc( *dc->pool, sizeof( *dc->entries ) * DISKCACHE_MAX_ENTRIES );
+
+	Q_snprintf( pattern, sizeof( pattern ), "%s/*.%s", dc->dir, dc->ext );
+	t = FS_Search( pattern, true, DiskCache_GameDirOnly( ));
+	if( !t ) return;
+
+	for( i = 0; i < t->numfilenames && dc->numentries < DISKCACHE_MAX_ENTRIES; i++ )
+	{
+		diskcache_entry_t *e = &dc->entries[dc->numentries];
+		const char *name = COM_FileWithoutPath( t->filenames[i] );
+		int filetime;
+
+		if( sscanf( name, "%08x%08x", &e->key[0], &e->key[1] ) != 2 )
+			continue;
+
+		e->filesize = FS_FileSize( t->filenames[i], DiskCache_GameDirOnly( ));
+		filetime = FS_FileTime( t->filenames[i], DiskCache_GameDirOnly( ));
+		e->lastused = Q_max( filetime, 0 );
+		dc->totalsize += e->filesize;
+		dc->numentries++;
+	}
+
+	Mem_Free( t );
+
+	qsort( dc->entries, dc->numentries, sizeof( *dc->entries ), DiskCache_SortByTime );
+
+	for( i = 0; i < dc->numentries; i++ )
+		dc->entries[i].lastused = dc->sequence++;
+}
+
+static qboolean DiskCache_Ready( diskcache_t *dc )
+{
+	if( !dc->enabled->value )
+		return false;
+
+	if( !dc->indexed || Q_strcmp( dc->gamedir, DiskCache_GameDir( )))
+		DiskCache_BuildIndex( dc );
+
+	return true;
+}
+
+static size_t DiskCache_Limit( const diskcache_t *dc )
+{
+	return (size_t)Q_max( dc->maxsize->value, 0.0f ) * 1024 * 1024;
+}
+
+/*
+=================
+DiskCache_Evict
+
+drop least recently used entries until we fit into the limit
+=================
+*/
+void DiskCache_Evict( diskcache_t *dc, size_t required )
+{
+	size_t limit = DiskCache_Limit( dc );
+	char path[MAX_QPATH];
+
+	while( dc->numentries > 0 && ( dc->totalsize + required > limit || dc->numentries >= DISKCACHE_MAX_ENTRIES ))
+	{
+		int i, oldest = 0;
+
+		for( i = 1; i < dc->numentries; i++ )
+		{
+			if( dc->entries[i].lastused < dc->entries[oldest].lastused )
+				oldest = i;
+		}
+
+		DiskCache_EntryPath( dc, path, sizeof( path ), dc->entries[oldest].key );
+		FS_Delete( path );
+		DiskCache_RemoveEntry( dc, oldest );
+		dc->evicted++;
+	}
+}
+
+/*
+=================
+DiskCache_Load
+
+decodes entry into out with owner's read callback
+=================
+*/
+qboolean DiskCache_Load( diskcache_t *dc, const uint32_t key[2], void *out )
+{
+	const diskcache_header_t *hdr;
+	char path[MAX_QPATH];
+	fs_offset_t filesize;
+	size_t decoded = 0;
+	byte *file;
+	int idx;
+
+	if( !DiskCache_Ready( dc ))
+		return false;
+
+	idx = DiskCache_FindEntry( dc, key );
+
+	if( idx < 0 )
+	{
+		dc->misses++;
+		return false;
+	}
+
+	DiskCache_EntryPath( dc, path, sizeof( path ), key );
+	file = FS_LoadFile( path, &filesize, DiskCache_GameDirOnly( ));
+	hdr = (const diskcache_header_t *)file;
+
+	if( file && filesize >= sizeof( *hdr ) && hdr->ident == dc->ident && hdr->version == dc->version
+		&& hdr->key[0] == key[0] && hdr->key[1] == key[1] )
+		decoded = dc->funcs.read( file, filesize, out );
+
+	if( file )
+		Mem_Free( file );
+
+	if( !decoded )
+	{
+		// corrupted or stale, forget about it
+		FS_Delete( path );
+		DiskCache_RemoveEntry( dc, idx );
+		dc->misses++;
+		return false;
+	}
+
+	dc->entries[idx].lastused = dc->sequence++;
+	dc->hits++;
+	dc->bytes_saved += decoded;
+
+	return true;
+}
+
+/*
+=================
+DiskCache_Store
+
+save freshly decoded data with owner's write callback
+=================
+*/
+void DiskCache_Store( diskcache_t *dc, const uint32_t key[2], const void *data )
+{
+	diskcache_header_t hdr;
+	diskcache_entry_t *e;
+	char path[MAX_QPATH];
+	size_t filesize;
+	file_t *f;
+
+	if( !DiskCache_Ready( dc ) || DiskCache_FindEntry( dc, key ) >= 0 )
+		return;
+
+	filesize = dc->funcs.filesize( data );
+
+	if( !filesize || filesize > DiskCache_Limit( dc ))
+		return;
+
+	DiskCache_Evict( dc, filesize );
+
+	DiskCache_EntryPath( dc, path, sizeof( path ), key );
+	f = FS_Open( path, "wb", DiskCache_GameDirOnly( ));
+
+	if( !f )
+		return;
+
+	hdr.ident = dc->ident;
+	hdr.version = dc->version;
+	hdr.key[0] = key[0];
+	hdr.key[1] = key[1];
+
+	FS_Write( f, &hdr, sizeof( hdr ));
+	dc->funcs.write( f, data );
+	FS_Close( f );
+
+	e = &dc->entries[dc->numentries++];
+	e->key[0] = key[0];
+	e->key[1] = key[1];
+	e->filesize = filesize;
+	e->lastused = dc->sequence++;
+	dc->totalsize += filesize;
+	dc->stores++;
+}
+
+/*
+=================
+DiskCache_WriteAligned
+
+writes data and pads file up to DISKCACHE_ALIGN
+=================
+*/
+void DiskCache_WriteAligned( file_t *f, const void *data, size_t size )
+{
+	static const byte pad[DISKCACHE_ALIGN];
+	fs_offset_t pos;
+
+	FS_Write( f, data, size );
+	pos = FS_Tell( f );
+	FS_Write( f, pad, DISKCACHE_PAD( pos ) - pos );
+}
+
+void DiskCache_Info( diskcache_t *dc )
+{
+	uint total = dc->hits + dc->misses;
+
+	Con_Printf( "%s cache is %s\n", dc->name, dc->enabled->value ? "enabled" : "disabled" );
+	Con_Printf( "entries: %i, %s of %s\n", dc->numentries,
+		Q_memprint( dc->totalsize ), Q_memprint( DiskCache_Limit( dc )));
+	Con_Printf( "hits: %u, misses: %u (%.1f%% hit rate)\n", dc->hits, dc->misses,
+		total ? dc->hits * 100.0f / total : 0.0f );
+	Con_Printf( "stored: %u, evicted: %u\n", dc->stores, dc->evicted );
+	Con_Printf( "decoded bytes served from cache: %s\n", Q_memprint( dc->bytes_saved ));
+}
+
+void DiskCache_Flush( diskcache_t *dc )
+{
+	char path[MAX_QPATH];
+
+	if( !dc->indexed )
+		DiskCache_BuildIndex( dc );
+
+	while( dc->numentries > 0 )
+	{
+		DiskCache_EntryPath( dc, path, sizeof( path ), dc->entries[0].key );
+		FS_Delete( path );
+		DiskCache_RemoveEntry( dc, 0 );
+	}
+}
+
+void DiskCache_Shutdown( diskcache_t *dc )
+{
+	// memory is owned by owner's pool
+	dc->entries = NULL;
+	dc->numentries = 0;
+	dc->totalsize = 0;
+	dc->indexed = false;
+}
+
+#if XASH_ENGINE_TESTS
+void DiskCache_BeginTest( diskcache_t *dc, diskcache_test_t *test )
+{
+	// don't touch user's cache, its index and settings
+	test->saved = *dc;
+	Q_snprintf( test->dir, sizeof( test->dir ), "%s_test", dc->dir );
+	Q_strncpy( test->enabled, dc->enabled->string, sizeof( test->enabled ));
+	Q_strncpy( test->maxsize, dc->maxsize->string, sizeof( test->maxsize ));
+
+	dc->dir = test->dir;
+	dc->entries = NULL;
+	dc->numentries = 0;
+	dc->totalsize = 0;
+	dc->indexed = false;
+	Cvar_DirectSet( dc->maxsize, dc->maxsize->def_string );
+}
+
+void DiskCache_EndTest( diskcache_t *dc, const diskcache_test_t *test )
+{
+	DiskCache_Flush( dc );
+
+	if( dc->entries )
+		Mem_Free( dc->entries );
+
+	*dc = test->saved;
+	Cvar_DirectSet( dc->maxsize, test->maxsize );
+	Cvar_DirectSet( dc->enabled, test->enabled );
+}
+#endif // XASH_ENGINE_TESTS
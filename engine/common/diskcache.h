@@ -0,0 +1,109 @@
+/*
+diskcache.h - persistent cache of decoded resources
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+/*
+========================================================================
+
+every entry is a single file in the gamedir named after the 64-bit key
+that owner computes from source data and everything that changes the
+decoded result. file starts with diskcache_header_t, the rest is owner's
+payload, each part of it is aligned to DISKCACHE_ALIGN
+
+========================================================================
+*/
+#define DISKCACHE_ALIGN       16
+#define DISKCACHE_MAX_ENTRIES 8192
+
+#define DISKCACHE_PAD( x ) ((( x ) + DISKCACHE_ALIGN - 1 ) & ~( DISKCACHE_ALIGN - 1 ))
+
+typedef struct diskcache_header_s
+{
+	uint32_t ident;
+	uint32_t version;
+	uint32_t key[2];
+} diskcache_header_t;
+
+typedef struct diskcache_entry_s
+{
+	uint32_t key[2];
+	size_t   filesize;
+	uint     lastused;   // LRU sequence
+} diskcache_entry_t;
+
+typedef struct diskcache_funcs_s
+{
+	// full file size including diskcache_header_t, 0 if data can't be stored
+	size_t (*filesize)( const void *data );
+
+	// writes payload after diskcache_header_t
+	void (*write)( file_t *f, const void *data );
+
+	// validates payload and decodes it into out, returns decoded size or 0 if entry is broken
+	size_t (*read)( const byte *file, fs_offset_t filesize, void *out );
+} diskcache_funcs_t;
+
+typedef struct diskcache_s
+{
+	// set by owner
+	const char  *name;    // for console messages
+	const char  *dir;
+	const char  *ext;
+	uint32_t    ident;
+	uint32_t    version;
+	convar_t    *enabled;
+	convar_t    *maxsize; // in megabytes
+	poolhandle_t *pool;   // owner's pool, may be created after the cache
+	diskcache_funcs_t funcs;
+
+	diskcache_entry_t *entries;
+	int      numentries;
+	size_t   totalsize;
+	uint     sequence;
+	qboolean indexed;
+	char     gamedir[MAX_QPATH]; // index is valid only for this game
+
+	// stats
+	uint     hits;
+	uint     misses;
+	uint     stores;
+	uint     evicted;
+	size_t   bytes_saved;
+} diskcache_t;
+
+qboolean DiskCache_Load( diskcache_t *dc, const uint32_t key[2], void *out );
+void DiskCache_Store( diskcache_t *dc, const uint32_t key[2], const void *data );
+void DiskCache_Evict( diskcache_t *dc, size_t required );
+void DiskCache_WriteAligned( file_t *f, const void *data, size_t size );
+void DiskCache_Info( diskcache_t *dc );
+void DiskCache_Flush( diskcache_t *dc );
+void DiskCache_Shutdown( diskcache_t *dc );
+
+#if XASH_ENGINE_TESTS
+typedef struct diskcache_test_s
+{
+	diskcache_t saved;
+	char        dir[MAX_QPATH];
+	char        enabled[32];
+	char        maxsize[32];
+} diskcache_test_t;
+
+// switches cache to empty private directory with default limit, and back
+void DiskCache_BeginTest( diskcache_t *dc, diskcache_test_t *test );
+void DiskCache_EndTest( diskcache_t *dc, const diskcache_test_t *test );
+#endif // XASH_ENGINE_TESTS
+
+#endif // DISKCACHE_H
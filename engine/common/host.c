@@ -81,6 +81,7 @@ CVAR_DEFINE_AUTO( fps_override, "1", FCVAR_FILTERABLE, "unlock higher framerate
 static CVAR_DEFINE_AUTO( host_framerate, "0", FCVAR_FILTERABLE, "locks frame timing to this value in seconds" );
 static CVAR_DEFINE( host_sleeptime, "sleeptime", "1", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "milliseconds to sleep for each frame. higher values reduce fps accuracy" );
 static CVAR_DEFINE_AUTO( host_sleeptime_debug, "0", 0, "print sleeps between frames" );
+static CVAR_DEFINE_AUTO( sys_tickwait, "1", FCVAR_ARCHIVE|FCVAR_FILTERABLE, "dedicated server waits for network packets or exact tick deadline instead of fixed sleeps" );
 CVAR_DEFINE_AUTO( host_allow_materials, "0", FCVAR_LATCH|FCVAR_ARCHIVE, "allow texture replacements from materials/ folder" );
 CVAR_DEFINE( con_gamemaps, "con_mapfilter", "1", FCVAR_ARCHIVE, "when true show only maps in game folder" );
 
@@ -669,6 +670,168 @@ static double Host_CalcFPS( void )
 	return fps;
 }
 
+/*
+===============================================================================
+
+DEDICATED TICK SCHEDULER
+
+Ticks are scheduled on absolute deadlines, so oversleeping one frame doesn't
+shift the following ones. Between ticks server waits on its sockets and
+an incoming packet runs a frame early, but not earlier than half a tick
+after previous frame. Early frame takes the place of the next scheduled
+tick, so frame rate never goes over the tick rate on average. Lateness of
+each scheduled tick goes into a histogram.
+
+===============================================================================
+*/
+#define NUM_TICK_BUCKETS 9
+
+static const int tick_bucket_usec[NUM_TICK_BUCKETS - 1] =
+{
+	50, 100, 250, 500, 1000, 2000, 5000, 10000
+};
+
+static struct
+{
+	double nexttick;   // absolute deadline of next scheduled tick
+	double lastframe;  // start of last frame, scheduled or not
+	double sumlate;
+	double maxlate;
+	uint   ticks;
+	uint   early;      // frames woken up by network
+	uint   resyncs;    // schedule was reset after falling behind
+	uint   buckets[NUM_TICK_BUCKETS];
+} host_tick;
+
+/*
+==================
+Host_RecordTickLateness
+==================
+*/
+static void Host_RecordTickLateness( double late )
+{
+	int i, usec = (int)( late * 1000000.0 );
+
+	for( i = 0; i < NUM_TICK_BUCKETS - 1; i++ )
+	{
+		if( usec < tick_bucket_usec[i] )
+			break;
+	}
+
+	host_tick.buckets[i]++;
+	host_tick.ticks++;
+	host_tick.sumlate += late;
+	host_tick.maxlate = Q_max( host_tick.maxlate, late );
+}
+
+/*
+==================
+Host_TickWait
+
+returns true if it's time to run a frame
+==================
+*/
+static qboolean Host_TickWait( double interval )
+{
+	double now = Sys_DoubleTime();
+	double earliest;
+
+	if( host_tick.nexttick == 0.0 )
+		host_tick.nexttick = now;
+
+	if( now >= host_tick.nexttick )
+	{
+		Host_RecordTickLateness( now - host_tick.nexttick );
+
+		host_tick.nexttick += interval;
+
+		// fell behind by a whole tick, don't try to catch up with a burst of frames
+		if( host_tick.nexttick <= now )
+		{
+			host_tick.nexttick = now + interval;
+			host_tick.resyncs++;
+		}
+
+		host_tick.lastframe = now;
+		return true;
+	}
+
+	// interval got shorter, don't wait for old schedule, early
+	// frame may have legitimately moved it up to two ticks ahead
+	if( host_tick.nexttick - now > interval * 2 )
+		host_tick.nexttick = now + interval;
+
+	// after an early frame the tick it took is still ahead,
+	// don't take the next one before that tick was due
+	earliest = Q_max( host_tick.lastframe + interval * 0.5, host_tick.nexttick - interval );
+
+	if( now < earliest )
+	{
+		NET_WaitUntil( Q_min( earliest, host_tick.nexttick ), false );
+		return false;
+	}
+
+	if( NET_WaitUntil( host_tick.nexttick, true ))
+	{
+		// runs instead of the scheduled frame, so ticrate still caps the rate
+		host_tick.lastframe = Sys_DoubleTime();
+		host_tick.nexttick += interval;
+		host_tick.early++;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+==================
+Host_TickStats_f
+==================
+*/
+static void Host_TickStats_f( void )
+{
+	int i;
+
+	if( Cmd_Argc() > 1 )
+	{
+		if( Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+		{
+			Con_Printf( S_USAGE "host_tickstats [reset]\n" );
+			return;
+		}
+
+		host_tick.sumlate = host_tick.maxlate = 0.0;
+		host_tick.ticks = host_tick.early = host_tick.resyncs = 0;
+		memset( host_tick.buckets, 0, sizeof( host_tick.buckets ));
+		return;
+	}
+
+	if( !Host_IsDedicated( ) || !sys_tickwait.value || !host_sleeptime.value )
+		Con_Printf( "tick scheduler is not active\n" );
+
+	Con_Printf( "wait method: %s\n", NET_WaitMethod( ));
+	Con_Printf( "%u ticks, %u early frames, %u resyncs\n", host_tick.ticks, host_tick.early, host_tick.resyncs );
+
+	if( !host_tick.ticks )
+		return;
+
+	Con_Printf( "lateness: mean %.1f us, max %.1f us\n", host_tick.sumlate * 1000000.0 / host_tick.ticks, host_tick.maxlate * 1000000.0 );
+
+	for( i = 0; i < NUM_TICK_BUCKETS; i++ )
+	{
+		const double frac = host_tick.buckets[i] / (double)host_tick.ticks;
+		char bar[41];
+		int len = (int)( frac * ( sizeof( bar ) - 1 ) + 0.5 );
+
+		memset( bar, '#', len );
+		bar[len] = 0;
+
+		if( i < NUM_TICK_BUCKETS - 1 )
+			Con_Printf( "  < %5d us: %8u %5.1f%% %s\n", tick_bucket_usec[i], host_tick.buckets[i], frac * 100.0, bar );
+		else Con_Printf( "  >=%5d us: %8u %5.1f%% %s\n", tick_bucket_usec[i - 1], host_tick.buckets[i], frac * 100.0, bar );
+	}
+}
+
 static qboolean Host_Autosleep( double dt, double scale )
 {
 	double targetframetime, fps;
@@ -687,6 +850,10 @@ static qboolean Host_Autosleep( double dt, double scale )
 	else targetframetime = ( 1.0 / fps );
 
 	sleep = Host_CalcSleep();
+
+	if( sleep != 0 && sys_tickwait.value && Host_IsDedicated( ))
+		return Host_TickWait( targetframetime * scale );
+
 	if( sleep == 0 ) // no sleeps between frames, much simpler code
 	{
 		if( dt < targetframetime * scale )
@@ -1029,6 +1196,7 @@ static void Host_InitCommon( int argc, char **argv, const char *progname, qboole
 	// e.g. xash.exe +game xash -game xash
 	// so we clear all cmd_args, but leave dbg states as well
 	Sys_ParseCommandLine( argc, argv );
+	Sys_InitThreads();
 	Host_DetermineExecutableName( exename, exename_size );
 
 	if( !Sys_CheckParm( "-disablehelp" ))
@@ -1121,6 +1289,7 @@ static void Host_InitCommon( int argc, char **argv, const char *progname, qboole
 	}
 
 	Con_Init(); // early console running to catch all the messages
+	COM_InitJobs();
 
 #if XASH_ENGINE_TESTS
 	if( Sys_CheckParm( "-runtests" ))
@@ -1155,7 +1324,9 @@ static void Host_InitCommon( int argc, char **argv, const char *progname, qboole
 	Cmd_AddRestrictedCommand( "userconfigd", Host_Userconfigd_f, "execute all scripts from userconfig.d" );
 
 	Image_Init();
+	Image_CacheInit();
 	Sound_Init();
+	Sound_CacheInit();
 
 #if XASH_ENGINE_TESTS
 	if( Sys_CheckParm( "-runtests" ))
@@ -1224,6 +1395,7 @@ int EXPORT Host_Main( int argc, char **argv, const char *progname, int bChangeGa
 	Cvar_RegisterVariable( &host_framerate );
 	Cvar_RegisterVariable( &host_sleeptime );
 	Cvar_RegisterVariable( &host_sleeptime_debug );
+	Cvar_RegisterVariable( &sys_tickwait );
 	Cvar_RegisterVariable( &host_gameloaded );
 	Cvar_RegisterVariable( &host_clientloaded );
 	Cvar_RegisterVariable( &host_limitlocal );
@@ -1268,6 +1440,7 @@ int EXPORT Host_Main( int argc, char **argv, const char *progname, int bChangeGa
 
 		Cmd_AddRestrictedCommand( "quit", Sys_Quit_f, "quit the game" );
 		Cmd_AddRestrictedCommand( "exit", Sys_Quit_f, "quit the game" );
+		Cmd_AddCommand( "host_tickstats", Host_TickStats_f, "print tick lateness histogram, 'reset' clears it" );
 	}
 	else Cmd_AddRestrictedCommand( "minimize", Host_Minimize_f, "minimize main window to tray" );
 
@@ -1394,6 +1567,7 @@ void Host_ShutdownWithReason( const char *reason )
 
 	SoundList_Shutdown();
 	Mod_Shutdown();
+	COM_ShutdownJobs();
 	NET_Shutdown();
 	HTTP_Shutdown();
 	Host_FreeCommon();
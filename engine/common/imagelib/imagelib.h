@@ -172,6 +172,14 @@ qboolean Image_SavePNG( const char *name, rgbdata_t *pix );
 //
 rgbdata_t *Image_Quantize( rgbdata_t *pic );
 
+//
+// img_cache.c
+//
+qboolean Image_CacheKey( const loadpixformat_t *fmt, const char *name, const byte *buffer, fs_offset_t filesize, uint32_t key[2] );
+qboolean Image_CacheLoad( const uint32_t key[2] );
+void Image_CacheStore( const uint32_t key[2] );
+void Image_CacheShutdown( void );
+
 //
 // img_utils.c
 //
@@ -0,0 +1,325 @@
+/*
+img_cache.c - persistent decoded image cache
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "imagelib.h"
+#include "xash3d_mathlib.h"
+#include "eiface.h" // ARRAYSIZE
+#include "diskcache.h"
+
+/*
+=============================================================================
+
+	DECODED IMAGE CACHE
+
+	payload is fixed header + palette + pixels, each part aligned
+	to DISKCACHE_ALIGN so entry can be mapped and used directly
+
+=============================================================================
+*/
+#define IMGCACHE_IDENT       (('C'<<24)+('M'<<16)+('I'<<8)+'X') // little-endian "XIMC"
+#define IMGCACHE_VERSION     1
+#define IMGCACHE_DIR         "imgcache"
+#define IMGCACHE_EXT         "xic"
+#define IMGCACHE_MIN_SIZE    4096 // don't bother with tiny pictures, I/O is more expensive than decoding
+
+typedef struct imgcache_header_s
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t type;
+	uint32_t flags;
+	uint32_t num_mips;
+	uint32_t encode;
+	rgba_t   fogParams;
+	uint32_t paloffset;  // from start of file
+	uint32_t palsize;
+	uint32_t dataoffset; // from start of file
+	uint32_t datasize;
+} imgcache_header_t;
+
+static CVAR_DEFINE_AUTO( image_cache, "0", FCVAR_ARCHIVE, "store decoded images on disk to skip decoding on next load" );
+static CVAR_DEFINE_AUTO( image_cache_size, "256", FCVAR_ARCHIVE, "decoded images cache size limit, in megabytes" );
+
+static size_t Image_CacheFileSize( const void *data );
+static void Image_CacheWrite( file_t *f, const void *data );
+static size_t Image_CacheRead( const byte *file, fs_offset_t filesize, void *out );
+
+static diskcache_t imgcache =
+{
+	"image", IMGCACHE_DIR, IMGCACHE_EXT, IMGCACHE_IDENT, IMGCACHE_VERSION,
+	&image_cache, &image_cache_size, &host.imagepool,
+	{ Image_CacheFileSize, Image_CacheWrite, Image_CacheRead },
+};
+
+// these loaders only depend on the source data and loader flags
+static qboolean (*const cacheable_loaders[])( const char *name, const byte *buffer, fs_offset_t filesize ) =
+{
+	Image_LoadTGA,
+	Image_LoadBMP,
+	Image_LoadPNG,
+	Image_LoadDDS,
+	Image_LoadKTX2,
+	Image_LoadMIP,
+};
+
+/*
+=================
+Image_CacheKey
+
+source data crc plus everything that changes loader output
+=================
+*/
+qboolean Image_CacheKey( const loadpixformat_t *fmt, const char *name, const byte *buffer, fs_offset_t filesize, uint32_t key[2] )
+{
+	uint32_t params[4];
+	byte gamma[256];
+	int i;
+
+	if( !image_cache.value || image.custom_palette )
+		return false;
+
+	for( i = 0; i < ARRAYSIZE( cacheable_loaders ); i++ )
+	{
+		if( cacheable_loaders[i] == fmt->loadfunc )
+			break;
+	}
+
+	if( i == ARRAYSIZE( cacheable_loaders ))
+		return false;
+
+	params[0] = image.cmd_flags;
+	params[1] = image.force_flags;
+	params[2] = image.hint;
+	params[3] = i;
+
+	// palettes are baked with texture gamma, the table covers
+	// texgamma, gamma, brightness and linear gamma space at once
+	for( i = 0; i < ARRAYSIZE( gamma ); i++ )
+		gamma[i] = TextureToGamma( i );
+
+	CRC32_Init( &key[0] );
+	CRC32_ProcessBuffer( &key[0], buffer, filesize );
+	key[0] = CRC32_Final( key[0] );
+
+	// some loaders look at the name, i.e. '{' prefix for masked textures
+	CRC32_Init( &key[1] );
+	CRC32_ProcessBuffer( &key[1], params, sizeof( params ));
+	CRC32_ProcessBuffer( &key[1], gamma, sizeof( gamma ));
+	CRC32_ProcessBuffer( &key[1], name, Q_strlen( name ));
+	key[1] = CRC32_Final( key[1] );
+
+	return true;
+}
+
+/*
+=================
+Image_CacheFillHeader
+
+layout of current global image
+=================
+*/
+static void Image_CacheFillHeader( imgcache_header_t *hdr )
+{
+	memset( hdr, 0, sizeof( *hdr ));
+	hdr->width = image.width;
+	hdr->height = image.height;
+	hdr->depth = image.depth;
+	hdr->type = image.type;
+	hdr->flags = image.flags;
+	hdr->num_mips = image.num_mips;
+	hdr->encode = image.encode;
+	memcpy( hdr->fogParams, image.fogParams, sizeof( hdr->fogParams ));
+
+	if( image.palette )
+	{
+		if( image.type == PF_INDEXED_24 )
+			hdr->palsize = 768;
+		else if( image.type == PF_INDEXED_32 )
+			hdr->palsize = 1024;
+	}
+
+	hdr->paloffset = DISKCACHE_PAD( sizeof( diskcache_header_t ) + sizeof( *hdr ));
+	hdr->dataoffset = DISKCACHE_PAD( hdr->paloffset + hdr->palsize );
+	hdr->datasize = image.size;
+}
+
+static size_t Image_CacheFileSize( const void *data )
+{
+	imgcache_header_t hdr;
+
+	Image_CacheFillHeader( &hdr );
+
+	return hdr.dataoffset + hdr.datasize;
+}
+
+static void Image_CacheWrite( file_t *f, const void *data )
+{
+	imgcache_header_t hdr;
+
+	Image_CacheFillHeader( &hdr );
+
+	DiskCache_WriteAligned( f, &hdr, sizeof( hdr ));
+	if( hdr.palsize )
+		DiskCache_WriteAligned( f, image.palette, hdr.palsize );
+	FS_Write( f, image.rgba, hdr.datasize );
+}
+
+/*
+=================
+Image_CacheRead
+
+fills global image state like a loader would do
+=================
+*/
+static size_t Image_CacheRead( const byte *file, fs_offset_t filesize, void *out )
+{
+	const imgcache_header_t *hdr = (const imgcache_header_t *)( file + sizeof( diskcache_header_t ));
+
+	if( filesize < sizeof( diskcache_header_t ) + sizeof( *hdr ) || !hdr->datasize
+		|| (fs_offset_t)hdr->paloffset + hdr->palsize > filesize
+		|| (fs_offset_t)hdr->dataoffset + hdr->datasize > filesize )
+		return 0;
+
+	image.width = hdr->width;
+	image.height = hdr->height;
+	image.depth = hdr->depth;
+	image.type = hdr->type;
+	image.flags = hdr->flags;
+	image.num_mips = hdr->num_mips;
+	image.encode = hdr->encode;
+	image.size = hdr->datasize;
+	memcpy( image.fogParams, hdr->fogParams, sizeof( image.fogParams ));
+
+	image.rgba = Mem_Malloc( host.imagepool, hdr->datasize );
+	memcpy( image.rgba, file + hdr->dataoffset, hdr->datasize );
+
+	if( hdr->palsize )
+	{
+		image.palette = Mem_Malloc( host.imagepool, hdr->palsize );
+		memcpy( image.palette, file + hdr->paloffset, hdr->palsize );
+	}
+	else image.palette = NULL;
+
+	return image.size;
+}
+
+qboolean Image_CacheLoad( const uint32_t key[2] )
+{
+	return DiskCache_Load( &imgcache, key, NULL );
+}
+
+/*
+=================
+Image_CacheStore
+
+save freshly decoded image
+=================
+*/
+void Image_CacheStore( const uint32_t key[2] )
+{
+	if( !image.rgba || image.size < IMGCACHE_MIN_SIZE )
+		return;
+
+	DiskCache_Store( &imgcache, key, NULL );
+}
+
+static void Image_CacheInfo_f( void )
+{
+	DiskCache_Info( &imgcache );
+}
+
+static void Image_CacheFlush_f( void )
+{
+	DiskCache_Flush( &imgcache );
+}
+
+void Image_CacheInit( void )
+{
+	Cvar_RegisterVariable( &image_cache );
+	Cvar_RegisterVariable( &image_cache_size );
+	Cmd_AddCommand( "imagecache_info", Image_CacheInfo_f, "print decoded images cache statistics" );
+	Cmd_AddRestrictedCommand( "imagecache_flush", Image_CacheFlush_f, "remove all decoded images cache entries" );
+}
+
+void Image_CacheShutdown( void )
+{
+	DiskCache_Shutdown( &imgcache );
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+void Test_RunImageCache( void )
+{
+	rgbdata_t rgb = { 0 }, *load1, *load2;
+	diskcache_test_t test;
+	uint i, hits, stores;
+
+	DiskCache_BeginTest( &imgcache, &test );
+	Image_Setup();
+
+	rgb.width = 64;
+	rgb.height = 64;
+	rgb.type = PF_RGBA_32;
+	rgb.flags = IMAGE_HAS_ALPHA;
+	rgb.size = rgb.width * rgb.height * 4;
+	rgb.buffer = Z_Malloc( rgb.size );
+
+	for( i = 0; i < rgb.size; i++ )
+		rgb.buffer[i] = (byte)( i * 7 + ( i >> 8 ));
+
+	TASSERT( FS_SaveImage( "test_cache.png", &rgb ));
+
+	Cvar_DirectSet( &image_cache, "1" );
+	stores = imgcache.stores;
+	hits = imgcache.hits;
+
+	// first load decodes and stores
+	load1 = FS_LoadImage( "test_cache.png", NULL, 0 );
+	TASSERT( load1 != NULL );
+	TASSERT_EQi( imgcache.stores, stores + 1 );
+	TASSERT_EQi( imgcache.hits, hits );
+
+	// second load must come from cache
+	load2 = FS_LoadImage( "test_cache.png", NULL, 0 );
+	TASSERT( load2 != NULL );
+	TASSERT_EQi( imgcache.hits, hits + 1 );
+
+	if( load1 && load2 )
+	{
+		TASSERT( load1->width == load2->width );
+		TASSERT( load1->height == load2->height );
+		TASSERT( load1->type == load2->type );
+		TASSERT( load1->flags == load2->flags );
+		TASSERT( load1->size == load2->size );
+		TASSERT( memcmp( load1->buffer, load2->buffer, load1->size ) == 0 );
+		TASSERT( memcmp( load2->buffer, rgb.buffer, rgb.size ) == 0 );
+	}
+
+	FS_FreeImage( load1 );
+	FS_FreeImage( load2 );
+
+	// new limit must be respected
+	Cvar_DirectSet( &image_cache_size, "0" );
+	DiskCache_Evict( &imgcache, 0 );
+	TASSERT_EQi( imgcache.numentries, 0 );
+
+	FS_Delete( "test_cache.png" );
+	Z_Free( rgb.buffer );
+
+	DiskCache_EndTest( &imgcache, &test );
+}
+#endif /* XASH_ENGINE_TESTS */
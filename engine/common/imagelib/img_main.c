@@ -224,11 +224,25 @@ static const loadpixformat_t *Image_GetLoadFormatForExtension( const char *ext )
 
 static qboolean Image_ProbeLoadBuffer_( const loadpixformat_t *fmt, const char *name, const byte *buf, size_t size, int override_hint )
 {
+	uint32_t key[2];
+	qboolean cacheable;
+
 	if( override_hint > 0 )
 		image.hint = override_hint;
 	else image.hint = fmt->hint;
 
-	return fmt->loadfunc( name, buf, size );
+	cacheable = Image_CacheKey( fmt, name, buf, size, key );
+
+	if( cacheable && Image_CacheLoad( key ))
+		return true;
+
+	if( !fmt->loadfunc( name, buf, size ))
+		return false;
+
+	if( cacheable )
+		Image_CacheStore( key );
+
+	return true;
 }
 
 static qboolean Image_ProbeLoadBuffer( const loadpixformat_t *fmt, const char *name, const byte *buf, size_t size, int override_hint )
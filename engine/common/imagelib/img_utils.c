@@ -167,6 +167,7 @@ void Image_Init( void )
 void Image_Shutdown( void )
 {
 	Mem_Check(); // check for leaks
+	Image_CacheShutdown();
 	Mem_FreePool( &host.imagepool );
 }
 
@@ -0,0 +1,429 @@
+/*
+jobs.c - worker threads for parallel loops
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "xash3d_mathlib.h"
+
+/*
+===============================================================================
+
+	JOB THREADS
+
+	COM_ParallelFor splits a loop into batches that are picked up by the
+	calling thread and a small pool of persistent worker threads. The pool
+	is started, restarted and fed only by main thread and runs one loop at
+	a time, nested calls and calls from other threads are executed on the
+	calling thread.
+
+	Job functions must not use the zone allocator, filesystem or anything
+	else in the engine that isn't thread-safe.
+
+===============================================================================
+*/
+#define MAX_JOB_THREADS 16
+
+static CVAR_DEFINE_AUTO( host_jobthreads, "0", FCVAR_ARCHIVE, "number of worker threads for parallel jobs, 0 to use all processors, -1 to disable" );
+
+#if XASH_THREADS
+static struct
+{
+	// lock and condition variables live from init to shutdown
+	sys_mutex_t  *lock;
+	sys_cond_t   *wake;      // new loop was queued or pool is shutting down
+	sys_cond_t   *done;      // last running batch is finished
+	sys_thread_t *threads[MAX_JOB_THREADS];
+	qboolean     started;    // only used by main thread
+
+	// guarded by lock, only main thread changes them
+	int          numthreads;
+	qboolean     busy;
+	qboolean     quit;
+
+	// current loop, guarded by lock
+	uint         sequence;   // incremented for every loop
+	int          running;    // batches being executed right now
+	int          next;       // first index that isn't taken yet
+	int          count;
+	int          batch;
+	pfnJobRange  func;
+	void         *ctx;
+} jobs;
+
+/*
+=================
+COM_RunJobBatches
+
+takes batches of the current loop until there is nothing left,
+must be called with lock held
+=================
+*/
+static void COM_RunJobBatches( void )
+{
+	pfnJobRange func = jobs.func;
+	void *ctx = jobs.ctx;
+
+	while( jobs.next < jobs.count )
+	{
+		int start = jobs.next;
+		int end = Q_min( start + jobs.batch, jobs.count );
+
+		jobs.next = end;
+		jobs.running++;
+		Sys_UnlockMutex( jobs.lock );
+
+		func( ctx, start, end );
+
+		Sys_LockMutex( jobs.lock );
+		jobs.running--;
+	}
+
+	if( !jobs.running )
+		Sys_BroadcastCond( jobs.done );
+}
+
+/*
+=================
+COM_JobThreadLoop
+=================
+*/
+static void COM_JobThreadLoop( void *unused )
+{
+	uint sequence = 0;
+
+	Sys_LockMutex( jobs.lock );
+
+	while( 1 )
+	{
+		while( !jobs.quit && sequence == jobs.sequence )
+			Sys_WaitCond( jobs.wake, jobs.lock );
+
+		if( jobs.quit )
+			break;
+
+		// a thread that woke up late may see a newer loop, that's fine
+		sequence = jobs.sequence;
+		COM_RunJobBatches();
+	}
+
+	Sys_UnlockMutex( jobs.lock );
+}
+
+/*
+=================
+COM_StartJobThreads
+
+must be called by main thread while pool is stopped
+=================
+*/
+static void COM_StartJobThreads( void )
+{
+	int numthreads = host_jobthreads.value;
+	int i;
+
+	jobs.started = true;
+
+	if( numthreads < 0 )
+		return;
+
+	// calling thread does its share of work too
+	if( numthreads == 0 )
+		numthreads = Sys_CPUCount() - 1;
+
+	numthreads = bound( 0, numthreads, MAX_JOB_THREADS );
+
+	if( numthreads == 0 )
+		return;
+
+	Sys_LockMutex( jobs.lock );
+	jobs.quit = false;
+	jobs.sequence = 0;
+	jobs.running = 0;
+	Sys_UnlockMutex( jobs.lock );
+
+	for( i = 0; i < numthreads; i++ )
+	{
+		if( !( jobs.threads[i] = Sys_CreateThread( "Job thread", COM_JobThreadLoop, NULL )))
+		{
+			Con_Printf( S_ERROR "%s: can't create thread\n", __func__ );
+			break;
+		}
+	}
+
+	Sys_LockMutex( jobs.lock );
+	jobs.numthreads = i;
+	Sys_UnlockMutex( jobs.lock );
+
+	if( i > 0 )
+		Con_Reportf( "%s: %d worker threads\n", __func__, i );
+}
+
+/*
+=================
+COM_StopJobThreads
+
+must be called by main thread while pool isn't busy
+=================
+*/
+static void COM_StopJobThreads( void )
+{
+	int i, numthreads;
+
+	Sys_LockMutex( jobs.lock );
+	numthreads = jobs.numthreads;
+	jobs.quit = true;
+	Sys_BroadcastCond( jobs.wake );
+	Sys_UnlockMutex( jobs.lock );
+
+	for( i = 0; i < numthreads; i++ )
+	{
+		Sys_JoinThread( jobs.threads[i] );
+		jobs.threads[i] = NULL;
+	}
+
+	Sys_LockMutex( jobs.lock );
+	jobs.numthreads = 0;
+	Sys_UnlockMutex( jobs.lock );
+
+	jobs.started = false;
+}
+
+/*
+=================
+COM_CheckJobThreads
+
+starts the pool on first use and restarts it when host_jobthreads
+is changed, must be called by main thread with lock held while
+pool isn't busy, lock is held again on return
+=================
+*/
+static void COM_CheckJobThreads( void )
+{
+	if( jobs.started && !FBitSet( host_jobthreads.flags, FCVAR_CHANGED ))
+		return;
+
+	ClearBits( host_jobthreads.flags, FCVAR_CHANGED );
+
+	// workers need the lock to quit
+	Sys_UnlockMutex( jobs.lock );
+	if( jobs.started )
+		COM_StopJobThreads();
+	COM_StartJobThreads();
+	Sys_LockMutex( jobs.lock );
+}
+#endif // XASH_THREADS
+
+/*
+=================
+COM_ParallelFor
+
+calls func for every range of at most batch indices
+from 0 to count, returns when all of them are processed
+=================
+*/
+void COM_ParallelFor( int count, int batch, pfnJobRange func, void *ctx )
+{
+	if( count <= 0 )
+		return;
+
+	batch = Q_max( batch, 1 );
+
+#if XASH_THREADS
+	// pool belongs to main thread, calls from other threads, like
+	// nested calls from jobs, are executed on the calling thread
+	if( jobs.lock && count > batch && Sys_IsMainThread( ))
+	{
+		Sys_LockMutex( jobs.lock );
+
+		if( !jobs.busy )
+			COM_CheckJobThreads();
+
+		if( !jobs.busy && jobs.numthreads > 0 )
+		{
+			jobs.busy = true;
+			jobs.func = func;
+			jobs.ctx = ctx;
+			jobs.count = count;
+			jobs.batch = batch;
+			jobs.next = 0;
+			jobs.sequence++;
+			Sys_BroadcastCond( jobs.wake );
+
+			COM_RunJobBatches();
+
+			while( jobs.running > 0 )
+				Sys_WaitCond( jobs.done, jobs.lock );
+
+			jobs.busy = false;
+			Sys_UnlockMutex( jobs.lock );
+			return;
+		}
+
+		Sys_UnlockMutex( jobs.lock );
+	}
+#endif // XASH_THREADS
+
+	func( ctx, 0, count );
+}
+
+/*
+=================
+COM_NumJobThreads
+
+returns how many threads may run a loop at once, including the caller
+=================
+*/
+int COM_NumJobThreads( void )
+{
+#if XASH_THREADS
+	int numthreads;
+
+	if( !jobs.lock )
+		return 1;
+
+	Sys_LockMutex( jobs.lock );
+
+	if( !jobs.busy && Sys_IsMainThread( ))
+		COM_CheckJobThreads();
+
+	numthreads = jobs.numthreads;
+	Sys_UnlockMutex( jobs.lock );
+
+	return numthreads + 1;
+#else
+	return 1;
+#endif
+}
+
+/*
+=================
+COM_InitJobs
+=================
+*/
+void COM_InitJobs( void )
+{
+	Cvar_RegisterVariable( &host_jobthreads );
+
+#if XASH_THREADS
+	jobs.lock = Sys_CreateMutex( false );
+	jobs.wake = Sys_CreateCond();
+	jobs.done = Sys_CreateCond();
+
+	if( !jobs.lock || !jobs.wake || !jobs.done )
+	{
+		Con_Printf( S_ERROR "%s: can't create synchronization objects, jobs will run on main thread\n", __func__ );
+		Sys_DestroyCond( jobs.wake );
+		Sys_DestroyCond( jobs.done );
+		Sys_DestroyMutex( jobs.lock );
+		jobs.wake = jobs.done = NULL;
+		jobs.lock = NULL;
+	}
+#endif
+}
+
+/*
+=================
+COM_ShutdownJobs
+=================
+*/
+void COM_ShutdownJobs( void )
+{
+#if XASH_THREADS
+	if( !jobs.lock )
+		return;
+
+	if( jobs.started )
+		COM_StopJobThreads();
+
+	Sys_DestroyCond( jobs.wake );
+	Sys_DestroyCond( jobs.done );
+	Sys_DestroyMutex( jobs.lock );
+	jobs.wake = jobs.done = NULL;
+	jobs.lock = NULL;
+#endif
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+typedef struct
+{
+	int *values;
+	int nested;
+} test_jobs_t;
+
+static void Test_JobFill( void *ctx, int start, int end )
+{
+	test_jobs_t *t = ctx;
+	int i;
+
+	for( i = start; i < end; i++ )
+		t->values[i] += i * 2;
+}
+
+static void Test_JobNested( void *ctx, int start, int end )
+{
+	test_jobs_t *t = ctx;
+	int i;
+
+	// must not deadlock, runs on the calling thread
+	for( i = start; i < end; i++ )
+		COM_ParallelFor( 8, 1, Test_JobFill, &t[i + 1] );
+}
+
+void Test_RunJobs( void )
+{
+	static int values[5][8192];
+	test_jobs_t t[5];
+	int i, j, bad;
+
+	for( i = 0; i < 5; i++ )
+		t[i].values = values[i];
+
+	// use workers even on single processor machines
+	Cvar_DirectSet( &host_jobthreads, "3" );
+
+	COM_ParallelFor( 8192, 7, Test_JobFill, &t[0] );
+	COM_ParallelFor( 0, 1, Test_JobFill, &t[0] );
+
+	for( i = 0, bad = 0; i < 8192; i++ )
+	{
+		if( values[0][i] != i * 2 )
+			bad++;
+	}
+	TASSERT_EQi( bad, 0 );
+
+	COM_ParallelFor( 4, 1, Test_JobNested, &t[0] );
+
+	for( j = 1, bad = 0; j < 5; j++ )
+	{
+		for( i = 0; i < 8; i++ )
+		{
+			if( values[j][i] != i * 2 )
+				bad++;
+		}
+	}
+	TASSERT_EQi( bad, 0 );
+
+#if XASH_THREADS
+	TASSERT_EQi( COM_NumJobThreads(), 4 );
+#endif
+
+	// pool is restarted with new value by next call
+	Cvar_DirectSet( &host_jobthreads, "-1" );
+	TASSERT_EQi( COM_NumJobThreads(), 1 );
+
+	Cvar_DirectSet( &host_jobthreads, host_jobthreads.def_string );
+}
+#endif // XASH_ENGINE_TESTS
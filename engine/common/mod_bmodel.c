@@ -24,9 +24,10 @@ GNU General Public License for more details.
 #include "client.h"
 #include "server.h"			// LUMP_ error codes
 #include "ref_common.h"
-#if defined( HAVE_OPENMP )
-#include <omp.h>
-#endif // HAVE_OPENMP
+#if defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_AMD64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define XASH_VIS_SSE2 1
+#endif
 
 #define MIPTEX_CUSTOM_PALETTE_SIZE_BYTES ( sizeof( int16_t ) + 768 )
 
@@ -173,12 +174,67 @@ typedef struct
 	size_t      *count;
 } mlumpinfo_t;
 
+#define BSPCACHE_IDENT   (('C'<<24)+('B'<<16)+('S'<<8)+'X') // little-endian "XSBC"
+#define BSPCACHE_VERSION 1
+#define BSPCACHE_DIR     "bspcache"
+#define BSPCACHE_EXT     "xbc"
+#define BSPCACHE_ALIGN   16
+
+#define BSPCACHE_PAD( x ) ((( x ) + BSPCACHE_ALIGN - 1 ) & ~( BSPCACHE_ALIGN - 1 ))
+
+enum
+{
+	BSPCACHE_SURFACES = 0, // bspcache_surface_t for each face
+	BSPCACHE_BEVELS,       // mplane_t for each edge of each face
+	BSPCACHE_PHSOFS,       // uint32_t offset of PHS row for each leaf
+	BSPCACHE_PHS,          // compressed PHS rows
+	BSPCACHE_SECTIONS
+};
+
+typedef struct bspcache_header_s
+{
+	uint32_t ident;
+	uint32_t version;
+	uint32_t key;         // CRC32 of the lumps cached data is derived from
+	uint32_t numsurfaces;
+	uint32_t numleafs;
+	uint32_t visbytes;
+	struct
+	{
+		uint32_t offset;  // from start of file, aligned to BSPCACHE_ALIGN
+		uint32_t size;
+	} sections[BSPCACHE_SECTIONS];
+} bspcache_header_t;
+
+typedef struct bspcache_surface_s
+{
+	vec3_t  mins, maxs;
+	vec3_t  origin;
+	float   lmvecs[2][4];
+	short   texturemins[2];
+	short   extents[2];
+	short   lightmapmins[2];
+	short   lightextents[2];
+	vec3_t  bevelorigin;
+	vec_t   bevelradius;
+	int32_t bevelcontents;
+} bspcache_surface_t;
+
+typedef struct
+{
+	byte     *data;   // whole cache file, sections are used in place
+	uint32_t key;
+	qboolean active;  // world is being loaded with cache enabled
+	qboolean dirty;   // something was computed that wasn't in the cache
+} bspcache_t;
+
 world_static_t		world;
 static dbspmodel_t		srcmodel;
 static loadstat_t		loadstat;
 static model_t		*worldmodel;
-static byte		g_visdata[(MAX_MAP_LEAFS+7)/8];	// intermediate buffer
+static byte		g_visdata[(MAX_MAP_LEAFS+7)/8];	// intermediate buffer, main thread only
 static mlumpstat_t worldstats[HEADER_LUMPS+EXTRA_LUMPS];
+static bspcache_t		bspcache;
 static mlumpinfo_t srclumps[HEADER_LUMPS] =
 {
 	{
@@ -564,6 +620,281 @@ static void Mod_CreateDefaultTexture( model_t *mod, texture_t **texture )
 #endif // XASH_DEDICATED
 }
 
+/*
+===============================================================================
+
+			DERIVED DATA CACHE
+
+	surface extents, face bevels and PHS don't depend on anything but the
+	map itself, so for world they can be stored in a sidecar file and
+	reused on next load of the same map. Sections of the file are
+	addressed by offsets and aligned, so they are used right from the
+	loaded file. Cache is validated by CRC of all lumps but lighting.
+
+===============================================================================
+*/
+/*
+=================
+Mod_BspCacheKey
+
+=================
+*/
+static uint32_t Mod_BspCacheKey( const byte *mod_base )
+{
+	const dheader_t *header = (const dheader_t *)mod_base;
+	const dextrahdr_t *extrahdr = (const dextrahdr_t *)( mod_base + sizeof( dheader_t ));
+	uint32_t crc;
+	int i;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, &header->version, sizeof( header->version ));
+
+	for( i = 0; i < ARRAYSIZE( srclumps ); i++ )
+	{
+		const mlumpinfo_t *info = &srclumps[i];
+
+		// not loaded or doesn't affect derived data
+		if( !*info->dataptr || info->dataptr == (const void **)&srcmodel.lightdata )
+			continue;
+
+		CRC32_ProcessBuffer( &crc, *info->dataptr, header->lumps[info->lumpnumber].filelen );
+	}
+
+	for( i = 0; i < ARRAYSIZE( extlumps ); i++ )
+	{
+		const mlumpinfo_t *info = &extlumps[i];
+
+		// loaded extra lumps mean extra header is valid
+		if( !*info->dataptr )
+			continue;
+
+		CRC32_ProcessBuffer( &crc, *info->dataptr, extrahdr->lumps[info->lumpnumber].filelen );
+	}
+
+	return CRC32_Final( crc );
+}
+
+/*
+=================
+Mod_BspCachePath
+
+=================
+*/
+static void Mod_BspCachePath( char *path, size_t size, const char *modelname )
+{
+	string mapname;
+
+	COM_FileBase( modelname, mapname, sizeof( mapname ));
+	Q_snprintf( path, size, BSPCACHE_DIR "/%s." BSPCACHE_EXT, mapname );
+}
+
+/*
+=================
+Mod_BspCacheSection
+
+returns section of loaded cache and number of elements in it
+=================
+*/
+static const void *Mod_BspCacheSection( int section, size_t elemsize, size_t *count )
+{
+	const bspcache_header_t *hdr = (const bspcache_header_t *)bspcache.data;
+	uint32_t size;
+
+	*count = 0;
+
+	if( !hdr )
+		return NULL;
+
+	size = hdr->sections[section].size;
+
+	if( !size || size % elemsize )
+		return NULL;
+
+	*count = size / elemsize;
+	return bspcache.data + hdr->sections[section].offset;
+}
+
+/*
+=================
+Mod_LoadBspCache
+
+=================
+*/
+static void Mod_LoadBspCache( model_t *mod, const byte *mod_base, const dbspmodel_t *bmod )
+{
+	const bspcache_header_t *hdr;
+	char path[MAX_QPATH];
+	fs_offset_t len;
+	int i;
+
+	memset( &bspcache, 0, sizeof( bspcache ));
+
+	if( !bmod->isworld || !mod_bspcache.value )
+		return;
+
+	bspcache.active = true;
+	bspcache.dirty = true; // until proven otherwise
+	bspcache.key = Mod_BspCacheKey( mod_base );
+
+	Mod_BspCachePath( path, sizeof( path ), mod->name );
+	bspcache.data = FS_LoadFile( path, &len, true );
+
+	if( !bspcache.data )
+		return;
+
+	hdr = (const bspcache_header_t *)bspcache.data;
+
+	if( len < sizeof( *hdr ) || hdr->ident != BSPCACHE_IDENT || hdr->version != BSPCACHE_VERSION || hdr->key != bspcache.key )
+	{
+		Mem_Free( bspcache.data );
+		bspcache.data = NULL;
+		return;
+	}
+
+	for( i = 0; i < BSPCACHE_SECTIONS; i++ )
+	{
+		if( hdr->sections[i].offset % BSPCACHE_ALIGN || hdr->sections[i].offset > len || hdr->sections[i].size > len - hdr->sections[i].offset )
+		{
+			Con_Printf( S_WARN "%s: %s is corrupted\n", __func__, path );
+			Mem_Free( bspcache.data );
+			bspcache.data = NULL;
+			return;
+		}
+	}
+
+	bspcache.dirty = false;
+	Con_Reportf( "%s: using %s\n", __func__, path );
+}
+
+/*
+=================
+Mod_SaveBspCache
+
+=================
+*/
+static void Mod_SaveBspCache( model_t *mod )
+{
+	static const byte pad[BSPCACHE_ALIGN];
+	bspcache_header_t hdr;
+	bspcache_surface_t *surfs;
+	const void *data[BSPCACHE_SECTIONS];
+	uint32_t *phsofs = NULL;
+	mplane_t *planes;
+	size_t numplanes = 0;
+	char path[MAX_QPATH];
+	uint32_t offset;
+	file_t *f;
+	int i;
+
+	if( !bspcache.active || !bspcache.dirty )
+		return;
+
+	memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = BSPCACHE_IDENT;
+	hdr.version = BSPCACHE_VERSION;
+	hdr.key = bspcache.key;
+	hdr.numsurfaces = mod->numsurfaces;
+	hdr.numleafs = mod->numleafs;
+	hdr.visbytes = world.visbytes;
+
+	for( i = 0; i < mod->numsurfaces; i++ )
+	{
+		if( mod->surfaces[i].info->bevel )
+			numplanes += mod->surfaces[i].info->bevel->numedges;
+	}
+
+	surfs = Mem_Calloc( mod->mempool, sizeof( *surfs ) * mod->numsurfaces + sizeof( *planes ) * numplanes );
+	planes = (mplane_t *)&surfs[mod->numsurfaces];
+	numplanes = 0;
+
+	for( i = 0; i < mod->numsurfaces; i++ )
+	{
+		const msurface_t *surf = &mod->surfaces[i];
+		const mextrasurf_t *info = surf->info;
+		bspcache_surface_t *out = &surfs[i];
+
+		// skipped as corrupted, it will be skipped on next load too
+		if( !info->bevel )
+			continue;
+
+		VectorCopy( info->mins, out->mins );
+		VectorCopy( info->maxs, out->maxs );
+		VectorCopy( info->origin, out->origin );
+		memcpy( out->lmvecs, info->lmvecs, sizeof( out->lmvecs ));
+		memcpy( out->texturemins, surf->texturemins, sizeof( out->texturemins ));
+		memcpy( out->extents, surf->extents, sizeof( out->extents ));
+		memcpy( out->lightmapmins, info->lightmapmins, sizeof( out->lightmapmins ));
+		memcpy( out->lightextents, info->lightextents, sizeof( out->lightextents ));
+		VectorCopy( info->bevel->origin, out->bevelorigin );
+		out->bevelradius = info->bevel->radius;
+		out->bevelcontents = info->bevel->contents;
+
+		memcpy( &planes[numplanes], info->bevel->edges, sizeof( *planes ) * info->bevel->numedges );
+		numplanes += info->bevel->numedges;
+	}
+
+	data[BSPCACHE_SURFACES] = surfs;
+	hdr.sections[BSPCACHE_SURFACES].size = sizeof( *surfs ) * mod->numsurfaces;
+	data[BSPCACHE_BEVELS] = planes;
+	hdr.sections[BSPCACHE_BEVELS].size = sizeof( *planes ) * numplanes;
+	data[BSPCACHE_PHSOFS] = data[BSPCACHE_PHS] = NULL;
+
+	// lazily built rows aren't saved
+	if( world.compressed_phs && world.phsofs )
+	{
+		phsofs = Mem_Malloc( mod->mempool, sizeof( *phsofs ) * ( mod->numleafs + 1 ));
+		for( i = 0; i < mod->numleafs + 1; i++ )
+			phsofs[i] = world.phsofs[i];
+
+		data[BSPCACHE_PHSOFS] = phsofs;
+		hdr.sections[BSPCACHE_PHSOFS].size = sizeof( *phsofs ) * ( mod->numleafs + 1 );
+		data[BSPCACHE_PHS] = world.compressed_phs;
+		hdr.sections[BSPCACHE_PHS].size = world.phssize;
+	}
+
+	for( i = 0, offset = BSPCACHE_PAD( sizeof( hdr )); i < BSPCACHE_SECTIONS; i++ )
+	{
+		hdr.sections[i].offset = offset;
+		offset += BSPCACHE_PAD( hdr.sections[i].size );
+	}
+
+	Mod_BspCachePath( path, sizeof( path ), mod->name );
+
+	if(( f = FS_Open( path, "wb", true )) != NULL )
+	{
+		FS_Write( f, &hdr, sizeof( hdr ));
+		FS_Write( f, pad, BSPCACHE_PAD( sizeof( hdr )) - sizeof( hdr ));
+
+		for( i = 0; i < BSPCACHE_SECTIONS; i++ )
+		{
+			if( !hdr.sections[i].size )
+				continue;
+
+			FS_Write( f, data[i], hdr.sections[i].size );
+			FS_Write( f, pad, BSPCACHE_PAD( hdr.sections[i].size ) - hdr.sections[i].size );
+		}
+
+		FS_Close( f );
+		Con_Reportf( "%s: written %s\n", __func__, path );
+	}
+
+	if( phsofs ) Mem_Free( phsofs );
+	Mem_Free( surfs );
+}
+
+/*
+=================
+Mod_FreeBspCache
+
+=================
+*/
+static void Mod_FreeBspCache( void )
+{
+	if( bspcache.data )
+		Mem_Free( bspcache.data );
+	memset( &bspcache, 0, sizeof( bspcache ));
+}
+
 /*
 ===============================================================================
 
@@ -806,9 +1137,9 @@ void Mod_PrintWorldStats_f( void )
 */
 /*
 ===================
-Mod_DecompressPVS
+Mod_DecompressPVSTo
 
-TODO: replace all Mod_DecompressPVS calls by this
+decompresses visibility row into caller's buffer, can be used from any thread
 ===================
 */
 static void Mod_DecompressPVSTo( byte *const out, const byte *in, size_t visbytes )
@@ -840,9 +1171,43 @@ static void Mod_DecompressPVSTo( byte *const out, const byte *in, size_t visbyte
 	}
 }
 
+/*
+===================
+Mod_DecompressPVSOr
+
+merges compressed visibility row into out,
+zero runs are just skipped
+===================
+*/
+static void Mod_DecompressPVSOr( byte *const out, const byte *in, size_t visbytes )
+{
+	byte *dst = out;
+
+	if( !in ) // no visinfo, make all visible
+	{
+		memset( out, 0xFF, visbytes );
+		return;
+	}
+
+	while( dst < out + visbytes )
+	{
+		if( *in ) // uncompressed
+		{
+			*dst++ |= *in++;
+		}
+		else // zero repeated `c` times
+		{
+			dst += in[1];
+			in += 2;
+		}
+	}
+}
+
 /*
 ===================
 Mod_DecompressPVS
+
+NOTE: returns static buffer, use Mod_DecompressPVSTo outside of main thread
 ===================
 */
 static byte *Mod_DecompressPVS( const byte *in, int visbytes )
@@ -851,16 +1216,23 @@ static byte *Mod_DecompressPVS( const byte *in, int visbytes )
 	return g_visdata;
 }
 
+/*
+===================
+Mod_CompressPVS
+
+if out is NULL, only returns compressed size
+===================
+*/
 static size_t Mod_CompressPVS( byte *const out, const byte *in, size_t inbytes )
 {
-	size_t i;
-	byte *dst = out;
+	size_t i, size = 0;
 
 	for( i = 0; i < inbytes; i++ )
 	{
 		size_t j = i + 1, rep = 1;
 
-		*dst++ = in[i];
+		if( out ) out[size] = in[i];
+		size++;
 
 		// only compress zeros
 		if( in[i] )
@@ -872,11 +1244,37 @@ static size_t Mod_CompressPVS( byte *const out, const byte *in, size_t inbytes )
 				break;
 		}
 
-		*dst++ = rep;
+		if( out ) out[size] = rep;
+		size++;
 		i = j - 1;
 	}
 
-	return dst - out;
+	return size;
+}
+
+/*
+===================
+Mod_OrVisRows
+
+word-wide Q_memor for 16-byte aligned uncompressed rows
+===================
+*/
+static void Mod_OrVisRows( uint64_t *XASH_RESTRICT dst, const uint64_t *XASH_RESTRICT src, size_t words )
+{
+	size_t i = 0;
+
+#if XASH_VIS_SSE2
+	for( ; i + 2 <= words; i += 2 )
+	{
+		__m128i a = _mm_load_si128( (const __m128i *)&dst[i] );
+		__m128i b = _mm_load_si128( (const __m128i *)&src[i] );
+
+		_mm_store_si128( (__m128i *)&dst[i], _mm_or_si128( a, b ));
+	}
+#endif
+
+	for( ; i < words; i++ )
+		dst[i] |= src[i];
 }
 
 /*
@@ -902,13 +1300,14 @@ mleaf_t *Mod_PointInLeaf( const vec3_t p, mnode_t *node, model_t *mod )
 
 /*
 ==================
-Mod_GetPVSForPoint
+Mod_GetPVSForPointTo
 
-Returns PVS data for a given point
-NOTE: can return NULL
+Decompresses PVS for a given point into visbuffer,
+unlike Mod_GetPVSForPoint can be called from several threads at once
+Returns false if point isn't in any cluster
 ==================
 */
-byte *Mod_GetPVSForPoint( const vec3_t p )
+qboolean Mod_GetPVSForPointTo( const vec3_t p, byte *visbuffer, int visbytes )
 {
 	mleaf_t	*leaf;
 
@@ -916,11 +1315,93 @@ byte *Mod_GetPVSForPoint( const vec3_t p )
 
 	leaf = Mod_PointInLeaf( p, worldmodel->nodes, worldmodel );
 
-	if( leaf && leaf->cluster >= 0 )
-		return Mod_DecompressPVS( leaf->compressed_vis, world.visbytes );
+	if( !leaf || leaf->cluster < 0 )
+		return false;
+
+	Mod_DecompressPVSTo( visbuffer, leaf->compressed_vis, Q_min( world.visbytes, visbytes ));
+	return true;
+}
+
+/*
+==================
+Mod_GetPVSForPoint
+
+Returns PVS data for a given point
+NOTE: can return NULL
+NOTE: returns static buffer, valid until next call
+==================
+*/
+byte *Mod_GetPVSForPoint( const vec3_t p )
+{
+	if( Mod_GetPVSForPointTo( p, g_visdata, sizeof( g_visdata )))
+		return g_visdata;
 	return NULL;
 }
 
+/*
+==================
+Mod_CalcPHSRow
+
+Builds compressed PHS row for a single leaf, used
+when whole PHS isn't built at load time
+==================
+*/
+static byte *Mod_CalcPHSRow( int leafnum )
+{
+	// main thread only
+	static byte pvs[(MAX_MAP_LEAFS+7)/8];
+	static byte phs[(MAX_MAP_LEAFS+7)/8];
+	static byte compressed[(MAX_MAP_LEAFS+1)/4];
+	const size_t count = worldmodel->numleafs + 1;
+	size_t j, size;
+	byte *row;
+
+	Mod_DecompressPVSTo( pvs, worldmodel->leafs[leafnum].compressed_vis, world.visbytes );
+	memcpy( phs, pvs, world.visbytes );
+
+	for( j = 0; j < world.visbytes; j++ )
+	{
+		uint bitbyte = pvs[j];
+		size_t k;
+
+		if( bitbyte == 0 )
+			continue;
+
+		for( k = 0; k < 8; k++ )
+		{
+			// +1 because pvs is 1 based
+			size_t index = j * 8 + k + 1;
+
+			if( FBitSet( bitbyte, BIT( k )) && index < count )
+				Mod_DecompressPVSOr( phs, worldmodel->leafs[index].compressed_vis, world.visbytes );
+		}
+	}
+
+	size = Mod_CompressPVS( compressed, phs, world.visbytes );
+	row = Mem_Malloc( worldmodel->mempool, size );
+	memcpy( row, compressed, size );
+
+	return row;
+}
+
+/*
+==================
+Mod_GetCompressedPHS
+
+==================
+*/
+static const byte *Mod_GetCompressedPHS( int leafnum )
+{
+	if( world.phsrows )
+	{
+		if( !world.phsrows[leafnum] )
+			world.phsrows[leafnum] = Mod_CalcPHSRow( leafnum );
+		return world.phsrows[leafnum];
+	}
+
+	return &world.compressed_phs[world.phsofs[leafnum]];
+}
+
 /*
 ==================
 Mod_FatPVS_RecursiveBSPNode
@@ -948,19 +1429,9 @@ static void Mod_FatPVS_RecursiveBSPNode( const vec3_t org, float radius, byte *v
 	// if this leaf is in a cluster, accumulate the vis bits
 	if(((mleaf_t *)node)->cluster >= 0 )
 	{
-		byte *vis;
-
 		if( phs )
-		{
-			int i = ((mleaf_t *)node)->cluster + 1;
-			vis = Mod_DecompressPVS( &world.compressed_phs[world.phsofs[i]], world.visbytes );
-		}
-		else
-		{
-			vis = Mod_DecompressPVS( ((mleaf_t *)node)->compressed_vis, world.visbytes );
-		}
-
-		Q_memor( visbuffer, vis, visbytes );
+			Mod_DecompressPVSOr( visbuffer, Mod_GetCompressedPHS(((mleaf_t *)node)->cluster + 1 ), visbytes );
+		else Mod_DecompressPVSOr( visbuffer, ((mleaf_t *)node)->compressed_vis, visbytes );
 	}
 }
 
@@ -970,6 +1441,8 @@ Mod_FatPVS_RecursiveBSPNode
 
 Calculates a PVS that is the inclusive or of all leafs
 within radius pixels of the given point.
+NOTE: PVS can be requested from any thread, PHS only
+from main thread as its rows may be built on demand
 ==================
 */
 int Mod_FatPVS( const vec3_t org, float radius, byte *visbuffer, int visbytes, qboolean merge, qboolean fullvis, qboolean phs )
@@ -991,7 +1464,7 @@ int Mod_FatPVS( const vec3_t org, float radius, byte *visbuffer, int visbytes, q
 
 	// requested PHS but we don't have PHS for some reason
 	// enable full visibility
-	if( phs && !( world.compressed_phs && world.phsofs ))
+	if( phs && !( world.compressed_phs && world.phsofs ) && !world.phsrows )
 	{
 		memset( visbuffer, 0xFF, bytes );
 		return bytes;
@@ -2913,6 +3386,71 @@ static void Mod_LoadTexInfo( model_t *mod, dbspmodel_t *bmod )
 	}
 }
 
+/*
+=================
+Mod_CountBevelPlanes
+
+number of face bevel planes for this map, to check that cache matches
+=================
+*/
+static size_t Mod_CountBevelPlanes( model_t *mod, dbspmodel_t *bmod )
+{
+	size_t i, numplanes = 0;
+
+	for( i = 0; i < bmod->numsurfaces; i++ )
+	{
+		int firstedge, numedges;
+
+		if( bmod->version == QBSP2_VERSION )
+		{
+			firstedge = bmod->surfaces32[i].firstedge;
+			numedges = bmod->surfaces32[i].numedges;
+		}
+		else
+		{
+			firstedge = bmod->surfaces[i].firstedge;
+			numedges = bmod->surfaces[i].numedges;
+		}
+
+		// same check as in Mod_LoadSurfaces
+		if(( firstedge + numedges ) > mod->numsurfedges )
+			continue;
+
+		numplanes += numedges;
+	}
+
+	return numplanes;
+}
+
+/*
+=================
+Mod_LoadCachedSurface
+
+copies what Mod_CalcSurfaceBounds, Mod_CalcSurfaceExtents
+and Mod_CreateFaceBevels would calculate from cache
+=================
+*/
+static void Mod_LoadCachedSurface( msurface_t *surf, const bspcache_surface_t *in, mfacebevel_t *fb, mplane_t *planes )
+{
+	mextrasurf_t *info = surf->info;
+
+	VectorCopy( in->mins, info->mins );
+	VectorCopy( in->maxs, info->maxs );
+	VectorCopy( in->origin, info->origin );
+	memcpy( info->lmvecs, in->lmvecs, sizeof( info->lmvecs ));
+	memcpy( surf->texturemins, in->texturemins, sizeof( surf->texturemins ));
+	memcpy( surf->extents, in->extents, sizeof( surf->extents ));
+	memcpy( info->lightmapmins, in->lightmapmins, sizeof( info->lightmapmins ));
+	memcpy( info->lightextents, in->lightextents, sizeof( info->lightextents ));
+
+	fb->edges = planes;
+	fb->numedges = surf->numedges;
+	VectorCopy( in->bevelorigin, fb->origin );
+	fb->radius = in->bevelradius;
+	fb->contents = in->bevelcontents;
+	info->bevel = fb;
+}
+
 /*
 =================
 Mod_LoadSurfaces
@@ -2924,6 +3462,11 @@ static void Mod_LoadSurfaces( model_t *mod, dbspmodel_t *bmod )
 	int		next_lightofs = -1;
 	int		prev_lightofs = -1;
 	int		i, j, lightofs;
+	const bspcache_surface_t	*cached;
+	const mplane_t	*cachedplanes;
+	size_t		numcached, numplanes;
+	mfacebevel_t	*bevels = NULL;
+	mplane_t		*planes = NULL;
 	mextrasurf_t	*info;
 	msurface_t	*out;
 
@@ -2931,6 +3474,22 @@ static void Mod_LoadSurfaces( model_t *mod, dbspmodel_t *bmod )
 	info = Mem_Calloc( mod->mempool, bmod->numsurfaces * sizeof( mextrasurf_t ));
 	mod->numsurfaces = bmod->numsurfaces;
 
+	cached = Mod_BspCacheSection( BSPCACHE_SURFACES, sizeof( *cached ), &numcached );
+	cachedplanes = Mod_BspCacheSection( BSPCACHE_BEVELS, sizeof( *cachedplanes ), &numplanes );
+
+	if( cached && cachedplanes && numcached == bmod->numsurfaces && numplanes == Mod_CountBevelPlanes( mod, bmod ))
+	{
+		// all face bevels go into single allocation
+		bevels = Mem_Malloc( mod->mempool, bmod->numsurfaces * sizeof( *bevels ) + numplanes * sizeof( *planes ));
+		planes = (mplane_t *)&bevels[bmod->numsurfaces];
+		memcpy( planes, cachedplanes, numplanes * sizeof( *planes ));
+	}
+	else
+	{
+		cached = NULL;
+		bspcache.dirty = true;
+	}
+
 	// predict samplecount based on bspversion
 	if( bmod->version == Q1BSP_VERSION || bmod->version == QBSP2_VERSION )
 		bmod->lightmap_samples = 1;
@@ -3005,9 +3564,17 @@ static void Mod_LoadSurfaces( model_t *mod, dbspmodel_t *bmod )
 		if( FBitSet( out->texinfo->flags, TEX_SPECIAL ))
 			SetBits( out->flags, SURF_DRAWTILED );
 
-		Mod_CalcSurfaceBounds( mod, out, bmod );
-		Mod_CalcSurfaceExtents( mod, out, bmod );
-		Mod_CreateFaceBevels( mod, out, bmod );
+		if( cached )
+		{
+			Mod_LoadCachedSurface( out, &cached[i], &bevels[i], planes );
+			planes += out->numedges;
+		}
+		else
+		{
+			Mod_CalcSurfaceBounds( mod, out, bmod );
+			Mod_CalcSurfaceExtents( mod, out, bmod );
+			Mod_CreateFaceBevels( mod, out, bmod );
+		}
 
 		// grab the second sample to detect colored lighting
 		if( test_lightsize > 0 && lightofs != -1 )
@@ -3273,65 +3840,51 @@ static void Mod_LoadLeafs( model_t *mod, dbspmodel_t *bmod )
 		SetBits( world.flags, FWORLD_WATERALPHA );
 }
 
-/*
-===========
-Mod_CalcPHS
-
-To be called while loading world for multiplayer game server
-===========
-*/
-static void Mod_CalcPHS( model_t *mod )
+typedef struct phs_build_s
 {
-	const qboolean vis_stats = host_developer.value >= DEV_EXTENDED;
-	const size_t rowbytes = ALIGN( world.visbytes, 4 ); // force align rows by 32-bit boundary
-	const size_t count = mod->numleafs + 1; // same as mod->submodels[0].visleafs + 1
-	double t1;
-	double t2;
-	size_t total_compressed_size = 0;
-	size_t hcount = 0;
-	size_t vcount = 0;
+	model_t  *mod;
+	size_t   count;    // same as mod->submodels[0].visleafs + 1
+	size_t   rowbytes;
+	size_t   rowwords;
+	uint64_t *pvs;     // uncompressed rows
+	uint64_t *phs;
+} phs_build_t;
+
+static void Mod_DecompressPVSJob( void *ctx, int start, int end )
+{
+	const phs_build_t *b = ctx;
 	int i;
-	byte *uncompressed_pvs;
-	byte *uncompressed_phs;
-
-	if( !mod->visdata )
-		return;
 
-#if defined( HAVE_OPENMP )
-	Con_Reportf( "Building PHS in %d threads...\n", omp_get_max_threads( ));
-#else
-	Con_Reportf( "Building PHS...\n" );
-#endif
-
-	uncompressed_pvs = Mem_Calloc( mod->mempool, rowbytes * count * 2 );
-	uncompressed_phs = &uncompressed_pvs[rowbytes * count];
-
-	world.phsofs = Mem_Calloc( mod->mempool, sizeof( size_t ) * count );
-	world.compressed_phs = NULL;
+	for( i = start; i < end; i++ )
+		Mod_DecompressPVSTo( (byte *)&b->pvs[b->rowwords * i], b->mod->leafs[i].compressed_vis, world.visbytes );
+}
 
-	t1 = Platform_DoubleTime();
+static void Mod_MergePHSJob( void *ctx, int start, int end )
+{
+	const phs_build_t *b = ctx;
+	int i;
 
-#pragma omp parallel
+	for( i = start; i < end; i++ )
 	{
-		// uncompress pvs first
-#pragma omp for schedule( static, 256 ) // there might be thousands of leafs, split by 256
-		for( i = 0; i < count; i++ )
-			Mod_DecompressPVSTo( &uncompressed_pvs[rowbytes * i], mod->leafs[i].compressed_vis, world.visbytes );
+		const uint64_t *scan = &b->pvs[b->rowwords * i];
+		uint64_t *dst = &b->phs[b->rowwords * i];
+		size_t w;
 
-		// now create phs
-#pragma omp for schedule( static, 256 ) reduction( + : vcount, hcount )
-		for( i = 0; i < count; i++ )
+		memcpy( dst, scan, b->rowbytes );
+
+		for( w = 0; w < b->rowwords; w++ )
 		{
-			const byte *scan = &uncompressed_pvs[rowbytes * i];
-			byte *dst = &uncompressed_phs[rowbytes * i]; // rowbytes, not rowwords!
+			const byte *bits = (const byte *)&scan[w];
 			size_t j;
 
-			memcpy( dst, scan, rowbytes );
+			// most of the row is usually empty
+			if( scan[w] == 0 )
+				continue;
 
-			for( j = 0; j < rowbytes; j++ )
+			for( j = 0; j < sizeof( *scan ); j++ )
 			{
+				uint bitbyte = bits[j];
 				size_t k;
-				uint bitbyte = scan[j];
 
 				if( bitbyte == 0 )
 					continue;
@@ -3345,53 +3898,205 @@ static void Mod_CalcPHS( model_t *mod )
 
 					// OR this pvs row into the phs
 					// +1 because pvs is 1 based
-					index = (( j * 8 ) + k + 1 );
-					if( index >= count )
+					index = ( w * sizeof( *scan ) + j ) * 8 + k + 1;
+					if( index >= b->count )
 						continue;
 
-					Q_memor( dst, &uncompressed_pvs[rowbytes * index], rowbytes );
+					Mod_OrVisRows( dst, &b->pvs[b->rowwords * index], b->rowwords );
 				}
 			}
+		}
+	}
+}
 
-			if( vis_stats && i != 0 )
-			{
-				size_t j;
+static void Mod_MeasurePHSJob( void *ctx, int start, int end )
+{
+	const phs_build_t *b = ctx;
+	int i;
 
-				for( j = 0; j < count; j++ )
-				{
-					if( CHECKVISBIT( scan, j ))
-						vcount++;
+	for( i = start; i < end; i++ )
+		world.phsofs[i] = Mod_CompressPVS( NULL, (const byte *)&b->phs[b->rowwords * i], b->rowbytes );
+}
 
-					if( CHECKVISBIT( dst, j ))
-						hcount++;
-				}
-			}
+static void Mod_CompressPHSJob( void *ctx, int start, int end )
+{
+	const phs_build_t *b = ctx;
+	int i;
+
+	for( i = start; i < end; i++ )
+		Mod_CompressPVS( &world.compressed_phs[world.phsofs[i]], (const byte *)&b->phs[b->rowwords * i], b->rowbytes );
+}
+
+/*
+===========
+Mod_CheckCompressedRow
+
+row must decode to exactly visbytes, one bit per leaf,
+without reading past the end of the data
+===========
+*/
+static qboolean Mod_CheckCompressedRow( const byte *in, size_t size, size_t visbytes )
+{
+	size_t i = 0, decoded = 0;
+
+	while( decoded < visbytes )
+	{
+		if( i >= size )
+			return false;
+
+		if( in[i] ) // uncompressed
+		{
+			decoded++;
+			i++;
+			continue;
 		}
+
+		// zero repeated `c` times
+		if( i + 1 >= size || !in[i + 1] )
+			return false;
+
+		decoded += in[i + 1];
+		i += 2;
+	}
+
+	return decoded == visbytes;
+}
+
+/*
+===========
+Mod_LoadCachedPHS
+
+===========
+*/
+static qboolean Mod_LoadCachedPHS( model_t *mod, size_t count )
+{
+	const bspcache_header_t *hdr = (const bspcache_header_t *)bspcache.data;
+	const uint32_t *phsofs;
+	const byte *phs;
+	size_t numofs, size, i;
+
+	phsofs = Mod_BspCacheSection( BSPCACHE_PHSOFS, sizeof( *phsofs ), &numofs );
+	phs = Mod_BspCacheSection( BSPCACHE_PHS, sizeof( *phs ), &size );
+
+	if( !phsofs || !phs || numofs != count || hdr->visbytes != world.visbytes )
+		return false;
+
+	for( i = 0; i < count; i++ )
+	{
+		if( phsofs[i] >= size || !Mod_CheckCompressedRow( phs + phsofs[i], size - phsofs[i], world.visbytes ))
+			return false;
 	}
 
-	// since I can't predict at which spot compressed array
-	// should be put, this loop is single threaded
+	world.phsofs = Mem_Malloc( mod->mempool, sizeof( *world.phsofs ) * count );
 	for( i = 0; i < count; i++ )
+		world.phsofs[i] = phsofs[i];
+
+	world.compressed_phs = Mem_Malloc( mod->mempool, size );
+	memcpy( world.compressed_phs, phs, size );
+	world.phssize = size;
+
+	Con_Reportf( "PHS loaded from cache, %s\n", Q_memprint( size ));
+	return true;
+}
+
+/*
+===========
+Mod_CalcPHS
+
+To be called while loading world for multiplayer game server
+===========
+*/
+static void Mod_CalcPHS( model_t *mod )
+{
+	const qboolean vis_stats = host_developer.value >= DEV_EXTENDED;
+	phs_build_t b;
+	double t1;
+	double t2;
+	size_t total_compressed_size = 0;
+	size_t hcount = 0;
+	size_t vcount = 0;
+	size_t i;
+	byte *uncompressed;
+
+	if( !mod->visdata )
+		return;
+
+	b.mod = mod;
+	b.count = mod->numleafs + 1;
+
+	world.compressed_phs = NULL;
+	world.phsofs = NULL;
+	world.phsrows = NULL;
+	world.phssize = 0;
+
+	if( Mod_LoadCachedPHS( mod, b.count ))
+		return;
+
+	if( mod_lazyphs.value )
 	{
-		const byte *src = &uncompressed_phs[rowbytes * i];
-		byte temp_compressed_row[(MAX_MAP_LEAFS+1)/4]; // compression for this row might be ineffective
-		size_t compressed_size;
+		// rows will be built on first use
+		world.phsrows = Mem_Calloc( mod->mempool, sizeof( *world.phsrows ) * b.count );
+		return;
+	}
+
+	Con_Reportf( "Building PHS in %d threads...\n", COM_NumJobThreads( ));
+
+	b.rowbytes = ALIGN( world.visbytes, 16 ); // force align rows by 128-bit boundary
+	b.rowwords = b.rowbytes / sizeof( *b.pvs );
 
-		compressed_size = Mod_CompressPVS( temp_compressed_row, src, rowbytes );
+	uncompressed = Mem_Calloc( mod->mempool, b.rowbytes * b.count * 2 + 15 );
+	b.pvs = (uint64_t *)ALIGN( (uintptr_t)uncompressed, 16 );
+	b.phs = &b.pvs[b.rowwords * b.count];
 
-		world.compressed_phs = Mem_Realloc( mod->mempool, world.compressed_phs, total_compressed_size + compressed_size );
-		memcpy( &world.compressed_phs[total_compressed_size], temp_compressed_row, compressed_size );
-		world.phsofs[i]	= total_compressed_size;
+	world.phsofs = Mem_Calloc( mod->mempool, sizeof( size_t ) * b.count );
+
+	t1 = Platform_DoubleTime();
+
+	// uncompress pvs first, then create phs
+	// there might be thousands of leafs, split by 64
+	COM_ParallelFor( b.count, 64, Mod_DecompressPVSJob, &b );
+	COM_ParallelFor( b.count, 64, Mod_MergePHSJob, &b );
+
+	// find where each compressed row goes, then compress them in place
+	COM_ParallelFor( b.count, 64, Mod_MeasurePHSJob, &b );
+
+	for( i = 0; i < b.count; i++ )
+	{
+		size_t compressed_size = world.phsofs[i];
 
+		world.phsofs[i] = total_compressed_size;
 		total_compressed_size += compressed_size;
 	}
 
+	world.compressed_phs = Mem_Malloc( mod->mempool, total_compressed_size );
+	world.phssize = total_compressed_size;
+	COM_ParallelFor( b.count, 64, Mod_CompressPHSJob, &b );
+	bspcache.dirty = true;
+
 	t2 = Platform_DoubleTime();
 
 	if( vis_stats )
-		Con_Reportf( "Average leaves visible / audible / total: %zu / %zu / %zu\n", vcount / count, hcount / count, count );
-	Con_Reportf( "Uncompressed PHS size: %s\n", Q_memprint( rowbytes * count ));
-	Con_Reportf( "Compressed PHS size: %s\n", Q_memprint( total_compressed_size + sizeof( *world.phsofs ) * count ));
+	{
+		for( i = 1; i < b.count; i++ )
+		{
+			const byte *scan = (const byte *)&b.pvs[b.rowwords * i];
+			const byte *dst = (const byte *)&b.phs[b.rowwords * i];
+			size_t j;
+
+			for( j = 0; j < b.count; j++ )
+			{
+				if( CHECKVISBIT( scan, j ))
+					vcount++;
+
+				if( CHECKVISBIT( dst, j ))
+					hcount++;
+			}
+		}
+
+		Con_Reportf( "Average leaves visible / audible / total: %zu / %zu / %zu\n", vcount / b.count, hcount / b.count, b.count );
+	}
+	Con_Reportf( "Uncompressed PHS size: %s\n", Q_memprint( b.rowbytes * b.count ));
+	Con_Reportf( "Compressed PHS size: %s\n", Q_memprint( total_compressed_size + sizeof( *world.phsofs ) * b.count ));
 	Con_Reportf( "PHS building time: %.2f ms\n", ( t2 - t1 ) * 1000.0f );
 
 	// TODO: rewrite this into a unit test
@@ -3411,11 +4116,11 @@ static void Mod_CalcPHS( model_t *mod )
 	//
 	// NOTE: as of writing, uncompressed PVS and PHS data do match! hooray!
 	//
-	// FS_WriteFile( "op4_bootcamp.pvs", uncompressed_pvs, rowbytes * count );
-	// FS_WriteFile( "op4_bootcamp.phs", uncompressed_phs, rowbytes * count );
+	// FS_WriteFile( "op4_bootcamp.pvs", b.pvs, b.rowbytes * b.count );
+	// FS_WriteFile( "op4_bootcamp.phs", b.phs, b.rowbytes * b.count );
 
 	// release uncompressed data
-	Mem_Free( uncompressed_pvs );
+	Mem_Free( uncompressed );
 
 	// TODO: cache the PHS somewhere, it might take a long time on giant maps
 }
@@ -3687,6 +4392,8 @@ static qboolean Mod_LoadBmodelLumps( model_t *mod, const byte *mod_base, qboolea
 	else if( !bmod->isworld && loadstat.numwarnings )
 		Con_DPrintf( "Mod_Load%s: %i warning(s)\n", isworld ? "World" : "Brush", loadstat.numwarnings );
 
+	Mod_LoadBspCache( mod, mod_base, bmod );
+
 	// load into heap
 	Mod_LoadEntities( mod, bmod );
 	Mod_LoadPlanes( mod, bmod );
@@ -3720,6 +4427,9 @@ static qboolean Mod_LoadBmodelLumps( model_t *mod, const byte *mod_base, qboolea
 			Mod_CalcPHS( mod );
 	}
 
+	Mod_SaveBspCache( mod );
+	Mod_FreeBspCache();
+
 	for( i = 0; i < world.wadlist.count; i++ )
 	{
 		if( !world.wadlist.wadusage[i] )
@@ -125,6 +125,8 @@ typedef struct world_static_s
 	// Potentially Hearable Set
 	byte   *compressed_phs;
 	size_t *phsofs;
+	byte   **phsrows; // built on first use when mod_lazyphs is set
+	size_t phssize;   // size of compressed_phs
 
 	wadlist_t wadlist;
 } world_static_t;
@@ -134,6 +136,8 @@ extern world_static_t	world;
 extern poolhandle_t     com_studiocache;
 extern convar_t		mod_studiocache;
 extern convar_t		r_wadtextures;
+extern convar_t		mod_lazyphs;
+extern convar_t		mod_bspcache;
 extern convar_t		r_showhull;
 extern const mclipnode16_t box_clipnodes16[6];
 extern const mclipnode32_t box_clipnodes32[6];
@@ -177,6 +181,7 @@ int Mod_SaveLump( const char *filename, const int lump, void *lumpdata, int lump
 mleaf_t *Mod_PointInLeaf( const vec3_t p, mnode_t *node, model_t *mod );
 int Mod_SampleSizeForFace( const msurface_t *surf );
 byte *Mod_GetPVSForPoint( const vec3_t p );
+qboolean Mod_GetPVSForPointTo( const vec3_t p, byte *visbuffer, int visbytes );
 void Mod_UnloadBrushModel( model_t *mod );
 void Mod_PrintWorldStats_f( void );
 
@@ -24,12 +24,19 @@ GNU General Public License for more details.
 #include "client.h"
 #include "server.h"
 
+#define MOD_HASH_SIZE	1024	// must be power of two
+
 static model_info_t	mod_crcinfo[MAX_MODELS];
 static model_t	mod_known[MAX_MODELS];
 static int	mod_numknown = 0;
+static int	mod_hashfirst[MOD_HASH_SIZE];	// index + 1 of the first model in chain, zero terminates
+static int	mod_hashnext[MAX_MODELS];	// index + 1 of the next model in chain
+static uint	mod_freeslots[MAX_MODELS / 32];	// bit is set for unused slots below mod_numknown
 poolhandle_t      com_studiocache;		// cache for submodels
 CVAR_DEFINE( mod_studiocache, "r_studiocache", "1", FCVAR_ARCHIVE, "enables studio cache for speedup tracing hitboxes" );
 CVAR_DEFINE_AUTO( r_wadtextures, "0", 0, "completely ignore textures in the bsp-file if enabled" );
+CVAR_DEFINE_AUTO( mod_bspcache, "0", FCVAR_ARCHIVE, "store surface extents, face bevels and PHS of the world to skip calculating them on next load" );
+CVAR_DEFINE_AUTO( mod_lazyphs, "0", FCVAR_ARCHIVE, "build PHS of each leaf on first use instead of whole PHS at map load, for huge maps" );
 CVAR_DEFINE_AUTO( r_showhull, "0", 0, "draw collision hulls 1-3" );
 
 /*
@@ -92,6 +99,51 @@ static void Mod_FreeUserData( model_t *mod )
 #endif
 }
 
+/*
+================
+Mod_LinkName
+
+put model slot into name hash
+================
+*/
+static void Mod_LinkName( int i )
+{
+	uint	key = COM_HashKey( mod_known[i].name, MOD_HASH_SIZE );
+
+	mod_hashnext[i] = mod_hashfirst[key];
+	mod_hashfirst[key] = i + 1;
+	ClearBits( mod_freeslots[i >> 5], BIT( i & 31 ));
+}
+
+/*
+================
+Mod_UnlinkName
+
+remove model from name hash and mark it's slot as free,
+must be called before model name is cleared
+================
+*/
+static void Mod_UnlinkName( model_t *mod )
+{
+	int	i = mod - mod_known;
+	int	*link;
+
+	// sprites and other models outside of the table
+	if( i < 0 || i >= mod_numknown || !COM_CheckStringEmpty( mod->name ))
+		return;
+
+	for( link = &mod_hashfirst[COM_HashKey( mod->name, MOD_HASH_SIZE )]; *link; link = &mod_hashnext[*link - 1] )
+	{
+		if( *link == i + 1 )
+		{
+			*link = mod_hashnext[i];
+			break;
+		}
+	}
+
+	SetBits( mod_freeslots[i >> 5], BIT( i & 31 ));
+}
+
 /*
 ================
 Mod_FreeModel
@@ -119,8 +171,11 @@ void Mod_FreeModel( model_t *mod )
 		world.hull_models = NULL;
 		world.compressed_phs = NULL;
 		world.phsofs = NULL;
+		world.phsrows = NULL;
+		world.phssize = 0;
 	}
 
+	Mod_UnlinkName( mod );
 	memset( mod, 0, sizeof( *mod ));
 }
 
@@ -141,6 +196,8 @@ void Mod_Init( void )
 	com_studiocache = Mem_AllocPool( "Studio Cache" );
 	Cvar_RegisterVariable( &mod_studiocache );
 	Cvar_RegisterVariable( &r_wadtextures );
+	Cvar_RegisterVariable( &mod_lazyphs );
+	Cvar_RegisterVariable( &mod_bspcache );
 	Cvar_RegisterVariable( &r_showhull );
 
 	Cmd_AddCommand( "mapstats", Mod_PrintWorldStats_f, "show stats for currently loaded map" );
@@ -165,6 +222,9 @@ void Mod_FreeAll( void )
 	for( i = 0; i < mod_numknown; i++ )
 		Mod_FreeModel( &mod_known[i] );
 	mod_numknown = 0;
+
+	memset( mod_hashfirst, 0, sizeof( mod_hashfirst ));
+	memset( mod_freeslots, 0, sizeof( mod_freeslots ));
 }
 
 /*
@@ -214,8 +274,10 @@ model_t *Mod_FindName( const char *filename, qboolean trackCRC )
 	Q_strncpy( modname, filename, sizeof( modname ));
 
 	// search the currently loaded models
-	for( i = 0, mod = mod_known; i < mod_numknown; i++, mod++ )
+	for( i = mod_hashfirst[COM_HashKey( modname, MOD_HASH_SIZE )]; i; i = mod_hashnext[i - 1] )
 	{
+		mod = &mod_known[i - 1];
+
 		if( !Q_stricmp( mod->name, modname ))
 		{
 			if( mod->mempool || mod->name[0] == '*' )
@@ -226,19 +288,34 @@ model_t *Mod_FindName( const char *filename, qboolean trackCRC )
 		}
 	}
 
-	// find a free model slot spot
-	for( i = 0, mod = mod_known; i < mod_numknown; i++, mod++ )
-		if( !COM_CheckStringEmpty( mod->name ) ) break; // this is a valid spot
+	// find the lowest free model slot, world relies on it to get slot #0
+	for( i = 0; i < mod_numknown; i += 32 )
+	{
+		if( mod_freeslots[i >> 5] )
+		{
+			while( !FBitSet( mod_freeslots[i >> 5], BIT( i & 31 )))
+				i++;
+			break;
+		}
+	}
 
-	if( i == mod_numknown )
+	if( i >= mod_numknown )
 	{
 		if( mod_numknown == MAX_MODELS )
 			Host_Error( "MAX_MODELS limit exceeded (%d)\n", MAX_MODELS );
-		mod_numknown++;
+		i = mod_numknown++;
 	}
 
+	mod = &mod_known[i];
+
 	// copy name, so model loader can find model file
 	Q_strncpy( mod->name, modname, sizeof( mod->name ));
+
+	// empty name keeps the slot free, like it always did
+	if( COM_CheckStringEmpty( mod->name ))
+		Mod_LinkName( i );
+	else SetBits( mod_freeslots[i >> 5], BIT( i & 31 ));
+
 	if( trackCRC ) mod_crcinfo[i].flags = FCRC_SHOULD_CHECKSUM;
 	else mod_crcinfo[i].flags = 0;
 	mod->needload = NL_NEEDS_LOADED;
@@ -281,6 +358,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 
 	if( !buf || length < sizeof( uint ))
 	{
+		Mod_UnlinkName( mod );
 		memset( mod, 0, sizeof( model_t ));
 
 		if( crash ) Host_Error( "Could not load model %s from disk\n", tempname );
@@ -851,6 +851,245 @@ void MSG_ExciseBits( sizebuf_t *sb, int startbit, int bitstoremove )
 	sb->nDataBits -= bitstoremove;
 }
 
+/*
+=======================
+MSG_StartBitWriter
+
+pending bits start at byte boundary,
+so the partial byte is loaded back
+=======================
+*/
+void MSG_StartBitWriter( bitwriter_t *bw, sizebuf_t *sb )
+{
+	bw->sb = sb;
+	bw->start = sb->iCurBit & ~7;
+	bw->nbits = sb->iCurBit & 7;
+	bw->accum = bw->nbits ? sb->pData[bw->start >> 3] & MSG_BitMask( bw->nbits ) : 0;
+}
+
+/*
+=======================
+MSG_EndBitWriter
+
+writes out pending bits, keeping the rest of the last byte
+=======================
+*/
+void MSG_EndBitWriter( bitwriter_t *bw )
+{
+	sizebuf_t *sb = bw->sb;
+
+	while( bw->nbits >= 8 )
+	{
+		sb->pData[bw->start >> 3] = (byte)bw->accum;
+		bw->accum >>= 8;
+		bw->nbits -= 8;
+		bw->start += 8;
+	}
+
+	if( bw->nbits )
+	{
+		byte mask = MSG_BitMask( bw->nbits );
+		byte *p = &sb->pData[bw->start >> 3];
+
+		*p = ( *p & ~mask ) | ((byte)bw->accum & mask );
+	}
+
+	sb->iCurBit = bw->start + bw->nbits;
+}
+
+/*
+=======================
+MSG_BitWriterOverflow
+
+same as MSG_WriteUBitLong does, cursor goes to the end
+=======================
+*/
+void MSG_BitWriterOverflow( bitwriter_t *bw )
+{
+	sizebuf_t *sb = bw->sb;
+
+	MSG_EndBitWriter( bw );
+	sb->bOverflow = true;
+	sb->iCurBit = sb->nDataBits;
+	MSG_StartBitWriter( bw, sb );
+}
+
+void MSG_BitWriteSBitLong( bitwriter_t *bw, int data, int numbits )
+{
+	// keep in sync with MSG_WriteSBitLong
+	if( bw->sb->iAlternateSign )
+	{
+		MSG_BitWriteOneBit( bw, data < 0 ? 1 : 0 );
+		MSG_BitWriteUBitLong( bw, (uint)abs( data ), numbits - 1 );
+	}
+	else
+	{
+		if( data < 0 )
+		{
+			MSG_BitWriteUBitLong( bw, (uint)( 0x80000000 + data ), numbits - 1 );
+			MSG_BitWriteOneBit( bw, 1 );
+		}
+		else
+		{
+			MSG_BitWriteUBitLong( bw, (uint)data, numbits - 1 );
+			MSG_BitWriteOneBit( bw, 0 );
+		}
+	}
+}
+
+void MSG_BitWriteBitAngle( bitwriter_t *bw, float fAngle, int numbits )
+{
+	const uint shift = ( 1 << numbits );
+	const uint mask = shift - 1;
+	int	d;
+
+	// keep in sync with MSG_WriteBitAngle
+	fAngle = fmod( fAngle, 360.0f );
+	if( fAngle < 0 ) fAngle += 360.0f;
+
+	d = (int)(( fAngle * shift ) / 360.0f );
+	d &= mask;
+
+	MSG_BitWriteUBitLong( bw, (uint)d, numbits );
+}
+
+void MSG_BitWriteString( bitwriter_t *bw, const char *pStr )
+{
+	// strings are rare, let sizebuf handle them
+	MSG_EndBitWriter( bw );
+	MSG_WriteString( bw->sb, pStr );
+	MSG_StartBitWriter( bw, bw->sb );
+}
+
+/*
+=======================
+MSG_StartBitReader
+
+=======================
+*/
+void MSG_StartBitReader( bitreader_t *br, sizebuf_t *sb )
+{
+	br->sb = sb;
+	br->pos = sb->iCurBit;
+	br->nbits = 0;
+	br->accum = 0;
+}
+
+/*
+=======================
+MSG_EndBitReader
+
+loaded but unread bits are simply dropped
+=======================
+*/
+void MSG_EndBitReader( bitreader_t *br )
+{
+	br->sb->iCurBit = br->pos - br->nbits;
+}
+
+/*
+=======================
+MSG_BitReaderRefill
+
+=======================
+*/
+void MSG_BitReaderRefill( bitreader_t *br )
+{
+	const byte *data = br->sb->pData;
+	int end = BitByte( br->sb->nDataBits ) << 3;
+
+	// align to byte first
+	if( br->pos & 7 )
+	{
+		int shift = br->pos & 7;
+
+		br->accum |= (uint64_t)( data[br->pos >> 3] >> shift ) << br->nbits;
+		br->nbits += 8 - shift;
+		br->pos += 8 - shift;
+	}
+
+	// whole dword
+	if( br->nbits <= 32 && br->pos + 32 <= end )
+	{
+		const byte *p = &data[br->pos >> 3];
+		uint32_t dword = p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ((uint32_t)p[3] << 24 );
+
+		br->accum |= (uint64_t)dword << br->nbits;
+		br->nbits += 32;
+		br->pos += 32;
+	}
+
+	// bytes at the end of buffer
+	while( br->nbits <= 56 && br->pos < end )
+	{
+		br->accum |= (uint64_t)data[br->pos >> 3] << br->nbits;
+		br->nbits += 8;
+		br->pos += 8;
+	}
+}
+
+/*
+=======================
+MSG_BitReaderOverflow
+
+same as MSG_ReadUBitLong does, cursor goes to the end
+=======================
+*/
+void MSG_BitReaderOverflow( bitreader_t *br )
+{
+	br->sb->bOverflow = true;
+	br->pos = br->sb->nDataBits;
+	br->nbits = 0;
+	br->accum = 0;
+}
+
+int MSG_BitReadSBitLong( bitreader_t *br, int numbits )
+{
+	int r;
+
+	// keep in sync with MSG_ReadSBitLong
+	if( br->sb->iAlternateSign )
+	{
+		int sign = MSG_BitReadOneBit( br );
+		r = MSG_BitReadUBitLong( br, numbits - 1 );
+
+		if( sign )
+			r = -r;
+	}
+	else
+	{
+		r = MSG_BitReadUBitLong( br, numbits - 1 );
+		if( MSG_BitReadOneBit( br ))
+			r = -( BIT( numbits - 1 ) - r );
+	}
+
+	return r;
+}
+
+float MSG_BitReadBitAngle( bitreader_t *br, int numbits )
+{
+	float shift = (float)( 1 << numbits );
+	int i = MSG_BitReadUBitLong( br, numbits );
+	float fReturn = (float)i * ( 360.0f / shift );
+
+	// keep in sync with MSG_ReadBitAngle
+	if( fReturn < -180.0f ) fReturn += 360.0f;
+	else if( fReturn > 180.0f ) fReturn -= 360.0f;
+
+	return fReturn;
+}
+
+char *MSG_BitReadString( bitreader_t *br )
+{
+	char *pStr;
+
+	MSG_EndBitReader( br );
+	pStr = MSG_ReadString( br->sb );
+	MSG_StartBitReader( br, br->sb );
+
+	return pStr;
+}
+
 #ifdef XASH_ENGINE_TESTS
 #include "tests.h"
 
@@ -996,12 +1235,276 @@ static void Test_Buffer_ExciseBits( void )
 	TASSERT_EQi( MSG_ReadUBitLong( &sb, 4 ), 0xa );
 }
 
+#define TEST_FUZZ_ROUNDS 2000
+#define TEST_FUZZ_OPS    64
+#define TEST_FUZZ_BYTES  64
+
+static uint32_t Test_Buffer_Random( uint32_t *state )
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return *state = x;
+}
+
+static qboolean Test_Buffer_BitsEqual( const byte *a, const byte *b, int startbit, int endbit )
+{
+	int i;
+
+	for( i = startbit; i < endbit; i++ )
+	{
+		if((( a[i >> 3] ^ b[i >> 3] ) >> ( i & 7 )) & 1 )
+			return false;
+	}
+
+	return true;
+}
+
+static void Test_Buffer_RandomString( uint32_t *seed, char *str, size_t size )
+{
+	int i, len = Test_Buffer_Random( seed ) % ( size - 1 );
+
+	for( i = 0; i < len; i++ )
+		str[i] = 'a' + Test_Buffer_Random( seed ) % 26;
+	str[len] = 0;
+}
+
+static void Test_Buffer_FuzzWriter( void )
+{
+	uint32_t seed = 0x1badb002;
+	int round, failed = 0;
+
+	for( round = 0; round < TEST_FUZZ_ROUNDS; round++ )
+	{
+		// old writer works with whole dwords, leave some room after the end
+		uint32_t ref[TEST_FUZZ_BYTES / 4 + 2], out[TEST_FUZZ_BYTES / 4 + 2], orig[TEST_FUZZ_BYTES / 4 + 2];
+		int size = 1 + Test_Buffer_Random( &seed ) % TEST_FUZZ_BYTES;
+		int startbit = Test_Buffer_Random( &seed ) % ( size << 3 );
+		int numops = Test_Buffer_Random( &seed ) % TEST_FUZZ_OPS;
+		sizebuf_t sb1, sb2;
+		bitwriter_t bw;
+		int i, goodbits = startbit;
+
+		for( i = 0; i < sizeof( orig ) / sizeof( orig[0] ); i++ )
+			ref[i] = out[i] = orig[i] = Test_Buffer_Random( &seed );
+
+		MSG_StartWriting( &sb1, ref, size, startbit, -1 );
+		MSG_StartWriting( &sb2, out, size, startbit, -1 );
+		sb1.iAlternateSign = sb2.iAlternateSign = Test_Buffer_Random( &seed ) & 1;
+
+		MSG_StartBitWriter( &bw, &sb2 );
+
+		for( i = 0; i < numops; i++ )
+		{
+			uint32_t value = Test_Buffer_Random( &seed );
+			int numbits = 1 + Test_Buffer_Random( &seed ) % 32;
+			char str[16];
+			float angle;
+
+			if( !sb1.bOverflow )
+				goodbits = sb1.iCurBit;
+
+			switch( Test_Buffer_Random( &seed ) % 6 )
+			{
+			case 0:
+				MSG_WriteOneBit( &sb1, value & 1 );
+				MSG_BitWriteOneBit( &bw, value & 1 );
+				break;
+			case 1:
+			case 2:
+				MSG_WriteUBitLong( &sb1, value, numbits );
+				MSG_BitWriteUBitLong( &bw, value, numbits );
+				break;
+			case 3:
+				// keep abs() defined
+				numbits = Q_max( numbits, 2 );
+				value = (int)value >> ( 33 - numbits );
+				MSG_WriteSBitLong( &sb1, (int)value, numbits );
+				MSG_BitWriteSBitLong( &bw, (int)value, numbits );
+				break;
+			case 4:
+				numbits = 1 + numbits % 16;
+				angle = (int)( value % 72000 ) / 100.0f - 360.0f;
+				MSG_WriteBitAngle( &sb1, angle, numbits );
+				MSG_BitWriteBitAngle( &bw, angle, numbits );
+				break;
+			case 5:
+				Test_Buffer_RandomString( &seed, str, sizeof( str ));
+				MSG_WriteString( &sb1, str );
+				MSG_BitWriteString( &bw, str );
+				break;
+			}
+		}
+
+		MSG_EndBitWriter( &bw );
+
+		// old writer leaves junk after the cursor, on overflow the cursor jumps over it
+		if( !sb1.bOverflow )
+			goodbits = sb1.iCurBit;
+
+		if( sb1.iCurBit != sb2.iCurBit || sb1.bOverflow != sb2.bOverflow )
+			failed++;
+		else if( !Test_Buffer_BitsEqual( (byte *)ref, (byte *)out, 0, goodbits ))
+			failed++;
+		else if( !Test_Buffer_BitsEqual( (byte *)orig, (byte *)out, sb2.iCurBit, sizeof( out ) << 3 ))
+			failed++; // must not touch anything after the cursor
+	}
+
+	TASSERT_EQi( failed, 0 );
+}
+
+static void Test_Buffer_FuzzReader( void )
+{
+	uint32_t seed = 0xdeadbeef;
+	int round, failed = 0;
+
+	for( round = 0; round < TEST_FUZZ_ROUNDS; round++ )
+	{
+		uint32_t data[TEST_FUZZ_BYTES / 4 + 2];
+		int size = 1 + Test_Buffer_Random( &seed ) % TEST_FUZZ_BYTES;
+		int startbit = Test_Buffer_Random( &seed ) % ( size << 3 );
+		int numops = Test_Buffer_Random( &seed ) % TEST_FUZZ_OPS;
+		sizebuf_t sb1, sb2;
+		bitreader_t br;
+		int i;
+
+		for( i = 0; i < sizeof( data ) / sizeof( data[0] ); i++ )
+			data[i] = Test_Buffer_Random( &seed );
+
+		// strings are more likely to end inside the buffer
+		if( Test_Buffer_Random( &seed ) & 1 )
+		{
+			for( i = 0; i < size; i++ )
+				((byte *)data)[i] &= 0x0f;
+		}
+
+		MSG_StartReading( &sb1, data, size, startbit, -1 );
+		MSG_StartReading( &sb2, data, size, startbit, -1 );
+		sb1.iAlternateSign = sb2.iAlternateSign = Test_Buffer_Random( &seed ) & 1;
+
+		MSG_StartBitReader( &br, &sb2 );
+
+		for( i = 0; i < numops; i++ )
+		{
+			int numbits = 1 + Test_Buffer_Random( &seed ) % 32;
+			char str[4096];
+			float angle;
+
+			switch( Test_Buffer_Random( &seed ) % 6 )
+			{
+			case 0:
+				if( MSG_ReadOneBit( &sb1 ) != MSG_BitReadOneBit( &br ))
+					failed++;
+				break;
+			case 1:
+				numbits = 8; // has a special case
+				// fallthrough
+			case 2:
+				if( MSG_ReadUBitLong( &sb1, numbits ) != MSG_BitReadUBitLong( &br, numbits ))
+					failed++;
+				break;
+			case 3:
+				numbits = Q_max( numbits, 2 );
+				if( MSG_ReadSBitLong( &sb1, numbits ) != MSG_BitReadSBitLong( &br, numbits ))
+					failed++;
+				break;
+			case 4:
+				numbits = 1 + numbits % 16;
+				angle = MSG_ReadBitAngle( &sb1, numbits );
+				if( angle != MSG_BitReadBitAngle( &br, numbits ))
+					failed++;
+				break;
+			case 5:
+				Q_strncpy( str, MSG_ReadString( &sb1 ), sizeof( str ));
+				if( Q_strcmp( str, MSG_BitReadString( &br )))
+					failed++;
+				break;
+			}
+		}
+
+		MSG_EndBitReader( &br );
+
+		if( sb1.iCurBit != sb2.iCurBit || sb1.bOverflow != sb2.bOverflow )
+			failed++;
+	}
+
+	TASSERT_EQi( failed, 0 );
+}
+
+static void Test_Buffer_FuzzRoundTrip( void )
+{
+	uint32_t seed = 0xcafe;
+	int round, failed = 0;
+
+	for( round = 0; round < TEST_FUZZ_ROUNDS; round++ )
+	{
+		uint32_t data[TEST_FUZZ_OPS + 2] = { 0 }; // room for all values
+		uint32_t values[TEST_FUZZ_OPS];
+		int bits[TEST_FUZZ_OPS];
+		int numops = Test_Buffer_Random( &seed ) % TEST_FUZZ_OPS;
+		int startbit = Test_Buffer_Random( &seed ) % 32;
+		qboolean newwriter = round & 1;
+		sizebuf_t sb;
+		bitwriter_t bw;
+		bitreader_t br;
+		int i;
+
+		// old writer and new reader, then the other way around
+		MSG_StartWriting( &sb, data, sizeof( data ), startbit, -1 );
+		if( newwriter )
+			MSG_StartBitWriter( &bw, &sb );
+
+		for( i = 0; i < numops; i++ )
+		{
+			bits[i] = 1 + Test_Buffer_Random( &seed ) % 32;
+			values[i] = Test_Buffer_Random( &seed ) & MSG_BitMask( bits[i] );
+
+			if( newwriter )
+				MSG_BitWriteUBitLong( &bw, values[i], bits[i] );
+			else MSG_WriteUBitLong( &sb, values[i], bits[i] );
+		}
+
+		if( newwriter )
+			MSG_EndBitWriter( &bw );
+
+		MSG_SeekToBit( &sb, startbit, SEEK_SET );
+		if( !newwriter )
+			MSG_StartBitReader( &br, &sb );
+
+		for( i = 0; i < numops; i++ )
+		{
+			uint32_t value;
+
+			if( newwriter )
+				value = MSG_ReadUBitLong( &sb, bits[i] );
+			else value = MSG_BitReadUBitLong( &br, bits[i] );
+
+			if( value != values[i] )
+				failed++;
+		}
+
+		if( !newwriter )
+			MSG_EndBitReader( &br );
+
+		if( sb.bOverflow )
+			failed++;
+	}
+
+	TASSERT_EQi( failed, 0 );
+}
+
 void Test_RunBuffer( void )
 {
 	TRUN( Test_Buffer_BitByte( ));
 	TRUN( Test_Buffer_Write( ));
 	TRUN( Test_Buffer_Read( ));
 	TRUN( Test_Buffer_ExciseBits( ));
+	TRUN( Test_Buffer_FuzzWriter( ));
+	TRUN( Test_Buffer_FuzzReader( ));
+	TRUN( Test_Buffer_FuzzRoundTrip( ));
 }
 
 #endif // XASH_ENGINE_TESTS
@@ -259,4 +259,146 @@ char *MSG_ReadString( sizebuf_t *sb ) RETURNS_NONNULL;
 char *MSG_ReadStringLine( sizebuf_t *sb ) RETURNS_NONNULL;
 qboolean MSG_ReadBytes( sizebuf_t *sb, void *pOut, int nBytes );
 
+/*
+==============================================================================
+
+			BUFFERED BIT IO
+	Keeps pending bits in a 64-bit accumulator and touches the buffer
+	a dword at a time, output is the same as of MSG_Write/Read functions.
+	Sizebuf cursor isn't updated until MSG_EndBitWriter/MSG_EndBitReader.
+==============================================================================
+*/
+typedef struct bitwriter_s
+{
+	sizebuf_t *sb;
+	uint64_t  accum; // pending bits, the first written is the lowest
+	int       nbits; // number of pending bits
+	int       start; // byte aligned bit position of pending bits
+} bitwriter_t;
+
+typedef struct bitreader_s
+{
+	sizebuf_t *sb;
+	uint64_t  accum; // loaded bits, the next to read is the lowest
+	int       nbits; // number of loaded bits
+	int       pos;   // bit position of the next load
+} bitreader_t;
+
+void MSG_StartBitWriter( bitwriter_t *bw, sizebuf_t *sb );
+void MSG_EndBitWriter( bitwriter_t *bw );
+void MSG_BitWriterOverflow( bitwriter_t *bw );
+void MSG_BitWriteSBitLong( bitwriter_t *bw, int data, int numbits );
+void MSG_BitWriteBitAngle( bitwriter_t *bw, float fAngle, int numbits );
+void MSG_BitWriteString( bitwriter_t *bw, const char *pStr );
+
+void MSG_StartBitReader( bitreader_t *br, sizebuf_t *sb );
+void MSG_EndBitReader( bitreader_t *br );
+void MSG_BitReaderRefill( bitreader_t *br );
+void MSG_BitReaderOverflow( bitreader_t *br );
+int MSG_BitReadSBitLong( bitreader_t *br, int numbits );
+float MSG_BitReadBitAngle( bitreader_t *br, int numbits );
+char *MSG_BitReadString( bitreader_t *br ) RETURNS_NONNULL;
+
+static inline uint32_t MSG_BitMask( int numbits )
+{
+	return numbits >= 32 ? 0xffffffffU : ( 1U << numbits ) - 1;
+}
+
+static inline void MSG_BitWriteUBitLong( bitwriter_t *bw, uint data, int numbits )
+{
+	if( unlikely( bw->sb->bOverflow || bw->start + bw->nbits + numbits > bw->sb->nDataBits ))
+	{
+		MSG_BitWriterOverflow( bw );
+		return;
+	}
+
+	bw->accum |= (uint64_t)( data & MSG_BitMask( numbits )) << bw->nbits;
+	bw->nbits += numbits;
+
+	// flush a whole dword
+	if( bw->nbits >= 32 )
+	{
+		byte *p = bw->sb->pData + ( bw->start >> 3 );
+		uint32_t dword = (uint32_t)bw->accum;
+
+		p[0] = dword;
+		p[1] = dword >> 8;
+		p[2] = dword >> 16;
+		p[3] = dword >> 24;
+
+		bw->accum >>= 32;
+		bw->nbits -= 32;
+		bw->start += 32;
+	}
+}
+
+static inline void MSG_BitWriteOneBit( bitwriter_t *bw, int nValue )
+{
+	// like MSG_WriteOneBit, overflow doesn't move the cursor
+	if( unlikely( bw->sb->bOverflow || bw->start + bw->nbits + 1 > bw->sb->nDataBits ))
+	{
+		bw->sb->bOverflow = true;
+		return;
+	}
+
+	MSG_BitWriteUBitLong( bw, nValue ? 1 : 0, 1 );
+}
+
+static inline void MSG_BitWriteBitLong( bitwriter_t *bw, uint data, int numbits, qboolean bSigned )
+{
+	if( bSigned )
+		MSG_BitWriteSBitLong( bw, (int)data, numbits );
+	else MSG_BitWriteUBitLong( bw, data, numbits );
+}
+
+static inline uint MSG_BitReadUBitLong( bitreader_t *br, int numbits )
+{
+	sizebuf_t *sb = br->sb;
+	int curbit = br->pos - br->nbits;
+	uint ret;
+
+	// same as MSG_ReadUBitLong
+	if( numbits == 8 )
+	{
+		int leftBits = sb->nDataBits - curbit;
+
+		if( leftBits >= 0 && leftBits < 8 )
+			return 0; // end of message
+	}
+
+	if( unlikely( sb->bOverflow || curbit + numbits > sb->nDataBits ))
+	{
+		MSG_BitReaderOverflow( br );
+		return 0;
+	}
+
+	if( br->nbits < numbits )
+		MSG_BitReaderRefill( br );
+
+	ret = (uint)br->accum & MSG_BitMask( numbits );
+	br->accum >>= numbits;
+	br->nbits -= numbits;
+
+	return ret;
+}
+
+static inline int MSG_BitReadOneBit( bitreader_t *br )
+{
+	// like MSG_ReadOneBit, overflow doesn't move the cursor
+	if( unlikely( br->sb->bOverflow || br->pos - br->nbits + 1 > br->sb->nDataBits ))
+	{
+		br->sb->bOverflow = true;
+		return 0;
+	}
+
+	return MSG_BitReadUBitLong( br, 1 );
+}
+
+static inline uint MSG_BitReadBitLong( bitreader_t *br, int numbits, qboolean bSigned )
+{
+	if( bSigned )
+		return (uint)MSG_BitReadSBitLong( br, numbits );
+	return MSG_BitReadUBitLong( br, numbits );
+}
+
 #endif//NET_BUFFER_H
@@ -31,10 +31,10 @@ GNU General Public License for more details.
 #define FLOW_AVG			( 2.0f / 3.0f )	// how fast to converge flow estimates
 #define FLOW_INTERVAL		0.1		// don't compute more often than this
 #define MAX_RELIABLE_PAYLOAD		1400		// biggest packet that has frag and or reliable data
+#define MAX_FREE_FRAGBUFS		32		// outgoing fragment buffers kept for reuse by each channel
 
 // forward declarations
 void Netchan_FlushIncoming( netchan_t *chan, int stream );
-void Netchan_AddBufferToList( fragbuf_t **pplist, fragbuf_t *pbuf );
 
 /*
 packet header ( size in bits )
@@ -271,7 +271,7 @@ void Netchan_Init( void )
 	Cvar_RegisterVariable( &net_recv_debug );
 	Cvar_FullSet( net_qport.name, buf, net_qport.flags );
 
-	net_mempool = Mem_AllocPool( "Network Pool" );
+	net_mempool = Mem_AllocPoolExt( "Network Pool", MEMPOOL_SLAB );
 }
 
 void Netchan_Shutdown( void )
@@ -385,13 +385,34 @@ qboolean Netchan_CanPacket( netchan_t *chan, qboolean choke )
 	return chan->cleartime < host.realtime ? true : false;
 }
 
+/*
+==============================
+Netchan_FreeFragbuf
+
+messages are split into same sized fragments,
+so keep a few buffers around for the next ones
+==============================
+*/
+static void Netchan_FreeFragbuf( netchan_t *chan, fragbuf_t *buf )
+{
+	if( chan->numfreefragbufs < MAX_FREE_FRAGBUFS )
+	{
+		buf->next = chan->freefragbufs;
+		chan->freefragbufs = buf;
+		chan->numfreefragbufs++;
+		return;
+	}
+
+	Mem_Free( buf );
+}
+
 /*
 ==============================
 Netchan_UnlinkFragment
 
 ==============================
 */
-static void Netchan_UnlinkFragment( fragbuf_t *buf, fragbuf_t **list )
+static void Netchan_UnlinkFragment( netchan_t *chan, fragbuf_t *buf, fragbuf_t **list )
 {
 	fragbuf_t	*search;
 
@@ -404,7 +425,7 @@ static void Netchan_UnlinkFragment( fragbuf_t *buf, fragbuf_t **list )
 		*list = buf->next;
 
 		// destroy remnant
-		Mem_Free( buf );
+		Netchan_FreeFragbuf( chan, buf );
 		return;
 	}
 
@@ -416,7 +437,7 @@ static void Netchan_UnlinkFragment( fragbuf_t *buf, fragbuf_t **list )
 			search->next = buf->next;
 
 			// destroy remnant
-			Mem_Free( buf );
+			Netchan_FreeFragbuf( chan, buf );
 			return;
 		}
 		search = search->next;
@@ -429,7 +450,7 @@ Netchan_ClearFragbufs
 
 ==============================
 */
-static void Netchan_ClearFragbufs( fragbuf_t **ppbuf )
+static void Netchan_ClearFragbufs( netchan_t *chan, fragbuf_t **ppbuf )
 {
 	fragbuf_t	*buf, *n;
 
@@ -441,7 +462,7 @@ static void Netchan_ClearFragbufs( fragbuf_t **ppbuf )
 	while( buf )
 	{
 		n = buf->next;
-		Mem_Free( buf );
+		Netchan_FreeFragbuf( chan, buf );
 		buf = n;
 	}
 
@@ -466,13 +487,13 @@ static void Netchan_ClearFragments( netchan_t *chan )
 		while( wait )
 		{
 			next = wait->next;
-			Netchan_ClearFragbufs( &wait->fragbufs );
+			Netchan_ClearFragbufs( chan, &wait->fragbufs );
 			Mem_Free( wait );
 			wait = next;
 		}
 		chan->waitlist[i] = NULL;
 
-		Netchan_ClearFragbufs( &chan->fragbufs[i] );
+		Netchan_ClearFragbufs( chan, &chan->fragbufs[i] );
 		Netchan_FlushIncoming( chan, i );
 	}
 }
@@ -485,10 +506,19 @@ Netchan_Clear
 */
 void Netchan_Clear( netchan_t *chan )
 {
+	fragbuf_t	*buf;
 	int	i;
 
 	Netchan_ClearFragments( chan );
 
+	while( chan->freefragbufs )
+	{
+		buf = chan->freefragbufs;
+		chan->freefragbufs = buf->next;
+		Mem_Free( buf );
+	}
+	chan->numfreefragbufs = 0;
+
 	chan->cleartime = 0.0;
 	chan->reliable_length = 0;
 
@@ -500,6 +530,12 @@ void Netchan_Clear( netchan_t *chan )
 		chan->frag_startpos[i] = 0;
 		chan->frag_length[i] = 0;
 		chan->incomingready[i] = false;
+
+		if( chan->incoming[i].data )
+			Mem_Free( chan->incoming[i].data );
+		if( chan->incoming[i].offsets )
+			Mem_Free( chan->incoming[i].offsets );
+		memset( &chan->incoming[i], 0, sizeof( chan->incoming[i] ));
 	}
 
 	if( chan->tempbuffer )
@@ -571,11 +607,34 @@ Netchan_AllocFragbuf
 
 ==============================
 */
-static fragbuf_t *Netchan_AllocFragbuf( int fragment_size )
+static fragbuf_t *Netchan_AllocFragbuf( netchan_t *chan, int fragment_size, int chunksize )
 {
-	fragbuf_t	*buf;
+	fragbuf_t	*buf, **prev;
+	int	buffersize;
+
+	// take a released buffer that is big enough
+	for( prev = &chan->freefragbufs; *prev; prev = &(*prev)->next )
+	{
+		buf = *prev;
+
+		if( buf->buffersize < fragment_size )
+			continue;
 
-	buf = (fragbuf_t *)Mem_Calloc( net_mempool, sizeof( fragbuf_t ) + fragment_size );
+		*prev = buf->next;
+		chan->numfreefragbufs--;
+
+		buffersize = buf->buffersize;
+		memset( buf, 0, sizeof( *buf ));
+		buf->buffersize = buffersize;
+		MSG_Init( &buf->frag_message, "Frag Message", buf->frag_message_buf, fragment_size );
+
+		return buf;
+	}
+
+	// the last fragment is shorter, allocate whole chunk anyway so it can be reused
+	buffersize = Q_max( fragment_size, chunksize );
+	buf = (fragbuf_t *)Mem_Calloc( net_mempool, sizeof( fragbuf_t ) + buffersize );
+	buf->buffersize = buffersize;
 	MSG_Init( &buf->frag_message, "Frag Message", buf->frag_message_buf, fragment_size );
 
 	return buf;
@@ -680,51 +739,6 @@ void Netchan_FragSend( netchan_t *chan )
 	}
 }
 
-/*
-==============================
-Netchan_AddBufferToList
-
-==============================
-*/
-void Netchan_AddBufferToList( fragbuf_t **pplist, fragbuf_t *pbuf )
-{
-	// Find best slot
-	fragbuf_t	*pprev, *n;
-	int	id1, id2;
-
-	pbuf->next = NULL;
-
-	if( !pplist )
-		return;
-
-	if( !*pplist )
-	{
-		pbuf->next = *pplist;
-		*pplist = pbuf;
-		return;
-	}
-
-	pprev = *pplist;
-	while( pprev->next )
-	{
-		n = pprev->next; // next item in list
-		id1 = FRAG_GETID( n->bufferid );
-		id2 = FRAG_GETID( pbuf->bufferid );
-
-		if( id1 > id2 )
-		{
-			// insert here
-			pbuf->next = n->next;
-			pprev->next = pbuf;
-			return;
-		}
-		pprev = pprev->next;
-	}
-
-	// insert at end
-	pprev->next = pbuf;
-}
-
 /*
 ==============================
 Netchan_CreateFragments_
@@ -790,7 +804,7 @@ static void Netchan_CreateFragments_( netchan_t *chan, sizebuf_t *msg )
 		bytes = Q_min( remaining, chunksize );
 		remaining -= bytes;
 
-		buf = Netchan_AllocFragbuf( bytes );
+		buf = Netchan_AllocFragbuf( chan, bytes, chunksize );
 		buf->bufferid = bufferid++;
 
 		// Copy in data
@@ -836,74 +850,159 @@ void Netchan_CreateFragments( netchan_t *chan, sizebuf_t *msg )
 
 /*
 ==============================
-Netchan_FindBufferById
+Netchan_ResetIncoming
 
+forgets pending message, keeps buffers that fit a regular
+message for reuse and frees bigger ones, so files and forged
+fragment counts don't keep memory pinned
 ==============================
 */
-static fragbuf_t *Netchan_FindBufferById( fragbuf_t **pplist, int id, qboolean allocate )
+static void Netchan_ResetIncoming( fragassembly_t *in )
 {
-	fragbuf_t	*list = *pplist;
-	fragbuf_t	*pnewbuf;
-
-	while( list )
+	if( in->maxsize > NET_MAX_MESSAGE + 1 )
 	{
-		if( list->bufferid == id )
-			return list;
+		Mem_Free( in->data );
+		in->data = NULL;
+		in->maxsize = 0;
+	}
 
-		list = list->next;
+	if( in->maxcount > NET_MAX_MESSAGE / FRAGMENT_MIN_SIZE + 1 )
+	{
+		Mem_Free( in->offsets );
+		in->offsets = in->lengths = NULL;
+		in->maxcount = 0;
 	}
 
-	if( !allocate )
-		return NULL;
+	in->count = in->received = in->size = 0;
+}
+
+/*
+==============================
+Netchan_BeginIncoming
+
+prepares stream to receive a new fragmented message
+==============================
+*/
+static void Netchan_BeginIncoming( netchan_t *chan, int stream, int count )
+{
+	fragassembly_t	*in = &chan->incoming[stream];
 
-	// create new entry
-	pnewbuf = Netchan_AllocFragbuf( NET_MAX_FRAGMENT );
-	pnewbuf->bufferid = id;
-	Netchan_AddBufferToList( pplist, pnewbuf );
+	if( count > in->maxcount )
+	{
+		in->offsets = (int *)Mem_Realloc( net_mempool, in->offsets, count * 2 * sizeof( int ));
+		in->lengths = in->offsets + count;
+		in->maxcount = count;
+	}
 
-	return pnewbuf;
+	memset( in->offsets, 0xff, count * sizeof( int ));
+	in->count = count;
+	in->received = 0;
+	in->size = 0;
+	in->inorder = true;
 }
 
 /*
 ==============================
-Netchan_CheckForCompletion
+Netchan_AddIncomingFragment
 
+reads fragment directly into the assembly buffer,
+fragment id indexes the offset table, so lookup
+and duplicate check doesn't walk any lists
 ==============================
 */
-static void Netchan_CheckForCompletion( netchan_t *chan, int stream, int intotalbuffers )
+static void Netchan_AddIncomingFragment( netchan_t *chan, int stream, uint fragid, sizebuf_t *msg, int startbit, int bits )
 {
-	int	c, id;
-	int	size;
-	fragbuf_t	*p;
+	fragassembly_t	*in = &chan->incoming[stream];
+	int		id = FRAG_GETID( fragid );
+	int		count = FRAG_GETCOUNT( fragid );
+	int		length = BitByte( bits );
+	sizebuf_t		temp;
 
-	size = 0;
-	c = 0;
+	if( id < 1 || id > count )
+		return;
+
+	// fragment of another message
+	if( in->count != count )
+		Netchan_BeginIncoming( chan, stream, count );
 
-	p = chan->incomingbufs[stream];
-	if( !p ) return;
+	// duplicate
+	if( in->offsets[id - 1] != -1 )
+		return;
+
+	// regular message can't be bigger than the buffer it's copied to
+	if( stream == FRAG_NORMAL_STREAM && in->size + length > NET_MAX_MESSAGE )
+	{
+		Con_DPrintf( S_ERROR "%s: fragmented message is too big\n", __func__ );
+		Netchan_ResetIncoming( in );
+		return;
+	}
 
-	while( p )
+	// grow as fragments arrive, count is told by the peer and can't be trusted
+	// keep one more byte, so file data can be passed on as is
+	if( in->size + length + 1 > in->maxsize )
 	{
-		size += MSG_GetNumBytesWritten( &p->frag_message );
-		c++;
+		int	newsize = Q_max( in->maxsize * 2, in->size + length + 1 );
 
-		id = FRAG_GETID( p->bufferid );
-		if( id != c )
+		in->data = (byte *)Mem_Realloc( net_mempool, in->data, newsize );
+		in->maxsize = newsize;
+	}
+
+	// fragments are sent one at a time, getting id that is not next means one was lost
+	if( id != in->received + 1 )
+	{
+		if( in->inorder && chan->sock == NS_CLIENT )
 		{
-			if( chan->sock == NS_CLIENT )
-			{
-				Con_DPrintf( S_ERROR "Lost/dropped fragment would cause stall, retrying connection\n" );
-				Cbuf_AddText( "reconnect\n" );
-			}
+			Con_DPrintf( S_ERROR "Lost/dropped fragment would cause stall, retrying connection\n" );
+			Cbuf_AddText( "reconnect\n" );
 		}
-		p = p->next;
+		in->inorder = false;
 	}
 
+	MSG_StartReading( &temp, msg->pData, MSG_GetMaxBytes( msg ), startbit, -1 );
+	MSG_ReadBits( &temp, in->data + in->size, bits );
+
+	in->offsets[id - 1] = in->size;
+	in->lengths[id - 1] = length;
+	in->size += length;
+	in->received++;
+
 	// received final message
-	if( c == intotalbuffers )
+	if( in->received == in->count )
 		chan->incomingready[stream] = true;
 }
 
+/*
+==============================
+Netchan_GatherIncoming
+
+returns fragments data in order, rearranging it if needed
+==============================
+*/
+static byte *Netchan_GatherIncoming( netchan_t *chan, int stream )
+{
+	fragassembly_t	*in = &chan->incoming[stream];
+	byte		*data;
+	int		i, pos;
+
+	if( in->inorder )
+		return in->data;
+
+	data = (byte *)Mem_Malloc( net_mempool, in->maxsize );
+
+	for( i = 0, pos = 0; i < in->count; i++ )
+	{
+		memcpy( data + pos, in->data + in->offsets[i], in->lengths[i] );
+		in->offsets[i] = pos;
+		pos += in->lengths[i];
+	}
+
+	Mem_Free( in->data );
+	in->data = data;
+	in->inorder = true;
+
+	return data;
+}
+
 /*
 ==============================
 Netchan_CreateFileFragmentsFromBuffer
@@ -946,7 +1045,7 @@ void Netchan_CreateFileFragmentsFromBuffer( netchan_t *chan, const char *filenam
 	{
 		send = Q_min( remaining, chunksize );
 
-		buf = Netchan_AllocFragbuf( send );
+		buf = Netchan_AllocFragbuf( chan, send, chunksize );
 		buf->bufferid = bufferid++;
 
 		// copy in data
@@ -1069,7 +1168,7 @@ int Netchan_CreateFileFragments( netchan_t *chan, const char *filename )
 	{
 		send = Q_min( remaining, chunksize );
 
-		buf = Netchan_AllocFragbuf( send );
+		buf = Netchan_AllocFragbuf( chan, send, chunksize );
 		buf->bufferid = bufferid++;
 
 		// copy in data
@@ -1122,19 +1221,9 @@ Netchan_FlushIncoming
 */
 void Netchan_FlushIncoming( netchan_t *chan, int stream )
 {
-	fragbuf_t	*p, *n;
-
 	MSG_Clear( &net_message );
 
-	p = chan->incomingbufs[ stream ];
-
-	while( p )
-	{
-		n = p->next;
-		Mem_Free( p );
-		p = n;
-	}
-	chan->incomingbufs[stream] = NULL;
+	Netchan_ResetIncoming( &chan->incoming[stream] );
 	chan->incomingready[stream] = false;
 }
 
@@ -1146,33 +1235,33 @@ Netchan_CopyNormalFragments
 */
 qboolean Netchan_CopyNormalFragments( netchan_t *chan, sizebuf_t *msg, size_t *length )
 {
-	size_t	size = 0;
-	fragbuf_t	*p, *n;
+	fragassembly_t	*in = &chan->incoming[FRAG_NORMAL_STREAM];
+	size_t		size;
 
 	if( !chan->incomingready[FRAG_NORMAL_STREAM] )
 		return false;
 
-	if( !chan->incomingbufs[FRAG_NORMAL_STREAM] )
+	if( !in->count )
 	{
 		chan->incomingready[FRAG_NORMAL_STREAM] = false;
 		return false;
 	}
 
-	p = chan->incomingbufs[FRAG_NORMAL_STREAM];
-
-	MSG_Init( msg, "NetMessage", net_message_buffer, sizeof( net_message_buffer ));
+	size = in->size;
 
-	while( p )
+	if( size > sizeof( net_message_buffer ))
 	{
-		n = p->next;
+		Con_Printf( S_ERROR "%s: message is too big (%s)\n", __func__, Q_memprint( size ));
+		Netchan_FlushIncoming( chan, FRAG_NORMAL_STREAM );
+		return false;
+	}
 
-		// copy it in
-		MSG_WriteBytes( msg, MSG_GetData( &p->frag_message ), MSG_GetNumBytesWritten( &p->frag_message ));
-		size += MSG_GetNumBytesWritten( &p->frag_message );
+	MSG_Init( msg, "NetMessage", net_message_buffer, sizeof( net_message_buffer ));
 
-		Mem_Free( p );
-		p = n;
-	}
+	// copy it in
+	MSG_WriteBytes( msg, Netchan_GatherIncoming( chan, FRAG_NORMAL_STREAM ), size );
+
+	Netchan_ResetIncoming( in );
 
 	if( chan->use_bz2 && !memcmp( MSG_GetData( msg ), "BZ2", 4 ))
 	{
@@ -1213,8 +1302,6 @@ qboolean Netchan_CopyNormalFragments( netchan_t *chan, sizebuf_t *msg, size_t *l
 		}
 	}
 
-	chan->incomingbufs[FRAG_NORMAL_STREAM] = NULL;
-
 	// reset flag
 	chan->incomingready[FRAG_NORMAL_STREAM] = false;
 
@@ -1232,27 +1319,27 @@ Netchan_CopyFileFragments
 */
 qboolean Netchan_CopyFileFragments( netchan_t *chan, sizebuf_t *msg )
 {
-	char	filename[MAX_OSPATH], compressor[32];
-	uint	uncompressedSize;
-	int	nsize, pos;
-	byte	*buffer;
-	fragbuf_t	*p, *n;
+	fragassembly_t	*in = &chan->incoming[FRAG_FILE_STREAM];
+	char		filename[MAX_OSPATH], compressor[32];
+	uint		uncompressedSize;
+	int		nsize, headersize;
+	byte		*buffer;
 
 	if( !chan->incomingready[FRAG_FILE_STREAM] )
 		return false;
 
-	if( !chan->incomingbufs[FRAG_FILE_STREAM] )
+	if( !in->count )
 	{
 		chan->incomingready[FRAG_FILE_STREAM] = false;
 		return false;
 	}
 
-	p = chan->incomingbufs[FRAG_FILE_STREAM];
+	buffer = Netchan_GatherIncoming( chan, FRAG_FILE_STREAM );
 
 	MSG_Init( msg, "NetMessage", net_message_buffer, sizeof( net_message_buffer ));
 
 	// copy in first chunk so we can get filename out
-	MSG_WriteBytes( msg, MSG_GetData( &p->frag_message ), MSG_GetNumBytesWritten( &p->frag_message ));
+	MSG_WriteBytes( msg, buffer, in->lengths[0] );
 	MSG_Clear( msg );
 
 	Q_strncpy( filename, MSG_ReadString( msg ), sizeof( filename ));
@@ -1292,45 +1379,16 @@ qboolean Netchan_CopyFileFragments( netchan_t *chan, sizebuf_t *msg )
 		return true;
 	}
 
-	// create file from buffers
-	nsize = 0;
-	while ( p )
-	{
-		nsize += MSG_GetNumBytesWritten( &p->frag_message ); // Size will include a bit of slop, oh well
-		if( p == chan->incomingbufs[FRAG_FILE_STREAM] )
-			nsize -= MSG_GetNumBytesRead( msg );
-		p = p->next;
-	}
-
-	buffer = Mem_Calloc( net_mempool, nsize + 1 );
-	p = chan->incomingbufs[FRAG_FILE_STREAM];
-	pos = 0;
-
-	while( p )
-	{
-		int	cursize;
-
-		n = p->next;
-
-		cursize = MSG_GetNumBytesWritten( &p->frag_message );
+	// file data follows the header, the assembly buffer
+	// already has room for terminator so take it over
+	headersize = MSG_GetNumBytesRead( msg );
+	nsize = in->size - headersize;
+	memmove( buffer, buffer + headersize, nsize );
+	buffer[nsize] = 0;
 
-		// first message has the file name, don't write that into the data stream,
-		// just write the rest of the actual data
-		if( p == chan->incomingbufs[FRAG_FILE_STREAM] )
-		{
-			// copy it in
-			cursize -= MSG_GetNumBytesRead( msg );
-			memcpy( &buffer[pos], &p->frag_message.pData[MSG_GetNumBytesRead( msg )], cursize );
-		}
-		else
-		{
-			memcpy( &buffer[pos], p->frag_message.pData, cursize );
-		}
-
-		pos += cursize;
-		Mem_Free( p );
-		p = n;
-	}
+	in->data = NULL;
+	in->maxsize = 0;
+	Netchan_ResetIncoming( in );
 
 	if( chan->gs_netchan && chan->use_bz2 && !Q_stricmp( compressor, "bz2" ))
 	{
@@ -1376,7 +1434,6 @@ qboolean Netchan_CopyFileFragments( netchan_t *chan, sizebuf_t *msg )
 	// clear remnants
 	MSG_Clear( msg );
 
-	chan->incomingbufs[FRAG_FILE_STREAM] = NULL;
 	chan->incomingready[FRAG_FILE_STREAM] = false;
 
 	return true;
@@ -1422,9 +1479,8 @@ Netchan_UpdateProgress
 void Netchan_UpdateProgress( netchan_t *chan )
 {
 #if !XASH_DEDICATED
-	fragbuf_t *p;
-	int	i, c = 0;
-	int	total = 0;
+	fragassembly_t *in;
+	int	i;
 	float	bestpercent = 0.0;
 
 	if( host.downloadcount == 0 )
@@ -1434,46 +1490,35 @@ void Netchan_UpdateProgress( netchan_t *chan )
 	}
 
 	// do show slider for file downloads.
-	if( !chan->incomingbufs[FRAG_FILE_STREAM] )
+	if( !chan->incoming[FRAG_FILE_STREAM].received )
 		return;
 
 	for( i = MAX_STREAMS - 1; i >= 0; i-- )
 	{
+		in = &chan->incoming[i];
+
 		// receiving data
-		if( chan->incomingbufs[i] )
+		if( in->received )
 		{
-			p = chan->incomingbufs[i];
-
-			total = FRAG_GETCOUNT( p->bufferid );
-
-			while( p )
-			{
-				c++;
-				p = p->next;
-			}
-
-			if( total )
-			{
-				float	percent = 100.0f * (float)c / (float)total;
-
-				if( percent > bestpercent )
-					bestpercent = percent;
-			}
+			float	percent = 100.0f * (float)in->received / (float)in->count;
 
-			p = chan->incomingbufs[i];
+			if( percent > bestpercent )
+				bestpercent = percent;
 
-			if( i == FRAG_FILE_STREAM )
+			// first fragment has file name
+			if( i == FRAG_FILE_STREAM && in->offsets[0] != -1 )
 			{
 				char	sz[MAX_SYSPATH];
-				char	*in, *out;
+				const char	*pin;
+				char	*out;
 				int	len = 0;
 
-				in = (char *)MSG_GetData( &p->frag_message );
+				pin = (const char *)in->data + in->offsets[0];
 				out = sz;
 
-				while( *in )
+				while( len < in->lengths[0] && *pin )
 				{
-					*out++ = *in++;
+					*out++ = *pin++;
 					len++;
 					if( len > 128 )
 						break;
@@ -1675,7 +1720,7 @@ void Netchan_TransmitBits( netchan_t *chan, int length, const byte *data )
 				chan->frag_length[i] = MSG_GetNumBitsWritten( &pbuf->frag_message );
 
 				// unlink pbuf
-				Netchan_UnlinkFragment( pbuf, &chan->fragbufs[i] );
+				Netchan_UnlinkFragment( chan, pbuf, &chan->fragbufs[i] );
 
 				chan->reliable_fragment[i] = 1;
 
@@ -1949,42 +1994,15 @@ qboolean Netchan_Process( netchan_t *chan, sizebuf_t *msg )
 	{
 		for( i = 0; i < MAX_STREAMS; i++ )
 		{
-			int	j, inbufferid;
-			int	intotalbuffers;
+			int	j;
 			int	oldpos, curbit;
 			int	numbitstoremove;
-			fragbuf_t	*pbuf;
-
 			if( !frag_message[i] )
 				continue;
 
-			inbufferid = FRAG_GETID( fragid[i] );
-			intotalbuffers = FRAG_GETCOUNT( fragid[i] );
-
+			// copy in data, are we done?
 			if( fragid[i] != 0 )
-			{
-				pbuf = Netchan_FindBufferById( &chan->incomingbufs[i], fragid[i], true );
-
-				if( pbuf )
-				{
-					byte	buffer[NET_MAX_FRAGMENT];
-					int	bits, size;
-					sizebuf_t	temp;
-
-					size = MSG_GetNumBitsRead( msg ) + frag_offset[i];
-					bits = frag_length[i];
-
-					// copy in data
-					MSG_Clear( &pbuf->frag_message );
-
-					MSG_StartReading( &temp, msg->pData, MSG_GetMaxBytes( msg ), size, -1 );
-					MSG_ReadBits( &temp, buffer, bits );
-					MSG_WriteBits( &pbuf->frag_message, buffer, bits );
-				}
-
-				// count # of incoming bufs we've queued? are we done?
-				Netchan_CheckForCompletion( chan, i, intotalbuffers );
-			}
+				Netchan_AddIncomingFragment( chan, i, fragid[i], msg, MSG_GetNumBitsRead( msg ) + frag_offset[i], frag_length[i] );
 
 			// rearrange incoming data to not have the frag stuff in the middle of it
 			oldpos = MSG_GetNumBitsRead( msg );
@@ -2007,3 +2025,101 @@ qboolean Netchan_Process( netchan_t *chan, sizebuf_t *msg )
 
 	return true;
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+static void Test_Netchan_Fragments( void )
+{
+	static netchan_t chan;
+	const char *data = "0123456789";
+	sizebuf_t msg;
+	size_t length = 0;
+
+	memset( &chan, 0, sizeof( chan ));
+	chan.sock = NS_SERVER;
+	MSG_StartReading( &msg, (byte *)data, 10, 0, -1 );
+
+	// out of order with a duplicate
+	Netchan_AddIncomingFragment( &chan, FRAG_NORMAL_STREAM, MAKE_FRAGID( 1, 3 ), &msg, 0, 4 << 3 );
+	Netchan_AddIncomingFragment( &chan, FRAG_NORMAL_STREAM, MAKE_FRAGID( 1, 3 ), &msg, 0, 4 << 3 );
+	Netchan_AddIncomingFragment( &chan, FRAG_NORMAL_STREAM, MAKE_FRAGID( 3, 3 ), &msg, 8 << 3, 2 << 3 );
+	TASSERT_EQi( chan.incoming[FRAG_NORMAL_STREAM].received, 2 );
+	TASSERT( !chan.incomingready[FRAG_NORMAL_STREAM] );
+	TASSERT( !chan.incoming[FRAG_NORMAL_STREAM].inorder );
+
+	Netchan_AddIncomingFragment( &chan, FRAG_NORMAL_STREAM, MAKE_FRAGID( 2, 3 ), &msg, 4 << 3, 4 << 3 );
+	TASSERT( chan.incomingready[FRAG_NORMAL_STREAM] );
+
+	TASSERT( Netchan_CopyNormalFragments( &chan, &msg, &length ));
+	TASSERT_EQi( (int)length, 10 );
+	TASSERT( !memcmp( net_message_buffer, data, 10 ));
+	TASSERT( !chan.incomingready[FRAG_NORMAL_STREAM] );
+
+	// in order, buffer is reused
+	MSG_StartReading( &msg, (byte *)data, 10, 0, -1 );
+	Netchan_AddIncomingFragment( &chan, FRAG_NORMAL_STREAM, MAKE_FRAGID( 1, 2 ), &msg, 0, 5 << 3 );
+	Netchan_AddIncomingFragment( &chan, FRAG_NORMAL_STREAM, MAKE_FRAGID( 2, 2 ), &msg, 5 << 3, 5 << 3 );
+	TASSERT( chan.incoming[FRAG_NORMAL_STREAM].inorder );
+	TASSERT( Netchan_CopyNormalFragments( &chan, &msg, &length ));
+	TASSERT_EQi( (int)length, 10 );
+	TASSERT( !memcmp( net_message_buffer, data, 10 ));
+
+	// forged fragment count doesn't reserve memory, its offset table is freed on flush
+	MSG_StartReading( &msg, (byte *)data, 10, 0, -1 );
+	Netchan_AddIncomingFragment( &chan, FRAG_FILE_STREAM, MAKE_FRAGID( 1, 0xffff ), &msg, 0, 10 << 3 );
+	TASSERT_EQi( chan.incoming[FRAG_FILE_STREAM].received, 1 );
+	TASSERT( chan.incoming[FRAG_FILE_STREAM].maxsize <= NET_MAX_MESSAGE + 1 );
+	Netchan_FlushIncoming( &chan, FRAG_FILE_STREAM );
+	TASSERT( chan.incoming[FRAG_FILE_STREAM].offsets == NULL );
+
+	Netchan_Clear( &chan );
+	TASSERT( chan.incoming[FRAG_NORMAL_STREAM].data == NULL );
+}
+
+static void Test_Netchan_Fragbufs( void )
+{
+	static netchan_t chan;
+	fragbuf_t *buf, *buf2;
+
+	memset( &chan, 0, sizeof( chan ));
+
+	buf = Netchan_AllocFragbuf( &chan, 100, 1000 );
+	TASSERT_EQi( buf->buffersize, 1000 );
+	TASSERT_EQi( MSG_GetMaxBytes( &buf->frag_message ), 100 );
+	buf->bufferid = 5;
+	Netchan_FreeFragbuf( &chan, buf );
+	TASSERT_EQi( chan.numfreefragbufs, 1 );
+
+	// too big for the released one
+	buf2 = Netchan_AllocFragbuf( &chan, 2000, 1000 );
+	TASSERT( buf2 != buf );
+	TASSERT_EQi( chan.numfreefragbufs, 1 );
+
+	buf = Netchan_AllocFragbuf( &chan, 1000, 1000 );
+	TASSERT_EQi( chan.numfreefragbufs, 0 );
+	TASSERT_EQi( buf->bufferid, 0 );
+	TASSERT_EQi( MSG_GetMaxBytes( &buf->frag_message ), 1000 );
+
+	Netchan_FreeFragbuf( &chan, buf );
+	Netchan_FreeFragbuf( &chan, buf2 );
+	Netchan_Clear( &chan );
+	TASSERT_EQi( chan.numfreefragbufs, 0 );
+	TASSERT( chan.freefragbufs == NULL );
+}
+
+void Test_RunNetchan( void )
+{
+	qboolean	ownpool = !net_mempool;
+
+	// tests run before network is initialized
+	if( ownpool )
+		net_mempool = Mem_AllocPoolExt( "Network Pool", MEMPOOL_SLAB );
+
+	TRUN( Test_Netchan_Fragments( ));
+	TRUN( Test_Netchan_Fragbufs( ));
+
+	if( ownpool )
+		Mem_FreePool( &net_mempool );
+}
+#endif // XASH_ENGINE_TESTS
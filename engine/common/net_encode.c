@@ -1216,7 +1216,7 @@ write fields by offsets
 assume from and to is valid
 =====================
 */
-static void Delta_WriteField_( sizebuf_t *msg, delta_t *pField, const void *from, const void *to, double timebase )
+static void Delta_WriteField_( bitwriter_t *bw, delta_t *pField, const void *from, const void *to, double timebase )
 {
 	int		signbit = FBitSet( pField->flags, DT_SIGNED ) ? 1 : 0;
 	float		flValue, flAngle;
@@ -1235,7 +1235,7 @@ static void Delta_WriteField_( sizebuf_t *msg, delta_t *pField, const void *from
 			iValue *= pField->multiplier;
 
 		iValue = Delta_ClampIntegerField( pField, iValue, signbit, pField->bits );
-		MSG_WriteBitLong( msg, iValue, pField->bits, signbit );
+		MSG_BitWriteBitLong( bw, iValue, pField->bits, signbit );
 	}
 	else if( pField->flags & DT_SHORT )
 	{
@@ -1248,7 +1248,7 @@ static void Delta_WriteField_( sizebuf_t *msg, delta_t *pField, const void *from
 			iValue *= pField->multiplier;
 
 		iValue = Delta_ClampIntegerField( pField, iValue, signbit, pField->bits );
-		MSG_WriteBitLong( msg, iValue, pField->bits, signbit );
+		MSG_BitWriteBitLong( bw, iValue, pField->bits, signbit );
 	}
 	else if( pField->flags & DT_INTEGER )
 	{
@@ -1261,14 +1261,14 @@ static void Delta_WriteField_( sizebuf_t *msg, delta_t *pField, const void *from
 			iValue *= pField->multiplier;
 
 		iValue = Delta_ClampIntegerField( pField, iValue, signbit, pField->bits );
-		MSG_WriteBitLong( msg, iValue, pField->bits, signbit );
+		MSG_BitWriteBitLong( bw, iValue, pField->bits, signbit );
 	}
 	else if( pField->flags & DT_FLOAT )
 	{
 		flValue = *(float *)((byte *)to + pField->offset );
 		iValue = (int)((double)flValue * pField->multiplier);
 		iValue = Delta_ClampIntegerField( pField, iValue, signbit, pField->bits );
-		MSG_WriteBitLong( msg, iValue, pField->bits, signbit );
+		MSG_BitWriteBitLong( bw, iValue, pField->bits, signbit );
 	}
 	else if( pField->flags & DT_ANGLE )
 	{
@@ -1276,40 +1276,40 @@ static void Delta_WriteField_( sizebuf_t *msg, delta_t *pField, const void *from
 
 		// NOTE: never applies multipliers to angle because
 		// result may be wrong on client-side
-		MSG_WriteBitAngle( msg, flAngle, pField->bits );
+		MSG_BitWriteBitAngle( bw, flAngle, pField->bits );
 	}
 	else if( pField->flags & DT_TIMEWINDOW_8 )
 	{
 		flValue = *(float *)((byte *)to + pField->offset );
 		dt = Q_rint(( timebase - flValue ) * 100.0 );
 		dt = Delta_ClampIntegerField( pField, dt, 1, pField->bits );
-		MSG_WriteSBitLong( msg, dt, pField->bits );
+		MSG_BitWriteSBitLong( bw, dt, pField->bits );
 	}
 	else if( pField->flags & DT_TIMEWINDOW_BIG )
 	{
 		flValue = *(float *)((byte *)to + pField->offset );
 		dt = Q_rint(( timebase - flValue ) * pField->multiplier );
 		dt = Delta_ClampIntegerField( pField, dt, 1, pField->bits );
-		MSG_WriteSBitLong( msg, dt, pField->bits );
+		MSG_BitWriteSBitLong( bw, dt, pField->bits );
 	}
 	else if( pField->flags & DT_STRING )
 	{
 		pStr = (char *)((byte *)to + pField->offset );
-		MSG_WriteString( msg, pStr );
+		MSG_BitWriteString( bw, pStr );
 	}
 }
 
-static qboolean Delta_WriteField( sizebuf_t *msg, delta_t *pField, const void *from, const void *to, double timebase )
+static qboolean Delta_WriteField( bitwriter_t *bw, delta_t *pField, const void *from, const void *to, double timebase )
 {
 	if( Delta_CompareField( pField, from, to ))
 	{
-		MSG_WriteOneBit( msg, 0 );	// unchanged
+		MSG_BitWriteOneBit( bw, 0 );	// unchanged
 		return false;
 	}
 
-	MSG_WriteOneBit( msg, 1 );	// changed
+	MSG_BitWriteOneBit( bw, 1 );	// changed
 
-	Delta_WriteField_( msg, pField, from, to, timebase );
+	Delta_WriteField_( bw, pField, from, to, timebase );
 
 	return true;
 }
@@ -1369,7 +1369,7 @@ read fields by offsets
 assume 'from' and 'to' is valid
 =====================
 */
-static void Delta_ReadField_( sizebuf_t *msg, delta_t *pField, void *to, double timebase )
+static void Delta_ReadField_( bitreader_t *br, delta_t *pField, void *to, double timebase )
 {
 	qboolean		bSigned = ( pField->flags & DT_SIGNED ) ? true : false;
 	float		flValue, flAngle, flTime;
@@ -1381,7 +1381,7 @@ static void Delta_ReadField_( sizebuf_t *msg, delta_t *pField, void *to, double
 
 	if( pField->flags & DT_BYTE )
 	{
-		iValue = MSG_ReadBitLong( msg, pField->bits, bSigned );
+		iValue = MSG_BitReadBitLong( br, pField->bits, bSigned );
 		if( !Q_equal( pField->multiplier, 1.0 ))
 			iValue /= pField->multiplier;
 
@@ -1395,7 +1395,7 @@ static void Delta_ReadField_( sizebuf_t *msg, delta_t *pField, void *to, double
 	}
 	else if( pField->flags & DT_SHORT )
 	{
-		iValue = MSG_ReadBitLong( msg, pField->bits, bSigned );
+		iValue = MSG_BitReadBitLong( br, pField->bits, bSigned );
 		if( !Q_equal( pField->multiplier, 1.0 ))
 			iValue /= pField->multiplier;
 
@@ -1409,7 +1409,7 @@ static void Delta_ReadField_( sizebuf_t *msg, delta_t *pField, void *to, double
 	}
 	else if( pField->flags & DT_INTEGER )
 	{
-		iValue = MSG_ReadBitLong( msg, pField->bits, bSigned );
+		iValue = MSG_BitReadBitLong( br, pField->bits, bSigned );
 		if( !Q_equal( pField->multiplier, 1.0 ))
 			iValue /= pField->multiplier;
 
@@ -1423,7 +1423,7 @@ static void Delta_ReadField_( sizebuf_t *msg, delta_t *pField, void *to, double
 	}
 	else if( pField->flags & DT_FLOAT )
 	{
-		iValue = MSG_ReadBitLong( msg, pField->bits, bSigned );
+		iValue = MSG_BitReadBitLong( br, pField->bits, bSigned );
 		if( bSigned )
 			flValue = (int)iValue;
 		else
@@ -1439,44 +1439,45 @@ static void Delta_ReadField_( sizebuf_t *msg, delta_t *pField, void *to, double
 	}
 	else if( pField->flags & DT_ANGLE )
 	{
-		flAngle = MSG_ReadBitAngle( msg, pField->bits );
+		flAngle = MSG_BitReadBitAngle( br, pField->bits );
 		*(float *)((byte *)to + pField->offset ) = flAngle;
 	}
 	else if( pField->flags & DT_TIMEWINDOW_8 )
 	{
-		iValue = MSG_ReadSBitLong( msg, pField->bits );
+		iValue = MSG_BitReadSBitLong( br, pField->bits );
 		flTime = ( timebase * 100.0 - (int)iValue ) / 100.0;
 		*(float *)((byte *)to + pField->offset ) = flTime;
 	}
 	else if( pField->flags & DT_TIMEWINDOW_BIG )
 	{
-		iValue = MSG_ReadSBitLong( msg, pField->bits );
+		iValue = MSG_BitReadSBitLong( br, pField->bits );
 		flTime = ( timebase * pField->multiplier - (int)iValue ) / pField->multiplier;
 		*(float *)((byte *)to + pField->offset ) = flTime;
 	}
 	else if( pField->flags & DT_STRING )
 	{
-		pStr = MSG_ReadString( msg );
+		pStr = MSG_BitReadString( br );
 		pOut = (char *)((byte *)to + pField->offset );
 		Q_strncpy( pOut, pStr, pField->size );
 	}
 }
 
-static qboolean Delta_ReadField( sizebuf_t *msg, delta_t *pField, const void *from, void *to, double timebase )
+static qboolean Delta_ReadField( bitreader_t *br, delta_t *pField, const void *from, void *to, double timebase )
 {
-	if( !MSG_ReadOneBit( msg ))
+	if( !MSG_BitReadOneBit( br ))
 	{
 		Delta_CopyField( pField, from, to, timebase );
 		return false;
 	}
 
-	Delta_ReadField_( msg, pField, to, timebase );
+	Delta_ReadField_( br, pField, to, timebase );
 	return true;
 }
 
 static void Delta_ParseGSFields( sizebuf_t *msg, const delta_info_t *dt, const void *from, void *to, double timebase )
 {
 	uint8_t bits[8] = { 0 };
+	bitreader_t br;
 	delta_t *pField;
 	byte c;
 	int i;
@@ -1486,15 +1487,19 @@ static void Delta_ParseGSFields( sizebuf_t *msg, const delta_info_t *dt, const v
 	for( i = 0; i < c; i++ )
 		bits[i] = MSG_ReadByte( msg );
 
+	MSG_StartBitReader( &br, msg );
+
 	for( i = 0, pField = dt->pFields; i < dt->numFields; i++, pField++ )
 	{
 		int b = i >> 3;
 		int n = 1 << ( i & 7 );
 
 		if( FBitSet( bits[b], n ))
-			Delta_ReadField_( msg, pField, to, timebase );
+			Delta_ReadField_( &br, pField, to, timebase );
 		else Delta_CopyField( pField, from, to, timebase );
 	}
+
+	MSG_EndBitReader( &br );
 }
 
 void Delta_ReadGSFields( sizebuf_t *msg, int index, const void *from, void *to, double timebase )
@@ -1507,6 +1512,7 @@ void Delta_WriteGSFields( sizebuf_t *msg, int index, const void *from, const voi
 {
 	delta_info_t *dt = Delta_FindStructByIndex( index );
 	delta_t *pField;
+	bitwriter_t bw;
 	uint8_t bits[8] = { 0 };
 	uint c = 0;
 	int i;
@@ -1525,9 +1531,11 @@ void Delta_WriteGSFields( sizebuf_t *msg, int index, const void *from, const voi
 		}
 	}
 
-	MSG_WriteUBitLong( msg, c, 3 );
+	MSG_StartBitWriter( &bw, msg );
+
+	MSG_BitWriteUBitLong( &bw, c, 3 );
 	for( i = 0; i < c; i++ )
-		MSG_WriteByte( msg, bits[i] );
+		MSG_BitWriteUBitLong( &bw, bits[i], 8 );
 
 	for( i = 0, pField = dt->pFields; i < dt->numFields; i++, pField++ )
 	{
@@ -1535,8 +1543,10 @@ void Delta_WriteGSFields( sizebuf_t *msg, int index, const void *from, const voi
 		int n = 1 << ( i & 7 );
 
 		if( FBitSet( bits[b], n ))
-			Delta_WriteField_( msg, pField, from, to, timebase );
+			Delta_WriteField_( &bw, pField, from, to, timebase );
 	}
+
+	MSG_EndBitWriter( &bw );
 }
 
 /*
@@ -1554,6 +1564,7 @@ MSG_WriteDeltaUsercmd
 void MSG_WriteDeltaUsercmd( sizebuf_t *msg, const usercmd_t *from, const usercmd_t *to )
 {
 	delta_t		*pField;
+	bitwriter_t	bw;
 	delta_info_t	*dt;
 	int		i;
 
@@ -1567,10 +1578,12 @@ void MSG_WriteDeltaUsercmd( sizebuf_t *msg, const usercmd_t *from, const usercmd
 	Delta_CustomEncode( dt, from, to );
 
 	// process fields
+	MSG_StartBitWriter( &bw, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_WriteField( msg, pField, from, to, 0.0f );
+		Delta_WriteField( &bw, pField, from, to, 0.0f );
 	}
+	MSG_EndBitWriter( &bw );
 }
 
 /*
@@ -1581,6 +1594,7 @@ MSG_ReadDeltaUsercmd
 void MSG_ReadDeltaUsercmd( sizebuf_t *msg, const usercmd_t *from, usercmd_t *to )
 {
 	delta_t		*pField;
+	bitreader_t	br;
 	delta_info_t	*dt;
 	int		i;
 
@@ -1593,10 +1607,12 @@ void MSG_ReadDeltaUsercmd( sizebuf_t *msg, const usercmd_t *from, usercmd_t *to
 	*to = *from;
 
 	// process fields
+	MSG_StartBitReader( &br, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_ReadField( msg, pField, from, to, 0.0f );
+		Delta_ReadField( &br, pField, from, to, 0.0f );
 	}
+	MSG_EndBitReader( &br );
 
 	COM_NormalizeAngles( to->viewangles );
 }
@@ -1616,6 +1632,7 @@ MSG_WriteDeltaEvent
 void MSG_WriteDeltaEvent( sizebuf_t *msg, const event_args_t *from, const event_args_t *to )
 {
 	delta_t		*pField;
+	bitwriter_t	bw;
 	delta_info_t	*dt;
 	int		i;
 
@@ -1629,10 +1646,12 @@ void MSG_WriteDeltaEvent( sizebuf_t *msg, const event_args_t *from, const event_
 	Delta_CustomEncode( dt, from, to );
 
 	// process fields
+	MSG_StartBitWriter( &bw, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_WriteField( msg, pField, from, to, 0.0f );
+		Delta_WriteField( &bw, pField, from, to, 0.0f );
 	}
+	MSG_EndBitWriter( &bw );
 }
 
 /*
@@ -1643,6 +1662,7 @@ MSG_ReadDeltaEvent
 void MSG_ReadDeltaEvent( sizebuf_t *msg, const event_args_t *from, event_args_t *to )
 {
 	delta_t		*pField;
+	bitreader_t	br;
 	delta_info_t	*dt;
 	int		i;
 
@@ -1655,10 +1675,12 @@ void MSG_ReadDeltaEvent( sizebuf_t *msg, const event_args_t *from, event_args_t
 	*to = *from;
 
 	// process fields
+	MSG_StartBitReader( &br, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_ReadField( msg, pField, from, to, 0.0f );
+		Delta_ReadField( &br, pField, from, to, 0.0f );
 	}
+	MSG_EndBitReader( &br );
 }
 
 /*
@@ -1671,6 +1693,7 @@ movevars_t communication
 qboolean MSG_WriteDeltaMovevars( sizebuf_t *msg, const movevars_t *from, const movevars_t *to )
 {
 	delta_t		*pField;
+	bitwriter_t	bw;
 	delta_info_t	*dt;
 	int		i, startBit;
 	int		numChanges = 0;
@@ -1689,11 +1712,13 @@ qboolean MSG_WriteDeltaMovevars( sizebuf_t *msg, const movevars_t *from, const m
 	MSG_BeginServerCmd( msg, svc_deltamovevars );
 
 	// process fields
+	MSG_StartBitWriter( &bw, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		if( Delta_WriteField( msg, pField, from, to, 0.0f ))
+		if( Delta_WriteField( &bw, pField, from, to, 0.0f ))
 			numChanges++;
 	}
+	MSG_EndBitWriter( &bw );
 
 	// if we have no changes - kill the message
 	if( !numChanges )
@@ -1707,6 +1732,7 @@ qboolean MSG_WriteDeltaMovevars( sizebuf_t *msg, const movevars_t *from, const m
 void MSG_ReadDeltaMovevars( sizebuf_t *msg, const movevars_t *from, movevars_t *to )
 {
 	delta_t		*pField;
+	bitreader_t	br;
 	delta_info_t	*dt;
 	int		i;
 
@@ -1719,10 +1745,12 @@ void MSG_ReadDeltaMovevars( sizebuf_t *msg, const movevars_t *from, movevars_t *
 	*to = *from;
 
 	// process fields
+	MSG_StartBitReader( &br, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_ReadField( msg, pField, from, to, 0.0f );
+		Delta_ReadField( &br, pField, from, to, 0.0f );
 	}
+	MSG_EndBitReader( &br );
 }
 
 /*
@@ -1743,6 +1771,7 @@ Other clients can grab the client state from entity_state_t
 void MSG_WriteClientData( sizebuf_t *msg, const clientdata_t *from, const clientdata_t *to, double timebase )
 {
 	delta_t		*pField;
+	bitwriter_t	bw;
 	delta_info_t	*dt;
 	int		i, startBit;
 	int		numChanges = 0;
@@ -1761,11 +1790,13 @@ void MSG_WriteClientData( sizebuf_t *msg, const clientdata_t *from, const client
 	Delta_CustomEncode( dt, from, to );
 
 	// process fields
+	MSG_StartBitWriter( &bw, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		if( Delta_WriteField( msg, pField, from, to, timebase ))
+		if( Delta_WriteField( &bw, pField, from, to, timebase ))
 			numChanges++;
 	}
+	MSG_EndBitWriter( &bw );
 
 	if( numChanges ) return; // we have updates
 
@@ -1784,6 +1815,7 @@ void MSG_ReadClientData( sizebuf_t *msg, const clientdata_t *from, clientdata_t
 {
 #if !XASH_DEDICATED
 	delta_t		*pField;
+	bitreader_t	br;
 	delta_info_t	*dt;
 	int		i;
 	qboolean noChanges;
@@ -1797,12 +1829,14 @@ void MSG_ReadClientData( sizebuf_t *msg, const clientdata_t *from, clientdata_t
 	noChanges = !cls.legacymode && !MSG_ReadOneBit( msg );
 
 	// process fields
+	MSG_StartBitReader( &br, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
 		if( noChanges )
 			Delta_CopyField( pField, from, to, timebase );
-		else Delta_ReadField( msg, pField, from, to, timebase );
+		else Delta_ReadField( &br, pField, from, to, timebase );
 	}
+	MSG_EndBitReader( &br );
 #endif
 }
 
@@ -1824,6 +1858,7 @@ Other clients can grab the client state from entity_state_t
 void MSG_WriteWeaponData( sizebuf_t *msg, const weapon_data_t *from, const weapon_data_t *to, double timebase, int index )
 {
 	delta_t		*pField;
+	bitwriter_t	bw;
 	delta_info_t	*dt;
 	int		i, startBit;
 	int		numChanges = 0;
@@ -1843,11 +1878,13 @@ void MSG_WriteWeaponData( sizebuf_t *msg, const weapon_data_t *from, const weapo
 	MSG_WriteUBitLong( msg, index, MAX_WEAPON_BITS );
 
 	// process fields
+	MSG_StartBitWriter( &bw, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		if( Delta_WriteField( msg, pField, from, to, timebase ))
+		if( Delta_WriteField( &bw, pField, from, to, timebase ))
 			numChanges++;
 	}
+	MSG_EndBitWriter( &bw );
 
 	// if we have no changes - kill the message
 	if( !numChanges ) MSG_SeekToBit( msg, startBit, SEEK_SET );
@@ -1863,6 +1900,7 @@ Read the clientdata
 void MSG_ReadWeaponData( sizebuf_t *msg, const weapon_data_t *from, weapon_data_t *to, double timebase )
 {
 	delta_t		*pField;
+	bitreader_t	br;
 	delta_info_t	*dt;
 	int		i;
 
@@ -1873,10 +1911,12 @@ void MSG_ReadWeaponData( sizebuf_t *msg, const weapon_data_t *from, weapon_data_
 	Assert( pField != NULL );
 
 	// process fields
+	MSG_StartBitReader( &br, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_ReadField( msg, pField, from, to, timebase );
+		Delta_ReadField( &br, pField, from, to, timebase );
 	}
+	MSG_EndBitReader( &br );
 }
 
 /*
@@ -1901,6 +1941,7 @@ void MSG_WriteDeltaEntity( const entity_state_t *from, const entity_state_t *to,
 {
 	delta_info_t	*dt = NULL;
 	delta_t		*pField;
+	bitwriter_t	bw;
 	int		i, startBit;
 	int		numChanges = 0;
 
@@ -1978,11 +2019,13 @@ void MSG_WriteDeltaEntity( const entity_state_t *from, const entity_state_t *to,
 	}
 
 	// process fields
+	MSG_StartBitWriter( &bw, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		if( Delta_WriteField( msg, pField, from, to, timebase ))
+		if( Delta_WriteField( &bw, pField, from, to, timebase ))
 			numChanges++;
 	}
+	MSG_EndBitWriter( &bw );
 
 	// if we have no changes - kill the message
 	if( !numChanges && !force ) MSG_SeekToBit( msg, startBit, SEEK_SET );
@@ -2004,6 +2047,7 @@ qboolean MSG_ReadDeltaEntity( sizebuf_t *msg, const entity_state_t *from, entity
 #if !XASH_DEDICATED
 	delta_info_t	*dt = NULL;
 	delta_t		*pField;
+	bitreader_t	br;
 	int		i, fRemoveType;
 	int		baseline_offset = 0;
 
@@ -2092,10 +2136,12 @@ qboolean MSG_ReadDeltaEntity( sizebuf_t *msg, const entity_state_t *from, entity
 	Assert( pField != NULL );
 
 	// process fields
+	MSG_StartBitReader( &br, msg );
 	for( i = 0; i < dt->numFields; i++, pField++ )
 	{
-		Delta_ReadField( msg, pField, from, to, timebase );
+		Delta_ReadField( &br, pField, from, to, timebase );
 	}
+	MSG_EndBitReader( &br );
 #endif // XASH_DEDICATED
 	// message parsed
 	return true;
@@ -2278,6 +2324,8 @@ void Test_RunDelta( void )
 	delta_test_struct_t from, to = { 0 };
 	delta_test_struct_t null = { 0 };
 	sizebuf_t msg;
+	bitwriter_t bw;
+	bitreader_t br;
 	int i;
 	char buffer[4096] = { 0 };
 	const double timebase = 123.123;
@@ -2310,13 +2358,17 @@ void Test_RunDelta( void )
 
 	MSG_Init( &msg, "test message", buffer, sizeof( buffer ));
 
+	MSG_StartBitWriter( &bw, &msg );
 	for( i = 0; i < dt->numFields; i++ )
-		Delta_WriteField( &msg, &dt->pFields[i], &null, &from, timebase );
+		Delta_WriteField( &bw, &dt->pFields[i], &null, &from, timebase );
+	MSG_EndBitWriter( &bw );
 
 	MSG_SeekToBit( &msg, 0, SEEK_SET );
 
+	MSG_StartBitReader( &br, &msg );
 	for( i = 0; i < dt->numFields; i++ )
-		Delta_ReadField( &msg, &dt->pFields[i], &null, &to, timebase );
+		Delta_ReadField( &br, &dt->pFields[i], &null, &to, timebase );
+	MSG_EndBitReader( &br );
 
 	Con_Printf( "struct as encoded to delta:\n" );
 	TASSERT_STR( from.dt_string, to.dt_string );
@@ -27,10 +27,26 @@ GNU General Public License for more details.
 
 HTTP downloader
 
+Files are queued and spread over a small set of persistent HTTP/1.1
+connections. Each connection carries several pipelined requests, which
+are answered in order, so a queue of many small resources doesn't pay for
+a TCP handshake and a round trip per file. Sockets are only touched when
+select() reports them ready.
+
+Partially downloaded files are kept as .incomplete and continued with
+a Range request after a dropped connection. ETag or Last-Modified of the
+data is kept next to it and sent in If-Range, so a file that changed on
+server is downloaded from start. Leftovers of earlier sessions that have
+no such validator are never continued.
+
 =================================================
 */
 
 #define MAX_HTTP_BUFFER_SIZE (BIT( 16 ))
+#define MAX_HTTP_CONNECTIONS 16
+#define MAX_HTTP_PIPELINE    16
+#define MAX_HTTP_RETRIES     3     // dropped connections before switching to next server
+#define HTTP_KEEPALIVE_IDLE  10.0f // seconds to keep unused connection open
 
 typedef struct httpserver_s
 {
@@ -38,67 +54,168 @@ typedef struct httpserver_s
 	int port;
 	char path[MAX_SYSPATH];
 	struct httpserver_s *next;
+
+	// resolved once and shared by all connections to this server
+	struct sockaddr_storage addr;
+	int resolved; // 0 - not yet, 1 - resolved, -1 - failed
 } httpserver_t;
 
-typedef struct httpfile_s httpfile_t;
-typedef int (*http_process_fn_t)( httpfile_t *file );
+typedef enum
+{
+	HTTP_FILE_QUEUED = 0, // waiting for free connection
+	HTTP_FILE_REQUESTED,  // request is on connection
+	HTTP_FILE_DONE,       // waiting for clean up
+} httpfilestate_t;
 
 typedef struct httpfile_s
 {
 	struct httpfile_s *next;
 	httpserver_t *server;
+	struct httpconn_s *conn; // has pending response for this file
+	httpfilestate_t state;
 	char path[MAX_SYSPATH];
 	file_t *file;
-	int socket;
-	int size;
-	int downloaded;
-	int lastchecksize;
-	float checktime;
-	float blocktime;
-	const char *blockreason;
+	int size;       // expected size, -1 if unknown
+	int offset;     // bytes that were on disk when request was sent
+	int downloaded; // body bytes received for current request
+	int retries;
 	qboolean process;
-	qboolean got_response;
 	qboolean success;
 	qboolean compressed;
-	qboolean chunked;
-	int chunksize;
+	qboolean norange; // server doesn't like our Range requests
+	char validator[128]; // ETag or Last-Modified of data on disk, empty if unknown
 	resource_t *resource;
-	http_process_fn_t pfn_process;
-	struct sockaddr_storage addr;
-
-	char query_backup[1024];
 
-	// query or response
-	char buf[MAX_HTTP_BUFFER_SIZE+1];
-	int header_size, query_length, bytes_sent;
+	// throughput
+	double starttime;
+	int received; // body bytes over all requests
 } httpfile_t;
 
+typedef enum
+{
+	HTTP_CONN_RESOLVE = 0,
+	HTTP_CONN_CONNECTING,
+	HTTP_CONN_OPEN,
+	HTTP_CONN_CLOSED, // waiting for clean up
+} httpconnstate_t;
+
+typedef enum
+{
+	HTTP_PARSE_HEADER = 0,
+	HTTP_PARSE_BODY,        // Content-Length bytes
+	HTTP_PARSE_CHUNK_SIZE,
+	HTTP_PARSE_CHUNK_DATA,
+	HTTP_PARSE_CHUNK_END,   // CRLF after chunk data
+	HTTP_PARSE_TRAILER,
+	HTTP_PARSE_UNTIL_CLOSE, // no framing, body ends with connection
+} httpparsestate_t;
+
+typedef struct httpconn_s
+{
+	struct httpconn_s *next;
+	httpserver_t *server;
+	httpconnstate_t state;
+	int socket;
+
+	// requests in order of responses
+	httpfile_t *requests[MAX_HTTP_PIPELINE];
+	int num_requests;
+	int served;
+
+	char sendbuf[MAX_HTTP_BUFFER_SIZE];
+	int send_pos, send_len;
+
+	char recvbuf[MAX_HTTP_BUFFER_SIZE+1];
+	int recv_pos, recv_len;
+
+	// response to requests[0]
+	httpparsestate_t parse;
+	int remaining;      // body or chunk bytes left
+	qboolean keepalive;
+	qboolean discard;   // body of failed response is skipped
+
+	float blocktime;
+	float idletime;
+	const char *blockreason;
+} httpconn_t;
+
 static struct http_static_s
 {
-	// file and server lists
+	// file, server and connection lists
 	httpfile_t *first_file;
 	httpserver_t *first_server;
+	httpconn_t *first_conn;
 
 	int active_count, progress_count;
 	float progress;
 	qboolean resolving;
+
+	// totals for http_stats
+	int stat_connections;
+	int stat_requests;
+	int stat_reused;     // sent over connection that already served a response
+	int stat_resumed;
+	int stat_maxdepth;
+	int stat_completed;
+	double stat_bytes;
 } http;
 
 
 static CVAR_DEFINE_AUTO( http_useragent, "", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "User-Agent string" );
 static CVAR_DEFINE_AUTO( http_autoremove, "1", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "remove broken files" );
 static CVAR_DEFINE_AUTO( http_timeout, "45", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "timeout for http downloader" );
-static CVAR_DEFINE_AUTO( http_maxconnections, "2", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "maximum http connection number" );
+static CVAR_DEFINE_AUTO( http_maxconnections, "4", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "maximum http connection number" );
+static CVAR_DEFINE_AUTO( http_pipeline, "8", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "maximum pipelined requests per http connection, 1 disables pipelining" );
 static CVAR_DEFINE_AUTO( http_show_headers, "0", FCVAR_ARCHIVE | FCVAR_PRIVILEGED, "show HTTP headers (request and response)" );
 
-static int HTTP_FileFree( httpfile_t *file );
-static int HTTP_FileConnect( httpfile_t *file );
-static int HTTP_FileCreateSocket( httpfile_t *file );
-static int HTTP_FileProcessStream( httpfile_t *file );
-static int HTTP_FileQueue( httpfile_t *file );
-static int HTTP_FileResolveNS( httpfile_t *file );
-static int HTTP_FileSendRequest( httpfile_t *file );
 static int HTTP_FileDecompress( httpfile_t *file );
+static void HTTP_CloseConnection( httpconn_t *conn, httpfile_t *failed );
+
+/*
+==============
+HTTP_SaveValidator
+
+keeps validator next to .incomplete file, so
+partial data can be checked in the next session
+==============
+*/
+static void HTTP_SaveValidator( httpfile_t *file )
+{
+	char name[MAX_SYSPATH + 64];
+
+	Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "%s.incomplete.validator", file->path );
+
+	if( file->validator[0] )
+		FS_WriteFile( name, file->validator, Q_strlen( file->validator ));
+	else FS_Delete( name );
+}
+
+/*
+==============
+HTTP_LoadValidator
+==============
+*/
+static void HTTP_LoadValidator( httpfile_t *file )
+{
+	char name[MAX_SYSPATH + 64];
+	fs_offset_t len = 0;
+	byte *data;
+
+	Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "%s.incomplete.validator", file->path );
+
+	file->validator[0] = '\0';
+
+	if( !( data = FS_LoadFile( name, &len, false )))
+		return;
+
+	if( len > 0 && len < sizeof( file->validator ) && !Q_strchr( (char *)data, '\r' ) && !Q_strchr( (char *)data, '\n' ))
+	{
+		memcpy( file->validator, data, len );
+		file->validator[len] = '\0';
+	}
+
+	Mem_Free( data );
+}
 
 /*
 ==============
@@ -112,9 +229,7 @@ static void HTTP_FreeFile( httpfile_t *file, qboolean error )
 	char incname[MAX_SYSPATH + 64]; // plus downloaded/ plus .incomplete
 	qboolean was_open = false;
 
-	file->blocktime = 0;
-
-	// Allways close file and socket
+	// Allways close file
 	if( file->file )
 	{
 		FS_Close( file->file );
@@ -123,24 +238,26 @@ static void HTTP_FreeFile( httpfile_t *file, qboolean error )
 
 	file->file = NULL;
 
-	if( file->socket != -1 )
-	{
-		closesocket( file->socket );
-		http.active_count--;
-	}
-
-	file->socket = -1;
-
 	Q_snprintf( incname, sizeof( incname ), DEFAULT_DOWNLOADED_DIRECTORY "%s.incomplete", file->path );
 
 	if( error )
 	{
+		// compressed stream can't be resumed
+		if( file->compressed )
+		{
+			FS_Delete( incname );
+			file->compressed = false;
+			file->validator[0] = '\0';
+			HTTP_SaveValidator( file );
+		}
+
 		// switch to next fastdl server if present
 		if( file->server && was_open )
 		{
 			file->server = file->server->next;
+			file->retries = 0;
 
-			file->pfn_process = HTTP_FileQueue; // Reset download state, HTTP_Run() will open file again
+			file->state = HTTP_FILE_QUEUED; // Reset download state, HTTP_Run() will open file again
 			return;
 		}
 
@@ -149,6 +266,8 @@ static void HTTP_FreeFile( httpfile_t *file, qboolean error )
 		{
 			Con_Printf( S_ERROR "no servers to download %s\n", file->path );
 			FS_Delete( incname );
+			file->validator[0] = '\0';
+			HTTP_SaveValidator( file );
 		}
 		else // autoremove disabled, keep file
 		{
@@ -169,133 +288,347 @@ static void HTTP_FreeFile( httpfile_t *file, qboolean error )
 			Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "%s", file->path );
 			FS_Rename( incname, name );
 		}
+
+		file->validator[0] = '\0';
+		HTTP_SaveValidator( file );
 	}
 
-	file->pfn_process = HTTP_FileFree;
+	file->state = HTTP_FILE_DONE;
 	file->success = !error;
 }
 
-static int HTTP_FileFree( httpfile_t *file )
+/*
+==============
+HTTP_DetachFile
+
+drops pending response for file, other
+requests on its connection are sent again
+==============
+*/
+static void HTTP_DetachFile( httpfile_t *file )
 {
-	return 0; // do nothing, wait for memory clean up
+	if( file->conn )
+		HTTP_CloseConnection( file->conn, NULL );
 }
 
-static int HTTP_FileQueue( httpfile_t *file )
+/*
+==============
+HTTP_TruncateFile
+==============
+*/
+static qboolean HTTP_TruncateFile( httpfile_t *file )
 {
-	char name[MAX_SYSPATH];
+	char name[MAX_SYSPATH + 64];
 
-	if( http.active_count > http_maxconnections.value )
-		return 0;
+	if( file->file )
+		FS_Close( file->file );
+
+	Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "%s.incomplete", file->path );
 
-	if( !file->server )
+	file->offset = 0;
+	file->compressed = false;
+
+	// new one comes with the response
+	file->validator[0] = '\0';
+	HTTP_SaveValidator( file );
+
+	if( !( file->file = FS_Open( name, "wb+", true )))
 	{
-		HTTP_FreeFile( file, true );
-		return 0;
+		Con_Printf( S_ERROR "HTTP: cannot open %s!\n", name );
+		return false;
 	}
 
-	Con_Reportf( "HTTP: Starting download %s from %s:%d\n", file->path, file->server->host, file->server->port );
+	return true;
+}
+
+/*
+==============
+HTTP_OpenFile
+
+opens .incomplete file, keeping already downloaded part
+==============
+*/
+static qboolean HTTP_OpenFile( httpfile_t *file )
+{
+	char name[MAX_SYSPATH + 64];
+	qboolean reopened = false;
+	byte magic[2];
+
 	Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "%s.incomplete", file->path );
 
-	if( !( file->file = FS_Open( name, "wb+", true )))
+	if( !file->file )
+	{
+		if( !( file->file = FS_Open( name, "eb+", true )))
+		{
+			Con_Printf( S_ERROR "HTTP: cannot open %s!\n", name );
+			return false;
+		}
+
+		reopened = true;
+	}
+
+	FS_Seek( file->file, 0, SEEK_END );
+	file->offset = FS_Tell( file->file );
+
+	if( file->offset <= 0 )
+		return true;
+
+	if( file->norange || ( file->size > 0 && file->offset >= file->size ))
+		return HTTP_TruncateFile( file );
+
+	// data that wasn't written by this request chain, like a leftover
+	// of earlier session, is only continued if server can check it
+	if( reopened && !file->validator[0] )
+	{
+		HTTP_LoadValidator( file );
+
+		if( !file->validator[0] )
+			return HTTP_TruncateFile( file );
+	}
+
+	// leftover of gzipped transfer, we only resume plain ones
+	FS_Seek( file->file, 0, SEEK_SET );
+	if( FS_Read( file->file, magic, sizeof( magic )) == sizeof( magic ) && magic[0] == 0x1f && magic[1] == 0x8b
+		&& Q_stricmp( COM_FileExtension( file->path ), "gz" ))
+		return HTTP_TruncateFile( file );
+
+	FS_Seek( file->file, 0, SEEK_END );
+	return true;
+}
+
+/*
+==============
+HTTP_RequeueFile
+
+connection was lost before file was received
+==============
+*/
+static void HTTP_RequeueFile( httpfile_t *file, qboolean failed )
+{
+	if( file->state != HTTP_FILE_REQUESTED )
+		return;
+
+	if( failed && ++file->retries > MAX_HTTP_RETRIES )
 	{
-		Con_Printf( S_ERROR "HTTP: cannot open %s!", name );
 		HTTP_FreeFile( file, true );
-		return 0;
+		return;
 	}
 
-	file->pfn_process = HTTP_FileResolveNS;
-	file->blocktime = file->downloaded = file->lastchecksize = file->checktime = 0;
-	return 1;
+	// compressed stream can't be resumed
+	if( file->compressed && !HTTP_TruncateFile( file ))
+	{
+		HTTP_FreeFile( file, true );
+		return;
+	}
+
+	file->state = HTTP_FILE_QUEUED;
+}
+
+/*
+==============
+HTTP_CompleteFile
+==============
+*/
+static void HTTP_CompleteFile( httpfile_t *file )
+{
+	double elapsed = Sys_DoubleTime() - file->starttime;
+
+	if( !file->compressed && file->size > 0 && file->offset + file->downloaded != file->size )
+		Con_Reportf( S_WARN "Server reports wrong file size for %s!\n", file->path );
+
+	Con_Reportf( "HTTP: %s done, %d bytes in %.2f seconds (%.1f KB/s)%s\n", file->path, file->received, elapsed,
+		elapsed > 0.0 ? file->received / elapsed / 1024.0 : 0.0, file->offset > 0 ? ", resumed" : "" );
+
+	http.stat_completed++;
+
+	if( file->compressed )
+		HTTP_FileDecompress( file );
+	else HTTP_FreeFile( file, false ); // success
 }
 
-static int HTTP_FileResolveNS( httpfile_t *file )
+/*
+==============
+HTTP_ResolveServer
+
+returns 1 if address is known, 0 if still resolving and -1 on failure
+==============
+*/
+static int HTTP_ResolveServer( httpserver_t *server )
 {
 	net_gai_state_t res;
+	struct sockaddr_storage addr;
+
+	if( server->resolved )
+		return server->resolved;
 
 	if( http.resolving )
 		return 0;
 
-	memset( &file->addr, 0, sizeof( file->addr ));
+	res = NET_StringToSockaddr( server->host, &addr, true, AF_UNSPEC );
+
+	if( res == NET_EAI_AGAIN )
+	{
+		http.resolving = true;
+		return 0;
+	}
 
-	res = NET_StringToSockaddr( file->server->host, &file->addr, true, AF_UNSPEC );
+	if( res == NET_EAI_NONAME )
+	{
+		Con_Printf( S_ERROR "failed to resolve server address for %s!\n", server->host );
+		server->resolved = -1;
+		return -1;
+	}
 
-	switch( file->addr.ss_family )
+	switch( addr.ss_family )
 	{
 	case AF_INET:
-		((struct sockaddr_in *)&file->addr)->sin_port = MSG_BigShort( file->server->port );
+		((struct sockaddr_in *)&addr)->sin_port = MSG_BigShort( server->port );
 		break;
 	case AF_INET6:
-		((struct sockaddr_in6 *)&file->addr)->sin6_port = MSG_BigShort( file->server->port );
+		((struct sockaddr_in6 *)&addr)->sin6_port = MSG_BigShort( server->port );
 		break;
 	}
 
-	if( res == NET_EAI_AGAIN )
+	server->addr = addr;
+	server->resolved = 1;
+	return 1;
+}
+
+/*
+==============
+HTTP_NewConnection
+==============
+*/
+static httpconn_t *HTTP_NewConnection( httpserver_t *server )
+{
+	httpconn_t *conn = Z_Calloc( sizeof( *conn ));
+
+	conn->server = server;
+	conn->socket = -1;
+	conn->state = HTTP_CONN_RESOLVE;
+	conn->parse = HTTP_PARSE_HEADER;
+
+	conn->next = http.first_conn;
+	http.first_conn = conn;
+
+	http.active_count++;
+	http.stat_connections++;
+
+	return conn;
+}
+
+/*
+==============
+HTTP_CloseConnection
+
+requests still waiting on connection are queued again,
+failed request is counted as a retry
+==============
+*/
+static void HTTP_CloseConnection( httpconn_t *conn, httpfile_t *failed )
+{
+	int i;
+
+	if( conn->state == HTTP_CONN_CLOSED )
+		return;
+
+	for( i = 0; i < conn->num_requests; i++ )
 	{
-		http.resolving = true;
-		return 0;
+		httpfile_t *file = conn->requests[i];
+
+		file->conn = NULL;
+		HTTP_RequeueFile( file, file == failed );
 	}
 
-	if( res == NET_EAI_NONAME )
+	conn->num_requests = 0;
+
+	if( conn->socket != -1 )
+		closesocket( conn->socket );
+
+	conn->socket = -1;
+	conn->state = HTTP_CONN_CLOSED;
+	http.active_count--;
+}
+
+/*
+==============
+HTTP_FailConnection
+
+can't reach the server, move waiting files to the next one
+==============
+*/
+static void HTTP_FailConnection( httpconn_t *conn )
+{
+	int i;
+
+	for( i = 0; i < conn->num_requests; i++ )
 	{
-		Con_Printf( S_ERROR "failed to resolve server address for %s!\n", file->server->host );
-		HTTP_FreeFile( file, true );
-		return 0;
+		httpfile_t *file = conn->requests[i];
+
+		file->conn = NULL;
+		if( file->state == HTTP_FILE_REQUESTED )
+			HTTP_FreeFile( file, true );
 	}
 
-	file->pfn_process = HTTP_FileCreateSocket;
-	return 1;
+	conn->num_requests = 0;
+	HTTP_CloseConnection( conn, NULL );
 }
 
-static int HTTP_FileCreateSocket( httpfile_t *file )
+/*
+==============
+HTTP_ConnCreateSocket
+==============
+*/
+static qboolean HTTP_ConnCreateSocket( httpconn_t *conn )
 {
 	uint mode = 1;
 	int res;
 
-	file->socket = socket( file->addr.ss_family, SOCK_STREAM, IPPROTO_TCP );
+	conn->socket = socket( conn->server->addr.ss_family, SOCK_STREAM, IPPROTO_TCP );
 
-	if( file->socket < 0 )
+	if( conn->socket < 0 )
 	{
 		Con_Printf( S_ERROR "%s: socket() returned %s\n", __func__, NET_ErrorString());
-		HTTP_FreeFile( file, true );
-		return 0;
+		return false;
 	}
 
-	if( ioctlsocket( file->socket, FIONBIO, (void *)&mode ) < 0 )
+	if( ioctlsocket( conn->socket, FIONBIO, (void *)&mode ) < 0 )
 	{
 		Con_Printf( S_ERROR "%s: ioctl() returned %s\n", __func__, NET_ErrorString());
-		HTTP_FreeFile( file, true );
-		return 0;
+		return false;
 	}
 
 #if XASH_LINUX
 
-	res = fcntl( file->socket, F_GETFL, 0 );
+	res = fcntl( conn->socket, F_GETFL, 0 );
 
 	if( res < 0 )
 	{
 		Con_Printf( S_ERROR "%s: fcntl( F_GETFL ) returned %s\n", __func__, NET_ErrorString());
-		HTTP_FreeFile( file, true );
-		return 0;
+		return false;
 	}
 
 	// SOCK_NONBLOCK is not portable, so use fcntl
-	if( fcntl( file->socket, F_SETFL, res | O_NONBLOCK ) < 0 )
+	if( fcntl( conn->socket, F_SETFL, res | O_NONBLOCK ) < 0 )
 	{
 		Con_Printf( S_ERROR "%s: fcntl( F_SETFL ) returned %s\n", __func__, NET_ErrorString());
-		HTTP_FreeFile( file, true );
-		return 0;
+		return false;
 	}
 #endif
 
-	http.active_count++;
-	file->pfn_process = HTTP_FileConnect;
-	return 1;
+	return true;
 }
 
-static int HTTP_FileConnect( httpfile_t *file )
+/*
+==============
+HTTP_ConnConnect
+
+returns true when connection is established
+==============
+*/
+static qboolean HTTP_ConnConnect( httpconn_t *conn )
 {
-	string useragent;
-	int res = connect( file->socket, (struct sockaddr *)&file->addr, NET_SockAddrLen( &file->addr ));
+	int res = connect( conn->socket, (struct sockaddr *)&conn->server->addr, NET_SockAddrLen( &conn->server->addr ));
 
 	if( res < 0 )
 	{
@@ -310,18 +643,33 @@ static int HTTP_FileConnect( httpfile_t *file )
 		case WSAEINPROGRESS:
 		case WSAEALREADY:
 			// add to the timeout
-			file->blocktime += host.frametime;
-			file->blockreason = "request send";
-			return 0;
+			conn->blockreason = "connect";
+			return false;
 		default:
 			// error, exit
 			Con_Printf( S_ERROR "cannot connect to server: %s\n", NET_ErrorString( ));
-			HTTP_FreeFile( file, true );
-			return 0;
+			HTTP_FailConnection( conn );
+			return false;
 		}
 	}
 
-	file->blocktime = 0;
+	conn->state = HTTP_CONN_OPEN;
+	return true;
+}
+
+/*
+==============
+HTTP_ConnAddRequest
+
+appends request for file to connection send buffer
+==============
+*/
+static qboolean HTTP_ConnAddRequest( httpconn_t *conn, httpfile_t *file )
+{
+	char request[MAX_SYSPATH * 2 + 1024];
+	char range[256];
+	string useragent;
+	int len;
 
 	if( !COM_CheckStringEmpty( http_useragent.string ) || !Q_strcmp( http_useragent.string, "xash3d" ))
 	{
@@ -330,59 +678,827 @@ static int HTTP_FileConnect( httpfile_t *file )
 	}
 	else Q_strncpy( useragent, http_useragent.string, sizeof( useragent ));
 
-	file->query_length = Q_snprintf( file->buf, sizeof( file->buf ),
+	// resumed transfer asks for plain data, gzip stream can't be continued,
+	// server sends the whole file if it doesn't match the validator
+	if( file->offset > 0 && file->validator[0] )
+		Q_snprintf( range, sizeof( range ), "Range: bytes=%d-\r\nIf-Range: %s\r\n", file->offset, file->validator );
+	else if( file->offset > 0 )
+		Q_snprintf( range, sizeof( range ), "Range: bytes=%d-\r\n", file->offset );
+	else Q_strncpy( range, "Accept-Encoding: gzip, deflate\r\n", sizeof( range ));
+
+	len = Q_snprintf( request, sizeof( request ),
 		"GET %s%s HTTP/1.1\r\n"
 		"Host: %s:%d\r\n"
 		"User-Agent: %s\r\n"
-		"Accept-Encoding: gzip, deflate\r\n"
+		"%s"
 		"Accept: */*\r\n\r\n",
-		file->server->path, file->path,
-		file->server->host, file->server->port,
-		useragent );
-	Q_strncpy( file->query_backup, file->buf, sizeof( file->query_backup ));
-	file->bytes_sent = 0;
-	file->header_size = 0;
-	file->pfn_process = HTTP_FileSendRequest;
-	return 1;
+		conn->server->path, file->path,
+		conn->server->host, conn->server->port,
+		useragent, range );
+
+	if( len < 0 )
+		return false;
+
+	// move unsent part to the start
+	if( conn->send_pos > 0 )
+	{
+		memmove( conn->sendbuf, conn->sendbuf + conn->send_pos, conn->send_len - conn->send_pos );
+		conn->send_len -= conn->send_pos;
+		conn->send_pos = 0;
+	}
+
+	if( conn->send_len + len > sizeof( conn->sendbuf ))
+		return false;
+
+	memcpy( conn->sendbuf + conn->send_len, request, len );
+	conn->send_len += len;
+
+	if( http_show_headers.value )
+		Con_Reportf( "HTTP: Request queued: %s", request );
+
+	if( conn->served > 0 || conn->num_requests > 0 )
+		http.stat_reused++;
+
+	if( file->offset > 0 )
+		http.stat_resumed++;
+
+	http.stat_requests++;
+
+	conn->requests[conn->num_requests++] = file;
+	http.stat_maxdepth = Q_max( http.stat_maxdepth, conn->num_requests );
+
+	if( !file->starttime )
+		file->starttime = Sys_DoubleTime();
+
+	file->conn = conn;
+	file->state = HTTP_FILE_REQUESTED;
+	file->downloaded = 0;
+	file->compressed = false;
+	return true;
 }
 
-static int HTTP_FileSendRequest( httpfile_t *file )
-{
-	int res = -1;
+/*
+==============
+HTTP_FindHeader
 
-	res = send( file->socket, file->buf + file->bytes_sent, file->query_length - file->bytes_sent, 0 );
+returns value of header field, name is case insensitive
+==============
+*/
+static const char *HTTP_FindHeader( const char *headers, const char *name )
+{
+	const char *line = Q_strstr( headers, "\r\n" );
+	size_t len = Q_strlen( name );
 
-	if( res >= 0 )
+	while( line )
 	{
-		file->bytes_sent += res;
-		file->blocktime = 0;
+		line += 2;
 
-		if( file->bytes_sent >= file->query_length )
+		if( !Q_strnicmp( line, name, len ) && line[len] == ':' )
 		{
-			if( http_show_headers.value )
-				Con_Reportf( "HTTP: Request sent! (size %d data %s)\n", file->bytes_sent, file->buf );
-			else
-				Con_Reportf( "HTTP: Request sent!\n" );
-			memset( file->buf, 0, sizeof( file->buf ));
-			file->pfn_process = HTTP_FileProcessStream;
-			return 1;
+			line += len + 1;
+
+			while( *line == ' ' || *line == '\t' )
+				line++;
+
+			return line;
 		}
+
+		line = Q_strstr( line, "\r\n" );
 	}
-	else
+
+	return NULL;
+}
+
+/*
+==============
+HTTP_HeaderHasToken
+==============
+*/
+static qboolean HTTP_HeaderHasToken( const char *value, const char *token )
+{
+	const char *end;
+	size_t len = Q_strlen( token );
+
+	if( !value )
+		return false;
+
+	end = Q_strstr( value, "\r\n" );
+
+	for( ; *value && ( !end || value < end ); value++ )
+	{
+		if( !Q_strnicmp( value, token, len ))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+==============
+HTTP_CopyHeaderValue
+
+copies header value up to the end of line, leaves out untouched if it doesn't fit
+==============
+*/
+static void HTTP_CopyHeaderValue( char *out, const char *value, size_t size )
+{
+	size_t len;
+
+	for( len = 0; value[len] && value[len] != '\r' && value[len] != '\n'; len++ );
+
+	if( len == 0 || len >= size )
+		return;
+
+	memcpy( out, value, len );
+	out[len] = '\0';
+}
+
+/*
+==============
+HTTP_ConnParseHeader
+
+decides how to frame and where to put response body
+==============
+*/
+static qboolean HTTP_ConnParseHeader( httpconn_t *conn, char *headers )
+{
+	httpfile_t *file = conn->requests[0];
+	const char *content_length, *content_encoding, *content_range, *connection;
+	const char *total = NULL;
+	qboolean chunked;
+	int status;
+
+	if( Q_strncmp( headers, "HTTP/1.", 7 ) || !isdigit( headers[9] ))
+	{
+		Con_Printf( S_ERROR "%s: bad response from %s\n", file->path, conn->server->host );
+		return false;
+	}
+
+	status = Q_atoi( headers + 9 );
+
+	if( http_show_headers.value )
+		Con_Reportf( "Response headers: %s\n", headers );
+
+	// interim response, real one follows
+	if( status >= 100 && status < 200 )
+		return true;
+
+	connection = HTTP_FindHeader( headers, "Connection" );
+	conn->keepalive = headers[7] != '0'; // HTTP/1.0 closes by default
+
+	if( HTTP_HeaderHasToken( connection, "close" ))
+		conn->keepalive = false;
+	else if( HTTP_HeaderHasToken( connection, "keep-alive" ))
+		conn->keepalive = true;
+
+	chunked = HTTP_HeaderHasToken( HTTP_FindHeader( headers, "Transfer-Encoding" ), "chunked" );
+	content_length = HTTP_FindHeader( headers, "Content-Length" );
+
+	if( chunked )
+	{
+		conn->parse = HTTP_PARSE_CHUNK_SIZE;
+	}
+	else if( content_length )
+	{
+		conn->parse = HTTP_PARSE_BODY;
+		conn->remaining = Q_atoi( content_length );
+	}
+	else if( status == 204 || status == 304 )
+	{
+		conn->parse = HTTP_PARSE_BODY;
+		conn->remaining = 0;
+	}
+	else
+	{
+		conn->parse = HTTP_PARSE_UNTIL_CLOSE;
+		conn->keepalive = false;
+	}
+
+	conn->discard = true;
+
+	switch( status )
+	{
+	case 200:
+		// server ignored Range, start over
+		if( file->offset > 0 && !HTTP_TruncateFile( file ))
+		{
+			HTTP_FreeFile( file, true );
+			return true;
+		}
+
+		if( conn->parse == HTTP_PARSE_UNTIL_CLOSE )
+		{
+			// Usually fastdl's reports file size if link is correct
+			Con_Printf( S_ERROR "file size is unknown, refusing download!\n" );
+			HTTP_FreeFile( file, true );
+			return true;
+		}
+		break;
+	case 206:
+		content_range = HTTP_FindHeader( headers, "Content-Range" );
+
+		// bytes first-last/total, total must be on the same line
+		if( content_range )
+		{
+			const char *eol = Q_strstr( content_range, "\r\n" );
+
+			total = Q_strchr( content_range, '/' );
+
+			if( total && eol && total > eol )
+				total = NULL;
+		}
+
+		// partial data must start where ours ends and belong to a file of expected size
+		if( !content_range || Q_strnicmp( content_range, "bytes ", 6 ) || Q_atoi( content_range + 6 ) != file->offset
+			|| ( file->size > 0 && ( !total || Q_atoi( total + 1 ) != file->size ))
+			|| conn->parse == HTTP_PARSE_UNTIL_CLOSE )
+		{
+			Con_Printf( S_ERROR "%s: bad Content-Range, restarting download\n", file->path );
+			file->norange = true;
+			HTTP_RequeueFile( file, false );
+			return true;
+		}
+		break;
+	case 416:
+		// partial file doesn't match the one on server
+		file->norange = true;
+		HTTP_RequeueFile( file, false );
+		return true;
+	// TODO: handle redirects
+	case 404:
+		Con_Printf( S_ERROR "%s: file not found\n", file->path );
+		HTTP_FreeFile( file, true );
+		return true;
+	default:
+		{
+			char *p = Q_strchr( headers, '\r' );
+			if( p ) *p = 0;
+			Con_Printf( S_ERROR "%s: bad response: %s\n", file->path, headers );
+		}
+		HTTP_FreeFile( file, true );
+		return true;
+	}
+
+	content_encoding = HTTP_FindHeader( headers, "Content-Encoding" );
+	if( content_encoding ) // fetch compressed status
+	{
+		if( !Q_strnicmp( content_encoding, "gzip", 4 ) && ( content_encoding[4] == '\0' || content_encoding[4] == '\n' || content_encoding[4] == '\r' ))
+			file->compressed = true;
+		else if( Q_strnicmp( content_encoding, "identity", 8 ))
+		{
+			Con_Printf( S_ERROR "%s: bad Content-Encoding: %s\n", file->path, content_encoding );
+			HTTP_FreeFile( file, true );
+			return true;
+		}
+	}
+
+	// compressed stream is written from the start
+	if( file->compressed && file->offset > 0 && !HTTP_TruncateFile( file ))
+	{
+		HTTP_FreeFile( file, true );
+		return true;
+	}
+
+	// remember what identifies data being written, weak ETag can't be used in If-Range
+	file->validator[0] = '\0';
+
+	if( !file->compressed )
+	{
+		const char *validator = HTTP_FindHeader( headers, "ETag" );
+
+		if( !validator || !Q_strncmp( validator, "W/", 2 ))
+			validator = HTTP_FindHeader( headers, "Last-Modified" );
+
+		if( validator )
+			HTTP_CopyHeaderValue( file->validator, validator, sizeof( file->validator ));
+	}
+
+	HTTP_SaveValidator( file );
+
+	Con_Reportf( "HTTP: Got %d for %s%s%s\n", status, file->path, chunked ? ", chunked" : "", file->compressed ? ", compressed" : "" );
+
+	conn->discard = false;
+	return true;
+}
+
+/*
+==============
+HTTP_ConnFinishResponse
+==============
+*/
+static void HTTP_ConnFinishResponse( httpconn_t *conn )
+{
+	httpfile_t *file = conn->requests[0];
+	qboolean complete = !conn->discard;
+
+	conn->num_requests--;
+	memmove( conn->requests, conn->requests + 1, conn->num_requests * sizeof( conn->requests[0] ));
+
+	conn->parse = HTTP_PARSE_HEADER;
+	conn->discard = false;
+	conn->served++;
+
+	file->conn = NULL;
+
+	if( complete )
+		HTTP_CompleteFile( file );
+
+	if( !conn->keepalive )
+		HTTP_CloseConnection( conn, NULL );
+}
+
+/*
+==============
+HTTP_ConnSaveData
+==============
+*/
+static void HTTP_ConnSaveData( httpconn_t *conn, const char *data, int length )
+{
+	httpfile_t *file = conn->requests[0];
+
+	http.stat_bytes += length;
+
+	if( conn->discard )
+		return;
+
+	if( FS_Write( file->file, data, length ) != length )
+	{
+		// close it and go to next
+		Con_Printf( S_ERROR "write failed for %s!\n", file->path );
+		HTTP_FreeFile( file, true );
+		conn->discard = true;
+		return;
+	}
+
+	file->downloaded += length;
+	file->received += length;
+}
+
+/*
+==============
+HTTP_ConnFindLine
+
+returns length of line ending with CRLF or -1
+==============
+*/
+static int HTTP_ConnFindLine( httpconn_t *conn )
+{
+	int i;
+
+	for( i = conn->recv_pos; i + 1 < conn->recv_len; i++ )
+	{
+		if( conn->recvbuf[i] == '\r' && conn->recvbuf[i + 1] == '\n' )
+			return i - conn->recv_pos;
+	}
+
+	return -1;
+}
+
+/*
+==============
+HTTP_ConnParse
+
+processes received data, returns false on protocol error
+==============
+*/
+static qboolean HTTP_ConnParse( httpconn_t *conn )
+{
+	while( conn->state == HTTP_CONN_OPEN && conn->recv_pos < conn->recv_len )
+	{
+		char *data = conn->recvbuf + conn->recv_pos;
+		int avail = conn->recv_len - conn->recv_pos;
+		int len;
+
+		if( !conn->num_requests )
+		{
+			Con_Printf( S_ERROR "HTTP: unexpected data from %s\n", conn->server->host );
+			return false;
+		}
+
+		switch( conn->parse )
+		{
+		case HTTP_PARSE_HEADER:
+			{
+				char *end;
+
+				conn->recvbuf[conn->recv_len] = 0;
+				end = Q_strstr( data, "\r\n\r\n" );
+
+				if( !end )
+					return true; // wait for the rest
+
+				end[2] = 0; // keep last CRLF for HTTP_FindHeader
+				conn->recv_pos += end + 4 - data;
+
+				if( !HTTP_ConnParseHeader( conn, data ))
+					return false;
+			}
+			break;
+		case HTTP_PARSE_BODY:
+		case HTTP_PARSE_CHUNK_DATA:
+		case HTTP_PARSE_UNTIL_CLOSE:
+			len = conn->parse == HTTP_PARSE_UNTIL_CLOSE ? avail : Q_min( avail, conn->remaining );
+			HTTP_ConnSaveData( conn, data, len );
+			conn->recv_pos += len;
+			conn->remaining -= len;
+
+			if( conn->parse == HTTP_PARSE_CHUNK_DATA && conn->remaining <= 0 )
+				conn->parse = HTTP_PARSE_CHUNK_END;
+			break;
+		case HTTP_PARSE_CHUNK_SIZE:
+			if(( len = HTTP_ConnFindLine( conn )) < 0 )
+				return true;
+
+			conn->recvbuf[conn->recv_pos + len] = 0;
+			conn->remaining = Q_atoi_hex( 1, data );
+			conn->recv_pos += len + 2;
+
+			if( conn->remaining < 0 )
+			{
+				Con_Printf( S_ERROR "can't parse chunked transfer encoding header for %s\n", conn->requests[0]->path );
+				return false;
+			}
+
+			conn->parse = conn->remaining ? HTTP_PARSE_CHUNK_DATA : HTTP_PARSE_TRAILER;
+			break;
+		case HTTP_PARSE_CHUNK_END:
+			if( avail < 2 )
+				return true;
+
+			if( data[0] != '\r' || data[1] != '\n' )
+			{
+				Con_Printf( S_ERROR "can't parse chunked transfer encoding header 2 for %s\n", conn->requests[0]->path );
+				return false;
+			}
+
+			conn->recv_pos += 2;
+			conn->parse = HTTP_PARSE_CHUNK_SIZE;
+			break;
+		case HTTP_PARSE_TRAILER:
+			if(( len = HTTP_ConnFindLine( conn )) < 0 )
+				return true;
+
+			conn->recv_pos += len + 2;
+
+			// empty line ends the trailer
+			if( len == 0 )
+				conn->parse = HTTP_PARSE_BODY; // with zero remaining
+			break;
+		}
+
+		if( conn->parse == HTTP_PARSE_BODY && conn->remaining <= 0 )
+			HTTP_ConnFinishResponse( conn );
+	}
+
+	return true;
+}
+
+/*
+==============
+HTTP_ConnReceive
+==============
+*/
+static void HTTP_ConnReceive( httpconn_t *conn )
+{
+	while( conn->state == HTTP_CONN_OPEN )
+	{
+		int res;
+
+		// compact receive buffer
+		if( conn->recv_pos > 0 )
+		{
+			memmove( conn->recvbuf, conn->recvbuf + conn->recv_pos, conn->recv_len - conn->recv_pos );
+			conn->recv_len -= conn->recv_pos;
+			conn->recv_pos = 0;
+		}
+
+		if( conn->recv_len >= MAX_HTTP_BUFFER_SIZE )
+		{
+			Con_Reportf( S_ERROR "Header too big, the size is %d\n", conn->recv_len );
+			HTTP_CloseConnection( conn, conn->num_requests ? conn->requests[0] : NULL );
+			return;
+		}
+
+		res = recv( conn->socket, conn->recvbuf + conn->recv_len, MAX_HTTP_BUFFER_SIZE - conn->recv_len, 0 );
+
+		if( res > 0 )
+		{
+			conn->recv_len += res;
+			conn->blocktime = 0;
+
+			if( !HTTP_ConnParse( conn ))
+			{
+				HTTP_CloseConnection( conn, conn->num_requests ? conn->requests[0] : NULL );
+				return;
+			}
+
+			continue;
+		}
+
+		if( res == 0 )
+		{
+			// body framed by connection end
+			if( conn->parse == HTTP_PARSE_UNTIL_CLOSE && conn->num_requests )
+			{
+				HTTP_ConnFinishResponse( conn );
+				HTTP_CloseConnection( conn, NULL );
+				return;
+			}
+
+			// server may close idle keep-alive connection any time, but if
+			// it's in the middle of response, blame the file
+			if( conn->num_requests && ( conn->parse != HTTP_PARSE_HEADER || conn->recv_len > 0 || !conn->served ))
+			{
+				Con_Reportf( "HTTP: %s closed connection while sending %s\n", conn->server->host, conn->requests[0]->path );
+				HTTP_CloseConnection( conn, conn->requests[0] );
+			}
+			else HTTP_CloseConnection( conn, NULL );
+			return;
+		}
+
+		{
+			int err = WSAGetLastError();
+
+			if( err != WSAEWOULDBLOCK && err != WSAEINPROGRESS )
+			{
+				Con_Reportf( "problem downloading from %s: %s\n", conn->server->host, NET_ErrorString( ));
+				HTTP_CloseConnection( conn, conn->num_requests ? conn->requests[0] : NULL );
+			}
+		}
+		return;
+	}
+}
+
+/*
+==============
+HTTP_ConnSend
+==============
+*/
+static void HTTP_ConnSend( httpconn_t *conn )
+{
+	while( conn->send_pos < conn->send_len )
+	{
+		int res = send( conn->socket, conn->sendbuf + conn->send_pos, conn->send_len - conn->send_pos, 0 );
+
+		if( res < 0 )
+		{
+			int err = WSAGetLastError();
+
+			if( err != WSAEWOULDBLOCK && err != WSAENOTCONN )
+			{
+				Con_Printf( S_ERROR "failed to send request: %s\n", NET_ErrorString( ));
+				HTTP_CloseConnection( conn, conn->num_requests ? conn->requests[0] : NULL );
+			}
+			else conn->blockreason = "request send";
+			return;
+		}
+
+		conn->send_pos += res;
+		conn->blocktime = 0;
+	}
+
+	conn->send_pos = conn->send_len = 0;
+}
+
+/*
+==============
+HTTP_ConnRun
+==============
+*/
+static void HTTP_ConnRun( httpconn_t *conn, qboolean readable, qboolean writable )
+{
+	switch( conn->state )
+	{
+	case HTTP_CONN_RESOLVE:
+		switch( HTTP_ResolveServer( conn->server ))
+		{
+		case 0:
+			conn->blockreason = "resolving";
+			return;
+		case -1:
+			HTTP_FailConnection( conn );
+			return;
+		}
+
+		if( !HTTP_ConnCreateSocket( conn ))
+		{
+			HTTP_FailConnection( conn );
+			return;
+		}
+
+		conn->state = HTTP_CONN_CONNECTING;
+		Con_Reportf( "HTTP: Connecting to %s:%d\n", conn->server->host, conn->server->port );
+		// fallthrough
+	case HTTP_CONN_CONNECTING:
+		if( !HTTP_ConnConnect( conn ))
+			return;
+
+		conn->blocktime = 0;
+		writable = readable = true;
+		// fallthrough
+	case HTTP_CONN_OPEN:
+		if( writable && conn->send_len > 0 )
+			HTTP_ConnSend( conn );
+
+		if( readable && conn->state == HTTP_CONN_OPEN )
+			HTTP_ConnReceive( conn );
+
+		if( conn->state == HTTP_CONN_OPEN && conn->num_requests )
+			conn->blockreason = conn->parse == HTTP_PARSE_HEADER ? "receiving header" : "receiving data";
+		break;
+	case HTTP_CONN_CLOSED:
+		break;
+	}
+}
+
+/*
+==============
+HTTP_FindConnection
+
+picks least loaded connection to server, opens
+a new one while there are free slots
+==============
+*/
+static httpconn_t *HTTP_FindConnection( httpserver_t *server )
+{
+	int depth = bound( 1, (int)http_pipeline.value, MAX_HTTP_PIPELINE );
+	int maxconns = bound( 1, (int)http_maxconnections.value, MAX_HTTP_CONNECTIONS );
+	httpconn_t *conn, *best = NULL;
+
+	for( conn = http.first_conn; conn; conn = conn->next )
+	{
+		if( conn->server != server || conn->state == HTTP_CONN_CLOSED )
+			continue;
+
+		if( conn->num_requests >= depth )
+			continue;
+
+		if( !best || conn->num_requests < best->num_requests )
+			best = conn;
+	}
+
+	if( best && !best->num_requests )
+		return best;
+
+	if( http.active_count < maxconns )
+		return HTTP_NewConnection( server );
+
+	return best;
+}
+
+/*
+==============
+HTTP_AssignFiles
+
+puts queued files on connections
+==============
+*/
+static void HTTP_AssignFiles( void )
+{
+	httpfile_t *file;
+
+	for( file = http.first_file; file; file = file->next )
+	{
+		httpconn_t *conn;
+
+		if( file->state != HTTP_FILE_QUEUED || file->conn )
+			continue;
+
+		if( !file->server || file->server->resolved < 0 )
+		{
+			if( file->server )
+				file->server = file->server->next;
+
+			if( !file->server )
+				HTTP_FreeFile( file, true );
+			continue;
+		}
+
+		if( !( conn = HTTP_FindConnection( file->server )))
+			continue;
+
+		if( !HTTP_OpenFile( file ))
+		{
+			HTTP_FreeFile( file, true );
+			continue;
+		}
+
+		if( file->offset > 0 )
+			Con_Reportf( "HTTP: Resuming download %s from %s:%d at %d bytes\n", file->path, file->server->host, file->server->port, file->offset );
+		else Con_Reportf( "HTTP: Starting download %s from %s:%d\n", file->path, file->server->host, file->server->port );
+
+		HTTP_ConnAddRequest( conn, file );
+	}
+}
+
+/*
+==============
+HTTP_PollConnections
+
+runs connections that have something to do
+==============
+*/
+static void HTTP_PollConnections( void )
+{
+	httpconn_t *conn;
+#if !XASH_NO_NETWORK
+	struct timeval timeout = { 0 };
+	fd_set readset, writeset;
+	int maxfd = -1, res = 0;
+
+	FD_ZERO( &readset );
+	FD_ZERO( &writeset );
+
+	for( conn = http.first_conn; conn; conn = conn->next )
+	{
+		if( conn->socket == -1 || conn->state == HTTP_CONN_CLOSED )
+			continue;
+
+		FD_SET( conn->socket, &readset );
+
+		if( conn->state == HTTP_CONN_CONNECTING || conn->send_len > 0 )
+			FD_SET( conn->socket, &writeset );
+
+		maxfd = Q_max( maxfd, conn->socket );
+	}
+
+	if( maxfd >= 0 )
+		res = select( maxfd + 1, &readset, &writeset, NULL, &timeout );
+#endif
+
+	for( conn = http.first_conn; conn; conn = conn->next )
+	{
+		qboolean readable = true, writable = true;
+
+#if !XASH_NO_NETWORK
+		// if select failed, just try them all
+		if( res >= 0 && conn->socket != -1 )
+		{
+			readable = FD_ISSET( conn->socket, &readset );
+			writable = FD_ISSET( conn->socket, &writeset );
+		}
+#endif
+
+		if( conn->state != HTTP_CONN_CLOSED && ( readable || writable || conn->state == HTTP_CONN_RESOLVE ))
+			HTTP_ConnRun( conn, readable, writable );
+
+		if( conn->state == HTTP_CONN_CLOSED )
+			continue;
+
+		if( conn->num_requests || conn->state != HTTP_CONN_OPEN )
+		{
+			conn->idletime = 0;
+
+			if( !readable && !writable )
+				conn->blocktime += host.frametime;
+
+			if( conn->blocktime > http_timeout.value )
+			{
+				Con_Printf( S_ERROR "timeout on %s (server: %s)\n", conn->blockreason, conn->server->host );
+
+				// file in flight goes to the next server, others are sent again
+				if( conn->num_requests )
+					HTTP_FreeFile( conn->requests[0], true );
+
+				HTTP_CloseConnection( conn, NULL );
+			}
+		}
+		else
+		{
+			conn->blocktime = 0;
+			conn->idletime += host.frametime;
+
+			if( conn->idletime > HTTP_KEEPALIVE_IDLE )
+				HTTP_CloseConnection( conn, NULL );
+		}
+	}
+}
+
+/*
+==============
+HTTP_FreeConnections
+
+frees closed connections
+==============
+*/
+static void HTTP_FreeConnections( qboolean all )
+{
+	httpconn_t *cur, **prev = &http.first_conn;
+
+	while(( cur = *prev ))
 	{
-		int err = WSAGetLastError();
-		if( err != WSAEWOULDBLOCK && err != WSAENOTCONN )
+		if( all )
+			HTTP_CloseConnection( cur, NULL );
+
+		if( cur->state != HTTP_CONN_CLOSED )
 		{
-			Con_Printf( S_ERROR "failed to send request: %s\n", NET_ErrorString( ));
-			HTTP_FreeFile( file, true );
-			return 0;
+			prev = &cur->next;
+			continue;
 		}
 
-		file->blocktime += host.frametime;
-		file->blockreason = "request send";
+		*prev = cur->next;
+		Mem_Free( cur );
 	}
-
-	return 0;
 }
 
 static int HTTP_FileDecompress( httpfile_t *file )
@@ -526,6 +1642,9 @@ void HTTP_ClearCustomServers( void )
 	if( http.first_file )
 		return; // may be referenced
 
+	// idle connections reference servers too
+	HTTP_FreeConnections( true );
+
 	while( http.first_server )
 	{
 		httpserver_t *tmp = http.first_server;
@@ -540,7 +1659,7 @@ void HTTP_ClearCustomServers( void )
 ===================
 HTTP_AutoClean
 
-remove files with HTTP_FREE state from list
+remove files with HTTP_FILE_DONE state from list
 ===================
 */
 static void HTTP_AutoClean( void )
@@ -559,7 +1678,8 @@ static void HTTP_AutoClean( void )
 		if( !cur )
 			break;
 
-		if( cur->pfn_process != HTTP_FileFree )
+		// connection might be still skipping the response body
+		if( cur->state != HTTP_FILE_DONE || cur->conn )
 		{
 			prev = &cur->next;
 			continue;
@@ -596,288 +1716,6 @@ static void HTTP_AutoClean( void )
 #endif
 }
 
-static int HTTP_FileSaveReceivedData( httpfile_t *file, int pos, int length )
-{
-	while( length > 0 )
-	{
-		int oldpos = pos;
-		int ret;
-		int len_to_write;
-
-		if( file->chunked && file->chunksize <= 0 )
-		{
-			char *begin = &file->buf[pos];
-
-			if( begin[0] == '\r' && begin[1] == '\r' )
-				begin += 2;
-
-			file->chunksize = Q_atoi_hex( 1, begin );
-
-			if( !file->chunksize && begin[0] == '0' ) // actually an end, not Q_atoi being stupid
-			{
-				if( file->compressed )
-				{
-					file->blocktime = 0;
-					file->pfn_process = HTTP_FileDecompress;
-					return 1;
-				}
-				else
-				{
-					HTTP_FreeFile( file, false ); // success
-					return 1;
-				}
-			}
-
-			begin = Q_strstr( begin, "\r\n" );
-			if( !begin )
-			{
-				Con_Printf( S_ERROR "can't parse chunked transfer encoding header for %s\n", file->path );
-				if( http_show_headers.value )
-					Con_Reportf( "Request headers: %s", file->query_backup );
-				HTTP_FreeFile( file, true );
-				return 0;
-			}
-
-			pos = ( begin + 2 ) - file->buf;
-			length -= pos - oldpos;
-
-			if( length < 0 )
-			{
-				Con_Printf( S_ERROR "can't parse chunked transfer encoding header 2 for %s\n", file->path );
-				if( http_show_headers.value )
-					Con_Reportf( "Request headers: %s", file->query_backup );
-				HTTP_FreeFile( file, true );
-				return 0;
-			}
-		}
-
-		if( file->chunked )
-			len_to_write = Q_min( length, file->chunksize );
-		else len_to_write = length;
-
-		ret = FS_Write( file->file, &file->buf[pos], len_to_write );
-		if( ret != len_to_write )
-		{
-			// close it and go to next
-			Con_Printf( S_ERROR "write failed for %s!\n", file->path );
-			HTTP_FreeFile( file, true );
-			return 0;
-		}
-
-		length -= len_to_write;
-		file->chunksize -= len_to_write;
-
-		pos += ret;
-		file->downloaded += ret;
-		file->lastchecksize += ret;
-	}
-
-	return 1;
-}
-
-/*
-===================
-HTTP_ProcessStream
-
-process incoming data
-===================
-*/
-static int HTTP_FileProcessStream( httpfile_t *curfile )
-{
-	char buf[sizeof( curfile->buf )];
-	char *begin = 0;
-	int res;
-
-	// if we got there, we are receiving data
-	while(( res = recv( curfile->socket, buf, sizeof( buf ) - curfile->header_size - 1, 0 )) > 0 )
-	{
-		curfile->blocktime = 0;
-
-		if( !curfile->got_response ) // Response still not received
-		{
-			if( curfile->header_size + res + 1 > sizeof( buf ))
-			{
-				Con_Reportf( S_ERROR "Header too big, the size is %d\n", curfile->header_size );
-				HTTP_FreeFile( curfile, true );
-				return 0;
-			}
-
-			memcpy( curfile->buf + curfile->header_size, buf, res );
-			curfile->buf[curfile->header_size + res] = 0;
-			begin = Q_strstr( curfile->buf, "\r\n\r\n" );
-
-			if( begin ) // Got full header
-			{
-				char *content_length;
-				char *content_encoding;
-				char *transfer_encoding;
-
-				*begin = 0; // cut string to print out response
-
-				if( !Q_strstr( curfile->buf, "200 OK" ))
-				{
-					char *p;
-
-					int num = -1;
-
-					p = Q_strchr( curfile->buf, '\r' );
-					if( !p ) p = Q_strchr( curfile->buf, '\n' );
-					if( p ) *p = 0;
-
-					// extract the error code, don't assume the response is valid HTTP
-					if( !Q_strncmp( curfile->buf, "HTTP/1.", 7 ))
-					{
-						char tmp[4];
-
-						Q_strncpy( tmp, curfile->buf + 9, sizeof( tmp ));
-						if( Q_isdigit( tmp ))
-							num = Q_atoi( tmp );
-					}
-
-					switch( num )
-					{
-					// TODO: handle redirects
-					case 404:
-						Con_Printf( S_ERROR "%s: file not found\n", curfile->path );
-						break;
-					default:
-						Con_Printf( S_ERROR "%s: bad response: %s\n", curfile->path, curfile->buf );
-						if( http_show_headers.value )
-							Con_Printf( "Request headers: %s", curfile->query_backup );
-						break;
-					}
-
-					HTTP_FreeFile( curfile, true );
-					return 0;
-				}
-
-				content_encoding = Q_stristr( curfile->buf, "Content-Encoding" );
-				if( content_encoding ) // fetch compressed status
-				{
-					content_encoding += sizeof( "Content-Encoding: " ) - 1;
-
-					if( !Q_strnicmp( content_encoding, "gzip", 4 ) && ( content_encoding[4] == '\0' || content_encoding[4] == '\n' || content_encoding[4] == '\r' ))
-						curfile->compressed = true;
-					else
-					{
-						Con_Printf( S_ERROR "%s: bad Content-Encoding: %s\n", curfile->path, content_encoding );
-						if( http_show_headers.value )
-							Con_Printf( "Request headers: %s", curfile->query_backup );
-						HTTP_FreeFile( curfile, true );
-						return 0;
-					}
-				}
-
-				if(( transfer_encoding = Q_stristr( curfile->buf, "Transfer-Encoding: chunked" )))
-				{
-					curfile->size = -1;
-					curfile->chunked = true;
-
-					Con_Reportf( "HTTP: Got 200 OK! Chunked transfer encoding%s\n", curfile->compressed ? ", compressed" : "" );
-				}
-				else if(( content_length = Q_stristr( curfile->buf, "Content-Length: " ) ))
-				{
-					int size;
-
-					content_length += sizeof( "Content-Length: " ) - 1;
-					size = Q_atoi( content_length );
-
-					Con_Reportf( "HTTP: Got 200 OK! File size is %d%s\n", curfile->size, curfile->compressed ? ", compressed" : "" );
-
-					if( !curfile->compressed )
-					{
-						if( ( curfile->size != -1 ) && ( curfile->size != size )) // check size if specified, not used
-							Con_Reportf( S_WARN "Server reports wrong file size for %s!\n", curfile->path );
-					}
-
-					curfile->size = size;
-					curfile->header_size = 0;
-				}
-
-				if( curfile->size == -1 && !curfile->chunked )
-				{
-					// Usually fastdl's reports file size if link is correct
-					Con_Printf( S_ERROR "file size is unknown, refusing download!\n" );
-					HTTP_FreeFile( curfile, true );
-					return 0;
-				}
-
-				if( http_show_headers.value )
-					Con_Reportf( "Response headers: %s\n", curfile->buf );
-
-				curfile->got_response = true; // got response, let's start download
-				begin += 4;
-
-				if( res - ( begin - curfile->buf ) > 0 )
-				{
-					if( !HTTP_FileSaveReceivedData( curfile, begin - curfile->buf, res - ( begin - curfile->buf )))
-						return 0;
-				}
-			}
-			else
-				curfile->header_size += res;
-		}
-		else if( res > 0 )
-		{
-			memcpy( curfile->buf, buf, res );
-
-			// data download
-			if( !HTTP_FileSaveReceivedData( curfile, 0, res ))
-				return 0;
-
-			// as after it will run in same frame
-			if( curfile->checktime > 5 )
-			{
-				float speed = (float)curfile->lastchecksize / ( 5.0f * 1024 );
-
-				curfile->checktime = 0;
-				Con_Reportf( "download speed %f KB/s\n", speed );
-				curfile->lastchecksize = 0;
-			}
-		}
-	}
-
-	if( curfile->size > 0 )
-	{
-		http.progress += (float)curfile->downloaded / curfile->size;
-		http.progress_count++;
-
-		if( curfile->downloaded >= curfile->size )
-		{
-			HTTP_FreeFile( curfile, false ); // success
-			return 0;
-		}
-	}
-
-	if( res == 0 )
-	{
-		curfile->blocktime += host.frametime;
-		curfile->blockreason = "waiting for data";
-	}
-
-	if( res < 0 )
-	{
-		int err = WSAGetLastError();
-
-		if( err != WSAEWOULDBLOCK && err != WSAEINPROGRESS )
-		{
-			Con_Reportf( "problem downloading %s: %s\n", curfile->path, NET_ErrorString( ));
-			HTTP_FreeFile( curfile, true );
-			return 0;
-		}
-
-		curfile->blocktime += host.frametime;
-
-		if( !curfile->got_response )
-			curfile->blockreason = "receiving header";
-		else curfile->blockreason = "receiving data";
-		return 0;
-	}
-
-	curfile->checktime += host.frametime;
-	return 0; // don't block
-}
-
 /*
 ==============
 HTTP_Run
@@ -890,22 +1728,24 @@ void HTTP_Run( void )
 {
 	httpfile_t *curfile;
 
+	if( !http.first_file && !http.first_conn )
+		return;
+
 	http.resolving = false;
 	http.progress_count = 0;
 	http.progress = 0;
 
+	HTTP_AssignFiles();
+	HTTP_PollConnections();
+	HTTP_FreeConnections( false );
+
 	for( curfile = http.first_file; curfile; curfile = curfile->next )
 	{
-		int move_next = 1;
-
-		while( move_next > 0 )
-			move_next = curfile->pfn_process( curfile );
+		if( curfile->state != HTTP_FILE_REQUESTED || curfile->size <= 0 )
+			continue;
 
-		if( curfile->blocktime > http_timeout.value )
-		{
-			Con_Printf( S_ERROR "timeout on %s (file: %s)\n", curfile->blockreason, curfile->path );
-			HTTP_FreeFile( curfile, true );
-		}
+		http.progress += Q_min( 1.0f, (float)( curfile->offset + curfile->downloaded ) / curfile->size );
+		http.progress_count++;
 	}
 
 	// update progress
@@ -938,10 +1778,9 @@ void HTTP_AddDownload( const char *path, int size, qboolean process, resource_t
 
 	httpfile->resource = res;
 	httpfile->size = size;
-	httpfile->socket = -1;
 	Q_strncpy( httpfile->path, path, sizeof( httpfile->path ));
 
-	httpfile->pfn_process = HTTP_FileQueue;
+	httpfile->state = HTTP_FILE_QUEUED;
 	httpfile->server = http.first_server;
 	httpfile->process = process;
 
@@ -967,6 +1806,7 @@ static void HTTP_Download_f( void )
 	HTTP_AddDownload( Cmd_Argv( 1 ), -1, false, NULL );
 }
 
+
 /*
 ==============
 HTTP_ParseURL
@@ -1069,6 +1909,8 @@ Clear all queue
 */
 static void HTTP_Clear_f( void )
 {
+	HTTP_FreeConnections( true );
+
 	while( http.first_file )
 	{
 		httpfile_t *file = http.first_file;
@@ -1078,9 +1920,6 @@ static void HTTP_Clear_f( void )
 		if( file->file )
 			FS_Close( file->file );
 
-		if( file->socket != -1 )
-			closesocket( file->socket );
-
 		Mem_Free( file );
 	}
 }
@@ -1094,9 +1933,10 @@ Stop current download, skip to next file
 */
 static void HTTP_Cancel_f( void )
 {
-	if( !http.first_file )
+	if( !http.first_file || http.first_file->state == HTTP_FILE_DONE )
 		return;
 
+	HTTP_DetachFile( http.first_file );
 	http.first_file->server = NULL;
 	HTTP_FreeFile( http.first_file, true );
 }
@@ -1110,8 +1950,11 @@ Stop current download, skip to next server
 */
 static void HTTP_Skip_f( void )
 {
-	if( http.first_file )
-		HTTP_FreeFile( http.first_file, true );
+	if( !http.first_file || http.first_file->state == HTTP_FILE_DONE )
+		return;
+
+	HTTP_DetachFile( http.first_file );
+	HTTP_FreeFile( http.first_file, true );
 }
 
 /*
@@ -1131,7 +1974,7 @@ static void HTTP_List_f( void )
 
 	for( file = http.first_file; file; file = file->next )
 	{
-		Con_Printf( "%d. %s (%d of %d)\n", i++, file->path, file->downloaded, file->size );
+		Con_Printf( "%d. %s (%d of %d)\n", i++, file->path, file->offset + file->downloaded, file->size );
 
 		if( file->server )
 		{
@@ -1145,6 +1988,43 @@ static void HTTP_List_f( void )
 	}
 }
 
+/*
+=============
+HTTP_Stats_f
+
+Print connection usage and download throughput
+=============
+*/
+static void HTTP_Stats_f( void )
+{
+	double now = Sys_DoubleTime();
+	httpconn_t *conn;
+	httpfile_t *file;
+
+	Con_Printf( "connections: %d opened, %d active\n", http.stat_connections, http.active_count );
+	Con_Printf( "requests: %d sent, %d reused connection, %d resumed, pipeline depth up to %d\n",
+		http.stat_requests, http.stat_reused, http.stat_resumed, http.stat_maxdepth );
+	Con_Printf( "files: %d completed, %.1f KB received\n", http.stat_completed, http.stat_bytes / 1024.0 );
+
+	for( conn = http.first_conn; conn; conn = conn->next )
+	{
+		if( conn->state == HTTP_CONN_CLOSED )
+			continue;
+
+		Con_Printf( "  %s:%d: %d served, %d waiting\n", conn->server->host, conn->server->port, conn->served, conn->num_requests );
+	}
+
+	for( file = http.first_file; file; file = file->next )
+	{
+		double elapsed = now - file->starttime;
+
+		if( file->state != HTTP_FILE_REQUESTED || elapsed <= 0.0 )
+			continue;
+
+		Con_Printf( "  %s: %d of %d, %.1f KB/s\n", file->path, file->offset + file->downloaded, file->size, file->received / elapsed / 1024.0 );
+	}
+}
+
 /*
 ================
 HTTP_ResetProcessState
@@ -1174,12 +2054,14 @@ void HTTP_Init( void )
 	Cmd_AddRestrictedCommand( "http_cancel", HTTP_Cancel_f, "cancel current download" );
 	Cmd_AddRestrictedCommand( "http_clear", HTTP_Clear_f, "cancel all downloads" );
 	Cmd_AddRestrictedCommand( "http_list", HTTP_List_f, "list all queued downloads" );
+	Cmd_AddCommand( "http_stats", HTTP_Stats_f, "print http connection and throughput stats" );
 	Cmd_AddCommand( "http_addcustomserver", HTTP_AddCustomServer_f, "add custom fastdl server");
 
 	Cvar_RegisterVariable( &http_useragent );
 	Cvar_RegisterVariable( &http_autoremove );
 	Cvar_RegisterVariable( &http_timeout );
 	Cvar_RegisterVariable( &http_maxconnections );
+	Cvar_RegisterVariable( &http_pipeline );
 	Cvar_RegisterVariable( &http_show_headers );
 }
 
@@ -1200,3 +2082,323 @@ void HTTP_Shutdown( void )
 		Mem_Free( tmp );
 	}
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+#define TEST_HTTP_FILES   12
+#define TEST_HTTP_CLIENTS 8
+#define TEST_HTTP_CHUNKED 3 // sent with chunked transfer encoding
+#define TEST_HTTP_DROPPED 5 // connection drops in the middle of this file once
+#define TEST_HTTP_RESUMED 1 // valid leftover with matching validator
+#define TEST_HTTP_STALE   2 // leftover of older version of the file
+#define TEST_HTTP_UNKNOWN 4 // leftover without validator
+#define TEST_HTTP_SIZE( x ) ( 1000 + ( x ) * 2500 )
+
+typedef struct
+{
+	int socket;
+	char in[4096];
+	int inlen;
+	char out[TEST_HTTP_SIZE( TEST_HTTP_FILES ) + 4096];
+	int outpos, outlen;
+	qboolean drop; // close after out is sent
+} test_httpclient_t;
+
+typedef struct
+{
+	int listener;
+	test_httpclient_t clients[TEST_HTTP_CLIENTS];
+	int accepted;
+	int maxdepth; // most requests waiting at once
+	int ranges;
+	int dropped;
+} test_httpserver_t;
+
+static byte Test_HTTP_Byte( int file, int pos )
+{
+	return (byte)( file * 37 + pos * 13 + ( pos >> 8 ));
+}
+
+static void Test_HTTP_Respond( test_httpserver_t *sv, test_httpclient_t *cl, const char *request )
+{
+	int file = -1, offset = 0, size, i;
+	const char *range, *ifrange;
+	char *out = cl->out + cl->outlen;
+	char etag[32];
+
+	if( !Q_strncmp( request, "GET /httptest/file", 18 ))
+		file = Q_atoi( request + 18 );
+
+	if( file < 0 || file >= TEST_HTTP_FILES )
+	{
+		cl->outlen += Q_snprintf( out, sizeof( cl->out ) - cl->outlen, "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot found" );
+		return;
+	}
+
+	size = TEST_HTTP_SIZE( file );
+	Q_snprintf( etag, sizeof( etag ), "\"x%d\"", file );
+
+	range = Q_stristr( request, "Range: bytes=" );
+	ifrange = Q_stristr( request, "If-Range: " );
+
+	// range is ignored if file has changed since
+	if( range && ( !ifrange || !Q_strncmp( ifrange + 10, etag, Q_strlen( etag ))))
+	{
+		offset = Q_atoi( range + 13 );
+		sv->ranges++;
+
+		out += Q_snprintf( out, 256, "HTTP/1.1 206 Partial Content\r\nETag: %s\r\nContent-Range: bytes %d-%d/%d\r\nContent-Length: %d\r\n\r\n",
+			etag, offset, size - 1, size, size - offset );
+	}
+	else if( range && file == TEST_HTTP_UNKNOWN )
+	{
+		// leftover without validator must not be continued
+		sv->ranges += 100;
+	}
+	else if( file == TEST_HTTP_CHUNKED )
+	{
+		out += Q_snprintf( out, 256, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n" );
+
+		for( i = 0; i < size; i += 1000 )
+		{
+			int j, len = Q_min( 1000, size - i );
+
+			out += Q_snprintf( out, 16, "%x\r\n", len );
+			for( j = 0; j < len; j++ )
+				*out++ = Test_HTTP_Byte( file, i + j );
+			*out++ = '\r';
+			*out++ = '\n';
+		}
+
+		out += Q_snprintf( out, 16, "0\r\n\r\n" );
+		cl->outlen = out - cl->out;
+		return;
+	}
+	else out += Q_snprintf( out, 256, "HTTP/1.1 200 OK\r\nETag: %s\r\nContent-Length: %d\r\n\r\n", etag, size );
+
+	// send half of the file and hang up
+	if( file == TEST_HTTP_DROPPED && !sv->dropped )
+	{
+		size /= 2;
+		cl->drop = true;
+		sv->dropped++;
+	}
+
+	for( i = offset; i < size; i++ )
+		*out++ = Test_HTTP_Byte( file, i );
+
+	cl->outlen = out - cl->out;
+}
+
+static void Test_HTTP_Serve( test_httpserver_t *sv )
+{
+	int i, s;
+
+	while(( s = accept( sv->listener, NULL, NULL )) >= 0 )
+	{
+		uint mode = 1;
+
+		for( i = 0; i < TEST_HTTP_CLIENTS; i++ )
+		{
+			if( sv->clients[i].socket == -1 )
+				break;
+		}
+
+		if( i == TEST_HTTP_CLIENTS )
+		{
+			closesocket( s );
+			continue;
+		}
+
+		ioctlsocket( s, FIONBIO, (void *)&mode );
+		memset( &sv->clients[i], 0, sizeof( sv->clients[i] ));
+		sv->clients[i].socket = s;
+		sv->accepted++;
+	}
+
+	for( i = 0; i < TEST_HTTP_CLIENTS; i++ )
+	{
+		test_httpclient_t *cl = &sv->clients[i];
+		char *p, *end;
+		int res, depth = 0;
+
+		if( cl->socket == -1 )
+			continue;
+
+		if( cl->outpos < cl->outlen && ( res = send( cl->socket, cl->out + cl->outpos, cl->outlen - cl->outpos, 0 )) > 0 )
+			cl->outpos += res;
+
+		if( cl->outpos < cl->outlen )
+			continue;
+
+		cl->outpos = cl->outlen = 0;
+
+		if( cl->drop )
+		{
+			closesocket( cl->socket );
+			cl->socket = -1;
+			continue;
+		}
+
+		res = recv( cl->socket, cl->in + cl->inlen, sizeof( cl->in ) - 1 - cl->inlen, 0 );
+
+		if( res == 0 )
+		{
+			closesocket( cl->socket );
+			cl->socket = -1;
+			continue;
+		}
+
+		if( res > 0 )
+			cl->inlen += res;
+
+		cl->in[cl->inlen] = 0;
+
+		for( p = cl->in; ( p = Q_strstr( p, "\r\n\r\n" )); p += 4 )
+			depth++;
+
+		sv->maxdepth = Q_max( sv->maxdepth, depth );
+
+		// answer one request at a time, so the rest stays in the socket
+		if(( end = Q_strstr( cl->in, "\r\n\r\n" )))
+		{
+			end += 4;
+			end[-1] = 0;
+			Test_HTTP_Respond( sv, cl, cl->in );
+			cl->inlen -= end - cl->in;
+			memmove( cl->in, end, cl->inlen );
+		}
+	}
+}
+
+static void Test_HTTP_Leftover( int file, qboolean valid, const char *validator )
+{
+	int len = TEST_HTTP_SIZE( file ) / 2, i;
+	byte *data = Z_Malloc( len );
+	string name;
+
+	for( i = 0; i < len; i++ )
+		data[i] = valid ? Test_HTTP_Byte( file, i ) : 0xaa;
+
+	Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "httptest/file%d.bin.incomplete", file );
+	FS_WriteFile( name, data, len );
+	Mem_Free( data );
+
+	if( validator )
+	{
+		Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "httptest/file%d.bin.incomplete.validator", file );
+		FS_WriteFile( name, validator, Q_strlen( validator ));
+	}
+}
+
+static void Test_HTTP_Download( void )
+{
+	test_httpserver_t *sv = Z_Calloc( sizeof( *sv ));
+	struct sockaddr_in addr = { 0 };
+	socklen_t addrlen = sizeof( addr );
+	string name;
+	double end;
+	uint mode = 1;
+	int i;
+
+	for( i = 0; i < TEST_HTTP_CLIENTS; i++ )
+		sv->clients[i].socket = -1;
+
+	sv->listener = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	TASSERT( sv->listener >= 0 );
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+	TASSERT( bind( sv->listener, (struct sockaddr *)&addr, sizeof( addr )) == 0 );
+	TASSERT( listen( sv->listener, TEST_HTTP_CLIENTS ) == 0 );
+	TASSERT( getsockname( sv->listener, (struct sockaddr *)&addr, &addrlen ) == 0 );
+	ioctlsocket( sv->listener, FIONBIO, (void *)&mode );
+
+	Q_snprintf( name, sizeof( name ), "http://127.0.0.1:%d/", ntohs( addr.sin_port ));
+	HTTP_AddCustomServer( name );
+
+	// tests run before NET_Init, so don't rely on resolver
+	memcpy( &http.first_server->addr, &addr, sizeof( addr ));
+	http.first_server->resolved = 1;
+
+	// leftovers of earlier session
+	Test_HTTP_Leftover( TEST_HTTP_RESUMED, true, "\"x1\"" );
+	Test_HTTP_Leftover( TEST_HTTP_STALE, false, "\"old\"" );
+	Test_HTTP_Leftover( TEST_HTTP_UNKNOWN, false, NULL );
+
+	for( i = 0; i < TEST_HTTP_FILES; i++ )
+	{
+		Q_snprintf( name, sizeof( name ), "httptest/file%d.bin", i );
+		HTTP_AddDownload( name, TEST_HTTP_SIZE( i ), false, NULL );
+	}
+
+	HTTP_AddDownload( "httptest/missing.bin", -1, false, NULL );
+
+	for( end = Sys_DoubleTime() + 10.0; http.first_file && Sys_DoubleTime() < end; )
+	{
+		HTTP_Run();
+		Test_HTTP_Serve( sv );
+	}
+
+	TASSERT( http.first_file == NULL );
+
+	for( i = 0; i < TEST_HTTP_FILES; i++ )
+	{
+		fs_offset_t len = 0;
+		byte *data;
+		int j;
+
+		Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "httptest/file%d.bin", i );
+		data = FS_LoadFile( name, &len, false ); // game isn't mounted yet
+
+		TASSERT( data != NULL );
+		TASSERT_EQi( (int)len, TEST_HTTP_SIZE( i ));
+
+		if( data )
+		{
+			for( j = 0; j < len && data[j] == Test_HTTP_Byte( i, j ); j++ );
+			TASSERT_EQi( j, (int)len );
+			Mem_Free( data );
+		}
+
+		FS_Delete( name );
+
+		Q_snprintf( name, sizeof( name ), DEFAULT_DOWNLOADED_DIRECTORY "httptest/file%d.bin.incomplete.validator", i );
+		TASSERT( !FS_FileExists( name, false ));
+	}
+
+	TASSERT( !FS_FileExists( DEFAULT_DOWNLOADED_DIRECTORY "httptest/missing.bin", false ));
+	TASSERT( !FS_FileExists( DEFAULT_DOWNLOADED_DIRECTORY "httptest/missing.bin.incomplete", false ));
+
+	// connections were reused, requests were pipelined, dropped file and
+	// validated leftover were resumed, other leftovers were downloaded again
+	TASSERT( sv->accepted < TEST_HTTP_FILES );
+	TASSERT( sv->maxdepth > 1 );
+	TASSERT_EQi( sv->dropped, 1 );
+	TASSERT_EQi( sv->ranges, 2 );
+	TASSERT_EQi( http.stat_completed, TEST_HTTP_FILES );
+
+	HTTP_Clear_f();
+	HTTP_ClearCustomServers();
+
+	for( i = 0; i < TEST_HTTP_CLIENTS; i++ )
+	{
+		if( sv->clients[i].socket != -1 )
+			closesocket( sv->clients[i].socket );
+	}
+
+	closesocket( sv->listener );
+	Mem_Free( sv );
+}
+
+void Test_RunHTTP( void )
+{
+#if !XASH_WIN32 && !XASH_NO_NETWORK // winsock isn't initialized that early
+	HTTP_Init(); // tests run before host registers it
+
+	TRUN( Test_HTTP_Download() );
+#endif
+}
+#endif // XASH_ENGINE_TESTS
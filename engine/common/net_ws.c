@@ -24,6 +24,13 @@ GNU General Public License for more details.
 #include <SDL_thread.h>
 #endif
 
+#if XASH_LINUX && !XASH_NO_NETWORK
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#define CAN_EPOLL_WAIT
+#endif
+
 #define NET_USE_FRAGMENTS
 
 #define MAX_LOOPBACK		4
@@ -103,6 +110,14 @@ typedef struct
 	qboolean		configured;
 	qboolean		allow_ip;
 	qboolean		allow_ip6;
+#ifdef CAN_EPOLL_WAIT
+	int		epoll_fd;			// server sockets and tick timer
+	int		timer_fd;
+	int		polled_sockets[2];		// server sockets currently added to epoll_fd
+	qboolean		waitset_ready;
+	qboolean		waitset_dirty;		// sockets were reopened
+	qboolean		waitset_failed;		// fall back to select
+#endif
 #if XASH_WIN32
 	WSADATA		winsockdata;
 #endif
@@ -1970,6 +1985,10 @@ void NET_Config( qboolean multiplayer, qboolean changeport )
 
 	NET_ClearLoopback ();
 
+#ifdef CAN_EPOLL_WAIT
+	net.waitset_dirty = true;
+#endif
+
 	net.configured = multiplayer ? true : false;
 }
 
@@ -1996,33 +2015,281 @@ qboolean NET_IsActive( void )
 }
 
 /*
+===============================================================================
+
+HOST WAITING
+
+Dedicated server sleeps between ticks until an absolute deadline or until
+one of the server sockets receives a packet. On Linux it's an epoll set with
+both server sockets and a timerfd armed to the deadline, so the wakeup
+doesn't depend on millisecond rounding. Elsewhere it's a select() with
+a microsecond timeout.
+
+===============================================================================
+*/
+#ifdef CAN_EPOLL_WAIT
+/*
+====================
+NET_ShutdownWaitSet
 ====================
-NET_Sleep
+*/
+static void NET_ShutdownWaitSet( void )
+{
+	if( !net.waitset_ready )
+		return;
 
-sleeps msec or until net socket is ready
+	close( net.timer_fd );
+	close( net.epoll_fd );
+	net.waitset_ready = false;
+}
+
+/*
+====================
+NET_InitWaitSet
 ====================
 */
-void NET_Sleep( int msec )
+static qboolean NET_InitWaitSet( void )
 {
-#ifndef XASH_NO_NETWORK
-	struct timeval	timeout;
-	fd_set		fdset;
-	int		i = 0;
+	struct epoll_event ev = { 0 };
+
+	if( net.waitset_ready )
+		return true;
+
+	if( net.waitset_failed )
+		return false;
+
+	net.epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+	if( net.epoll_fd < 0 )
+	{
+		Con_Reportf( S_WARN "%s: epoll_create1 failed: %s\n", __func__, strerror( errno ));
+		net.waitset_failed = true;
+		return false;
+	}
+
+	net.timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC );
+	if( net.timer_fd < 0 )
+	{
+		Con_Reportf( S_WARN "%s: timerfd_create failed: %s\n", __func__, strerror( errno ));
+		close( net.epoll_fd );
+		net.waitset_failed = true;
+		return false;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = net.timer_fd;
+	if( epoll_ctl( net.epoll_fd, EPOLL_CTL_ADD, net.timer_fd, &ev ) < 0 )
+	{
+		Con_Reportf( S_WARN "%s: can't watch timer: %s\n", __func__, strerror( errno ));
+		close( net.timer_fd );
+		close( net.epoll_fd );
+		net.waitset_failed = true;
+		return false;
+	}
 
-	if( !net.initialized || host.type == HOST_NORMAL )
-		return; // we're not a dedicated server, just run full speed
+	net.polled_sockets[0] = net.polled_sockets[1] = INVALID_SOCKET;
+	net.waitset_dirty = true;
+	net.waitset_ready = true;
+
+	return true;
+}
+
+/*
+====================
+NET_UpdateWaitSet
+
+keeps server sockets in epoll set in sync with reopened sockets
+====================
+*/
+static void NET_UpdateWaitSet( void )
+{
+	const int sockets[2] = { net.ip_sockets[NS_SERVER], net.ip6_sockets[NS_SERVER] };
+	int i;
+
+	if( !net.waitset_dirty )
+		return;
+
+	for( i = 0; i < 2; i++ )
+	{
+		struct epoll_event ev = { 0 };
+
+		// closed sockets are removed from the set by kernel, so errors are fine here
+		if( NET_IsSocketValid( net.polled_sockets[i] ))
+			epoll_ctl( net.epoll_fd, EPOLL_CTL_DEL, net.polled_sockets[i], &ev );
+
+		net.polled_sockets[i] = INVALID_SOCKET;
+
+		if( !NET_IsSocketValid( sockets[i] ))
+			continue;
+
+		ev.events = EPOLLIN;
+		ev.data.fd = sockets[i];
+		if( epoll_ctl( net.epoll_fd, EPOLL_CTL_ADD, sockets[i], &ev ) < 0 && errno != EEXIST )
+			continue;
+
+		net.polled_sockets[i] = sockets[i];
+	}
+
+	net.waitset_dirty = false;
+}
+
+/*
+====================
+NET_EpollWait
+====================
+*/
+static qboolean NET_EpollWait( double remaining )
+{
+	struct epoll_event events[3];
+	struct itimerspec its = { 0 };
+	struct timespec now;
+	qboolean packet = false;
+	uint64_t expirations;
+	int i, count;
+
+	NET_UpdateWaitSet();
+
+	// arm timer to an absolute point on monotonic clock
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	its.it_value.tv_sec = now.tv_sec + (time_t)remaining;
+	its.it_value.tv_nsec = now.tv_nsec + (long)(( remaining - (time_t)remaining ) * 1000000000.0 );
+	if( its.it_value.tv_nsec >= 1000000000 )
+	{
+		its.it_value.tv_sec++;
+		its.it_value.tv_nsec -= 1000000000;
+	}
+
+	if( timerfd_settime( net.timer_fd, TFD_TIMER_ABSTIME, &its, NULL ) < 0 )
+		return false;
+
+	count = epoll_wait( net.epoll_fd, events, sizeof( events ) / sizeof( events[0] ), -1 );
+
+	for( i = 0; i < count; i++ )
+	{
+		if( events[i].data.fd == net.timer_fd )
+		{
+			// drain expirations, so timer doesn't stay readable
+			if( read( net.timer_fd, &expirations, sizeof( expirations )) < 0 )
+				continue;
+		}
+		else packet = true;
+	}
+
+	// disarm timer if woken up by network
+	if( packet )
+	{
+		memset( &its, 0, sizeof( its ));
+		timerfd_settime( net.timer_fd, 0, &its, NULL );
+	}
+
+	return packet;
+}
+#endif // CAN_EPOLL_WAIT
+
+/*
+====================
+NET_SleepFor
+
+plain sleep with best available precision
+====================
+*/
+static void NET_SleepFor( double remaining )
+{
+#if !XASH_WIN32 && !XASH_NO_NETWORK
+	struct timeval timeout;
+
+	timeout.tv_sec = (long)remaining;
+	timeout.tv_usec = (long)(( remaining - timeout.tv_sec ) * 1000000.0 );
+	select( 0, NULL, NULL, NULL, &timeout );
+#else
+	Platform_Sleep( (int)( remaining * 1000.0 ));
+#endif
+}
+
+/*
+====================
+NET_SelectWait
+====================
+*/
+static qboolean NET_SelectWait( double remaining )
+{
+#ifndef XASH_NO_NETWORK
+	const int sockets[2] = { net.ip_sockets[NS_SERVER], net.ip6_sockets[NS_SERVER] };
+	struct timeval timeout;
+	fd_set fdset;
+	int i, maxfd = -1;
 
 	FD_ZERO( &fdset );
 
-	if( net.ip_sockets[NS_SERVER] != INVALID_SOCKET )
+	for( i = 0; i < 2; i++ )
 	{
-		FD_SET( net.ip_sockets[NS_SERVER], &fdset ); // network socket
-		i = net.ip_sockets[NS_SERVER];
+		if( !NET_IsSocketValid( sockets[i] ))
+			continue;
+
+		FD_SET( sockets[i], &fdset );
+		maxfd = Q_max( maxfd, sockets[i] );
 	}
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
-	select( i+1, &fdset, NULL, NULL, &timeout );
+	// winsock doesn't allow empty sets
+	if( maxfd < 0 )
+	{
+		NET_SleepFor( remaining );
+		return false;
+	}
+
+	timeout.tv_sec = (long)remaining;
+	timeout.tv_usec = (long)(( remaining - timeout.tv_sec ) * 1000000.0 );
+
+	return select( maxfd + 1, &fdset, NULL, NULL, &timeout ) > 0;
+#else
+	NET_SleepFor( remaining );
+	return false;
+#endif
+}
+
+/*
+====================
+NET_WaitUntil
+
+sleeps until deadline (in Sys_DoubleTime seconds) or, if wake_on_packet
+is set, until server socket is readable. Returns true if woken up by network
+====================
+*/
+qboolean NET_WaitUntil( double deadline, qboolean wake_on_packet )
+{
+	double remaining = deadline - Sys_DoubleTime();
+
+	if( remaining <= 0.0 )
+		return false;
+
+	if( !wake_on_packet || !net.initialized || !net.configured )
+	{
+		NET_SleepFor( remaining );
+		return false;
+	}
+
+#ifdef CAN_EPOLL_WAIT
+	if( NET_InitWaitSet( ))
+		return NET_EpollWait( remaining );
+#endif
+
+	return NET_SelectWait( remaining );
+}
+
+/*
+====================
+NET_WaitMethod
+====================
+*/
+const char *NET_WaitMethod( void )
+{
+#ifdef CAN_EPOLL_WAIT
+	if( !net.waitset_failed )
+		return "epoll + timerfd";
+#endif
+#ifndef XASH_NO_NETWORK
+	return "select";
+#else
+	return "sleep";
 #endif
 }
 
@@ -2142,6 +2409,10 @@ void NET_Shutdown( void )
 
 	NET_Config( false, false );
 
+#ifdef CAN_EPOLL_WAIT
+	NET_ShutdownWaitSet();
+#endif
+
 #ifdef CAN_ASYNC_NS_RESOLVE
 	NET_DeleteCriticalSections();
 #endif
@@ -57,7 +57,8 @@ extern convar_t net_recv_debug;
 
 void NET_Init( void );
 void NET_Shutdown( void );
-void NET_Sleep( int msec );
+qboolean NET_WaitUntil( double deadline, qboolean wake_on_packet );
+const char *NET_WaitMethod( void );
 qboolean NET_IsActive( void );
 qboolean NET_IsConfigured( void );
 void NET_Config( qboolean net_enable, qboolean changeport );
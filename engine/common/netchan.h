@@ -190,6 +190,7 @@ typedef struct fragbuf_s
 	char		filename[MAX_OSPATH];		// name of the file to save out on remote host
 	int		foffset;				// offset in file from which to read data
 	int		size;				// size of data to read at that offset
+	int		buffersize;			// allocated size of frag_message_buf, for reuse
 	byte frag_message_buf[]; // the actual data sits here (flexible)
 } fragbuf_t;
 
@@ -201,6 +202,20 @@ typedef struct fbufqueue_s
 	fragbuf_t		*fragbufs;	// the actual buffers
 } fragbufwaiting_t;
 
+// Incoming fragments of a stream are read straight into one buffer
+typedef struct fragassembly_s
+{
+	byte		*data;		// received fragments, in arrival order
+	int		maxsize;		// allocated size of data
+	int		size;		// bytes received so far
+	int		count;		// fragments in the message, 0 if nothing is pending
+	int		received;		// distinct fragments received so far
+	int		maxcount;		// allocated size of offsets and lengths
+	int		*offsets;		// offset in data of each fragment by id, -1 if not received
+	int		*lengths;		// length of each fragment by id
+	qboolean		inorder;		// all fragments arrived in order, data is contiguous
+} fragassembly_t;
+
 typedef enum fragsize_e
 {
 	FRAGSIZE_FRAG,
@@ -264,7 +279,10 @@ typedef struct netchan_s
 	int		frag_startpos[MAX_STREAMS];	// position in outgoing buffer where frag data starts
 	int		frag_length[MAX_STREAMS];	// length of frag data in the buffer
 
-	fragbuf_t		*incomingbufs[MAX_STREAMS];	// incoming fragments are stored here
+	fragbuf_t		*freefragbufs;		// outgoing fragment buffers kept for reuse
+	int		numfreefragbufs;
+
+	fragassembly_t	incoming[MAX_STREAMS];	// incoming fragments are stored here
 	qboolean		incomingready[MAX_STREAMS];	// set to true when incoming data is ready
 
 	// Only referenced by the FRAG_FILE_STREAM component
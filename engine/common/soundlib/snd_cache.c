@@ -0,0 +1,273 @@
+/*
+snd_cache.c - persistent decoded sound cache
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "soundlib.h"
+#include "xash3d_mathlib.h"
+#include "diskcache.h"
+
+/*
+=============================================================================
+
+	DECODED SOUND CACHE
+
+	keeps final PCM of compressed or resampled sounds, so next
+	load only reads and hashes the source file. entries are keyed
+	by source contents, not name. payload is fixed header + samples
+	aligned to DISKCACHE_ALIGN
+
+=============================================================================
+*/
+#define SNDCACHE_IDENT       (('C'<<24)+('N'<<16)+('S'<<8)+'X') // little-endian "XSNC"
+#define SNDCACHE_VERSION     1
+#define SNDCACHE_DIR         "sndcache"
+#define SNDCACHE_EXT         "xsc"
+
+typedef struct sndcache_header_s
+{
+	uint32_t rate;
+	uint32_t width;
+	uint32_t channels;
+	uint32_t loopStart;
+	uint32_t samples;
+	uint32_t type;
+	uint32_t flags;
+	uint32_t dataoffset; // from start of file
+	uint32_t datasize;
+} sndcache_header_t;
+
+static CVAR_DEFINE_AUTO( sound_cache, "0", FCVAR_ARCHIVE, "store decoded and resampled sounds on disk to skip decoding on next load" );
+static CVAR_DEFINE_AUTO( sound_cache_size, "128", FCVAR_ARCHIVE, "decoded sounds cache size limit, in megabytes" );
+
+static size_t Sound_CacheFileSize( const void *data );
+static void Sound_CacheWrite( file_t *f, const void *data );
+static size_t Sound_CacheRead( const byte *file, fs_offset_t filesize, void *out );
+
+static diskcache_t sndcache =
+{
+	"sound", SNDCACHE_DIR, SNDCACHE_EXT, SNDCACHE_IDENT, SNDCACHE_VERSION,
+	&sound_cache, &sound_cache_size, &host.soundpool,
+	{ Sound_CacheFileSize, Sound_CacheWrite, Sound_CacheRead },
+};
+
+/*
+=================
+Sound_CacheKey
+
+source data crc plus format and caller's processing rules,
+returns false if cache is disabled
+=================
+*/
+qboolean Sound_CacheKey( const char *ext, const byte *buffer, fs_offset_t filesize, uint32_t variant, uint32_t key[2] )
+{
+	if( !sound_cache.value || !buffer || filesize <= 0 )
+		return false;
+
+	CRC32_Init( &key[0] );
+	CRC32_ProcessBuffer( &key[0], buffer, filesize );
+	key[0] = CRC32_Final( key[0] );
+
+	CRC32_Init( &key[1] );
+	CRC32_ProcessBuffer( &key[1], &variant, sizeof( variant ));
+	CRC32_ProcessBuffer( &key[1], ext, Q_strlen( ext ));
+	key[1] = CRC32_Final( key[1] );
+
+	return true;
+}
+
+static void Sound_CacheFillHeader( sndcache_header_t *hdr, const wavdata_t *sc )
+{
+	memset( hdr, 0, sizeof( *hdr ));
+	hdr->rate = sc->rate;
+	hdr->width = sc->width;
+	hdr->channels = sc->channels;
+	hdr->loopStart = sc->loopStart;
+	hdr->samples = sc->samples;
+	hdr->type = sc->type;
+	hdr->flags = sc->flags;
+	hdr->dataoffset = DISKCACHE_PAD( sizeof( diskcache_header_t ) + sizeof( *hdr ));
+	hdr->datasize = sc->size;
+}
+
+static size_t Sound_CacheFileSize( const void *data )
+{
+	sndcache_header_t hdr;
+
+	Sound_CacheFillHeader( &hdr, data );
+
+	return hdr.dataoffset + hdr.datasize;
+}
+
+static void Sound_CacheWrite( file_t *f, const void *data )
+{
+	const wavdata_t *sc = data;
+	sndcache_header_t hdr;
+
+	Sound_CacheFillHeader( &hdr, sc );
+
+	DiskCache_WriteAligned( f, &hdr, sizeof( hdr ));
+	FS_Write( f, sc->buffer, hdr.datasize );
+}
+
+static size_t Sound_CacheRead( const byte *file, fs_offset_t filesize, void *out )
+{
+	const sndcache_header_t *hdr = (const sndcache_header_t *)( file + sizeof( diskcache_header_t ));
+	wavdata_t *sc;
+
+	if( filesize < sizeof( diskcache_header_t ) + sizeof( *hdr ) || !hdr->datasize
+		|| hdr->width < 1 || hdr->width > 2 || hdr->channels < 1 || hdr->channels > 2
+		|| hdr->datasize != hdr->samples * hdr->width * hdr->channels
+		|| (fs_offset_t)hdr->dataoffset + hdr->datasize > filesize )
+		return 0;
+
+	sc = Mem_Malloc( host.soundpool, sizeof( *sc ) + hdr->datasize );
+	sc->size = hdr->datasize;
+	sc->loopStart = hdr->loopStart;
+	sc->samples = hdr->samples;
+	sc->type = hdr->type;
+	sc->flags = hdr->flags;
+	sc->rate = hdr->rate;
+	sc->width = hdr->width;
+	sc->channels = hdr->channels;
+	memcpy( sc->buffer, file + hdr->dataoffset, hdr->datasize );
+	*(wavdata_t **)out = sc;
+
+	return sc->size;
+}
+
+/*
+=================
+Sound_CacheLoad
+
+returns sound that can be released with FS_FreeSound
+=================
+*/
+wavdata_t *Sound_CacheLoad( const uint32_t key[2] )
+{
+	wavdata_t *sc = NULL;
+
+	if( !DiskCache_Load( &sndcache, key, &sc ))
+		return NULL;
+
+	return sc;
+}
+
+/*
+=================
+Sound_CacheStore
+
+save freshly decoded sound
+=================
+*/
+void Sound_CacheStore( const uint32_t key[2], const wavdata_t *sc )
+{
+	if( !sc || !sc->size )
+		return;
+
+	DiskCache_Store( &sndcache, key, sc );
+}
+
+static void Sound_CacheInfo_f( void )
+{
+	DiskCache_Info( &sndcache );
+}
+
+static void Sound_CacheFlush_f( void )
+{
+	DiskCache_Flush( &sndcache );
+}
+
+void Sound_CacheInit( void )
+{
+	Cvar_RegisterVariable( &sound_cache );
+	Cvar_RegisterVariable( &sound_cache_size );
+	Cmd_AddCommand( "soundcache_info", Sound_CacheInfo_f, "print decoded sounds cache statistics" );
+	Cmd_AddRestrictedCommand( "soundcache_flush", Sound_CacheFlush_f, "remove all decoded sounds cache entries" );
+}
+
+void Sound_CacheShutdown( void )
+{
+	DiskCache_Shutdown( &sndcache );
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+void Test_RunSoundCache( void )
+{
+	const byte source[] = "not really an ogg file, only hashed";
+	diskcache_test_t test;
+	wavdata_t *sc, *load;
+	uint32_t key[2], key2[2];
+	uint i, hits, stores;
+
+	DiskCache_BeginTest( &sndcache, &test );
+
+	sc = Mem_Calloc( host.soundpool, sizeof( *sc ) + 8192 );
+	sc->rate = 22050;
+	sc->width = 2;
+	sc->channels = 2;
+	sc->samples = 2048;
+	sc->size = 8192;
+	sc->flags = SOUND_LOOPED;
+	sc->loopStart = 100;
+
+	for( i = 0; i < sc->size; i++ )
+		sc->buffer[i] = (byte)( i * 13 + ( i >> 7 ));
+
+	TASSERT( !Sound_CacheKey( "ogg", source, sizeof( source ), 1, key ));
+
+	Cvar_DirectSet( &sound_cache, "1" );
+	stores = sndcache.stores;
+	hits = sndcache.hits;
+
+	TASSERT( Sound_CacheKey( "ogg", source, sizeof( source ), 1, key ));
+
+	// processing rules are part of the key
+	TASSERT( Sound_CacheKey( "ogg", source, sizeof( source ), 2, key2 ));
+	TASSERT( key[0] == key2[0] && key[1] != key2[1] );
+
+	TASSERT( Sound_CacheLoad( key ) == NULL );
+
+	Sound_CacheStore( key, sc );
+	TASSERT_EQi( sndcache.stores, stores + 1 );
+
+	load = Sound_CacheLoad( key );
+	TASSERT( load != NULL );
+	TASSERT_EQi( sndcache.hits, hits + 1 );
+	TASSERT( Sound_CacheLoad( key2 ) == NULL );
+
+	if( load )
+	{
+		TASSERT_EQi( load->rate, sc->rate );
+		TASSERT_EQi( load->width, sc->width );
+		TASSERT_EQi( load->channels, sc->channels );
+		TASSERT_EQi( load->samples, sc->samples );
+		TASSERT_EQi( load->flags, sc->flags );
+		TASSERT_EQi( load->loopStart, sc->loopStart );
+		TASSERT_EQi( (int)load->size, (int)sc->size );
+		TASSERT( memcmp( load->buffer, sc->buffer, sc->size ) == 0 );
+		FS_FreeSound( load );
+	}
+
+	// new limit must be respected
+	Cvar_DirectSet( &sound_cache_size, "0" );
+	DiskCache_Evict( &sndcache, 0 );
+	TASSERT_EQi( sndcache.numentries, 0 );
+
+	Mem_Free( sc );
+
+	DiskCache_EndTest( &sndcache, &test );
+}
+#endif /* XASH_ENGINE_TESTS */
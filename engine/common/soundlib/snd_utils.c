@@ -85,6 +85,7 @@ void Sound_Init( void )
 
 void Sound_Shutdown( void )
 {
+	Sound_CacheShutdown();
 	Mem_Check(); // check for leaks
 	Mem_FreePool( &host.soundpool );
 }
@@ -146,4 +146,9 @@ int Stream_SetPosOggOpus( stream_t *stream, int newpos );
 int Stream_GetPosOggOpus( stream_t *stream );
 void Stream_FreeOggOpus( stream_t *stream );
 
+//
+// snd_cache.c
+//
+void Sound_CacheShutdown( void );
+
 #endif//SOUNDLIB_H
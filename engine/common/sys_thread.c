@@ -0,0 +1,378 @@
+/*
+sys_thread.c - threads and synchronization primitives
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include <stdlib.h>
+
+/*
+===============================================================================
+
+	THREADS
+
+	Thin wrappers around SDL2, Win32 or POSIX threads for engine subsystems
+	that run work in background. Objects are allocated from the C heap, so
+	they can be created and released regardless of zone allocator state.
+
+===============================================================================
+*/
+#if XASH_THREADS
+#if XASH_SDL == 2
+#include <SDL.h>
+typedef SDL_mutex *native_mutex_t;
+typedef SDL_cond *native_cond_t;
+typedef SDL_Thread *native_thread_t;
+typedef SDL_threadID native_threadid_t;
+#elif XASH_WIN32
+typedef CRITICAL_SECTION native_mutex_t;
+typedef CONDITION_VARIABLE native_cond_t;
+typedef HANDLE native_thread_t;
+typedef DWORD native_threadid_t;
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_mutex_t native_mutex_t;
+typedef pthread_cond_t native_cond_t;
+typedef pthread_t native_thread_t;
+typedef pthread_t native_threadid_t;
+#endif
+
+struct sys_mutex_s
+{
+	native_mutex_t handle;
+};
+
+struct sys_cond_s
+{
+	native_cond_t handle;
+};
+
+struct sys_thread_s
+{
+	native_thread_t handle;
+	pfnThreadFunc   func;
+	void            *arg;
+};
+
+static native_threadid_t main_thread;
+
+/*
+=================
+Sys_ThreadStart
+=================
+*/
+#if XASH_SDL == 2
+static int Sys_ThreadStart( void *data )
+{
+	sys_thread_t *thread = data;
+
+	thread->func( thread->arg );
+	return 0;
+}
+#elif XASH_WIN32
+static DWORD WINAPI Sys_ThreadStart( LPVOID data )
+{
+	sys_thread_t *thread = data;
+
+	thread->func( thread->arg );
+	return 0;
+}
+#else
+static void *Sys_ThreadStart( void *data )
+{
+	sys_thread_t *thread = data;
+
+	thread->func( thread->arg );
+	return NULL;
+}
+#endif
+
+/*
+=================
+Sys_CreateMutex
+
+SDL mutexes and critical sections are always recursive,
+for pthreads it must be requested explicitly
+=================
+*/
+sys_mutex_t *Sys_CreateMutex( qboolean recursive )
+{
+	sys_mutex_t *mutex = calloc( 1, sizeof( *mutex ));
+
+	if( !mutex )
+		return NULL;
+
+#if XASH_SDL == 2
+	if( !( mutex->handle = SDL_CreateMutex( )))
+	{
+		free( mutex );
+		return NULL;
+	}
+#elif XASH_WIN32
+	InitializeCriticalSection( &mutex->handle );
+#else
+	{
+		pthread_mutexattr_t attr;
+		int err;
+
+		pthread_mutexattr_init( &attr );
+		if( recursive )
+			pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+		err = pthread_mutex_init( &mutex->handle, &attr );
+		pthread_mutexattr_destroy( &attr );
+
+		if( err )
+		{
+			free( mutex );
+			return NULL;
+		}
+	}
+#endif
+
+	return mutex;
+}
+
+void Sys_DestroyMutex( sys_mutex_t *mutex )
+{
+	if( !mutex )
+		return;
+
+#if XASH_SDL == 2
+	SDL_DestroyMutex( mutex->handle );
+#elif XASH_WIN32
+	DeleteCriticalSection( &mutex->handle );
+#else
+	pthread_mutex_destroy( &mutex->handle );
+#endif
+
+	free( mutex );
+}
+
+void Sys_LockMutex( sys_mutex_t *mutex )
+{
+#if XASH_SDL == 2
+	SDL_LockMutex( mutex->handle );
+#elif XASH_WIN32
+	EnterCriticalSection( &mutex->handle );
+#else
+	pthread_mutex_lock( &mutex->handle );
+#endif
+}
+
+void Sys_UnlockMutex( sys_mutex_t *mutex )
+{
+#if XASH_SDL == 2
+	SDL_UnlockMutex( mutex->handle );
+#elif XASH_WIN32
+	LeaveCriticalSection( &mutex->handle );
+#else
+	pthread_mutex_unlock( &mutex->handle );
+#endif
+}
+
+/*
+=================
+Sys_CreateCond
+=================
+*/
+sys_cond_t *Sys_CreateCond( void )
+{
+	sys_cond_t *cond = calloc( 1, sizeof( *cond ));
+
+	if( !cond )
+		return NULL;
+
+#if XASH_SDL == 2
+	if( !( cond->handle = SDL_CreateCond( )))
+	{
+		free( cond );
+		return NULL;
+	}
+#elif XASH_WIN32
+	InitializeConditionVariable( &cond->handle );
+#else
+	if( pthread_cond_init( &cond->handle, NULL ))
+	{
+		free( cond );
+		return NULL;
+	}
+#endif
+
+	return cond;
+}
+
+void Sys_DestroyCond( sys_cond_t *cond )
+{
+	if( !cond )
+		return;
+
+#if XASH_SDL == 2
+	SDL_DestroyCond( cond->handle );
+#elif !XASH_WIN32 // condition variables don't need to be released on Win32
+	pthread_cond_destroy( &cond->handle );
+#endif
+
+	free( cond );
+}
+
+/*
+=================
+Sys_WaitCond
+
+mutex must be locked exactly once by the calling thread
+=================
+*/
+void Sys_WaitCond( sys_cond_t *cond, sys_mutex_t *mutex )
+{
+#if XASH_SDL == 2
+	SDL_CondWait( cond->handle, mutex->handle );
+#elif XASH_WIN32
+	SleepConditionVariableCS( &cond->handle, &mutex->handle, INFINITE );
+#else
+	pthread_cond_wait( &cond->handle, &mutex->handle );
+#endif
+}
+
+void Sys_BroadcastCond( sys_cond_t *cond )
+{
+#if XASH_SDL == 2
+	SDL_CondBroadcast( cond->handle );
+#elif XASH_WIN32
+	WakeAllConditionVariable( &cond->handle );
+#else
+	pthread_cond_broadcast( &cond->handle );
+#endif
+}
+
+/*
+=================
+Sys_CreateThread
+
+name is only used for debugging where platform supports it
+=================
+*/
+sys_thread_t *Sys_CreateThread( const char *name, pfnThreadFunc func, void *arg )
+{
+	sys_thread_t *thread = calloc( 1, sizeof( *thread ));
+
+	if( !thread )
+		return NULL;
+
+	thread->func = func;
+	thread->arg = arg;
+
+#if XASH_SDL == 2
+	thread->handle = SDL_CreateThread( Sys_ThreadStart, name, thread );
+	if( !thread->handle )
+#elif XASH_WIN32
+	thread->handle = CreateThread( NULL, 0, Sys_ThreadStart, thread, 0, NULL );
+	if( !thread->handle )
+#else
+	if( pthread_create( &thread->handle, NULL, Sys_ThreadStart, thread ))
+#endif
+	{
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+=================
+Sys_JoinThread
+
+waits for thread function to return and releases the thread
+=================
+*/
+void Sys_JoinThread( sys_thread_t *thread )
+{
+	if( !thread )
+		return;
+
+#if XASH_SDL == 2
+	SDL_WaitThread( thread->handle, NULL );
+#elif XASH_WIN32
+	WaitForSingleObject( thread->handle, INFINITE );
+	CloseHandle( thread->handle );
+#else
+	pthread_join( thread->handle, NULL );
+#endif
+
+	free( thread );
+}
+
+/*
+=================
+Sys_CPUCount
+=================
+*/
+int Sys_CPUCount( void )
+{
+	int count = 1;
+
+#if XASH_SDL == 2
+	count = SDL_GetCPUCount( );
+#elif XASH_WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	count = info.dwNumberOfProcessors;
+#elif defined( _SC_NPROCESSORS_ONLN )
+	count = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+
+	return count > 0 ? count : 1;
+}
+#endif // XASH_THREADS
+
+/*
+=================
+Sys_InitThreads
+
+remembers the calling thread as main
+=================
+*/
+void Sys_InitThreads( void )
+{
+#if XASH_THREADS
+#if XASH_SDL == 2
+	main_thread = SDL_ThreadID( );
+#elif XASH_WIN32
+	main_thread = GetCurrentThreadId( );
+#else
+	main_thread = pthread_self( );
+#endif
+#endif // XASH_THREADS
+}
+
+/*
+=================
+Sys_IsMainThread
+=================
+*/
+qboolean Sys_IsMainThread( void )
+{
+#if XASH_THREADS
+#if XASH_SDL == 2
+	return SDL_ThreadID( ) == main_thread;
+#elif XASH_WIN32
+	return GetCurrentThreadId( ) == main_thread;
+#else
+	return pthread_equal( pthread_self( ), main_thread ) != 0;
+#endif
+#else
+	return true;
+#endif // XASH_THREADS
+}
@@ -79,6 +79,36 @@ void Sys_InitLog( void );
 void Sys_PrintLog( const char *pMsg );
 int Sys_LogFileNo( void );
 
+//
+// sys_thread.c
+//
+#if !XASH_EMSCRIPTEN && !XASH_DOS4GW && !defined XASH_NO_THREADS
+#define XASH_THREADS 1
+#else
+#define XASH_THREADS 0
+#endif
+
+typedef struct sys_mutex_s sys_mutex_t;
+typedef struct sys_cond_s sys_cond_t;
+typedef struct sys_thread_s sys_thread_t;
+typedef void (*pfnThreadFunc)( void *arg );
+
+void Sys_InitThreads( void );
+qboolean Sys_IsMainThread( void );
+#if XASH_THREADS
+sys_mutex_t *Sys_CreateMutex( qboolean recursive );
+void Sys_DestroyMutex( sys_mutex_t *mutex );
+void Sys_LockMutex( sys_mutex_t *mutex );
+void Sys_UnlockMutex( sys_mutex_t *mutex );
+sys_cond_t *Sys_CreateCond( void );
+void Sys_DestroyCond( sys_cond_t *cond );
+void Sys_WaitCond( sys_cond_t *cond, sys_mutex_t *mutex );
+void Sys_BroadcastCond( sys_cond_t *cond );
+sys_thread_t *Sys_CreateThread( const char *name, pfnThreadFunc func, void *arg );
+void Sys_JoinThread( sys_thread_t *thread );
+int Sys_CPUCount( void );
+#endif // XASH_THREADS
+
 // text messages
 #define Msg	Con_Printf
 
@@ -31,17 +31,27 @@ extern struct tests_stats_s tests_stats;
 	_TASSERT( Q_strcmp(( str1 ), ( str2 )), Msg( S_ERROR "assert failed at %s:%i, \"%s\" != \"%s\"\n", __FILE__, __LINE__, ( str1 ), ( str2 )))
 
 void Test_RunImagelib( void );
+void Test_RunImageCache( void );
+void Test_RunSoundCache( void );
 void Test_RunLibCommon( void );
 void Test_RunCommon( void );
 void Test_RunCmd( void );
 void Test_RunCvar( void );
 void Test_RunCon( void );
 void Test_RunVOX( void );
+void Test_RunMixer( void );
 void Test_RunIPFilter( void );
+void Test_RunStr64( void );
 void Test_RunGamma( void );
 void Test_RunDelta( void );
 void Test_RunBuffer( void );
 void Test_RunMunge( void );
+void Test_RunJobs( void );
+void Test_RunZone( void );
+void Test_RunNetchan( void );
+void Test_RunHTTP( void );
+void Test_RunSaveWriter( void );
+void Test_RunSaveTables( void );
 
 #define TEST_LIST_0 \
 	Test_RunLibCommon(); \
@@ -51,17 +61,27 @@ void Test_RunMunge( void );
 	Test_RunIPFilter(); \
 	Test_RunBuffer(); \
 	Test_RunDelta(); \
-	Test_RunMunge();
+	Test_RunMunge(); \
+	Test_RunJobs(); \
+	Test_RunZone(); \
+	Test_RunNetchan(); \
+	Test_RunSaveTables();
 
 #define TEST_LIST_0_CLIENT \
 	Test_RunCon(); \
 	Test_RunGamma();
 
 #define TEST_LIST_1 \
-	Test_RunImagelib();
+	Test_RunImagelib(); \
+	Test_RunImageCache(); \
+	Test_RunSoundCache(); \
+	Test_RunHTTP(); \
+	Test_RunSaveWriter(); \
+	Test_RunStr64();
 
 #define TEST_LIST_1_CLIENT \
-	Test_RunVOX();
+	Test_RunVOX(); \
+	Test_RunMixer();
 
 #endif
 
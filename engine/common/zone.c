@@ -17,10 +17,19 @@ GNU General Public License for more details.
 */
 
 #include "common.h"
+#include "xash3d_mathlib.h"
 
 #define MEMHEADER_SENTINEL1	0xA1BAU
 #define MEMHEADER_SENTINEL2	0xDFU
 
+#define MEMSLAB_CLASSES	11
+#define MEMSLAB_MAXSIZE	1024	// larger allocations in slab pools go to malloc
+#define MEMSLAB_SIZE	( 64 * 1024 )
+#define MEMARENA_SIZE	( 256 * 1024 )
+#define MEMBLOCK_ALIGN	16
+
+#define MEMBLOCK_PAD( x ) ((( x ) + MEMBLOCK_ALIGN - 1 ) & ~( MEMBLOCK_ALIGN - 1 ))
+
 #ifdef XASH_CUSTOM_SWAP
 #include "platform/swap/swap.h"
 #define Q_malloc SWAP_Malloc
@@ -65,6 +74,32 @@ typedef struct memheader_s
 	// immediately followed by data, which is followed by a MEMHEADER_SENTINEL2 byte
 } memheader_t;
 
+// slab is a malloc'd block of equally sized slots, each one is
+// memheader + data + sentinel, so slab allocations look like any other
+typedef struct memslab_s
+{
+	struct memslab_s *next;
+} memslab_t;
+
+typedef struct memclass_s
+{
+	memheader_t *freelist;  // free slots, linked through memheader->next
+	memslab_t   *slabs;
+	size_t      numslabs;
+	size_t      numslots;
+	size_t      used;       // slots in use
+	size_t      requested;  // sum of sizes of allocations in use
+} memclass_t;
+
+// arena chunks are linked in allocation order, reset rewinds them all
+typedef struct memarena_s
+{
+	struct memarena_s *next;
+	size_t            size;
+	size_t            used;
+	// immediately followed by data
+} memarena_t;
+
 typedef struct mempool_s
 {
 	struct memheader_s *chain;        // chain of individual memory allocations
@@ -73,9 +108,19 @@ typedef struct mempool_s
 	size_t             lastchecksize; // updated each time the pool is displayed by memlist
 	const char         *filename;     // file name and line where Mem_AllocPool was called
 	int                fileline;
+	int                flags;         // MEMPOOL_ flags
+	memclass_t         classes[MEMSLAB_CLASSES]; // MEMPOOL_SLAB
+	memarena_t         *arena;        // MEMPOOL_ARENA
+	memarena_t         *arenacur;
+	size_t             arenapeak;
 	char               name[64];      // name of the pool
 } mempool_t;
 
+static const size_t mem_classsize[MEMSLAB_CLASSES] =
+{
+	16, 32, 64, 96, 128, 192, 256, 384, 512, 768, MEMSLAB_MAXSIZE
+};
+
 static mempool_t *poolchain = NULL; // critical stuff
 static size_t poolcount = 0;
 
@@ -168,6 +213,257 @@ static qboolean Mem_CheckAllocHeader( const char *func, const memheader_t *mem,
 	return true;
 }
 
+/*
+=============================================================================
+
+SLAB AND ARENA BACKENDS
+
+MEMPOOL_SLAB pools take allocations up to MEMSLAB_MAXSIZE from per size class
+free lists, refilled a slab at a time, larger ones still go to malloc.
+Which backend owns a block is decided by its pool and size, so blocks never
+change backend in place and are copied when they have to.
+
+MEMPOOL_ARENA pools bump allocate from big chunks. Blocks aren't linked into
+pool chain, freeing gives memory back only for the most recent allocation,
+everything else is reclaimed at once by Mem_EmptyPool, which keeps chunks.
+
+=============================================================================
+*/
+#define Mem_ArenaData( chunk ) ((byte *)( chunk ) + MEMBLOCK_PAD( sizeof( memarena_t )))
+
+static inline size_t Mem_SlotSize( size_t size )
+{
+	return MEMBLOCK_PAD( sizeof( memheader_t ) + size + sizeof( byte ));
+}
+
+static inline int Mem_BlockClass( const mempool_t *pool, size_t size )
+{
+	int i;
+
+	if( !FBitSet( pool->flags, MEMPOOL_SLAB ) || size > MEMSLAB_MAXSIZE )
+		return -1;
+
+	for( i = 0; size > mem_classsize[i]; i++ );
+
+	return i;
+}
+
+static qboolean Mem_AddSlab( mempool_t *pool, int cls )
+{
+	memclass_t *c = &pool->classes[cls];
+	size_t slotsize = Mem_SlotSize( mem_classsize[cls] );
+	size_t i, count = ( MEMSLAB_SIZE - MEMBLOCK_PAD( sizeof( memslab_t ))) / slotsize;
+	memslab_t *slab;
+	byte *slot;
+
+	slab = (memslab_t *)Q_malloc( MEMSLAB_SIZE );
+	if( !slab )
+		return false;
+
+	slab->next = c->slabs;
+	c->slabs = slab;
+	c->numslabs++;
+	c->numslots += count;
+	pool->realsize += MEMSLAB_SIZE;
+
+	// push in reverse, so slots are handed out in address order
+	slot = (byte *)slab + MEMBLOCK_PAD( sizeof( memslab_t )) + slotsize * count;
+
+	for( i = 0; i < count; i++ )
+	{
+		memheader_t *mem;
+
+		slot -= slotsize;
+		mem = (memheader_t *)slot;
+		mem->sentinel1 = 0;
+		mem->next = c->freelist;
+		c->freelist = mem;
+	}
+
+	return true;
+}
+
+static memheader_t *Mem_SlabAlloc( mempool_t *pool, int cls, size_t size )
+{
+	memclass_t *c = &pool->classes[cls];
+	memheader_t *mem;
+
+	if( !c->freelist && !Mem_AddSlab( pool, cls ))
+		return NULL;
+
+	mem = c->freelist;
+	c->freelist = mem->next;
+	c->used++;
+	c->requested += size;
+
+	return mem;
+}
+
+static void Mem_SlabFree( mempool_t *pool, int cls, memheader_t *mem )
+{
+	memclass_t *c = &pool->classes[cls];
+
+	c->used--;
+	c->requested -= mem->size;
+	mem->sentinel1 = 0; // catch double free
+	mem->next = c->freelist;
+	c->freelist = mem;
+}
+
+static void Mem_FreeSlabs( mempool_t *pool )
+{
+	int i;
+
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+	{
+		memclass_t *c = &pool->classes[i];
+
+		while( c->slabs )
+		{
+			memslab_t *next = c->slabs->next;
+
+			Q_free( c->slabs );
+			pool->realsize -= MEMSLAB_SIZE;
+			c->slabs = next;
+		}
+
+		memset( c, 0, sizeof( *c ));
+	}
+}
+
+static memheader_t *Mem_ArenaAlloc( mempool_t *pool, size_t size )
+{
+	size_t slotsize = Mem_SlotSize( size );
+	memarena_t *chunk = pool->arenacur;
+	memheader_t *mem;
+
+	// space left in skipped chunks is wasted until reset
+	while( chunk && chunk->size - chunk->used < slotsize )
+		chunk = chunk->next;
+
+	if( !chunk )
+	{
+		size_t chunksize = Q_max( MEMARENA_SIZE, slotsize );
+		memarena_t *tail;
+
+		chunk = (memarena_t *)Q_malloc( MEMBLOCK_PAD( sizeof( memarena_t )) + chunksize );
+		if( !chunk )
+			return NULL;
+
+		chunk->next = NULL;
+		chunk->size = chunksize;
+		chunk->used = 0;
+		pool->realsize += MEMBLOCK_PAD( sizeof( memarena_t )) + chunksize;
+
+		if( pool->arenacur )
+		{
+			for( tail = pool->arenacur; tail->next; tail = tail->next );
+			tail->next = chunk;
+		}
+		else pool->arena = chunk;
+	}
+
+	pool->arenacur = chunk;
+	mem = (memheader_t *)( Mem_ArenaData( chunk ) + chunk->used );
+	chunk->used += slotsize;
+
+	return mem;
+}
+
+static inline qboolean Mem_ArenaIsTop( const mempool_t *pool, const memheader_t *mem )
+{
+	const memarena_t *chunk = pool->arenacur;
+
+	return chunk && (const byte *)mem + Mem_SlotSize( mem->size ) == Mem_ArenaData( chunk ) + chunk->used;
+}
+
+static size_t Mem_ArenaUsed( const mempool_t *pool )
+{
+	const memarena_t *chunk;
+	size_t used = 0;
+
+	for( chunk = pool->arena; chunk; chunk = chunk->next )
+		used += chunk->used;
+
+	return used;
+}
+
+static void Mem_ArenaFree( mempool_t *pool, memheader_t *mem )
+{
+	if( Mem_ArenaIsTop( pool, mem ))
+		pool->arenacur->used -= Mem_SlotSize( mem->size );
+
+	mem->sentinel1 = 0; // catch double free
+}
+
+static void Mem_ArenaReset( mempool_t *pool )
+{
+	memarena_t *chunk;
+
+	pool->arenapeak = Q_max( pool->arenapeak, Mem_ArenaUsed( pool ));
+
+	for( chunk = pool->arena; chunk; chunk = chunk->next )
+		chunk->used = 0;
+
+	pool->arenacur = pool->arena;
+	pool->totalsize = 0;
+}
+
+static void Mem_FreeArena( mempool_t *pool )
+{
+	while( pool->arena )
+	{
+		memarena_t *next = pool->arena->next;
+
+		pool->realsize -= MEMBLOCK_PAD( sizeof( memarena_t )) + pool->arena->size;
+		Q_free( pool->arena );
+		pool->arena = next;
+	}
+
+	pool->arenacur = NULL;
+}
+
+static memheader_t *Mem_NewBlock( mempool_t *pool, size_t size )
+{
+	memheader_t *mem;
+	int cls;
+
+	if( FBitSet( pool->flags, MEMPOOL_ARENA ))
+		mem = Mem_ArenaAlloc( pool, size );
+	else if(( cls = Mem_BlockClass( pool, size )) >= 0 )
+		mem = Mem_SlabAlloc( pool, cls, size );
+	else
+	{
+		mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( byte ));
+		if( mem ) Mem_PoolAdd( pool, size );
+		return mem;
+	}
+
+	if( mem ) pool->totalsize += size;
+	return mem;
+}
+
+static void Mem_ReleaseBlock( mempool_t *pool, memheader_t *mem )
+{
+	int cls;
+
+	if( FBitSet( pool->flags, MEMPOOL_ARENA ))
+	{
+		pool->totalsize -= mem->size;
+		Mem_ArenaFree( pool, mem );
+	}
+	else if(( cls = Mem_BlockClass( pool, mem->size )) >= 0 )
+	{
+		pool->totalsize -= mem->size;
+		Mem_SlabFree( pool, cls, mem );
+	}
+	else
+	{
+		Mem_PoolSubtract( pool, mem->size );
+		Q_free( mem );
+	}
+}
+
 void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char *filename, int fileline )
 {
 	memheader_t *mem;
@@ -186,7 +482,7 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 	if( !pool )
 		return NULL;
 
-	mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( byte ));
+	mem = Mem_NewBlock( pool, size );
 	if( mem == NULL )
 	{
 		Sys_Error( "%s: out of memory (alloc size %s at %s:%i)\n", __func__, Q_memprint( size ), filename, fileline );
@@ -195,8 +491,12 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 
 	Mem_InitAlloc( mem, size, filename, fileline );
 
-	Mem_PoolAdd( pool, size );
-	Mem_PoolLinkAlloc( pool, mem );
+	if( FBitSet( pool->flags, MEMPOOL_ARENA ))
+	{
+		mem->next = mem->prev = NULL;
+		mem->poolptr = poolptr;
+	}
+	else Mem_PoolLinkAlloc( pool, mem );
 
 	if( clear )
 		memset((void *)((byte *)mem + sizeof( memheader_t )), 0, mem->size );
@@ -215,6 +515,13 @@ static void Mem_FreeBlock( memheader_t *mem, const char *filename, int fileline
 	if( !pool )
 		return;
 
+	// arena blocks aren't linked
+	if( FBitSet( pool->flags, MEMPOOL_ARENA ))
+	{
+		Mem_ReleaseBlock( pool, mem );
+		return;
+	}
+
 	// unlink memheader from doubly linked list
 	if(( mem->prev ? mem->prev->next != mem : pool->chain != mem ) || ( mem->next && mem->next->prev != mem ))
 	{
@@ -222,10 +529,8 @@ static void Mem_FreeBlock( memheader_t *mem, const char *filename, int fileline
 		return;
 	}
 
-	Mem_PoolSubtract( pool, mem->size );
 	Mem_PoolUnlinkAlloc( pool, mem );
-
-	Q_free( mem );
+	Mem_ReleaseBlock( pool, mem );
 }
 
 void _Mem_Free( void *data, const char *filename, int fileline )
@@ -251,6 +556,66 @@ static void Mem_MigratePool( poolhandle_t newpoolptr, memheader_t *mem, const ch
 	Mem_PoolAdd( newpool, mem->size );
 }
 
+/*
+=================
+Mem_ReallocBackend
+
+realloc for blocks that come from or go to slab and arena pools
+=================
+*/
+static void *Mem_ReallocBackend( poolhandle_t poolptr, memheader_t *mem, size_t size, qboolean clear, const char *filename, int fileline )
+{
+	mempool_t *pool = Mem_FindPool( poolptr );
+	size_t oldsize = mem->size;
+	void *data = (byte *)mem + sizeof( memheader_t );
+	void *newdata;
+
+	if( mem->poolptr == poolptr )
+	{
+		qboolean inplace = false;
+		int cls = Mem_BlockClass( pool, oldsize );
+
+		if( cls >= 0 && cls == Mem_BlockClass( pool, size ))
+		{
+			// still fits into the same slot
+			pool->classes[cls].requested += size - oldsize;
+			inplace = true;
+		}
+		else if( FBitSet( pool->flags, MEMPOOL_ARENA ) && Mem_ArenaIsTop( pool, mem ))
+		{
+			memarena_t *chunk = pool->arenacur;
+			size_t avail = chunk->size - chunk->used + Mem_SlotSize( oldsize );
+
+			if( Mem_SlotSize( size ) <= avail )
+			{
+				chunk->used += Mem_SlotSize( size ) - Mem_SlotSize( oldsize );
+				inplace = true;
+			}
+		}
+
+		if( inplace )
+		{
+			pool->totalsize += size - oldsize;
+			Mem_InitAlloc( mem, size, filename, fileline );
+
+			if( clear && size > oldsize )
+				memset((byte *)data + oldsize, 0, size - oldsize );
+
+			return data;
+		}
+	}
+
+	newdata = _Mem_Alloc( poolptr, size, false, filename, fileline );
+	memcpy( newdata, data, Q_min( oldsize, size ));
+
+	if( clear && size > oldsize )
+		memset((byte *)newdata + oldsize, 0, size - oldsize );
+
+	Mem_FreeBlock( mem, filename, fileline );
+
+	return newdata;
+}
+
 void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clear, const char *filename, int fileline )
 {
 	memheader_t *mem;
@@ -275,6 +640,9 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clea
 	if( !Mem_CheckAllocHeader( __func__, mem, filename, fileline ))
 		return NULL;
 
+	if( Mem_FindPool( mem->poolptr )->flags || Mem_FindPool( poolptr )->flags )
+		return Mem_ReallocBackend( poolptr, mem, size, clear, filename, fileline );
+
 	// migrate pool if requested, even if no reallocation needed
 	if( mem->poolptr != poolptr )
 		Mem_MigratePool( poolptr, mem, filename, fileline );
@@ -318,20 +686,21 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *data, size_t size, qboolean clea
 	return (void *)((byte *)mem + sizeof( memheader_t ));
 }
 
-static poolhandle_t Mem_InitPool( mempool_t *pool, const char *name, const char *filename, int fileline )
+static poolhandle_t Mem_InitPool( mempool_t *pool, const char *name, int flags, const char *filename, int fileline )
 {
 	memset( pool, 0, sizeof( *pool ));
 
 	// fill header
 	pool->filename = filename;
 	pool->fileline = fileline;
+	pool->flags = flags;
 	pool->realsize = sizeof( mempool_t );
 	Q_strncpy( pool->name, name, sizeof( pool->name ));
 
 	return Mem_PoolIndex( pool );
 }
 
-poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int fileline )
+poolhandle_t _Mem_AllocPoolExt( const char *name, int flags, const char *filename, int fileline )
 {
 	mempool_t *pool;
 	size_t i;
@@ -339,7 +708,7 @@ poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int filelin
 	for( i = 0, pool = poolchain; i < poolcount; i++, pool++ )
 	{
 		if( pool->filename == NULL )
-			return Mem_InitPool( pool, name, filename, fileline );
+			return Mem_InitPool( pool, name, flags, filename, fileline );
 	}
 
 	pool = (mempool_t *)Q_realloc( poolchain, sizeof( *poolchain ) * ( poolcount + 1 ));
@@ -351,7 +720,28 @@ poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int filelin
 
 	poolchain = pool;
 	pool = &poolchain[poolcount++];
-	return Mem_InitPool( pool, name, filename, fileline );
+	return Mem_InitPool( pool, name, flags, filename, fileline );
+}
+
+poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int fileline )
+{
+	return _Mem_AllocPoolExt( name, 0, filename, fileline );
+}
+
+static void Mem_ReleasePool( mempool_t *pool, qboolean keepchunks, const char *filename, int fileline )
+{
+	while( pool->chain )
+		Mem_FreeBlock( pool->chain, filename, fileline );
+
+	if( FBitSet( pool->flags, MEMPOOL_ARENA ))
+	{
+		Mem_ArenaReset( pool );
+
+		if( !keepchunks )
+			Mem_FreeArena( pool );
+	}
+
+	Mem_FreeSlabs( pool );
 }
 
 void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline )
@@ -368,8 +758,7 @@ void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline )
 		}
 
 		// free memory owned by the pool
-		while( pool->chain )
-			Mem_FreeBlock( pool->chain, filename, fileline );
+		Mem_ReleasePool( pool, false, filename, fileline );
 
 		// free the pool itself
 		memset( pool, 0xBF, sizeof( mempool_t ));
@@ -392,8 +781,8 @@ void _Mem_EmptyPool( poolhandle_t poolptr, const char *filename, int fileline )
 	if( !pool )
 		return;
 
-	// free memory owned by the pool
-	while( pool->chain ) Mem_FreeBlock( pool->chain, filename, fileline );
+	// free memory owned by the pool, arena keeps its chunks for reuse
+	Mem_ReleasePool( pool, true, filename, fileline );
 }
 
 static qboolean Mem_CheckAlloc( mempool_t *pool, void *data )
@@ -449,24 +838,84 @@ void _Mem_Check( const char *filename, int fileline )
 			Mem_CheckAllocHeader( __func__, mem, filename, fileline );
 }
 
+/*
+========================
+Mem_PrintPoolBackend
+
+slab occupancy is used slots out of all slots, slack is
+space lost inside used slots due to rounding up to class size
+========================
+*/
+static void Mem_PrintPoolBackend( mempool_t *pool )
+{
+	int i;
+
+	if( FBitSet( pool->flags, MEMPOOL_ARENA ))
+	{
+		size_t used = Mem_ArenaUsed( pool ), reserved = 0, count = 0;
+		memarena_t *chunk;
+
+		for( chunk = pool->arena; chunk; chunk = chunk->next, count++ )
+			reserved += chunk->size;
+
+		Con_Printf( "%10s arena, %s of %s used in %zu chunks, %s peak\n", "", Q_memprint( used ),
+			Q_memprint( reserved ), count, Q_memprint( Q_max( used, pool->arenapeak )));
+	}
+
+	if( !FBitSet( pool->flags, MEMPOOL_SLAB ))
+		return;
+
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+	{
+		const memclass_t *c = &pool->classes[i];
+
+		if( !c->numslabs )
+			continue;
+
+		Con_Printf( "%10s slab %4zu: %6zu of %6zu slots in %zu slabs, %5.1f%% occupancy, %5.1f%% slack\n", "",
+			mem_classsize[i], c->used, c->numslots, c->numslabs, c->used * 100.0f / c->numslots,
+			c->used ? 100.0f - c->requested * 100.0f / ( c->used * mem_classsize[i] ) : 0.0f );
+	}
+}
+
 void Mem_PrintStats( void )
 {
 	size_t    count = 0, size = 0, realsize = 0, i;
+	size_t    slots = 0, usedslots = 0, slabsize = 0, arenasize = 0;
 	mempool_t *pool;
 
 	Mem_Check();
 	for( i = 0, pool = poolchain; i < poolcount; i++, pool++ )
 	{
+		memarena_t *chunk;
+		int j;
+
 		if( !pool->filename )
 			continue;
 
 		count++;
 		size += pool->totalsize;
 		realsize += pool->realsize;
+
+		for( j = 0; j < MEMSLAB_CLASSES; j++ )
+		{
+			slots += pool->classes[j].numslots;
+			usedslots += pool->classes[j].used;
+			slabsize += pool->classes[j].numslabs * MEMSLAB_SIZE;
+		}
+
+		for( chunk = pool->arena; chunk; chunk = chunk->next )
+			arenasize += chunk->size;
 	}
 
 	Con_Printf( "^3%zu^7 memory pools, totalling: ^1%s\n", count, Q_memprint( size ));
 	Con_Printf( "total allocated size: ^1%s\n", Q_memprint( realsize ));
+
+	if( slots )
+		Con_Printf( "slabs: ^1%s^7, %zu of %zu slots used (%.1f%% occupancy)\n", Q_memprint( slabsize ), usedslots, slots, usedslots * 100.0f / slots );
+
+	if( arenasize )
+		Con_Printf( "arenas: ^1%s\n", Q_memprint( arenasize ));
 }
 
 void Mem_PrintList( size_t minallocationsize )
@@ -499,6 +948,8 @@ void Mem_PrintList( size_t minallocationsize )
 			Con_Printf( "%10s (%10s real)\t%s\n", Q_memprint( pool->totalsize ), Q_memprint( pool->realsize ), pool->name );
 		}
 
+		Mem_PrintPoolBackend( pool );
+
 		pool->lastchecksize = pool->totalsize;
 		for( mem = pool->chain; mem; mem = mem->next )
 		{
@@ -518,3 +969,184 @@ void Memory_Init( void )
 	poolchain = NULL; // init mem chain
 	poolcount = 0;
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+#define TEST_ZONE_BLOCKS 2048
+
+static double Test_ZoneThroughput( poolhandle_t pool, qboolean reset )
+{
+	static void *ptrs[256];
+	const int count = 256;
+	double start = Sys_DoubleTime();
+	int i, j;
+
+	for( i = 0; i < 2000; i++ )
+	{
+		for( j = 0; j < count; j++ )
+			ptrs[j] = Mem_Malloc( pool, 8 + (( i + j * 7 ) & 255 ));
+
+		if( reset )
+		{
+			Mem_EmptyPool( pool );
+			continue;
+		}
+
+		for( j = 0; j < count; j++ )
+			Mem_Free( ptrs[j] );
+	}
+
+	return Sys_DoubleTime() - start;
+}
+
+static void Test_ZoneSlab( void )
+{
+	static byte *ptrs[TEST_ZONE_BLOCKS];
+	poolhandle_t pool = Mem_AllocPoolExt( "test slab", MEMPOOL_SLAB );
+	poolhandle_t heap = Mem_AllocPool( "test heap" );
+	mempool_t *p = Mem_FindPool( pool );
+	qboolean valid = true;
+	size_t used;
+	int i, j;
+
+	for( i = 0; i < TEST_ZONE_BLOCKS; i++ )
+	{
+		size_t size = 1 + ( i * 37 ) % 1500;
+
+		ptrs[i] = Mem_Malloc( pool, size );
+		memset( ptrs[i], i & 0xff, size );
+	}
+
+	used = 0;
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+		used += p->classes[i].used;
+
+	// everything up to MEMSLAB_MAXSIZE must be in slabs
+	for( i = 0, j = 0; i < TEST_ZONE_BLOCKS; i++ )
+		j += 1 + ( i * 37 ) % 1500 <= MEMSLAB_MAXSIZE;
+	TASSERT_EQi( (int)used, j );
+
+	// grow within the class, across classes and out of slabs
+	for( i = 0; i < TEST_ZONE_BLOCKS; i += 3 )
+	{
+		size_t size = 1 + ( i * 37 ) % 1500;
+
+		ptrs[i] = Mem_Realloc( pool, ptrs[i], size + ( i & 1 ? 1 : 600 ));
+
+		for( j = 0; j < size; j++ )
+			valid &= ptrs[i][j] == ( i & 0xff );
+		for( ; j < size + ( i & 1 ? 1 : 600 ); j++ )
+			valid &= ptrs[i][j] == 0;
+	}
+	TASSERT( valid );
+
+	// migrate to the plain pool and back
+	ptrs[1] = Mem_Realloc( heap, ptrs[1], 1 + 37 );
+	TASSERT( Mem_IsAllocatedExt( heap, ptrs[1] ));
+	TASSERT( ptrs[1][37] == 1 );
+	ptrs[1] = Mem_Realloc( pool, ptrs[1], 1 + 37 );
+	TASSERT( Mem_IsAllocatedExt( pool, ptrs[1] ));
+	TASSERT( ptrs[1][0] == 1 );
+
+	Mem_Check();
+
+	for( i = 0; i < TEST_ZONE_BLOCKS; i += 2 )
+		Mem_Free( ptrs[i] );
+
+	// freed slots are reused before new slabs are made
+	j = 0;
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+		j += p->classes[i].numslabs;
+	for( i = 0; i < TEST_ZONE_BLOCKS; i += 2 )
+		ptrs[i] = Mem_Malloc( pool, 1 + ( i * 37 ) % 1500 );
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+		j -= p->classes[i].numslabs;
+	TASSERT_EQi( j, 0 );
+
+	for( i = 0; i < TEST_ZONE_BLOCKS; i++ )
+		Mem_Free( ptrs[i] );
+
+	TASSERT_EQi( (int)p->totalsize, 0 );
+	for( i = 0; i < MEMSLAB_CLASSES; i++ )
+	{
+		TASSERT_EQi( (int)p->classes[i].used, 0 );
+		TASSERT_EQi( (int)p->classes[i].requested, 0 );
+	}
+
+	Mem_FreePool( &pool );
+	Mem_FreePool( &heap );
+}
+
+static void Test_ZoneArena( void )
+{
+	poolhandle_t pool = Mem_AllocPoolExt( "test arena", MEMPOOL_ARENA );
+	mempool_t *p = Mem_FindPool( pool );
+	byte *a, *b, *c;
+	size_t used, realsize;
+	int i;
+
+	a = Mem_Malloc( pool, 100 );
+	b = Mem_Calloc( pool, 200 );
+	used = Mem_ArenaUsed( p );
+
+	// only the last block gives memory back
+	c = Mem_Malloc( pool, 300 );
+	Mem_Free( c );
+	TASSERT_EQi( (int)Mem_ArenaUsed( p ), (int)used );
+	Mem_Free( a );
+	TASSERT_EQi( (int)Mem_ArenaUsed( p ), (int)used );
+
+	// last block grows in place
+	memset( b, 0x55, 200 );
+	c = Mem_Realloc( pool, b, 1000 );
+	TASSERT( c == b );
+	TASSERT( c[199] == 0x55 && c[200] == 0 && c[999] == 0 );
+	TASSERT_EQi( (int)p->totalsize, 1000 );
+
+	// chunks survive reset and get reused
+	for( i = 0; i < 4096; i++ )
+		a = Mem_Malloc( pool, 1 + i % 300 );
+	Mem_Check();
+
+	realsize = p->realsize;
+	Mem_EmptyPool( pool );
+	TASSERT_EQi( (int)p->totalsize, 0 );
+	TASSERT_EQi( (int)Mem_ArenaUsed( p ), 0 );
+	TASSERT_EQi( (int)p->realsize, (int)realsize );
+
+	for( i = 0; i < 4096; i++ )
+		a = Mem_Malloc( pool, 1 + i % 300 );
+	TASSERT_EQi( (int)p->realsize, (int)realsize );
+
+	// blocks bigger than chunk get their own
+	a = Mem_Malloc( pool, MEMARENA_SIZE * 2 );
+	memset( a, 1, MEMARENA_SIZE * 2 );
+	TASSERT( p->realsize > realsize );
+
+	Mem_FreePool( &pool );
+}
+
+void Test_RunZone( void )
+{
+	poolhandle_t pool;
+	double heap, slab, arena;
+
+	Test_ZoneSlab();
+	Test_ZoneArena();
+
+	pool = Mem_AllocPool( "test heap" );
+	heap = Test_ZoneThroughput( pool, false );
+	Mem_FreePool( &pool );
+
+	pool = Mem_AllocPoolExt( "test slab", MEMPOOL_SLAB );
+	slab = Test_ZoneThroughput( pool, false );
+	Mem_FreePool( &pool );
+
+	pool = Mem_AllocPoolExt( "test arena", MEMPOOL_ARENA );
+	arena = Test_ZoneThroughput( pool, true );
+	Mem_FreePool( &pool );
+
+	Msg( "zone: 512000 alloc/free pairs, heap %.3fs, slab %.3fs, arena %.3fs\n", heap, slab, arena );
+}
+#endif /* XASH_ENGINE_TESTS */
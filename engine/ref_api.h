@@ -59,7 +59,9 @@ GNU General Public License for more details.
 //    CL_RunLightStyles now accepts lightstyles array.
 //    Removed R_DrawTileClear and Mod_LoadMapSprite, as they're implemented on engine side
 //    Removed FillRGBABlend. Now FillRGBA accepts rendermode parameter.
-#define REF_API_VERSION 9
+// 10. CL_DrawParticles must not call CL_ThinkParticle anymore, engine updates all particles after drawing.
+// 11. Added COM_ParallelFor and COM_NumJobThreads, so renderers can use engine job threads.
+#define REF_API_VERSION 11
 
 #define TF_SKY		(TF_SKYSIDE|TF_NOMIPMAP|TF_ALLOW_NEAREST)
 #define TF_FONT		(TF_NOMIPMAP|TF_CLAMP|TF_ALLOW_NEAREST)
@@ -474,6 +476,10 @@ typedef struct ref_api_s
 	int (*XVK_GetInstanceExtensions)( unsigned int count, const char **pNames );
 	void *(*XVK_GetVkGetInstanceProcAddr)( void );
 	VkSurfaceKHR (*XVK_CreateSurface)( VkInstance instance );
+
+	// job threads
+	void (*COM_ParallelFor)( int count, int batch, void (*func)( void *ctx, int start, int end ), void *ctx );
+	int (*COM_NumJobThreads)( void );
 } ref_api_t;
 
 struct mip_s;
@@ -67,6 +67,7 @@ extern int SV_UPDATE_BACKUP;
 #define MAX_PUSHED_ENTS	256
 #define MAX_VIEWENTS	128
 #define MAX_LOCALINFO_STRING	32768	// localinfo used on server and not sended to the clients
+#define PRECACHE_HASH_SIZE	256	// must be power of two
 
 #define MAX_ENT_LEAFS( ext ) (( ext ) ? MAX_ENT_LEAFS_32 : MAX_ENT_LEAFS_16 )
 
@@ -119,6 +120,40 @@ typedef struct
 	file_t		*file;
 } server_log_t;
 
+typedef struct sv_freeedict_s
+{
+	int		num;			// edict number
+	int		serialnumber;		// serial at the time it was freed, to detect stale entries
+} sv_freeedict_t;
+
+#define SV_FINDCACHE_FIELDS	4
+
+// cached hashes of hot string fields, see SV_FindEntityByString
+typedef struct sv_findcache_s
+{
+	string_t		value[SV_FINDCACHE_FIELDS];	// field value the hash was computed for
+	uint		hash[SV_FINDCACHE_FIELDS];
+	uint		generation;		// svgame.findcache_generation values were cached at
+} sv_findcache_t;
+
+typedef struct sv_edictstats_s
+{
+	size_t		allocs;			// total SV_AllocEdict calls
+	size_t		reused;			// taken from free queue
+	size_t		probes;			// free queue entries looked at
+	size_t		scans;			// fallbacks to full edicts scan
+	size_t		dropped;			// entries lost on queue overflow
+	int		maxqueued;		// free queue depth high water mark
+} sv_edictstats_t;
+
+// case insensitive index over one of precache arrays,
+// next links are kept in a separate array of the same size
+typedef struct precache_hash_s
+{
+	short		first[PRECACHE_HASH_SIZE];	// chain heads, zero terminates the chain
+	int		numindexed;		// entries below this one are in chains
+} precache_hash_t;
+
 typedef struct server_s
 {
 	sv_state_t	state;		// precache commands are only valid during load
@@ -145,6 +180,14 @@ typedef struct server_s
 	char		sound_precache[MAX_SOUNDS][MAX_QPATH];
 	char		files_precache[MAX_CUSTOM][MAX_QPATH];
 	char		event_precache[MAX_EVENTS][MAX_QPATH];
+	precache_hash_t	model_hash;
+	precache_hash_t	sound_hash;
+	precache_hash_t	files_hash;
+	precache_hash_t	event_hash;
+	short		model_hashnext[MAX_MODELS];
+	short		sound_hashnext[MAX_SOUNDS];
+	short		files_hashnext[MAX_CUSTOM];
+	short		event_hashnext[MAX_EVENTS];
 	byte		model_precache_flags[MAX_MODELS];
 	model_t		*models[MAX_MODELS];
 	int		num_static_entities;
@@ -344,6 +387,14 @@ typedef struct
 	edict_t		*edicts;			// solid array of server entities
 	int		numEntities;		// actual entities count
 
+	// freed edicts in order of freetime, see SV_AllocEdict
+	sv_freeedict_t	*freeedicts;		// ring buffer [GI->max_edicts]
+	int		firstfreeedict;
+	int		numfreeedicts;
+	sv_edictstats_t	edictstats;
+	sv_findcache_t	*findcache;		// [GI->max_edicts]
+	uint		findcache_generation;	// bumped when string offsets can be reused
+
 	movevars_t	movevars;			// movement variables curstate
 	movevars_t	oldmovevars;		// movement variables oldstate
 	playermove_t	*pmove;			// pmove state
@@ -448,6 +499,8 @@ extern convar_t		sv_trace_messages;
 extern convar_t		sv_enttools_enable;
 extern convar_t		sv_enttools_maxfire;
 extern convar_t		sv_autosave;
+extern convar_t		sv_save_async;
+extern convar_t		sv_save_compress;
 extern convar_t		deathmatch;
 extern convar_t		hostname;
 extern convar_t		skill;
@@ -483,6 +536,7 @@ void SV_KickPlayer( sv_client_t *cl, const char *fmt, ... ) FORMAT_CHECK( 2 );
 void SV_DropClient( sv_client_t *cl, qboolean crash ) RENAME_SYMBOL( "SV_DropClient_" );
 void SV_UpdateMovevars( qboolean initialize );
 int SV_ModelIndex( const char *name );
+int SV_FindModelIndex( const char *name );
 int SV_SoundIndex( const char *name );
 int SV_EventIndex( const char *name );
 int SV_GenericIndex( const char *name );
@@ -622,6 +676,7 @@ void SV_FreeEdicts( void );
 edict_t *SV_AllocEdict( void );
 void SV_FreeEdict( edict_t *pEdict );
 void SV_InitEdict( edict_t *pEdict );
+void SV_ClearFreeEdicts( void );
 const char *SV_ClassName( const edict_t *e );
 void SV_CopyTraceToGlobal( trace_t *trace );
 qboolean SV_CheckEdict( const edict_t *e, const char *file, const int line );
@@ -682,6 +737,8 @@ int SV_LoadGameState( char const *level );
 void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char *start, qboolean background );
 const char *SV_GetLatestSave( void );
 void SV_InitSaveRestore( void );
+void SV_FinishSaveGame( qboolean wait );
+void SV_SaveStats_f( void );
 void SV_ClearGameState( void );
 
 //
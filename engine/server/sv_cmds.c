@@ -468,6 +468,9 @@ static void SV_DeleteSave_f( void )
 		return;
 	}
 
+	// save might be still written
+	SV_FinishSaveGame( true );
+
 	// delete save and saveshot
 	FS_Delete( va( DEFAULT_SAVE_DIRECTORY "%s.sav", Cmd_Argv( 1 )));
 	FS_Delete( va( DEFAULT_SAVE_DIRECTORY "%s.bmp", Cmd_Argv( 1 )));
@@ -885,6 +888,12 @@ static void SV_EdictUsage_f( void )
 	Con_Printf( "%5i edicts is used\n", active );
 	Con_Printf( "%5i edicts is free\n", GI->max_edicts - active );
 	Con_Printf( "%5i total\n", GI->max_edicts );
+	Con_Printf( "%5i in free queue, %i at most\n", svgame.numfreeedicts, svgame.edictstats.maxqueued );
+	Con_Printf( "%lu allocations, %lu reused from queue, %.2f queue probes per allocation\n",
+		(unsigned long)svgame.edictstats.allocs, (unsigned long)svgame.edictstats.reused,
+		svgame.edictstats.allocs ? (double)svgame.edictstats.probes / svgame.edictstats.allocs : 0.0 );
+	Con_Printf( "%lu full scans, %lu queue entries dropped\n",
+		(unsigned long)svgame.edictstats.scans, (unsigned long)svgame.edictstats.dropped );
 }
 
 /*
@@ -1029,6 +1038,7 @@ void SV_InitOperatorCommands( void )
 		Cmd_AddCommand( "save", SV_Save_f, "save the game to a file" );
 		Cmd_AddCommand( "savequick", SV_QuickSave_f, "save the game to the quicksave" );
 		Cmd_AddCommand( "autosave", SV_AutoSave_f, "save the game to 'autosave' file" );
+		Cmd_AddCommand( "savestats", SV_SaveStats_f, "print sizes and timings of the last savegame" );
 	}
 	else if( host.type == HOST_DEDICATED )
 	{
@@ -1068,6 +1078,7 @@ void SV_KillOperatorCommands( void )
 		Cmd_RemoveCommand( "save" );
 		Cmd_RemoveCommand( "savequick" );
 		Cmd_RemoveCommand( "autosave" );
+		Cmd_RemoveCommand( "savestats" );
 	}
 	else if( host.type == HOST_DEDICATED )
 	{
@@ -74,6 +74,26 @@ static edict_t *SV_PEntityOfEntIndex( const int iEntIndex, const qboolean allent
 }
 
 
+/*
+=============
+SV_HashString
+
+FNV-1a, strings are case sensitive
+=============
+*/
+static uint SV_HashString( const char *s )
+{
+	uint hash = 2166136261u;
+
+	while( *s )
+	{
+		hash ^= (byte)*s++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 /*
 =============
 EntvarsDescription
@@ -1005,6 +1025,43 @@ void SV_InitEdict( edict_t *pEdict )
 	pEdict->v.controller[2] = 0x7F;
 	pEdict->v.controller[3] = 0x7F;
 	pEdict->free = false;
+
+	// string offsets can be reused by the next level
+	if( svgame.findcache )
+		memset( &svgame.findcache[NUM_FOR_EDICT( pEdict )], 0, sizeof( *svgame.findcache ));
+}
+
+/*
+==============
+SV_QueueFreeEdict
+
+append freed edict to the end of free queue
+==============
+*/
+static void SV_QueueFreeEdict( edict_t *pEdict )
+{
+	sv_freeedict_t	*entry;
+	int		num = NUM_FOR_EDICT( pEdict );
+
+	// world and clients are never allocated
+	if( !svgame.freeedicts || num <= svs.maxclients )
+		return;
+
+	// only stale entries can fill it up, drop the oldest one,
+	// SV_AllocEdict will find it with a full scan if needed
+	if( svgame.numfreeedicts == GI->max_edicts )
+	{
+		svgame.firstfreeedict = ( svgame.firstfreeedict + 1 ) % GI->max_edicts;
+		svgame.numfreeedicts--;
+		svgame.edictstats.dropped++;
+	}
+
+	entry = &svgame.freeedicts[( svgame.firstfreeedict + svgame.numfreeedicts ) % GI->max_edicts];
+	entry->num = num;
+	entry->serialnumber = pEdict->serialnumber;
+	svgame.numfreeedicts++;
+
+	svgame.edictstats.maxqueued = Q_max( svgame.edictstats.maxqueued, svgame.numfreeedicts );
 }
 
 /*
@@ -1042,6 +1099,34 @@ void SV_FreeEdict( edict_t *pEdict )
 	VectorClear( pEdict->v.angles );
 	VectorClear( pEdict->v.origin );
 	pEdict->free = true;
+
+	SV_QueueFreeEdict( pEdict );
+}
+
+/*
+==============
+SV_ClearFreeEdicts
+
+forget freed edicts, must be called when numEntities is reset
+==============
+*/
+void SV_ClearFreeEdicts( void )
+{
+	svgame.firstfreeedict = 0;
+	svgame.numfreeedicts = 0;
+}
+
+/*
+==============
+SV_EdictReusable
+
+the first couple seconds of server time can involve a lot of
+freeing and allocating, so relax the replacement policy
+==============
+*/
+static qboolean SV_EdictReusable( const edict_t *e )
+{
+	return e->freetime < 2.0f || ( sv.time - e->freetime ) > 0.5f;
 }
 
 /*
@@ -1056,26 +1141,60 @@ edict_t *GAME_EXPORT SV_AllocEdict( void )
 	edict_t	*e;
 	int	i;
 
+	svgame.edictstats.allocs++;
+
+	// queue is ordered by freetime, so if the oldest edict
+	// is too young to be reused, all others are too
+	while( svgame.numfreeedicts > 0 )
+	{
+		const sv_freeedict_t *entry = &svgame.freeedicts[svgame.firstfreeedict];
+
+		e = EDICT_NUM( entry->num );
+		svgame.edictstats.probes++;
+
+		// skip edicts that were reused or freed again since
+		if( entry->num < svgame.numEntities && e->free && e->serialnumber == entry->serialnumber )
+		{
+			if( !SV_EdictReusable( e ))
+				break;
+
+			svgame.firstfreeedict = ( svgame.firstfreeedict + 1 ) % GI->max_edicts;
+			svgame.numfreeedicts--;
+			svgame.edictstats.reused++;
+
+			SV_InitEdict( e );
+			return e;
+		}
+
+		svgame.firstfreeedict = ( svgame.firstfreeedict + 1 ) % GI->max_edicts;
+		svgame.numfreeedicts--;
+	}
+
+	if( svgame.numEntities < GI->max_edicts )
+	{
+		e = EDICT_NUM( svgame.numEntities );
+		svgame.numEntities++;
+		SV_InitEdict( e );
+		return e;
+	}
+
+	// last resort, edicts dropped from the queue
+	svgame.edictstats.scans++;
+
 	for( i = svs.maxclients + 1; i < svgame.numEntities; i++ )
 	{
 		e = EDICT_NUM( i );
-		// the first couple seconds of server time can involve a lot of
-		// freeing and allocating, so relax the replacement policy
-		if( e->free && ( e->freetime < 2.0f || ( sv.time - e->freetime ) > 0.5f ))
+
+		if( e->free && SV_EdictReusable( e ))
 		{
 			SV_InitEdict( e );
 			return e;
 		}
 	}
 
-	if( i >= GI->max_edicts )
-		Host_Error( "%s: no free edicts (max is %d)\n", __func__, GI->max_edicts );
+	Host_Error( "%s: no free edicts (max is %d)\n", __func__, GI->max_edicts );
 
-	svgame.numEntities++;
-	e = EDICT_NUM( i );
-	SV_InitEdict( e );
-
-	return e;
+	return NULL;
 }
 
 /*
@@ -1330,11 +1449,8 @@ static int GAME_EXPORT pfnModelIndex( const char *m )
 	Q_strncpy( name, m, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_MODELS && sv.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.model_precache[i], name ))
-			return i;
-	}
+	if(( i = SV_FindModelIndex( name )) != 0 )
+		return i;
 
 	Con_Printf( S_ERROR "Cannot get index for model %s: not precached\n", name );
 	return 0;
@@ -1482,18 +1598,50 @@ static void GAME_EXPORT pfnChangePitch( edict_t* ent )
 	ent->v.angles[PITCH] = SV_AngleMod( ent->v.idealpitch, ent->v.angles[PITCH], ent->v.pitch_speed );
 }
 
+/*
+=========
+SV_FindCacheSlot
+
+returns slot in sv_findcache_t for the field, or -1 if it's not cached
+=========
+*/
+static int SV_FindCacheSlot( const TYPEDESCRIPTION *desc )
+{
+	static const int fields[SV_FINDCACHE_FIELDS] =
+	{
+		offsetof( entvars_t, classname ),
+		offsetof( entvars_t, globalname ),
+		offsetof( entvars_t, target ),
+		offsetof( entvars_t, targetname ),
+	};
+	int	i;
+
+	for( i = 0; i < ARRAYSIZE( fields ); i++ )
+	{
+		if( fields[i] == desc->fieldOffset )
+			return i;
+	}
+
+	return -1;
+}
+
 /*
 =========
 SV_FindEntityByString
 
+hot fields keep a per edict hash of their value, it's recomputed
+whenever string_t in entvars changes, so game dll is free to
+assign strings directly. string pool resets make the same
+string_t point to other text, so they invalidate all the hashes
 =========
 */
 static edict_t *GAME_EXPORT SV_FindEntityByString( edict_t *pStartEdict, const char *pszField, const char *pszValue )
 {
-	int		i = 0, e = 0;
+	int		i = 0, e = 0, slot;
 	const TYPEDESCRIPTION	*desc = NULL;
 	edict_t		*ed;
 	const char	*t;
+	uint		hash = 0;
 
 	if( !COM_CheckString( pszValue ))
 		return svgame.edicts;
@@ -1515,8 +1663,15 @@ static edict_t *GAME_EXPORT SV_FindEntityByString( edict_t *pStartEdict, const c
 		return svgame.edicts;
 	}
 
+	slot = svgame.findcache ? SV_FindCacheSlot( desc ) : -1;
+
+	if( slot >= 0 )
+		hash = SV_HashString( pszValue );
+
 	for( e++; e < svgame.numEntities; e++ )
 	{
+		string_t	str;
+
 		ed = EDICT_NUM( e );
 		if( !SV_IsValidEdict( ed )) continue;
 
@@ -1528,9 +1683,30 @@ static edict_t *GAME_EXPORT SV_FindEntityByString( edict_t *pStartEdict, const c
 		case FIELD_STRING:
 		case FIELD_MODELNAME:
 		case FIELD_SOUNDNAME:
-			t = STRING( *(string_t *)&((byte *)&ed->v)[desc->fieldOffset] );
+			str = *(string_t *)&((byte *)&ed->v)[desc->fieldOffset];
+			t = STRING( str );
 			if( t != NULL && t != svgame.globals->pStringBase )
 			{
+				if( slot >= 0 && str != 0 )
+				{
+					sv_findcache_t *cache = &svgame.findcache[e];
+
+					if( cache->generation != svgame.findcache_generation )
+					{
+						memset( cache->value, 0, sizeof( cache->value ));
+						cache->generation = svgame.findcache_generation;
+					}
+
+					if( cache->value[slot] != str )
+					{
+						cache->value[slot] = str;
+						cache->hash[slot] = SV_HashString( t );
+					}
+
+					if( cache->hash[slot] != hash )
+						break;
+				}
+
 				if( !Q_strcmp( t, pszValue ))
 					return ed;
 			}
@@ -2977,6 +3153,14 @@ static void *GAME_EXPORT pfnPvEntPrivateData( edict_t *pEdict )
 }
 
 
+typedef struct str64slot_s
+{
+	uint offset; // from pstringarray, zero is empty slot
+	uint hash;
+} str64slot_t;
+
+#define STR64_HASH_MIN_SLOTS 4096 // must be power of two
+
 static struct str64_s
 {
 	size_t maxstringarray;
@@ -2992,8 +3176,106 @@ static struct str64_s
 	size_t numdups;
 	size_t numoverflows;
 	size_t totalalloc;
+
+	// interned strings between poldstringbase and plast
+	str64slot_t *slots;
+	uint numslots;
+	uint numstrings;
+	size_t numlookups;
+	size_t numprobes;
 } str64;
 
+#if XASH_64BIT
+/*
+==================
+SV_ClearStringHash
+
+must be called each time the strings it points to can be overwritten
+==================
+*/
+static void SV_ClearStringHash( void )
+{
+	if( str64.slots )
+		memset( str64.slots, 0, sizeof( *str64.slots ) * str64.numslots );
+	str64.numstrings = 0;
+
+	// old offsets will be reused by new strings
+	svgame.findcache_generation++;
+}
+
+/*
+==================
+SV_InsertStringHash
+
+==================
+*/
+static void SV_InsertStringHash( const char *s, uint hash )
+{
+	uint i;
+
+	if( !str64.slots || ( str64.numstrings + 1 ) * 2 > str64.numslots )
+	{
+		// keep load factor under 0.5, rehash using stored hashes
+		str64slot_t *oldslots = str64.slots;
+		uint oldnumslots = str64.numslots;
+
+		str64.numslots = oldslots ? oldnumslots * 2 : STR64_HASH_MIN_SLOTS;
+		str64.slots = Mem_Calloc( host.mempool, sizeof( *str64.slots ) * str64.numslots );
+
+		for( i = 0; i < oldnumslots; i++ )
+		{
+			uint j;
+
+			if( !oldslots[i].offset )
+				continue;
+
+			for( j = oldslots[i].hash & ( str64.numslots - 1 ); str64.slots[j].offset; j = ( j + 1 ) & ( str64.numslots - 1 ));
+			str64.slots[j] = oldslots[i];
+		}
+
+		if( oldslots )
+			Mem_Free( oldslots );
+	}
+
+	for( i = hash & ( str64.numslots - 1 ); str64.slots[i].offset; i = ( i + 1 ) & ( str64.numslots - 1 ));
+
+	str64.slots[i].offset = s - str64.pstringarray;
+	str64.slots[i].hash = hash;
+	str64.numstrings++;
+}
+
+/*
+==================
+SV_FindStringHash
+
+returns previously allocated copy of string or NULL
+==================
+*/
+static const char *SV_FindStringHash( const char *s, uint hash )
+{
+	uint i;
+
+	if( !str64.slots )
+		return NULL;
+
+	str64.numlookups++;
+
+	for( i = hash & ( str64.numslots - 1 ); str64.slots[i].offset; i = ( i + 1 ) & ( str64.numslots - 1 ))
+	{
+		const char *check = str64.pstringarray + str64.slots[i].offset;
+
+		str64.numprobes++;
+
+		if( str64.slots[i].hash == hash && !Q_strcmp( check, s ))
+			return check;
+	}
+
+	str64.numprobes++; // empty slot
+
+	return NULL;
+}
+#endif // XASH_64BIT
+
 /*
 ==================
 SV_EmptyStringPool
@@ -3003,6 +3285,8 @@ Free strings on server stop. Reset string pointer on 64 bits
 */
 void SV_EmptyStringPool( qboolean clear_stats )
 {
+	svgame.findcache_generation++;
+
 #if XASH_64BIT
 	if( str64.dynamic ) // switch only after array fill (more space for multiplayer games)
 	{
@@ -3012,6 +3296,7 @@ void SV_EmptyStringPool( qboolean clear_stats )
 	{
 		str64.pstringbase = str64.poldstringbase = str64.pstringarraystatic;
 		str64.plast = str64.pstringbase + 1;
+		SV_ClearStringHash();
 	}
 
 	if( clear_stats )
@@ -3020,6 +3305,8 @@ void SV_EmptyStringPool( qboolean clear_stats )
 		str64.totalalloc = 0;
 		str64.numdups = 0;
 		str64.numoverflows = 0;
+		str64.numlookups = 0;
+		str64.numprobes = 0;
 	}
 #endif // !XASH_64BIT
 }
@@ -3162,6 +3449,11 @@ static void SV_FreeStringPool( void )
 	{
 		Mem_Free( str64.staticstringarray );
 	}
+
+	if( str64.slots )
+		Mem_Free( str64.slots );
+	str64.slots = NULL;
+	str64.numslots = str64.numstrings = 0;
 #else // !XASH_64BIT
 	Mem_FreePool( &svgame.stringspool );
 #endif // !XASH_64BIT
@@ -3234,59 +3526,77 @@ use -str64dup to disable deduplication, -str64alloc to set array size
 string_t GAME_EXPORT SV_AllocString( const char *szValue )
 {
 	uint len = SV_ProcessString( NULL, szValue );
-	char *processed_string = Mem_Calloc( svgame.stringspool, len );
-	char *dupe_string = NULL;
-	qboolean found_dupe = false;
-
-	(void)dupe_string;
-	(void)found_dupe;
-
-	SV_ProcessString( processed_string, szValue );
+	char *processed_string;
+#if XASH_64BIT
+	const char *dupe_string = NULL;
+	char *temp_string = NULL;
+	uint hash = 0;
+#endif // XASH_64BIT
 
 	if( svgame.physFuncs.pfnAllocString != NULL )
 	{
-		string_t i = svgame.physFuncs.pfnAllocString( processed_string );
+		string_t i;
+
+		processed_string = Mem_Calloc( svgame.stringspool, len );
+		SV_ProcessString( processed_string, szValue );
+		i = svgame.physFuncs.pfnAllocString( processed_string );
 		Mem_Free( processed_string );
 		return i;
 	}
 
 #if XASH_64BIT
+	// process right at the end of array, if it turns out to be
+	// a duplicate it's simply not committed
+	if( str64.plast - str64.poldstringbase + len + 1 > str64.maxstringarray )
+		processed_string = temp_string = Mem_Malloc( svgame.stringspool, len );
+	else processed_string = str64.plast;
+
+	SV_ProcessString( processed_string, szValue );
+
 	if( !str64.allowdup )
 	{
-		for( dupe_string = str64.poldstringbase + 1;
-			dupe_string < str64.plast && ( found_dupe = !Q_strcmp( dupe_string, processed_string ));
-			dupe_string += Q_strlen( dupe_string ) + 1 );
+		hash = SV_HashString( processed_string );
+		dupe_string = SV_FindStringHash( processed_string, hash );
 	}
 
-	if( !found_dupe )
+	if( !dupe_string )
 	{
-		if( str64.plast - str64.poldstringbase + len + 1 > str64.maxstringarray )
+		if( temp_string )
 		{
 			str64.plast = str64.pstringbase + 1;
 			str64.poldstringbase = str64.pstringbase;
 			str64.numoverflows++;
+			SV_ClearStringHash();
+
+			Q_strncpy( str64.plast, temp_string, len );
 		}
 
-		//MsgDev( D_NOTE, "SV_AllocString: %ld %s\n", str64.plast - svgame.globals->pStringBase, processed_string );
-		Q_strncpy( str64.plast, processed_string, len );
+		//MsgDev( D_NOTE, "SV_AllocString: %ld %s\n", str64.plast - svgame.globals->pStringBase, str64.plast );
 		str64.totalalloc += len;
 
 		dupe_string = str64.plast;
 		str64.plast += len;
+
+		if( !str64.allowdup )
+			SV_InsertStringHash( dupe_string, hash );
 	}
 	else
 	{
 		str64.numdups++;
-		//MsgDev( D_NOTE, "SV_AllocString: dup %ld %s\n", dupe_string - svgame.globals->pStringBase, processed_string );
+		//MsgDev( D_NOTE, "SV_AllocString: dup %ld %s\n", dupe_string - svgame.globals->pStringBase, dupe_string );
 	}
 
 	if( dupe_string - str64.pstringarray > str64.maxalloc )
 		str64.maxalloc = dupe_string - str64.pstringarray;
 
-	Mem_Free( processed_string );
+	if( temp_string )
+		Mem_Free( temp_string );
 
 	return dupe_string - svgame.globals->pStringBase;
 #else // !XASH_64BIT
+	processed_string = Mem_Calloc( svgame.stringspool, len );
+	SV_ProcessString( processed_string, szValue );
+
 	return processed_string - svgame.globals->pStringBase;
 #endif // !XASH_64BIT
 }
@@ -3302,6 +3612,32 @@ void SV_PrintStr64Stats_f( void )
 	Con_Printf( "maximum array usage: %lu\n", str64.maxalloc );
 	Con_Printf( "overflow counter: %lu\n", str64.numoverflows );
 	Con_Printf( "dup string counter: %lu\n", str64.numdups );
+
+	if( !str64.allowdup )
+	{
+		size_t totalprobe = 0;
+		uint i, maxprobe = 0;
+
+		// distance from home slot for every interned string
+		for( i = 0; i < str64.numslots; i++ )
+		{
+			uint probe;
+
+			if( !str64.slots[i].offset )
+				continue;
+
+			probe = (( i - str64.slots[i].hash ) & ( str64.numslots - 1 )) + 1;
+			totalprobe += probe;
+			maxprobe = Q_max( maxprobe, probe );
+		}
+
+		Con_Printf( "hash table: %u strings, %u slots, load factor %.2f\n",
+			str64.numstrings, str64.numslots, str64.numslots ? (float)str64.numstrings / str64.numslots : 0.0f );
+		Con_Printf( "probe length: average %.2f, longest %u\n",
+			str64.numstrings ? (float)totalprobe / str64.numstrings : 0.0f, maxprobe );
+		Con_Printf( "lookups: %lu, average %.2f probes per lookup\n",
+			str64.numlookups, str64.numlookups ? (float)str64.numprobes / str64.numlookups : 0.0f );
+	}
 #else // !XASH_64BIT
 	Con_Printf( "Not implemented\n" );
 #endif // !XASH_64BIT
@@ -5339,9 +5675,12 @@ qboolean SV_LoadProgs( const char *name )
 	svgame.globals->maxEntities = GI->max_edicts;
 	svgame.globals->maxClients = svs.maxclients;
 	svgame.edicts = Mem_Calloc( svgame.mempool, sizeof( edict_t ) * GI->max_edicts );
+	svgame.freeedicts = Mem_Calloc( svgame.mempool, sizeof( sv_freeedict_t ) * GI->max_edicts );
+	svgame.findcache = Mem_Calloc( svgame.mempool, sizeof( sv_findcache_t ) * GI->max_edicts );
 	svs.static_entities = Z_Calloc( sizeof( entity_state_t ) * MAX_STATIC_ENTITIES );
 	svs.baselines = Z_Calloc( sizeof( entity_state_t ) * GI->max_edicts );
 	svgame.numEntities = svs.maxclients + 1; // clients + world
+	SV_ClearFreeEdicts();
 
 	for( i = 0, e = svgame.edicts; i < GI->max_edicts; i++, e++ )
 		e->free = true; // mark all edicts as freed
@@ -5365,3 +5704,87 @@ qboolean SV_LoadProgs( const char *name )
 
 	return true;
 }
+
+#if XASH_ENGINE_TESTS
+
+#include "tests.h"
+
+static void Test_AllocString64( void )
+{
+#if XASH_64BIT
+	struct str64_s saved = str64;
+	globalvars_t *saved_globals = svgame.globals;
+	poolhandle_t saved_pool = svgame.stringspool;
+	globalvars_t globals;
+	string_t a, b, c;
+	size_t overflows;
+	uint generation;
+	int i;
+
+	memset( &str64, 0, sizeof( str64 ));
+	memset( &globals, 0, sizeof( globals ));
+
+	str64.maxstringarray = 65536;
+	str64.pstringarray = str64.staticstringarray = Mem_Calloc( host.mempool, str64.maxstringarray * 2 );
+	str64.pstringarraystatic = str64.pstringarray + str64.maxstringarray;
+	str64.pstringbase = str64.poldstringbase = str64.pstringarray;
+	str64.plast = str64.pstringarray + 1;
+	globals.pStringBase = str64.pstringarray;
+	svgame.globals = &globals;
+	svgame.stringspool = host.mempool;
+
+	a = SV_AllocString( "func_wall" );
+	b = SV_AllocString( "func_door" );
+	c = SV_AllocString( "func_wall" );
+	TASSERT_EQi( a, c );
+	TASSERT( a != b );
+	TASSERT_STR( SV_GetString( a ), "func_wall" );
+	TASSERT_STR( SV_GetString( b ), "func_door" );
+
+	// case sensitive
+	c = SV_AllocString( "FUNC_WALL" );
+	TASSERT( a != c );
+
+	// escapes are processed before lookup
+	a = SV_AllocString( "line\\nbreak" );
+	c = SV_AllocString( "line\nbreak" );
+	TASSERT_EQi( a, c );
+	TASSERT_STR( SV_GetString( a ), "line\nbreak" );
+
+	// enough strings to grow the table a few times
+	a = SV_AllocString( "0" );
+	for( i = 1; i < STR64_HASH_MIN_SLOTS * 2; i++ )
+		SV_AllocString( va( "%d", i ));
+
+	TASSERT( str64.numslots > STR64_HASH_MIN_SLOTS );
+	TASSERT_EQi( SV_AllocString( "0" ), a );
+	TASSERT_STR( SV_GetString( SV_AllocString( "1234" )), "1234" );
+	TASSERT_EQi( SV_AllocString( "func_door" ), b );
+
+	// overflow restarts the array and forgets old strings
+	overflows = str64.numoverflows;
+	generation = svgame.findcache_generation;
+	for( i = 0; str64.numoverflows == overflows; i++ )
+		a = SV_AllocString( va( "overflow_string_%d", i ));
+
+	TASSERT_STR( SV_GetString( a ), va( "overflow_string_%d", i - 1 ));
+	TASSERT_EQi( str64.numstrings, 1 );
+	TASSERT_EQi( SV_AllocString( va( "overflow_string_%d", i - 1 )), a );
+
+	// cached field hashes can't be trusted anymore
+	TASSERT( svgame.findcache_generation != generation );
+
+	Mem_Free( str64.slots );
+	Mem_Free( str64.staticstringarray );
+	str64 = saved;
+	svgame.globals = saved_globals;
+	svgame.stringspool = saved_pool;
+#endif // XASH_64BIT
+}
+
+void Test_RunStr64( void )
+{
+	Test_AllocString64();
+}
+
+#endif // XASH_ENGINE_TESTS
@@ -93,6 +93,84 @@ static void SV_SendSingleResource( const char *name, resourcetype_t type, int in
 	SV_SendResource( pResource, &sv.reliable_datagram );
 }
 
+/*
+================
+SV_IndexPrecache
+
+link new precache entries into hash chains, this also picks up
+slots that are written directly, like world and brush models
+================
+*/
+static void SV_IndexPrecache( precache_hash_t *hash, short *next, char (*list)[MAX_QPATH], int max )
+{
+	if( hash->numindexed < 1 )
+		hash->numindexed = 1; // zero slot is never used
+
+	for( ; hash->numindexed < max && list[hash->numindexed][0]; hash->numindexed++ )
+	{
+		uint key = COM_HashKey( list[hash->numindexed], PRECACHE_HASH_SIZE );
+
+		next[hash->numindexed] = hash->first[key];
+		hash->first[key] = hash->numindexed;
+	}
+}
+
+/*
+================
+SV_FindPrecache
+
+returns index of already registered resource or zero
+================
+*/
+static int SV_FindPrecache( precache_hash_t *hash, short *next, char (*list)[MAX_QPATH], int max, const char *name )
+{
+	int	i;
+
+	SV_IndexPrecache( hash, next, list, max );
+
+	for( i = hash->first[COM_HashKey( name, PRECACHE_HASH_SIZE )]; i; i = next[i] )
+	{
+		if( !Q_stricmp( list[i], name ))
+			return i;
+	}
+
+	return 0;
+}
+
+/*
+================
+SV_AddPrecache
+
+returns index of newly registered resource or zero if list is full
+================
+*/
+static int SV_AddPrecache( precache_hash_t *hash, short *next, char (*list)[MAX_QPATH], int max, const char *name )
+{
+	int	i;
+
+	SV_IndexPrecache( hash, next, list, max );
+
+	if(( i = hash->numindexed ) >= max )
+		return 0;
+
+	Q_strncpy( list[i], name, sizeof( list[i] ));
+	SV_IndexPrecache( hash, next, list, max );
+
+	return i;
+}
+
+/*
+================
+SV_FindModelIndex
+
+returns index of precached model, doesn't register anything
+================
+*/
+int SV_FindModelIndex( const char *name )
+{
+	return SV_FindPrecache( &sv.model_hash, sv.model_hashnext, sv.model_precache, MAX_MODELS, name );
+}
+
 /*
 ================
 SV_ModelIndex
@@ -113,21 +191,16 @@ int SV_ModelIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_MODELS && sv.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.model_precache[i], name ))
-			return i;
-	}
+	if(( i = SV_FindModelIndex( name )) != 0 )
+		return i;
 
-	if( i == MAX_MODELS )
+	// register new model
+	if(( i = SV_AddPrecache( &sv.model_hash, sv.model_hashnext, sv.model_precache, MAX_MODELS, name )) == 0 )
 	{
 		Host_Error( "MAX_MODELS limit exceeded (%d)\n", MAX_MODELS );
 		return 0;
 	}
 
-	// register new model
-	Q_strncpy( sv.model_precache[i], name, sizeof( sv.model_precache[i] ));
-
 	if( sv.state != ss_loading )
 	{
 		// send the update to everyone
@@ -164,21 +237,16 @@ int GAME_EXPORT SV_SoundIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_SOUNDS && sv.sound_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.sound_precache[i], name ))
-			return i;
-	}
+	if(( i = SV_FindPrecache( &sv.sound_hash, sv.sound_hashnext, sv.sound_precache, MAX_SOUNDS, name )) != 0 )
+		return i;
 
-	if( i == MAX_SOUNDS )
+	// register new sound
+	if(( i = SV_AddPrecache( &sv.sound_hash, sv.sound_hashnext, sv.sound_precache, MAX_SOUNDS, name )) == 0 )
 	{
 		Host_Error( "MAX_SOUNDS limit exceeded (%d)\n", MAX_SOUNDS );
 		return 0;
 	}
 
-	// register new sound
-	Q_strncpy( sv.sound_precache[i], name, sizeof( sv.sound_precache[i] ));
-
 	if( sv.state != ss_loading )
 	{
 		// send the update to everyone
@@ -207,21 +275,16 @@ int SV_EventIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_EVENTS && sv.event_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.event_precache[i], name ))
-			return i;
-	}
+	if(( i = SV_FindPrecache( &sv.event_hash, sv.event_hashnext, sv.event_precache, MAX_EVENTS, name )) != 0 )
+		return i;
 
-	if( i == MAX_EVENTS )
+	// register new event
+	if(( i = SV_AddPrecache( &sv.event_hash, sv.event_hashnext, sv.event_precache, MAX_EVENTS, name )) == 0 )
 	{
 		Host_Error( "MAX_EVENTS limit exceeded (%d)\n", MAX_EVENTS );
 		return 0;
 	}
 
-	// register new event
-	Q_strncpy( sv.event_precache[i], name, sizeof( sv.event_precache[i] ));
-
 	if( sv.state != ss_loading )
 	{
 		// send the update to everyone
@@ -249,21 +312,16 @@ int GAME_EXPORT SV_GenericIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_CUSTOM && sv.files_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.files_precache[i], name ))
-			return i;
-	}
+	if(( i = SV_FindPrecache( &sv.files_hash, sv.files_hashnext, sv.files_precache, MAX_CUSTOM, name )) != 0 )
+		return i;
 
-	if( i == MAX_CUSTOM )
+	// register new generic resource
+	if(( i = SV_AddPrecache( &sv.files_hash, sv.files_hashnext, sv.files_precache, MAX_CUSTOM, name )) == 0 )
 	{
 		Host_Error( "MAX_CUSTOM limit exceeded (%d)\n", MAX_CUSTOM );
 		return 0;
 	}
 
-	// register new generic resource
-	Q_strncpy( sv.files_precache[i], name, sizeof( sv.files_precache[i] ));
-
 	if( sv.state != ss_loading )
 	{
 		// send the update to everyone
@@ -713,6 +771,7 @@ void SV_DeactivateServer( void )
 	svgame.globals->maxEntities = GI->max_edicts;
 	svgame.globals->maxClients = svs.maxclients;
 	svgame.numEntities = svs.maxclients + 1; // clients + world
+	SV_ClearFreeEdicts();
 	svgame.globals->startspot = 0;
 	svgame.globals->mapname = 0;
 }
@@ -823,6 +882,7 @@ static void SV_SetupClients( void )
 	// init network stuff
 	NET_Config(( svs.maxclients > 1 ), true );
 	svgame.numEntities = svs.maxclients + 1; // clients + world
+	SV_ClearFreeEdicts();
 	ClearBits( sv_maxclients.flags, FCVAR_CHANGED );
 }
 
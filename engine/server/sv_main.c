@@ -61,6 +61,8 @@ CVAR_DEFINE_AUTO( sv_log_onefile, "0", FCVAR_ARCHIVE, "logs server information t
 CVAR_DEFINE_AUTO( sv_trace_messages, "0", FCVAR_LATCH, "enable server usermessages tracing (good for developers)" );
 CVAR_DEFINE_AUTO( sv_master_response_timeout, "4", FCVAR_ARCHIVE, "master server heartbeat response timeout in seconds" );
 CVAR_DEFINE_AUTO( sv_autosave, "1", FCVAR_ARCHIVE|FCVAR_SERVER|FCVAR_PRIVILEGED, "enable autosaving" );
+CVAR_DEFINE_AUTO( sv_save_async, "1", FCVAR_ARCHIVE|FCVAR_PRIVILEGED, "write savegames on a background thread" );
+CVAR_DEFINE_AUTO( sv_save_compress, "0", FCVAR_ARCHIVE|FCVAR_PRIVILEGED, "savegame state files compression level, 0 to disable (compressed saves can't be loaded by older engines)" );
 CVAR_DEFINE_AUTO( sv_speedhack_kick, "10", FCVAR_ARCHIVE, "number of speedhack warns before automatic kick (0 to disable)" );
 
 // game-related cvars
@@ -664,6 +666,9 @@ void Host_ServerFrame( void )
 	// update dedicated server status line in console
 	SV_UpdateStatusLine ();
 
+	// put background savegame in place when it's written
+	SV_FinishSaveGame( false );
+
 	// if server is not active, do nothing
 	if( !svs.initialized ) return;
 
@@ -931,6 +936,8 @@ void SV_Init( void )
 
 	Cvar_RegisterVariable( &sv_background_freeze );
 	Cvar_RegisterVariable( &sv_autosave );
+	Cvar_RegisterVariable( &sv_save_async );
+	Cvar_RegisterVariable( &sv_save_compress );
 
 	Cvar_RegisterVariable( &mapcyclefile );
 	Cvar_RegisterVariable( &motdfile );
@@ -1067,6 +1074,9 @@ before Sys_Quit or Sys_Error
 */
 void SV_Shutdown( const char *finalmsg )
 {
+	// don't lose the savegame that is being written
+	SV_FinishSaveGame( true );
+
 	// already freed
 	if( !SV_Initialized( ))
 	{
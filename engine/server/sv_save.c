@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include "render_api.h"	// decallist_t
 #include "sound.h"		// S_GetDynamicSounds
 #include "ref_common.h" // decals
+#include "miniz.h"
 
 /*
 ==============================================================================
@@ -31,10 +32,12 @@ half-life implementation of saverestore system
 #define SAVEFILE_HEADER		(('V'<<24)+('L'<<16)+('A'<<8)+'V')	// little-endian "VALV"
 #define SAVEGAME_HEADER		(('V'<<24)+('A'<<16)+('S'<<8)+'J')	// little-endian "JSAV"
 #define SAVEGAME_VERSION		0x0071				// Version 0.71 GoldSrc compatible
+#define SAVEGAME_VERSION_DEFLATE	0x0072				// Xash3D, level state files are deflated
 #define CLIENT_SAVEGAME_VERSION	0x0067				// Version 0.67
 
 #define SAVE_HEAPSIZE		0x400000				// reserve 4Mb for now
 #define SAVE_HASHSTRINGS		0xFFF				// 4095 unique strings
+#define SAVE_MAXHASHSTRINGS		32749				// game dlls store token index as short
 
 // savedata headers
 typedef struct
@@ -354,28 +357,6 @@ static void SaveBuildComment( char *text, int maxlength )
 	Q_snprintf( text, maxlength, "%-64.64s %02d:%02d", pName, (int)(sv.time / 60.0 ), (int)fmod( sv.time, 60.0 ));
 }
 
-/*
-=============
-DirectoryCount
-
-counting all the files with HL1-HL3 extension
-in save folder
-=============
-*/
-static int DirectoryCount( const char *pPath )
-{
-	int	count;
-	search_t	*t;
-
-	t = FS_Search( pPath, true, true );	// lookup only in gamedir
-	if( !t ) return 0; // empty
-
-	count = t->numfilenames;
-	Mem_Free( t );
-
-	return count;
-}
-
 /*
 =============
 InitEntityTable
@@ -402,22 +383,22 @@ static void InitEntityTable( SAVERESTOREDATA *pSaveData, int entityCount )
 
 /*
 =============
-EntryInTable
+ConnectionMask
 
-check level in transition list
+collect bits of all the connections to the level
 =============
 */
-static int EntryInTable( SAVERESTOREDATA *pSaveData, const char *pMapName, int index )
+static int ConnectionMask( SAVERESTOREDATA *pSaveData, const char *pMapName )
 {
-	int	i;
+	int	i, mask = 0;
 
-	for( i = index + 1; i < pSaveData->connectionCount; i++ )
+	for( i = 0; i < pSaveData->connectionCount; i++ )
 	{
-		if ( !Q_stricmp( pSaveData->levelList[i].mapName, pMapName ))
-			return i;
+		if( !Q_stricmp( pSaveData->levelList[i].mapName, pMapName ))
+			SetBits( mask, BIT( i ));
 	}
 
-	return -1;
+	return mask;
 }
 
 /*
@@ -633,36 +614,466 @@ static void AgeSaveList( const char *pName, int count )
 	}
 }
 
+/*
+==============================================================================
+SAVE WRITER
+
+snapshot of a savegame is taken on the server thread, then level state
+files are optionally compressed and written out by a background thread.
+The .sav is written under a temporary name and renamed when complete, so
+a partially written file never replaces a good one
+
+worker must not use the zone allocator, so everything is allocated here
+==============================================================================
+*/
+typedef struct
+{
+	char	name[MAX_OSPATH];
+	int	size;
+	byte	*data;
+} saveentry_t;
+
+typedef struct
+{
+	char	name[MAX_QPATH];
+	char	tempname[MAX_QPATH];
+	file_t	*file;
+	int	level;		// compression level, 0 for classic saves
+
+	byte	*header;		// JSAV header, tokens and game globals
+	int	headerSize;
+	saveentry_t *entries;	// snapshot of level state files
+	int	numentries;
+	byte	*packed;		// compression buffer, fits any entry
+	int	packedSize;
+
+	// filled by worker
+	qboolean	failed;
+	size_t	rawSize;
+	size_t	fileSize;
+	double	writeTime;
+
+	// set on server thread
+	qboolean	async;
+	double	startTime;
+	double	stateTime;
+	double	captureTime;
+} savejob_t;
+
+static struct
+{
+	// last finished save
+	char	name[MAX_QPATH];
+	qboolean	valid;
+	qboolean	failed;
+	qboolean	async;
+	int	level;
+	int	numentries;
+	size_t	rawSize;
+	size_t	fileSize;
+	double	stateTime;	// SaveGameState, server thread
+	double	captureTime;	// snapshot, server thread
+	double	writeTime;	// compress and write, worker thread
+	double	totalTime;	// from request to file in place
+
+	// totals since startup
+	int	count;
+	int	asyncCount;
+	size_t	totalRaw;
+	size_t	totalWritten;
+	double	maxHitch;
+
+	// last changelevel
+	double	transitionSave;
+	double	transitionLoad;
+
+	// save string tokens
+	int	lastTokens;	// used by last level state
+	int	lastTokenCount;	// its hash table size
+} savestats;
+
+// most strings seen in a level state, sizes the token table,
+// so it's kept apart from diagnostics that can be reset
+static int save_peak_tokens;
+
+static savejob_t *savejob;
+
+#if XASH_THREADS
+static struct
+{
+	sys_mutex_t	*lock;
+	sys_thread_t	*thread;
+	qboolean	running;	// only changed by server thread
+	qboolean	done;	// guarded by lock
+} savethread;
+#endif // XASH_THREADS
+
 /*
 =============
-DirectoryCopy
+SaveWriterCreate
 
-put the HL1-HL3 files into .sav file
+take a snapshot of level state files
 =============
 */
-static void DirectoryCopy( const char *pPath, file_t *pFile )
+static savejob_t *SaveWriterCreate( const char *pPath, int level )
 {
-	char	szName[MAX_OSPATH];
-	int	i, fileSize;
-	file_t	*pCopy;
+	savejob_t	*job;
 	search_t	*t;
+	int	i;
+
+	job = Mem_Calloc( host.mempool, sizeof( *job ));
+	job->startTime = Sys_DoubleTime();
+	job->level = bound( 0, level, 9 );
 
 	t = FS_Search( pPath, true, true );
-	if( !t ) return; // nothing to copy ?
+	if( !t ) return job; // nothing to copy ?
+
+	job->entries = Mem_Calloc( host.mempool, sizeof( *job->entries ) * t->numfilenames );
 
 	for( i = 0; i < t->numfilenames; i++ )
 	{
-		pCopy = FS_Open( t->filenames[i], "rb", true );
-		fileSize = FS_FileLength( pCopy );
+		saveentry_t	*entry = &job->entries[job->numentries];
+		fs_offset_t	size;
 
-		memset( szName, 0, sizeof( szName )); // clearing the string to prevent garbage in output file
-		Q_strncpy( szName, COM_FileWithoutPath( t->filenames[i] ), sizeof( szName ));
-		FS_Write( pFile, szName, MAX_OSPATH );
-		FS_Write( pFile, &fileSize, sizeof( int ));
-		FS_FileCopy( pFile, pCopy, fileSize );
-		FS_Close( pCopy );
+		entry->data = FS_LoadFile( t->filenames[i], &size, true );
+		if( !entry->data ) continue;
+
+		// clearing the string to prevent garbage in output file
+		Q_strncpy( entry->name, COM_FileWithoutPath( t->filenames[i] ), sizeof( entry->name ));
+		entry->size = size;
+		job->numentries++;
 	}
 	Mem_Free( t );
+
+	return job;
+}
+
+/*
+=============
+SaveWriterSetHeader
+
+copy savegame header, tokens and globals
+=============
+*/
+static void SaveWriterSetHeader( savejob_t *job, SAVERESTOREDATA *pSaveData, const char *pTokenData )
+{
+	int	data[5];
+
+	data[0] = SAVEGAME_HEADER;
+	data[1] = job->level > 0 ? SAVEGAME_VERSION_DEFLATE : SAVEGAME_VERSION;
+	data[2] = pSaveData->size; // does not include token table
+	data[3] = pSaveData->tokenCount;
+	data[4] = pSaveData->tokenSize;
+
+	// write out the tokens first so we can load them before we load the entities
+	job->headerSize = sizeof( data ) + pSaveData->tokenSize + pSaveData->size;
+	job->header = Mem_Malloc( host.mempool, job->headerSize );
+	memcpy( job->header, data, sizeof( data ));
+	memcpy( job->header + sizeof( data ), pTokenData, pSaveData->tokenSize );
+	memcpy( job->header + sizeof( data ) + pSaveData->tokenSize, pSaveData->pBaseData, pSaveData->size ); // header and globals
+}
+
+/*
+=============
+SaveWriterOpen
+=============
+*/
+static qboolean SaveWriterOpen( savejob_t *job, const char *name )
+{
+	Q_strncpy( job->name, name, sizeof( job->name ));
+	Q_snprintf( job->tempname, sizeof( job->tempname ), "%s.tmp", name );
+
+	job->file = FS_Open( job->tempname, "wb", true );
+
+	return job->file != NULL;
+}
+
+/*
+=============
+SaveWriterWrite
+=============
+*/
+static void SaveWriterWrite( savejob_t *job, const void *data, int size )
+{
+	if( job->failed || size <= 0 )
+		return;
+
+	if( FS_Write( job->file, data, size ) != size )
+		job->failed = true;
+
+	job->fileSize += size;
+}
+
+/*
+=============
+SaveWriterRun
+
+compress and write the snapshot, may be called from any thread
+=============
+*/
+static void SaveWriterRun( savejob_t *job )
+{
+	double	start = Sys_DoubleTime();
+	int	i;
+
+	SaveWriterWrite( job, job->header, job->headerSize );
+	job->rawSize = job->headerSize;
+
+	// put the HL1-HL3 files into .sav file
+	for( i = 0; i < job->numentries && !job->failed; i++ )
+	{
+		saveentry_t	*entry = &job->entries[i];
+
+		SaveWriterWrite( job, entry->name, MAX_OSPATH );
+		SaveWriterWrite( job, &entry->size, sizeof( int ));
+		job->rawSize += MAX_OSPATH + sizeof( int ) + entry->size;
+
+		if( job->level > 0 )
+		{
+			mz_ulong	packedSize = job->packedSize;
+			int	len;
+
+			if( compress2( job->packed, &packedSize, entry->data, entry->size, job->level ) != Z_OK )
+			{
+				job->failed = true;
+				break;
+			}
+
+			len = packedSize;
+			SaveWriterWrite( job, &len, sizeof( int ));
+			SaveWriterWrite( job, job->packed, len );
+		}
+		else SaveWriterWrite( job, entry->data, entry->size );
+	}
+
+	job->writeTime = Sys_DoubleTime() - start;
+
+#if XASH_THREADS
+	if( job->async )
+	{
+		Sys_LockMutex( savethread.lock );
+		savethread.done = true;
+		Sys_UnlockMutex( savethread.lock );
+	}
+#endif
+}
+
+#if XASH_THREADS
+static void SaveWriterThread( void *job )
+{
+	SaveWriterRun( job );
+}
+#endif // XASH_THREADS
+
+/*
+=============
+SaveWriterFree
+=============
+*/
+static void SaveWriterFree( savejob_t *job )
+{
+	int	i;
+
+	if( job->file )
+		FS_Close( job->file );
+
+	for( i = 0; i < job->numentries; i++ )
+		Mem_Free( job->entries[i].data );
+
+	if( job->entries )
+		Mem_Free( job->entries );
+
+	if( job->packed )
+		Mem_Free( job->packed );
+
+	if( job->header )
+		Mem_Free( job->header );
+
+	Mem_Free( job );
+}
+
+/*
+=============
+SaveWriterComplete
+
+put the written file in place and update stats
+=============
+*/
+static void SaveWriterComplete( savejob_t *job )
+{
+	FS_Close( job->file );
+	job->file = NULL;
+
+	if( !job->failed )
+	{
+		FS_Delete( job->name );
+
+		if( !FS_Rename( job->tempname, job->name ))
+			job->failed = true;
+	}
+
+	if( job->failed )
+	{
+		Con_Printf( S_ERROR "couldn't write %s\n", job->name );
+		FS_Delete( job->tempname );
+	}
+
+	Q_strncpy( savestats.name, job->name, sizeof( savestats.name ));
+	savestats.valid = true;
+	savestats.failed = job->failed;
+	savestats.async = job->async;
+	savestats.level = job->level;
+	savestats.numentries = job->numentries;
+	savestats.rawSize = job->rawSize;
+	savestats.fileSize = job->fileSize;
+	savestats.stateTime = job->stateTime;
+	savestats.captureTime = job->captureTime;
+	savestats.writeTime = job->writeTime;
+	savestats.totalTime = Sys_DoubleTime() - job->startTime;
+
+	savestats.count++;
+	if( job->async ) savestats.asyncCount++;
+	savestats.totalRaw += job->rawSize;
+	savestats.totalWritten += job->fileSize;
+
+	// without worker server thread waits for the whole write
+	if( job->async )
+		savestats.maxHitch = Q_max( savestats.maxHitch, job->stateTime + job->captureTime );
+	else savestats.maxHitch = Q_max( savestats.maxHitch, job->stateTime + job->captureTime + job->writeTime );
+
+	SaveWriterFree( job );
+}
+
+/*
+=============
+SaveWriterStart
+
+hand the snapshot over to worker or write it right now
+=============
+*/
+static void SaveWriterStart( savejob_t *job, qboolean async )
+{
+	int	i, maxSize = 0;
+
+	if( job->level > 0 )
+	{
+		for( i = 0; i < job->numentries; i++ )
+			maxSize = Q_max( maxSize, job->entries[i].size );
+
+		job->packedSize = compressBound( maxSize );
+		job->packed = Mem_Malloc( host.mempool, job->packedSize );
+	}
+
+	job->captureTime = Sys_DoubleTime() - job->startTime - job->stateTime;
+
+#if XASH_THREADS
+	if( async && ( savethread.lock = Sys_CreateMutex( false )))
+	{
+		job->async = true;
+		savethread.done = false;
+
+		if(( savethread.thread = Sys_CreateThread( "Save writer thread", SaveWriterThread, job )))
+		{
+			savethread.running = true;
+			savejob = job;
+			return;
+		}
+
+		Sys_DestroyMutex( savethread.lock );
+		savethread.lock = NULL;
+		job->async = false;
+	}
+#endif // XASH_THREADS
+
+	SaveWriterRun( job );
+	SaveWriterComplete( job );
+}
+
+/*
+=============
+SV_FinishSaveGame
+
+complete background savegame write, if wait
+is false only checks if worker is done
+=============
+*/
+void SV_FinishSaveGame( qboolean wait )
+{
+#if XASH_THREADS
+	if( !savethread.running )
+		return;
+
+	if( !wait )
+	{
+		qboolean done;
+
+		Sys_LockMutex( savethread.lock );
+		done = savethread.done;
+		Sys_UnlockMutex( savethread.lock );
+
+		if( !done ) return;
+	}
+
+	Sys_JoinThread( savethread.thread );
+	Sys_DestroyMutex( savethread.lock );
+	savethread.thread = NULL;
+	savethread.lock = NULL;
+	savethread.running = false;
+
+	SaveWriterComplete( savejob );
+	savejob = NULL;
+#endif // XASH_THREADS
+}
+
+/*
+=============
+SV_SaveStats_f
+=============
+*/
+void SV_SaveStats_f( void )
+{
+	if( Cmd_Argc() == 2 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+	{
+		memset( &savestats, 0, sizeof( savestats ));
+		return;
+	}
+
+	if( savejob )
+		Con_Printf( "writing %s...\n", savejob->name );
+
+	if( !savestats.valid )
+	{
+		Con_Printf( "no saves since startup\n" );
+	}
+	else
+	{
+		Con_Printf( "last save: %s (%s, %s)%s\n", savestats.name,
+			savestats.async ? "background" : "synchronous",
+			savestats.level > 0 ? va( "deflate level %i", savestats.level ) : "uncompressed",
+			savestats.failed ? " ^1FAILED^7" : "" );
+		Con_Printf( "  %i state files, %s raw, %s written (%.1f%%)\n", savestats.numentries,
+			Q_memprint( savestats.rawSize ), Q_memprint( savestats.fileSize ),
+			savestats.rawSize ? savestats.fileSize * 100.0 / savestats.rawSize : 0.0 );
+		Con_Printf( "  server thread: %.2f ms game state, %.2f ms snapshot\n",
+			savestats.stateTime * 1000.0, savestats.captureTime * 1000.0 );
+		Con_Printf( "  writer: %.2f ms, file in place %.2f ms after request\n",
+			savestats.writeTime * 1000.0, savestats.totalTime * 1000.0 );
+		Con_Printf( "%i saves (%i background), %s raw, %s written, worst server thread stall %.2f ms\n",
+			savestats.count, savestats.asyncCount, Q_memprint( savestats.totalRaw ),
+			Q_memprint( savestats.totalWritten ), savestats.maxHitch * 1000.0 );
+	}
+
+	if( savestats.lastTokenCount > 0 )
+	{
+		Con_Printf( "last level state: %i strings in %i token slots, most seen %i\n",
+			savestats.lastTokens, savestats.lastTokenCount, save_peak_tokens );
+	}
+
+	if( savestats.transitionSave > 0.0 )
+	{
+		Con_Printf( "last changelevel: %.2f ms to save level state, %.2f ms to restore\n",
+			savestats.transitionSave * 1000.0, savestats.transitionLoad * 1000.0 );
+	}
 }
 
 /*
@@ -672,11 +1083,13 @@ DirectoryExtract
 extract the HL1-HL3 files from the .sav file
 =============
 */
-static void DirectoryExtract( file_t *pFile, int fileCount )
+static qboolean DirectoryExtract( file_t *pFile, int fileCount, qboolean compressed )
 {
 	char	szName[MAX_OSPATH];
 	char	fileName[MAX_OSPATH];
-	int	i, fileSize;
+	int	i, fileSize, packedSize;
+	byte	*packed, *data;
+	mz_ulong	len;
 	file_t	*pCopy;
 
 	for( i = 0; i < fileCount; i++ )
@@ -684,13 +1097,98 @@ static void DirectoryExtract( file_t *pFile, int fileCount )
 		// filename can only be as long as a map name + extension
 		FS_Read( pFile, szName, MAX_OSPATH );
 		FS_Read( pFile, &fileSize, sizeof( int ));
+		szName[MAX_OSPATH - 1] = '\0';
 		Q_snprintf( fileName, sizeof( fileName ), DEFAULT_SAVE_DIRECTORY "%s", szName );
 		COM_FixSlashes( fileName );
 
+		if( !compressed )
+		{
+			pCopy = FS_Open( fileName, "wb", true );
+			FS_FileCopy( pCopy, pFile, fileSize );
+			FS_Close( pCopy );
+			continue;
+		}
+
+		FS_Read( pFile, &packedSize, sizeof( int ));
+
+		if( fileSize < 0 || packedSize < 0 || packedSize > compressBound( fileSize ))
+		{
+			Con_Printf( S_ERROR "%s: corrupted state file %s\n", __func__, szName );
+			return false;
+		}
+
+		packed = Mem_Malloc( host.mempool, packedSize );
+		data = Mem_Malloc( host.mempool, fileSize );
+		len = fileSize;
+
+		if( FS_Read( pFile, packed, packedSize ) != packedSize
+			|| uncompress( data, &len, packed, packedSize ) != Z_OK || len != fileSize )
+		{
+			Con_Printf( S_ERROR "%s: corrupted state file %s\n", __func__, szName );
+			Mem_Free( packed );
+			Mem_Free( data );
+			return false;
+		}
+
 		pCopy = FS_Open( fileName, "wb", true );
-		FS_FileCopy( pCopy, pFile, fileSize );
+		FS_Write( pCopy, data, fileSize );
 		FS_Close( pCopy );
+
+		Mem_Free( packed );
+		Mem_Free( data );
+	}
+
+	return true;
+}
+
+/*
+=============
+SaveTokenCount
+
+game dlls keep save strings in an open addressed
+hash table of this size, their hash is weak and probing
+is linear, so keep it at most a quarter full. It's sized
+by entity count and by the most tokens seen in a level
+state so far
+=============
+*/
+static int SaveTokenCount( int entityCount )
+{
+	static const int tokenCounts[] = { SAVE_HASHSTRINGS, 8191, 16381, SAVE_MAXHASHSTRINGS };
+	int	i, needed;
+
+	needed = Q_max( entityCount * 2, save_peak_tokens ) * 4;
+
+	for( i = 0; i < ARRAYSIZE( tokenCounts ) - 1; i++ )
+	{
+		if( tokenCounts[i] >= needed )
+			break;
+	}
+
+	return tokenCounts[i];
+}
+
+/*
+=============
+SaveCountTokens
+
+remember how many strings level state used
+=============
+*/
+static int SaveCountTokens( SAVERESTOREDATA *pSaveData )
+{
+	int	i, count = 0;
+
+	for( i = 0; i < pSaveData->tokenCount; i++ )
+	{
+		if( pSaveData->pTokens[i] )
+			count++;
 	}
+
+	savestats.lastTokens = count;
+	save_peak_tokens = Q_max( save_peak_tokens, count );
+
+	return count;
 }
 
 /*
@@ -933,6 +1431,7 @@ static SAVERESTOREDATA *LoadSaveData( const char *level )
 
 	// Parse the symbol table
 	BuildHashTable( pSaveData, pFile );
+	SaveCountTokens( pSaveData );
 
 	// Set up the restore basis
 	pSaveData->fUseLandmark = true;
@@ -1003,6 +1502,7 @@ static void EntityPatchWrite( SAVERESTOREDATA *pSaveData, const char *level )
 {
 	char	name[MAX_QPATH];
 	int	i, size = 0;
+	int	*patch;
 	file_t	*pFile;
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL3", level );
@@ -1010,21 +1510,19 @@ static void EntityPatchWrite( SAVERESTOREDATA *pSaveData, const char *level )
 	if(( pFile = FS_Open( name, "wb", true )) == NULL )
 		return;
 
-	for( i = 0; i < pSaveData->tableCount; i++ )
-	{
-		if( FBitSet( pSaveData->pTable[i].flags, FENTTABLE_REMOVED ))
-			size++;
-	}
-
-	// patch count
-	FS_Write( pFile, &size, sizeof( int ));
+	// patch count followed by entity indices, written at once
+	patch = Mem_Malloc( host.mempool, ( pSaveData->tableCount + 1 ) * sizeof( int ));
 
 	for( i = 0; i < pSaveData->tableCount; i++ )
 	{
 		if( FBitSet( pSaveData->pTable[i].flags, FENTTABLE_REMOVED ))
-			FS_Write( pFile, &i, sizeof( int ));
+			patch[++size] = i;
 	}
 
+	patch[0] = size;
+	FS_Write( pFile, patch, ( size + 1 ) * sizeof( int ));
+
+	Mem_Free( patch );
 	FS_Close( pFile );
 }
 
@@ -1053,7 +1551,9 @@ static void EntityPatchRead( SAVERESTOREDATA *pSaveData, const char *level )
 	for( i = 0; i < size; i++ )
 	{
 		FS_Read( pFile, &entityId, sizeof( int ));
-		pSaveData->pTable[entityId].flags = FENTTABLE_REMOVED;
+
+		if( entityId >= 0 && entityId < pSaveData->tableCount )
+			pSaveData->pTable[entityId].flags = FENTTABLE_REMOVED;
 	}
 
 	FS_Close( pFile );
@@ -1306,6 +1806,10 @@ static void LoadClientState( SAVERESTOREDATA *pSaveData, const char *level, qboo
 
 	// clearing the restore buffer to reuse
 	SaveClear( pSaveData );
+
+	// HL1 and HL2 are written with the same table, but don't trust the file
+	if( tokenCount > pSaveData->tokenCount )
+		pSaveData->pTokens = Mem_Realloc( host.mempool, pSaveData->pTokens, tokenCount * sizeof( char* ));
 	pSaveData->tokenCount = tokenCount;
 	pSaveData->tokenSize = tokenSize;
 
@@ -1461,7 +1965,7 @@ static SAVERESTOREDATA *SaveGameState( int changelevel )
 	if( !svgame.dllFuncs.pfnParmsChangeLevel )
 		return NULL;
 
-	pSaveData = SaveInit( SAVE_HEAPSIZE, SAVE_HASHSTRINGS );
+	pSaveData = SaveInit( SAVE_HEAPSIZE, SaveTokenCount( svgame.numEntities ));
 
 	Q_snprintf( name, sizeof( name ), DEFAULT_SAVE_DIRECTORY "%s.HL1", sv.name );
 	COM_FixSlashes( name );
@@ -1552,6 +2056,8 @@ static SAVERESTOREDATA *SaveGameState( int changelevel )
 	tableSize = pSaveData->size - dataSize;
 
 	// Write entity string token table
+	SaveCountTokens( pSaveData );
+	savestats.lastTokenCount = pSaveData->tokenCount;
 	pTokenData = StoreHashTable( pSaveData );
 
 	// output to disk
@@ -1675,12 +2181,16 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 {
 	char		hlPath[MAX_QPATH];
 	char		name[MAX_QPATH];
-	int		id, version;
 	char		*pTokenData;
 	SAVERESTOREDATA	*pSaveData;
 	GAME_HEADER	gameHeader;
-	file_t		*pFile;
+	savejob_t		*job;
+	double		start;
+
+	// only one save can be written at a time
+	SV_FinishSaveGame( true );
 
+	start = Sys_DoubleTime();
 	pSaveData = SaveGameState( false );
 	if( !pSaveData ) return false;
 
@@ -1688,9 +2198,13 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 	pSaveData = SaveInit( SAVE_HEAPSIZE, SAVE_HASHSTRINGS ); // re-init the buffer
 
 	Q_strncpy( hlPath, DEFAULT_SAVE_DIRECTORY "*.HL?", sizeof( hlPath ) );
+	job = SaveWriterCreate( hlPath, sv_save_compress.value );
+	job->stateTime = job->startTime - start;
+	job->startTime = start;
+
 	Q_strncpy( gameHeader.mapName, sv.name, sizeof( gameHeader.mapName )); // get the name of level where a player
 	Q_strncpy( gameHeader.comment, pSaveComment, sizeof( gameHeader.comment ));
-	gameHeader.mapCount = DirectoryCount( hlPath ); // counting all the adjacency maps
+	gameHeader.mapCount = job->numentries; // counting all the adjacency maps
 
 	// Store the game header
 	svgame.dllFuncs.pfnSaveWriteFields( pSaveData, "GameHeader", &gameHeader, gGameHeader, ARRAYSIZE( gGameHeader ));
@@ -1711,9 +2225,10 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 		AgeSaveList( pSaveName, GI->autosave_aged_count );
 
 	// output to disk
-	if(( pFile = FS_Open( name, "wb", true )) == NULL )
+	if( !SaveWriterOpen( job, name ))
 	{
 		// something bad is happens
+		SaveWriterFree( job );
 		SaveFinish( pSaveData );
 		return false;
 	}
@@ -1722,22 +2237,9 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 	Cbuf_AddTextf( "saveshot \"%s\"\n", pSaveName );
 	Con_Printf( "Saving game to %s...\n", name );
 
-	version = SAVEGAME_VERSION;
-	id = SAVEGAME_HEADER;
-
-	FS_Write( pFile, &id, sizeof( id ));
-	FS_Write( pFile, &version, sizeof( version ));
-	FS_Write( pFile, &pSaveData->size, sizeof( int )); // does not include token table
-
-	// write out the tokens first so we can load them before we load the entities
-	FS_Write( pFile, &pSaveData->tokenCount, sizeof( int ));
-	FS_Write( pFile, &pSaveData->tokenSize, sizeof( int ));
-	FS_Write( pFile, pTokenData, pSaveData->tokenSize );
-	FS_Write( pFile, pSaveData->pBaseData, pSaveData->size ); // header and globals
-
-	DirectoryCopy( hlPath, pFile );
+	SaveWriterSetHeader( job, pSaveData, pTokenData );
 	SaveFinish( pSaveData );
-	FS_Close( pFile );
+	SaveWriterStart( job, sv_save_async.value != 0.0f );
 
 	return true;
 }
@@ -1746,7 +2248,8 @@ static qboolean SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 =============
 SaveReadHeader
 
-read header of .sav file
+read header of .sav file,
+returns savegame version
 =============
 */
 static int SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader )
@@ -1763,7 +2266,7 @@ static int SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader )
 	}
 
 	FS_Read( pFile, &version, sizeof( version ));
-	if( version != SAVEGAME_VERSION )
+	if( version != SAVEGAME_VERSION && version != SAVEGAME_VERSION_DEFLATE )
 	{
 		FS_Close( pFile );
 		return 0;
@@ -1792,7 +2295,7 @@ static int SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader )
 
 	SaveFinish( pSaveData );
 
-	return 1;
+	return version;
 }
 
 /*
@@ -1901,7 +2404,7 @@ static void LoadAdjacentEnts( const char *pOldLevel, const char *pLandmarkName )
 {
 	SAVE_HEADER	header;
 	SAVERESTOREDATA	currentLevelData, *pSaveData;
-	int		i, test, flags, index, movedCount = 0;
+	int		i, test, flags, movedCount = 0;
 	qboolean		foundprevious = false;
 	vec3_t		landmarkOrigin;
 
@@ -1938,24 +2441,18 @@ static void LoadAdjacentEnts( const char *pOldLevel, const char *pLandmarkName )
 
 			pSaveData->time = sv.time; // - header.time;
 			pSaveData->fUseLandmark = true;
-			flags = movedCount = 0;
-			index = -1;
+			movedCount = 0;
 
 			// calculate landmark offset
 			LandmarkOrigin( &currentLevelData, landmarkOrigin, pLandmarkName );
 			LandmarkOrigin( pSaveData, pSaveData->vecLandmarkOffset, pLandmarkName );
 			VectorSubtract( landmarkOrigin, pSaveData->vecLandmarkOffset, pSaveData->vecLandmarkOffset );
 
+			flags = ConnectionMask( pSaveData, sv.name );
+
 			if( !Q_stricmp( currentLevelData.levelList[i].mapName, pOldLevel ))
 				SetBits( flags, FENTTABLE_PLAYER );
 
-			while( 1 )
-			{
-				index = EntryInTable( pSaveData, sv.name, index );
-				if( index < 0 ) break;
-				SetBits( flags, BIT( index ));
-			}
-
 			if( flags ) movedCount = CreateEntityTransitionList( pSaveData, flags );
 
 			// if ents were moved, rewrite entity table to save file
@@ -2013,6 +2510,7 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 	char		_startspot[MAX_QPATH];
 	char		*startspot = NULL;
 	SAVERESTOREDATA	*pSaveData = NULL;
+	double		starttime;
 
 	if( sv.state != ss_active )
 	{
@@ -2035,7 +2533,9 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 		svgame.globals->changelevel = true;
 
 		// save the current level's state
+		starttime = Sys_DoubleTime();
 		pSaveData = SaveGameState( true );
+		savestats.transitionSave = Sys_DoubleTime() - starttime;
 	}
 
 	SV_InactivateClients ();
@@ -2050,9 +2550,11 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 		// finish saving gamestate
 		SaveFinish( pSaveData );
 
+		starttime = Sys_DoubleTime();
 		if( !LoadGameState( level, true ))
 			SV_SpawnEntities( level );
 		LoadAdjacentEnts( oldlevel, startspot );
+		savestats.transitionLoad = Sys_DoubleTime() - starttime;
 
 		if( sv_newunit.value )
 			ClearSaveDir();
@@ -2078,6 +2580,7 @@ qboolean SV_LoadGame( const char *pPath )
 	GAME_HEADER	gameHeader;
 	file_t		*pFile;
 	uint		flags;
+	int		version;
 
 	if( Host_IsDedicated() )
 		return false;
@@ -2088,6 +2591,9 @@ qboolean SV_LoadGame( const char *pPath )
 	if( !COM_CheckString( pPath ))
 		return false;
 
+	// savegame might be still written
+	SV_FinishSaveGame( true );
+
 	// silently ignore if missed
 	if( !FS_FileExists( pPath, true ))
 		return false;
@@ -2103,11 +2609,8 @@ qboolean SV_LoadGame( const char *pPath )
 	{
 		SV_ClearGameState();
 
-		if( SaveReadHeader( pFile, &gameHeader ))
-		{
-			DirectoryExtract( pFile, gameHeader.mapCount );
-			validload = true;
-		}
+		if(( version = SaveReadHeader( pFile, &gameHeader )) != 0 )
+			validload = DirectoryExtract( pFile, gameHeader.mapCount, version == SAVEGAME_VERSION_DEFLATE );
 		FS_Close( pFile );
 
 		if( validload )
@@ -2218,6 +2721,8 @@ const char *SV_GetLatestSave( void )
 	int		i, found = 0;
 	search_t		*t;
 
+	SV_FinishSaveGame( true );
+
 	if(( t = FS_Search( DEFAULT_SAVE_DIRECTORY "*.sav" , true, true )) == NULL )
 		return NULL;
 
@@ -2259,6 +2764,8 @@ int GAME_EXPORT SV_GetSaveComment( const char *savename, char *comment )
 	string	mapName, description;
 	file_t	*f;
 
+	SV_FinishSaveGame( true );
+
 	if(( f = FS_Open( savename, "rb", true )) == NULL )
 	{
 		// just not exist - clear comment
@@ -2291,7 +2798,7 @@ int GAME_EXPORT SV_GetSaveComment( const char *savename, char *comment )
 		return 0;
 	}
 
-	if( tag > SAVEGAME_VERSION )
+	if( tag > SAVEGAME_VERSION_DEFLATE )
 	{
 		// old xash version ?
 		Q_strncpy( comment, "<invalid version>", MAX_STRING );
@@ -2443,3 +2950,283 @@ void SV_InitSaveRestore( void )
 {
 	pfnSaveGameComment = COM_GetProcAddress( svgame.hInstance, "SV_SaveGameComment" );
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+#define TEST_SAVE_NAME DEFAULT_SAVE_DIRECTORY "test_writer.sav"
+
+static const char *test_state_files[] = { "test_a.HL1", "test_a.HL2", "test_b.HL1" };
+
+static void Test_MakeStateFiles( byte **data, int *sizes )
+{
+	int i, j;
+
+	for( i = 0; i < ARRAYSIZE( test_state_files ); i++ )
+	{
+		sizes[i] = 1000 + i * 30000;
+		data[i] = Mem_Malloc( host.mempool, sizes[i] );
+
+		// mostly repetitive like real entity data
+		for( j = 0; j < sizes[i]; j++ )
+			data[i][j] = ( j % 97 ) < 80 ? ( j % 7 ) : COM_RandomLong( 0, 255 );
+	}
+}
+
+static void Test_CheckSave( byte **data, int *sizes, int level )
+{
+	int header[5], i;
+	byte globals[32];
+	file_t *f;
+
+	TASSERT( !FS_FileExists( TEST_SAVE_NAME ".tmp", false ));
+
+	f = FS_Open( TEST_SAVE_NAME, "rb", false );
+	TASSERT( f != NULL );
+	if( !f ) return;
+
+	FS_Read( f, header, sizeof( header ));
+	TASSERT_EQi( header[0], SAVEGAME_HEADER );
+	TASSERT_EQi( header[1], level > 0 ? SAVEGAME_VERSION_DEFLATE : SAVEGAME_VERSION );
+	TASSERT_EQi( header[2], (int)sizeof( globals ));
+	TASSERT_EQi( header[4], 0 );
+	FS_Read( f, globals, sizeof( globals ));
+	TASSERT( globals[0] == 0x55 && globals[sizeof( globals ) - 1] == 0x55 );
+
+	TASSERT( DirectoryExtract( f, ARRAYSIZE( test_state_files ), header[1] == SAVEGAME_VERSION_DEFLATE ));
+	FS_Close( f );
+
+	for( i = 0; i < ARRAYSIZE( test_state_files ); i++ )
+	{
+		const char *name = va( DEFAULT_SAVE_DIRECTORY "%s", test_state_files[i] );
+		fs_offset_t size;
+		byte *extracted = FS_LoadFile( name, &size, false );
+
+		TASSERT( extracted != NULL );
+		if( !extracted ) continue;
+
+		TASSERT_EQi( (int)size, sizes[i] );
+		TASSERT( size == sizes[i] && !memcmp( extracted, data[i], size ));
+		Mem_Free( extracted );
+		FS_Delete( name );
+	}
+}
+
+void Test_RunSaveWriter( void )
+{
+	byte *data[ARRAYSIZE( test_state_files )];
+	int sizes[ARRAYSIZE( test_state_files )];
+	byte globals[32];
+	SAVERESTOREDATA save = { 0 };
+	int pass, i;
+
+	memset( globals, 0x55, sizeof( globals ));
+	save.pBaseData = (char *)globals;
+	save.size = sizeof( globals );
+
+	Test_MakeStateFiles( data, sizes );
+
+	// classic and compressed, written inline and on worker
+	for( pass = 0; pass < 4; pass++ )
+	{
+		int level = ( pass & 1 ) ? 1 : 0;
+		qboolean async = ( pass & 2 ) != 0;
+		savejob_t *job = SaveWriterCreate( DEFAULT_SAVE_DIRECTORY "test_*.HL?", level );
+
+		// game isn't mounted yet so search won't find anything, feed the snapshot directly
+		TASSERT_EQi( job->numentries, 0 );
+		job->entries = Mem_Calloc( host.mempool, sizeof( *job->entries ) * ARRAYSIZE( test_state_files ));
+
+		for( i = 0; i < ARRAYSIZE( test_state_files ); i++ )
+		{
+			saveentry_t *entry = &job->entries[job->numentries++];
+
+			Q_strncpy( entry->name, test_state_files[i], sizeof( entry->name ));
+			entry->size = sizes[i];
+			entry->data = Mem_Malloc( host.mempool, sizes[i] );
+			memcpy( entry->data, data[i], sizes[i] );
+		}
+
+		SaveWriterSetHeader( job, &save, NULL );
+		TASSERT( SaveWriterOpen( job, TEST_SAVE_NAME ));
+		SaveWriterStart( job, async );
+		SV_FinishSaveGame( true );
+
+		TASSERT( !savestats.failed );
+		TASSERT( savejob == NULL );
+		TASSERT_EQi( (int)savestats.rawSize, (int)( sizeof( int ) * 5 + sizeof( globals ) + ( MAX_OSPATH + sizeof( int )) * 3 + sizes[0] + sizes[1] + sizes[2] ));
+		if( level > 0 )
+		{
+			TASSERT( savestats.fileSize < savestats.rawSize / 2 );
+		}
+		else
+		{
+			TASSERT_EQi( (int)savestats.fileSize, (int)savestats.rawSize );
+		}
+
+		Test_CheckSave( data, sizes, level );
+	}
+
+	// truncated compressed stream must be rejected
+	{
+		fs_offset_t size;
+		byte *buf = FS_LoadFile( TEST_SAVE_NAME, &size, false );
+		file_t *f;
+		int header[5];
+
+		TASSERT( buf != NULL );
+		if( buf )
+		{
+			FS_WriteFile( TEST_SAVE_NAME, buf, size - 100 );
+			Mem_Free( buf );
+
+			f = FS_Open( TEST_SAVE_NAME, "rb", false );
+			FS_Read( f, header, sizeof( header ));
+			FS_Seek( f, header[2] + header[4], SEEK_CUR );
+			TASSERT( !DirectoryExtract( f, ARRAYSIZE( test_state_files ), true ));
+			FS_Close( f );
+		}
+	}
+
+	for( i = 0; i < ARRAYSIZE( test_state_files ); i++ )
+	{
+		FS_Delete( va( DEFAULT_SAVE_DIRECTORY "%s", test_state_files[i] ));
+		Mem_Free( data[i] );
+	}
+	FS_Delete( TEST_SAVE_NAME );
+	memset( &savestats, 0, sizeof( savestats ));
+}
+
+// same as save-restore buffer in the game dlls
+static int Test_TokenHash( char **pTokens, int tokenCount, const char *pszToken, int *probes )
+{
+	uint	hash = 0;
+	const char	*p;
+	int	i;
+
+	for( p = pszToken; *p; p++ )
+		hash = (( hash >> 4 ) | ( hash << 28 )) ^ *p;
+
+	hash = (word)( hash % (uint)tokenCount );
+
+	for( i = 0; i < tokenCount; i++ )
+	{
+		int index = hash + i;
+
+		if( index >= tokenCount )
+			index -= tokenCount;
+
+		( *probes )++;
+
+		if( !pTokens[index] || !Q_strcmp( pszToken, pTokens[index] ))
+		{
+			pTokens[index] = (char *)pszToken;
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+static double Test_FillTokens( int tokenCount, char (*strings)[32], int numStrings, int *probes, int *lost )
+{
+	char	**pTokens = Mem_Calloc( host.mempool, tokenCount * sizeof( char* ));
+	double	start = Sys_DoubleTime();
+	int	i, j;
+
+	*probes = *lost = 0;
+
+	// every string is written a few times, like a targetname referenced by several entities
+	for( j = 0; j < 4; j++ )
+	{
+		for( i = 0; i < numStrings; i++ )
+		{
+			if( Test_TokenHash( pTokens, tokenCount, strings[i], probes ) < 0 && j == 0 )
+				( *lost )++;
+		}
+	}
+
+	start = Sys_DoubleTime() - start;
+	Mem_Free( pTokens );
+
+	return start;
+}
+
+static void Test_MakeTokens( char (*strings)[32], int numStrings )
+{
+	int i;
+
+	// brush models, targetnames, precached resources
+	for( i = 0; i < numStrings; i++ )
+	{
+		switch( i % 5 )
+		{
+		case 0: Q_snprintf( strings[i], sizeof( strings[i] ), "*%d", i ); break;
+		case 1: Q_snprintf( strings[i], sizeof( strings[i] ), "door_%d", i ); break;
+		case 2: Q_snprintf( strings[i], sizeof( strings[i] ), "models/gib%d.mdl", i ); break;
+		case 3: Q_snprintf( strings[i], sizeof( strings[i] ), "ambience/loop%d.wav", i ); break;
+		default: Q_snprintf( strings[i], sizeof( strings[i] ), "path_corner%d", i ); break;
+		}
+	}
+}
+
+void Test_RunSaveTables( void )
+{
+	SAVERESTOREDATA save = { 0 };
+	char (*strings)[32];
+	int numStrings = 3800, numEntities = 1500;
+	int fixedProbes, sizedProbes, fixedLost, sizedLost, tokenCount;
+	int old_peak_tokens = save_peak_tokens;
+	double fixed, sized;
+
+	memset( &savestats, 0, sizeof( savestats ));
+	save_peak_tokens = 0;
+
+	// token table grows with the level, but never past short index
+	TASSERT_EQi( SaveTokenCount( 100 ), SAVE_HASHSTRINGS );
+	TASSERT_EQi( SaveTokenCount( 100000 ), SAVE_MAXHASHSTRINGS );
+	TASSERT( SAVE_MAXHASHSTRINGS <= 32767 );
+	save_peak_tokens = 5000;
+	TASSERT( SaveTokenCount( 100 ) >= 10000 );
+	save_peak_tokens = 0;
+
+	strings = Mem_Calloc( host.mempool, numStrings * sizeof( *strings ));
+	Test_MakeTokens( strings, numStrings );
+
+	tokenCount = SaveTokenCount( numEntities );
+	fixed = Test_FillTokens( SAVE_HASHSTRINGS, strings, numStrings, &fixedProbes, &fixedLost );
+	sized = Test_FillTokens( tokenCount, strings, numStrings, &sizedProbes, &sizedLost );
+
+	TASSERT_EQi( fixedLost, 0 );
+	TASSERT_EQi( sizedLost, 0 );
+	TASSERT( sizedProbes < fixedProbes / 4 );
+	TASSERT( sizedProbes < numStrings * 4 * 2 );
+
+	Msg( "save tokens: %d strings, %d slots %d probes %.3fms, %d slots %d probes %.3fms\n", numStrings,
+		SAVE_HASHSTRINGS, fixedProbes, fixed * 1000.0, tokenCount, sizedProbes, sized * 1000.0 );
+
+	// overfilled fixed table drops strings
+	numStrings = SAVE_HASHSTRINGS + 100;
+	strings = Mem_Realloc( host.mempool, strings, numStrings * sizeof( *strings ));
+	Test_MakeTokens( strings, numStrings );
+
+	Test_FillTokens( SAVE_HASHSTRINGS, strings, numStrings, &fixedProbes, &fixedLost );
+	Test_FillTokens( SaveTokenCount( numStrings / 2 ), strings, numStrings, &sizedProbes, &sizedLost );
+	TASSERT_EQi( fixedLost, 100 );
+	TASSERT_EQi( sizedLost, 0 );
+	Mem_Free( strings );
+
+	// all the connections to the level in one pass
+	save.connectionCount = 4;
+	Q_strncpy( save.levelList[0].mapName, "c1a0", sizeof( save.levelList[0].mapName ));
+	Q_strncpy( save.levelList[1].mapName, "c1a0d", sizeof( save.levelList[1].mapName ));
+	Q_strncpy( save.levelList[2].mapName, "C1A0", sizeof( save.levelList[2].mapName ));
+	Q_strncpy( save.levelList[3].mapName, "c1a0e", sizeof( save.levelList[3].mapName ));
+	TASSERT_EQi( ConnectionMask( &save, "c1a0" ), BIT( 0 ) | BIT( 2 ));
+	TASSERT_EQi( ConnectionMask( &save, "c1a0e" ), BIT( 3 ));
+	TASSERT_EQi( ConnectionMask( &save, "c1a1" ), 0 );
+
+	memset( &savestats, 0, sizeof( savestats ));
+	save_peak_tokens = old_peak_tokens;
+}
+#endif // XASH_ENGINE_TESTS
@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "port.h"
+#include "xash3d_types.h"
+#include "const.h"
+#include "com_model.h"
+#include "crtlib.h"
+#include "xash3d_mathlib.h"
+
+#define MAX_TEST_SAMPLES	( 67 * 41 ) // odd extents to hit the scalar tail
+
+static uint test_seed = 0x1234567;
+
+static uint Test_Rand( void )
+{
+	test_seed = test_seed * 1103515245 + 12345;
+	return test_seed >> 8;
+}
+
+// the loop R_BuildLightMap used before it got vectorized
+static void Test_AccumulateScalar( uint *bl, const color24 *lm, int size, uint scale )
+{
+	int i;
+
+	for( i = 0; i < size; i++ )
+	{
+		bl[i * 3 + 0] += lm[i].r * scale;
+		bl[i * 3 + 1] += lm[i].g * scale;
+		bl[i * 3 + 2] += lm[i].b * scale;
+	}
+}
+
+static int Test_AccumulateLightmap( void )
+{
+	static color24 samples[MAX_TEST_SAMPLES * MAXLIGHTMAPS + 1];
+	static uint expected[MAX_TEST_SAMPLES * 3 + 1];
+	static uint result[MAX_TEST_SAMPLES * 3 + 1];
+	// typical lightstyle values, full bright 'z' style, and
+	// huge scales that make the accumulator wrap around
+	const uint scales[] = { 0, 1, 22, 256, 264, 22 * 'z', 256 * 256, 0x12345, 0xffff, 0x10000, 0xfffffff, 0xffffffff };
+	const int sizes[] = { 1, 5, 6, 16, 17, 64, 67 * 41 };
+	int i, j, k;
+
+	for( i = 0; i < sizeof( samples ); i++ )
+		((byte *)samples)[i] = Test_Rand() & 0xff;
+
+	for( i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+	{
+		const int size = sizes[i];
+
+		// also check unaligned sample and accumulator pointers
+		for( k = 0; k < 2; k++ )
+		{
+			uint *bl_expected = expected + k;
+			uint *bl_result = result + k;
+			const color24 *lm = (const color24 *)((const byte *)samples + k );
+
+			memset( expected, 0, sizeof( expected ));
+			memset( result, 0, sizeof( result ));
+
+			for( j = 0; j < sizeof( scales ) / sizeof( scales[0] ); j++ )
+			{
+				const color24 *style = &lm[( j % MAXLIGHTMAPS ) * size];
+
+				Test_AccumulateScalar( bl_expected, style, size, scales[j] );
+				R_AccumulateLightmap( bl_result, (const byte *)style, size * 3, scales[j] );
+
+				if( memcmp( expected, result, sizeof( expected )))
+				{
+					printf( "size %d offset %d scale %u mismatch\n", size, k, scales[j] );
+					return i + 1;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+int main( void )
+{
+	int ret = Test_AccumulateLightmap();
+
+	if( ret > 0 )
+		return ret;
+
+	return 0;
+}
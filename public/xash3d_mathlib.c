@@ -20,6 +20,14 @@ GNU General Public License for more details.
 #include "eiface.h"
 #include "studio.h"
 
+#if XASH_LITTLE_ENDIAN && ( defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_AMD64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ))
+#include <emmintrin.h>
+#define XASH_LIGHTMAP_SSE2 1
+#elif XASH_LITTLE_ENDIAN && ( defined( __ARM_NEON ) || defined( __ARM_NEON__ ))
+#include <arm_neon.h>
+#define XASH_LIGHTMAP_NEON 1
+#endif
+
 #define NUM_HULL_ROUNDS	ARRAYSIZE( hull_table )
 #define HULL_PRECISION	4
 
@@ -624,3 +632,69 @@ void R_StudioCalcBonePosition( int frame, float s, const mstudiobone_t *pbone, c
 		VectorCopy( origin1, pos );
 	}
 }
+
+/*
+====================
+R_AccumulateLightmap
+
+adds count lightmap bytes (packed color24, so three per sample)
+multiplied by lightstyle scale to the blocklights accumulator.
+wraps around exactly like the scalar uint math, so renderers
+get the same lightmaps whichever path was taken
+====================
+*/
+void R_AccumulateLightmap( uint *blocklights, const byte *samples, int count, uint scale )
+{
+	int i = 0;
+
+#if XASH_LIGHTMAP_SSE2
+	// SSE2 has no 32-bit mullo, but samples fit in 16 bits, so
+	// split scale in halves: s * scale = s * lo + (( s * hi ) << 16 )
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i scale_lo = _mm_set1_epi16((short)( scale & 0xffff ));
+	const __m128i scale_hi = _mm_set1_epi16((short)( scale >> 16 ));
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		const __m128i in = _mm_loadu_si128((const __m128i *)&samples[i] );
+		__m128i s16[2];
+		int j;
+
+		s16[0] = _mm_unpacklo_epi8( in, zero );
+		s16[1] = _mm_unpackhi_epi8( in, zero );
+
+		for( j = 0; j < 2; j++ )
+		{
+			const __m128i lo = _mm_mullo_epi16( s16[j], scale_lo );
+			const __m128i hi = _mm_mulhi_epu16( s16[j], scale_lo );
+			const __m128i top = _mm_mullo_epi16( s16[j], scale_hi );
+			__m128i *out = (__m128i *)&blocklights[i + j * 8];
+			__m128i p0, p1;
+
+			p0 = _mm_add_epi32( _mm_unpacklo_epi16( lo, hi ), _mm_unpacklo_epi16( zero, top ));
+			p1 = _mm_add_epi32( _mm_unpackhi_epi16( lo, hi ), _mm_unpackhi_epi16( zero, top ));
+
+			_mm_storeu_si128( out + 0, _mm_add_epi32( _mm_loadu_si128( out + 0 ), p0 ));
+			_mm_storeu_si128( out + 1, _mm_add_epi32( _mm_loadu_si128( out + 1 ), p1 ));
+		}
+	}
+#elif XASH_LIGHTMAP_NEON
+	for( ; i + 16 <= count; i += 16 )
+	{
+		const uint8x16_t in = vld1q_u8( &samples[i] );
+		const uint16x8_t s16[2] = { vmovl_u8( vget_low_u8( in )), vmovl_u8( vget_high_u8( in )) };
+		int j;
+
+		for( j = 0; j < 2; j++ )
+		{
+			uint32_t *out = (uint32_t *)&blocklights[i + j * 8];
+
+			vst1q_u32( out + 0, vmlaq_n_u32( vld1q_u32( out + 0 ), vmovl_u16( vget_low_u16( s16[j] )), scale ));
+			vst1q_u32( out + 4, vmlaq_n_u32( vld1q_u32( out + 4 ), vmovl_u16( vget_high_u16( s16[j] )), scale ));
+		}
+	}
+#endif
+
+	for( ; i < count; i++ )
+		blocklights[i] += samples[i] * scale;
+}
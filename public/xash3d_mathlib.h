@@ -171,6 +171,7 @@ void QuaternionSlerp( const vec4_t p, const vec4_t q, float t, vec4_t qt );
 void R_StudioCalcBoneQuaternion( int frame, float s, const mstudiobone_t *pbone, const mstudioanim_t *panim, const float *adj, vec4_t q );
 void R_StudioCalcBonePosition( int frame, float s, const mstudiobone_t *pbone, const mstudioanim_t *panim, const vec3_t adj, vec3_t pos );
 int BoxOnPlaneSide( const vec3_t emins, const vec3_t emaxs, const mplane_t *p );
+void R_AccumulateLightmap( uint *blocklights, const byte *samples, int count, uint scale );
 #define BOX_ON_PLANE_SIDE( emins, emaxs, p )           \
 	((( p )->type < 3 ) ?                              \
 	(                                                  \
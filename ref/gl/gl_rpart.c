@@ -42,7 +42,7 @@ static color24 gTracerColors[] =
 ================
 CL_DrawParticles
 
-update particle color, position, free expired and draw it
+draw particles, engine updates them after that
 ================
 */
 void CL_DrawParticles( double frametime, particle_t *cl_active_particles, float partsize )
@@ -103,8 +103,6 @@ void CL_DrawParticles( double frametime, particle_t *cl_active_particles, float
 			pglVertex3f( p->org[0] - right[0] - up[0], p->org[1] - right[1] - up[1], p->org[2] - right[2] - up[2] );
 			r_stats.c_particle_count++;
 		}
-
-		gEngfuncs.CL_ThinkParticle( frametime, p );
 	}
 
 	pglEnd();
@@ -17,6 +17,15 @@ GNU General Public License for more details.
 #include "xash3d_mathlib.h"
 #include "mod_local.h"
 
+#define MAX_LIGHTMAP_BUILDS	256
+
+typedef struct
+{
+	msurface_t	*surf;
+	byte		*dest;
+	uint		*blocklights;
+} lightmapbuild_t;
+
 typedef struct
 {
 	int		allocated[BLOCK_SIZE_MAX];
@@ -24,6 +33,11 @@ typedef struct
 	msurface_t	*dynamic_surfaces;
 	msurface_t	*lightmap_surfaces[MAX_LIGHTMAPS];
 	byte		lightmap_buffer[BLOCK_SIZE_MAX*BLOCK_SIZE_MAX*4];
+
+	// dynamic lightmaps waiting to be built before block upload
+	lightmapbuild_t	builds[MAX_LIGHTMAP_BUILDS];
+	int		numbuilds;
+	int		buildlights;	// used part of r_blocklights
 } gllightmapstate_t;
 
 static int		nColinElim; // stats
@@ -47,6 +61,7 @@ static msurface_t		*skychain = NULL;
 static gllightmapstate_t	gl_lms;
 
 static void LM_UploadBlock( qboolean dynamic );
+static void R_BuildQueuedLightmaps( void );
 static qboolean R_AddSurfToVBO( msurface_t *surf, qboolean buildlightmaps );
 static void R_DrawVBO( qboolean drawlightmaps, qboolean drawtextures );
 
@@ -529,7 +544,7 @@ static texture_t *R_TextureAnimation( msurface_t *s )
 R_AddDynamicLights
 ===============
 */
-static void R_AddDynamicLights( const msurface_t *surf )
+static void R_AddDynamicLights( const msurface_t *surf, uint *blocklights )
 {
 	const mextrasurf_t *info = surf->info;
 	int lnum, smax, tmax;
@@ -617,7 +632,7 @@ static void R_AddDynamicLights( const msurface_t *surf )
 
 				if( dist < minlight )
 				{
-					uint *bl = &r_blocklights[(s + (t * smax)) * 3];
+					uint *bl = &blocklights[(s + (t * smax)) * 3];
 
 					bl[0] += ((int)((rad - dist) * 256) * dl->color.r ) / 256;
 					bl[1] += ((int)((rad - dist) * 256) * dl->color.g ) / 256;
@@ -653,6 +668,10 @@ static void R_SetCacheState( msurface_t *surf )
 static void LM_InitBlock( void )
 {
 	memset( gl_lms.allocated, 0, sizeof( gl_lms.allocated ));
+
+	// queued builds were meant for the old block contents
+	gl_lms.numbuilds = 0;
+	gl_lms.buildlights = 0;
 }
 
 static int LM_AllocBlock( int w, int h, int *x, int *y )
@@ -695,6 +714,8 @@ static void LM_UploadDynamicBlock( void )
 {
 	int	height = 0, i;
 
+	R_BuildQueuedLightmaps();
+
 	for( i = 0; i < BLOCK_SIZE; i++ )
 	{
 		if( gl_lms.allocated[i] > height )
@@ -739,10 +760,10 @@ static void LM_UploadBlock( qboolean dynamic )
 R_BuildLightmap
 
 Combine and scale multiple lightmaps into the floating
-format in r_blocklights
+format in blocklights
 =================
 */
-static void R_BuildLightMap( const msurface_t *surf, byte *dest, int stride, qboolean dynamic )
+static void R_BuildLightMap( const msurface_t *surf, byte *dest, int stride, qboolean dynamic, uint *blocklights )
 {
 	int map, t;
 	const mextrasurf_t *info = surf->info;
@@ -757,31 +778,20 @@ static void R_BuildLightMap( const msurface_t *surf, byte *dest, int stride, qbo
 		lightscale = ( R_HasEnabledVBO() && !r_vbo_overbrightmode.value) ? 171 : 256;
 	else lightscale = ( pow( 2.0f, 1.0f / v_lightgamma->value ) * 256 ) + 0.5;
 
-	memset( r_blocklights, 0, sizeof( uint ) * size * 3 );
+	memset( blocklights, 0, sizeof( uint ) * size * 3 );
 
 	// add all the lightmaps
 	for( map = 0; map < MAXLIGHTMAPS && surf->samples; map++ )
 	{
-		const color24 *lm = &surf->samples[map * size];
-		uint scale;
-		int i;
-
 		if( surf->styles[map] >= 255 )
 			break;
 
-		scale = tr.lightstylevalue[surf->styles[map]];
-
-		for( i = 0; i < size; i++ )
-		{
-			r_blocklights[i * 3 + 0] += lm[i].r * scale;
-			r_blocklights[i * 3 + 1] += lm[i].g * scale;
-			r_blocklights[i * 3 + 2] += lm[i].b * scale;
-		}
+		R_AccumulateLightmap( blocklights, (const byte *)&surf->samples[map * size], size * 3, tr.lightstylevalue[surf->styles[map]] );
 	}
 
 	// add all the dynamic lights
 	if( surf->dlightframe == tr.framecount && dynamic )
-		R_AddDynamicLights( surf );
+		R_AddDynamicLights( surf, blocklights );
 
 	for( t = 0; t < tmax; t++ )
 	{
@@ -789,7 +799,7 @@ static void R_BuildLightMap( const msurface_t *surf, byte *dest, int stride, qbo
 
 		for( s = 0; s < smax; s++ )
 		{
-			const uint *bl = &r_blocklights[(s + (t * smax)) * 3];
+			const uint *bl = &blocklights[(s + (t * smax)) * 3];
 			byte *dst = &dest[(t * stride) + (s * 4)];
 			int i;
 
@@ -807,6 +817,81 @@ static void R_BuildLightMap( const msurface_t *surf, byte *dest, int stride, qbo
 	}
 }
 
+/*
+=============================================================================
+
+  LIGHTMAP BUILD JOBS
+
+Dynamic lightmaps are queued as their block space gets allocated and built
+by job threads right before the block is uploaded. Surfaces packed in one
+block never overlap, so they're written to the lightmap buffer in parallel,
+and the sum of their sizes fits in r_blocklights which is split between them.
+Results are the same as building them one by one on the main thread.
+
+=============================================================================
+*/
+/*
+=================
+R_QueueLightmapBuild
+=================
+*/
+static void R_QueueLightmapBuild( msurface_t *surf, byte *dest )
+{
+	const mextrasurf_t *info = surf->info;
+	const int sample_size = gEngfuncs.Mod_SampleSizeForFace( surf );
+	const int smax = ( info->lightextents[0] / sample_size ) + 1;
+	const int tmax = ( info->lightextents[1] / sample_size ) + 1;
+	const int size = smax * tmax * 3;
+	lightmapbuild_t *build;
+
+	if( !gl_lightmap_threads.value || gEngfuncs.COM_NumJobThreads() <= 1 )
+	{
+		R_BuildLightMap( surf, dest, BLOCK_SIZE * 4, true, r_blocklights );
+		return;
+	}
+
+	if( gl_lms.numbuilds == MAX_LIGHTMAP_BUILDS || gl_lms.buildlights + size > ARRAYSIZE( r_blocklights ))
+		R_BuildQueuedLightmaps();
+
+	build = &gl_lms.builds[gl_lms.numbuilds++];
+	build->surf = surf;
+	build->dest = dest;
+	build->blocklights = &r_blocklights[gl_lms.buildlights];
+	gl_lms.buildlights += size;
+}
+
+/*
+=================
+R_LightmapBuildJob
+=================
+*/
+static void R_LightmapBuildJob( void *ctx, int start, int end )
+{
+	int i;
+
+	for( i = start; i < end; i++ )
+	{
+		const lightmapbuild_t *build = &gl_lms.builds[i];
+
+		R_BuildLightMap( build->surf, build->dest, BLOCK_SIZE * 4, true, build->blocklights );
+	}
+}
+
+/*
+=================
+R_BuildQueuedLightmaps
+=================
+*/
+static void R_BuildQueuedLightmaps( void )
+{
+	if( !gl_lms.numbuilds )
+		return;
+
+	gEngfuncs.COM_ParallelFor( gl_lms.numbuilds, 1, R_LightmapBuildJob, NULL );
+	gl_lms.numbuilds = 0;
+	gl_lms.buildlights = 0;
+}
+
 /*
 ================
 DrawGLPoly
@@ -1013,7 +1098,7 @@ static void R_BlendLightmaps( void )
 				base = gl_lms.lightmap_buffer;
 				base += ( surf->info->dlight_t * BLOCK_SIZE + surf->info->dlight_s ) * 4;
 
-				R_BuildLightMap( surf, base, BLOCK_SIZE * 4, true );
+				R_QueueLightmapBuild( surf, base );
 			}
 			else
 			{
@@ -1045,7 +1130,7 @@ static void R_BlendLightmaps( void )
 				base = gl_lms.lightmap_buffer;
 				base += ( surf->info->dlight_t * BLOCK_SIZE + surf->info->dlight_s ) * 4;
 
-				R_BuildLightMap( surf, base, BLOCK_SIZE * 4, true );
+				R_QueueLightmapBuild( surf, base );
 			}
 		}
 
@@ -1264,7 +1349,7 @@ static qboolean R_CheckLightMap( msurface_t *fa )
 			tmax = ( info->lightextents[1] / sample_size ) + 1;
 
 			if( smax < 132 && tmax < 132 )
-				R_BuildLightMap( fa, temp, smax * 4, true );
+				R_BuildLightMap( fa, temp, smax * 4, true, r_blocklights );
 			else
 			{
 				smax = Q_min( smax, 132 );
@@ -2802,7 +2887,7 @@ static void R_DrawVBODlights( vboarray_t *vbo, vbotexture_t *vbotex, texture_t *
 				base = gl_lms.lightmap_buffer;
 				base += ( info->dlight_t * BLOCK_SIZE + info->dlight_s ) * 4;
 
-				R_BuildLightMap( surf, base, BLOCK_SIZE * 4, true );
+				R_QueueLightmapBuild( surf, base );
 			}
 			else
 			{
@@ -2842,7 +2927,7 @@ static void R_DrawVBODlights( vboarray_t *vbo, vbotexture_t *vbotex, texture_t *
 				base = gl_lms.lightmap_buffer;
 				base += ( info->dlight_t * BLOCK_SIZE + info->dlight_s ) * 4;
 
-				R_BuildLightMap( surf, base, BLOCK_SIZE * 4, true );
+				R_QueueLightmapBuild( surf, base );
 			}
 
 			// build index and texcoords arrays
@@ -3780,7 +3865,7 @@ static void GL_CreateSurfaceLightmap( msurface_t *surf, model_t *loadmodel )
 	base += ( surf->light_t * BLOCK_SIZE + surf->light_s ) * 4;
 
 	R_SetCacheState( surf );
-	R_BuildLightMap( surf, base, BLOCK_SIZE * 4, false );
+	R_BuildLightMap( surf, base, BLOCK_SIZE * 4, false, r_blocklights );
 }
 
 /*
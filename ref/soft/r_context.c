@@ -292,14 +292,48 @@ static void GAME_EXPORT GL_SetTexCoordArrayMode( uint mode )
 
 }
 
+static char r_speeds_msg[MAX_SYSPATH];
+
 static void GAME_EXPORT GL_BackendStartFrame( void )
 {
+	r_speeds_msg[0] = '\0';
 
+	// counters grow every frame, even when r_speeds is off
+	memset( &r_stats, 0, sizeof( r_stats ));
 }
 
 static void GAME_EXPORT GL_BackendEndFrame( void )
 {
+	int used, total;
+
+	if( r_speeds->value <= 0 || !RI.drawWorld )
+		return;
 
+	switch( (int)r_speeds->value )
+	{
+	case 1:
+		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i wpoly, %3i apoly\n%3i epoly, %3i spoly",
+			r_stats.c_world_polys, r_stats.c_alias_polys, r_stats.c_studio_polys, r_stats.c_sprite_polys );
+		break;
+	case 2:
+		used = D_SurfaceCacheUsage( &total );
+		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "surface cache:\n%3i hits, %3i misses\n%3i built on job threads\n%3i evicted%s\n%s of %s used",
+			r_stats.c_surfcache_hits, r_stats.c_surfcache_misses, r_stats.c_surfcache_jobs, r_stats.c_surfcache_evicts,
+			r_cache_thrash ? " (thrashing)" : "", Q_memprint( used ), Q_memprint( total ));
+		break;
+	case 3:
+		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i alias models drawn\n%3i studio models drawn\n%3i sprites drawn",
+			r_stats.c_alias_models_drawn, r_stats.c_studio_models_drawn, r_stats.c_sprite_models_drawn );
+		break;
+	case 4:
+		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i static entities\n%3i normal entities\n%3i server entities",
+			r_numStatics, r_numEntities - r_numStatics, (int)ENGINE_GET_PARM( PARM_NUMENTITIES ));
+		break;
+	case 5:
+		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i tempents\n%3i viewbeams\n%3i particles",
+			r_stats.c_active_tents_count, r_stats.c_view_beams_count, r_stats.c_particle_count );
+		break;
+	}
 }
 
 
@@ -386,7 +420,19 @@ void GAME_EXPORT Mod_SetOrthoBounds( const float *mins, const float *maxs )
 
 qboolean GAME_EXPORT R_SpeedsMessage( char *out, size_t size )
 {
-	return false;
+	if( gEngfuncs.drawFuncs->R_SpeedsMessage != NULL )
+	{
+		if( gEngfuncs.drawFuncs->R_SpeedsMessage( out, size ))
+			return true;
+		// otherwise pass to default handler
+	}
+
+	if( r_speeds->value <= 0 ) return false;
+	if( !out || !size ) return false;
+
+	Q_strncpy( out, r_speeds_msg, size );
+
+	return true;
 }
 
 byte *GAME_EXPORT Mod_GetCurrentVis( void )
@@ -709,6 +709,7 @@ surfcache_t *pcurrentcache;
 vec3_t      transformed_modelorg;
 vec3_t      world_transformed_modelorg;
 vec3_t      local_modelorg;
+static qboolean d_deferspans;
 
 /*
 =============
@@ -734,6 +735,25 @@ static int D_MipLevelForScale( float scale )
 	return lmiplevel;
 }
 
+/*
+=============
+D_SurfMipLevel
+=============
+*/
+static int D_SurfMipLevel( const surf_t *s, const msurface_t *pface )
+{
+	int lmiplevel;
+
+	if( pface->flags & SURF_CONVEYOR )
+		lmiplevel = 1;
+	else
+		lmiplevel = D_MipLevelForScale( s->nearzi * scale_for_mip );
+	while( 1 << lmiplevel > gEngfuncs.Mod_SampleSizeForFace( pface ))
+		lmiplevel--;
+
+	return lmiplevel;
+}
+
 
 /*
 ==============
@@ -1055,12 +1075,7 @@ static void D_SolidSurf( surf_t *s )
 	if( !pface )
 		return;
 
-	if( pface->flags & SURF_CONVEYOR )
-		miplevel = 1;
-	else
-		miplevel = D_MipLevelForScale( s->nearzi * scale_for_mip );
-	while( 1 << miplevel > gEngfuncs.Mod_SampleSizeForFace( pface ))
-		miplevel--;
+	miplevel = D_SurfMipLevel( s, pface );
 
 	// FIXME: make this passed in to D_CacheSurface
 	pcurrentcache = D_CacheSurface( pface, miplevel );
@@ -1070,9 +1085,15 @@ static void D_SolidSurf( surf_t *s )
 
 	D_CalcGradients( pface );
 
-	D_DrawSpans16( s->spans );
-
-	D_DrawZSpans( s->spans );
+	if( d_deferspans )
+	{
+		D_DeferSpans( s->spans, pcurrentcache );
+	}
+	else
+	{
+		D_DrawSpans16( s->spans );
+		D_DrawZSpans( s->spans );
+	}
 
 	if( s->insubmodel )
 	{
@@ -1118,6 +1139,43 @@ static void D_DrawflatSurfaces( void )
 	}
 }
 
+/*
+==============
+D_BuildWorldSurfaces
+
+Rebuild outdated world surface caches on job threads before drawing,
+submodel surfaces depend on entity state and are left to D_SolidSurf
+==============
+*/
+static void D_BuildWorldSurfaces( void )
+{
+	cl_entity_t *oldentity = RI.currententity;
+	qboolean    oldidentity = tr.modelviewIdentity;
+	surf_t      *s;
+
+	if( !sw_threads.value || gEngfuncs.COM_NumJobThreads() <= 1 )
+		return;
+
+	RI.currententity = CL_GetEntityByIndex( 0 ); // r_worldentity;
+	tr.modelviewIdentity = true;
+
+	for( s = &surfaces[1]; s < surface_p; s++ )
+	{
+		if( !s->spans || !s->msurf || s->insubmodel )
+			continue;
+
+		if( FBitSet( s->flags, SURF_DRAWSKY|SURF_DRAWTURB ))
+			continue;
+
+		if( !D_QueueSurfaceBuild( s->msurf, D_SurfMipLevel( s, s->msurf )))
+			break;
+	}
+
+	D_BuildQueuedSurfaces();
+	RI.currententity = oldentity;
+	tr.modelviewIdentity = oldidentity;
+}
+
 /*
 ==============
 D_DrawSurfaces
@@ -1137,6 +1195,12 @@ void D_DrawSurfaces( void )
 
 	if( !sw_drawflat.value )
 	{
+		if( !alphaspans )
+			D_BuildWorldSurfaces();
+
+		// solid spans are filled by job threads after all surfaces were set up
+		d_deferspans = !alphaspans && D_BeginDeferredSpans();
+
 		for( s = &surfaces[1]; s < surface_p; s++ )
 		{
 			if( !s->spans )
@@ -1151,6 +1215,14 @@ void D_DrawSurfaces( void )
 			else
 				D_SolidSurf( s );
 		}
+
+		if( d_deferspans )
+		{
+			D_EndDeferredSpans();
+			d_deferspans = false;
+		}
+
+		D_EndSurfaceBuilds();
 	}
 	else
 		D_DrawflatSurfaces();
@@ -324,6 +324,11 @@ typedef struct
 	uint   c_particle_count;
 
 	uint   c_client_ents;           // entities that moved to client
+
+	uint   c_surfcache_hits;
+	uint   c_surfcache_misses;      // surfaces that were rebuilt
+	uint   c_surfcache_jobs;        // rebuilt on job threads
+	uint   c_surfcache_evicts;
 	double t_world_node;
 	double t_world_draw;
 } ref_speeds_t;
@@ -855,6 +860,23 @@ typedef struct
 	int        surfmip;                     // mipmapped ratio of surface texels / world pixels
 	int        surfwidth;                   // in mipmapped texels
 	int        surfheight;                  // in mipmapped texels
+
+	// lighting, set up before building
+	unsigned   *blocklights;
+	qboolean   identity;                    // dynamic lights are in world space
+	matrix4x4  objectmatrix;                // otherwise transform them by this
+
+	// block drawer state, filled by R_DrawSurface
+	unsigned   *lightptr;
+	int        lightwidth;
+	int        numvblocks;
+	int        blocksize;
+	int        sourcetstep;
+	int        stepback;
+	pixel_t    *sourcemax;
+	pixel_t    *basesource;
+	pixel_t    *rowdestbase;
+	float      worldlux_s;
 } drawsurf_t;
 
 // clipped bmodel edges
@@ -879,11 +901,16 @@ typedef struct clipplane_s
 
 typedef struct surfcache_s
 {
-	struct surfcache_s *next;
+	struct surfcache_s *next;                       // LRU order or free list of the same size class
+	struct surfcache_s *prev;
 	struct surfcache_s **owner;                     // NULL is an empty chunk of memory
 	int                lightadj[MAXLIGHTMAPS];      // checked for strobe flush
 	int                dlight;
 	int                size;                                // including header
+	int                order;                       // size class of free block or the one surface was taken from
+	int                lastframe;                   // when it was used last time
+	int                buildseq;                    // built by job threads in this batch
+	uint               deferseq;                    // read by deferred spans of this batch
 	unsigned           width;
 	unsigned           height;                      // DEBUG only needed for debug
 	float              mipscale;
@@ -898,6 +925,19 @@ typedef struct espan_s
 	struct espan_s *pnext;
 } espan_t;
 
+// everything span fillers need to texture a surface,
+// so spans can be filled after the globals were changed
+typedef struct spanstate_s
+{
+	pixel_t   *cacheblock;
+	int       cachewidth;
+	float     sdivzstepu, tdivzstepu, zistepu;
+	float     sdivzstepv, tdivzstepv, zistepv;
+	float     sdivzorigin, tdivzorigin, ziorigin;
+	fixed16_t sadjust, tadjust;
+	fixed16_t bbextents, bbextentt;
+} spanstate_t;
+
 
 // FIXME: compress, make a union if that will help
 // insubmodel is only 1, flags is fewer than 32, spanstate could be a byte
@@ -957,7 +997,6 @@ void D_ViewChanged( void );
 
 extern drawsurf_t r_drawsurf;
 
-void R_DrawSurface( void );
 
 // extern int              c_surf;
 
@@ -968,9 +1007,6 @@ extern byte r_warpbuffer[WARP_WIDTH * WARP_HEIGHT];
 
 extern float       scale_for_mip;
 
-extern qboolean    d_roverwrapped;
-extern surfcache_t *sc_rover;
-extern surfcache_t *d_initial_rover;
 
 extern float       d_sdivzstepu, d_tdivzstepu, d_zistepu;
 extern float       d_sdivzstepv, d_tdivzstepv, d_zistepv;
@@ -982,6 +1018,11 @@ extern fixed16_t   bbextents, bbextentt;
 
 void D_DrawSpans16( espan_t *pspans );
 void D_DrawZSpans( espan_t *pspans );
+qboolean D_BeginDeferredSpans( void );
+void D_DeferSpans( espan_t *pspans, surfcache_t *cache );
+void D_FlushDeferredSpans( void );
+void D_EndDeferredSpans( void );
+extern uint d_deferseq;
 void Turbulent8( espan_t *pspan );
 void NonTurbulent8( espan_t *pspan ); // PGM
 void D_BlendSpans16( espan_t *pspan, int alpha );
@@ -990,6 +1031,11 @@ void D_AddSpans16( espan_t *pspan );
 void TurbulentZ8( espan_t *pspan, int alpha );
 
 surfcache_t     *D_CacheSurface( msurface_t *surface, int miplevel );
+qboolean D_QueueSurfaceBuild( msurface_t *surface, int miplevel );
+void D_BuildQueuedSurfaces( void );
+void D_EndSurfaceBuilds( void );
+int D_SurfaceCacheUsage( int *total );
+extern qboolean r_cache_thrash;
 
 
 extern pixel_t      *d_viewbuffer;
@@ -1052,6 +1098,7 @@ extern convar_t sw_mipcap;
 extern convar_t sw_mipscale;
 extern convar_t sw_surfcacheoverride;
 extern convar_t sw_texfilt;
+extern convar_t sw_threads;
 extern convar_t r_traceglow;
 extern convar_t sw_noalphabrushes;
 extern convar_t r_studio_sort_textures;
@@ -69,8 +69,11 @@ static CVAR_DEFINE_AUTO( sw_notransbrushes, "0", FCVAR_GLCONFIG, "do not apply t
 CVAR_DEFINE_AUTO( sw_noalphabrushes, "0", FCVAR_GLCONFIG, "do not draw brush holes (faster)" );
 CVAR_DEFINE_AUTO( r_traceglow, "0", FCVAR_GLCONFIG, "cull flares behind models" );
 CVAR_DEFINE_AUTO( sw_texfilt, "0", FCVAR_GLCONFIG, "texture dither" );
+CVAR_DEFINE_AUTO( sw_threads, "1", FCVAR_GLCONFIG, "fill solid surface spans on job threads" );
 static CVAR_DEFINE_AUTO( r_novis, "0", 0, "" );
 
+static qboolean r_testthreads; // set by sw_testthreads for the next frame
+
 
 DEFINE_ENGINE_SHARED_CVAR_LIST()
 
@@ -1291,6 +1294,70 @@ void R_SetupRefParams( const ref_viewpass_t *rvp )
 	VectorCopy( rvp->vieworigin, RI.pvsorigin );
 }
 
+/*
+===============
+R_TestThreadedScene
+
+renders the scene without and with job threads,
+pictures must be identical to the last bit
+===============
+*/
+static void R_TestThreadedScene( const ref_viewpass_t *rvp )
+{
+	const size_t pixels = vid.width * vid.height;
+	uint32_t     color[2], depth[2];
+	string       oldthreads;
+	int          i;
+
+	Q_strncpy( oldthreads, sw_threads.string, sizeof( oldthreads ));
+
+	for( i = 0; i < 2; i++ )
+	{
+		gEngfuncs.Cvar_SetValue( "sw_threads", i );
+
+		// both passes start from the same picture and build
+		// all surfaces from scratch, in threads on second pass
+		memset( vid.buffer, 0, pixels * sizeof( pixel_t ));
+		memset( d_pzbuffer, 0, pixels * sizeof( short ));
+		D_FlushCaches();
+
+		R_SetupRefParams( rvp );
+		R_RenderScene();
+
+		CRC32_Init( &color[i] );
+		CRC32_ProcessBuffer( &color[i], vid.buffer, pixels * sizeof( pixel_t ));
+		color[i] = CRC32_Final( color[i] );
+
+		CRC32_Init( &depth[i] );
+		CRC32_ProcessBuffer( &depth[i], d_pzbuffer, pixels * sizeof( short ));
+		depth[i] = CRC32_Final( depth[i] );
+	}
+
+	gEngfuncs.Cvar_Set( "sw_threads", oldthreads );
+	R_SetupRefParams( rvp );
+
+	if( color[0] == color[1] && depth[0] == depth[1] )
+	{
+		gEngfuncs.Con_Printf( "sw_testthreads: passed with %d job threads, color %08x, depth %08x\n",
+			gEngfuncs.COM_NumJobThreads(), color[0], depth[0] );
+	}
+	else
+	{
+		gEngfuncs.Con_Printf( S_ERROR "sw_testthreads: failed with %d job threads, color %08x != %08x, depth %08x != %08x\n",
+			gEngfuncs.COM_NumJobThreads(), color[0], color[1], depth[0], depth[1] );
+	}
+}
+
+/*
+===============
+R_TestThreads_f
+===============
+*/
+static void R_TestThreads_f( void )
+{
+	r_testthreads = true;
+}
+
 /*
 ===============
 R_RenderFrame
@@ -1327,6 +1394,13 @@ void GAME_EXPORT R_RenderFrame( const ref_viewpass_t *rvp )
 		R_RunViewmodelEvents();
 
 	tr.realframecount++; // right called after viewmodel events
+
+	if( r_testthreads && RI.drawWorld && WORLDMODEL )
+	{
+		r_testthreads = false;
+		R_TestThreadedScene( rvp );
+	}
+
 	R_RenderScene();
 
 	return;
@@ -1506,9 +1580,12 @@ qboolean GAME_EXPORT R_Init( void )
 #ifndef DISABLE_TEXFILTER
 	gEngfuncs.Cvar_RegisterVariable( &sw_texfilt );
 #endif
+	gEngfuncs.Cvar_RegisterVariable( &sw_threads );
 	gEngfuncs.Cvar_RegisterVariable( &r_novis );
 	gEngfuncs.Cvar_RegisterVariable( &r_studio_sort_textures );
 
+	gEngfuncs.Cmd_AddCommand( "sw_testthreads", R_TestThreads_f, "render next frame without and with job threads and compare the results" );
+
 	r_temppool = Mem_AllocPool( "ref_soft zone" );
 
 	glblit = !!gEngfuncs.Sys_CheckParm( "-glblit" );
@@ -1562,6 +1639,7 @@ qboolean GAME_EXPORT R_Init( void )
 
 void GAME_EXPORT R_Shutdown( void )
 {
+	gEngfuncs.Cmd_RemoveCommand( "sw_testthreads" );
 	R_ShutdownImages();
 	gEngfuncs.R_Free_Video();
 }
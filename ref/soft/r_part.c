@@ -42,7 +42,7 @@ static color24 gTracerColors[] =
 ================
 CL_DrawParticles
 
-update particle color, position, free expired and draw it
+draw particles, engine updates them after that
 ================
 */
 void GAME_EXPORT CL_DrawParticles( double frametime, particle_t *cl_active_particles, float partsize )
@@ -110,8 +110,6 @@ void GAME_EXPORT CL_DrawParticles( double frametime, particle_t *cl_active_parti
 			TriEnd();
 			r_stats.c_particle_count++;
 		}
-
-		gEngfuncs.CL_ThinkParticle( frametime, p );
 	}
 
 	TriEnd();
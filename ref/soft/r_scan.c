@@ -520,12 +520,12 @@ int kernel[2][2][2] =
 #endif
 /*
 =============
-D_DrawSpans16
+D_DrawSpans16State
 
   FIXME: actually make this subdivide by 16 instead of 8!!!
 =============
 */
-void D_DrawSpans16( espan_t *pspan )
+static void D_DrawSpans16State( const spanstate_t *st, espan_t *pspan )
 {
 	int       count, spancount;
 	pixel_t   *pbase, *pdest;
@@ -536,11 +536,11 @@ void D_DrawSpans16( espan_t *pspan )
 	sstep = 0; // keep compiler happy
 	tstep = 0; // ditto
 
-	pbase = cacheblock;
+	pbase = st->cacheblock;
 
-	sdivz8stepu = d_sdivzstepu * 8;
-	tdivz8stepu = d_tdivzstepu * 8;
-	zi8stepu = d_zistepu * 8;
+	sdivz8stepu = st->sdivzstepu * 8;
+	tdivz8stepu = st->tdivzstepu * 8;
+	zi8stepu = st->zistepu * 8;
 
 	do
 	{
@@ -553,20 +553,20 @@ void D_DrawSpans16( espan_t *pspan )
 		du = (float)pspan->u;
 		dv = (float)pspan->v;
 
-		sdivz = d_sdivzorigin + dv * d_sdivzstepv + du * d_sdivzstepu;
-		tdivz = d_tdivzorigin + dv * d_tdivzstepv + du * d_tdivzstepu;
-		zi = d_ziorigin + dv * d_zistepv + du * d_zistepu;
+		sdivz = st->sdivzorigin + dv * st->sdivzstepv + du * st->sdivzstepu;
+		tdivz = st->tdivzorigin + dv * st->tdivzstepv + du * st->tdivzstepu;
+		zi = st->ziorigin + dv * st->zistepv + du * st->zistepu;
 		z = (float)0x10000 / zi; // prescale to 16.16 fixed-point
 
-		s = (int)( sdivz * z ) + sadjust;
-		if( s > bbextents )
-			s = bbextents;
+		s = (int)( sdivz * z ) + st->sadjust;
+		if( s > st->bbextents )
+			s = st->bbextents;
 		else if( s < 0 )
 			s = 0;
 
-		t = (int)( tdivz * z ) + tadjust;
-		if( t > bbextentt )
-			t = bbextentt;
+		t = (int)( tdivz * z ) + st->tadjust;
+		if( t > st->bbextentt )
+			t = st->bbextentt;
 		else if( t < 0 )
 			t = 0;
 
@@ -589,17 +589,17 @@ void D_DrawSpans16( espan_t *pspan )
 				zi += zi8stepu;
 				z = (float)0x10000 / zi; // prescale to 16.16 fixed-point
 
-				snext = (int)( sdivz * z ) + sadjust;
-				if( snext > bbextents )
-					snext = bbextents;
+				snext = (int)( sdivz * z ) + st->sadjust;
+				if( snext > st->bbextents )
+					snext = st->bbextents;
 				else if( snext < 8 )
 					snext = 8; // prevent round-off error on <0 steps from
 				//  from causing overstepping & running off the
 				//  edge of the texture
 
-				tnext = (int)( tdivz * z ) + tadjust;
-				if( tnext > bbextentt )
-					tnext = bbextentt;
+				tnext = (int)( tdivz * z ) + st->tadjust;
+				if( tnext > st->bbextentt )
+					tnext = st->bbextentt;
 				else if( tnext < 8 )
 					tnext = 8; // guard against round-off error on <0 steps
 
@@ -613,21 +613,21 @@ void D_DrawSpans16( espan_t *pspan )
 				// span by division, biasing steps low so we don't run off the
 				// texture
 				spancountminus1 = (float)( spancount - 1 );
-				sdivz += d_sdivzstepu * spancountminus1;
-				tdivz += d_tdivzstepu * spancountminus1;
-				zi += d_zistepu * spancountminus1;
+				sdivz += st->sdivzstepu * spancountminus1;
+				tdivz += st->tdivzstepu * spancountminus1;
+				zi += st->zistepu * spancountminus1;
 				z = (float)0x10000 / zi; // prescale to 16.16 fixed-point
-				snext = (int)( sdivz * z ) + sadjust;
-				if( snext > bbextents )
-					snext = bbextents;
+				snext = (int)( sdivz * z ) + st->sadjust;
+				if( snext > st->bbextents )
+					snext = st->bbextents;
 				else if( snext < 8 )
 					snext = 8; // prevent round-off error on <0 steps from
 				//  from causing overstepping & running off the
 				//  edge of the texture
 
-				tnext = (int)( tdivz * z ) + tadjust;
-				if( tnext > bbextentt )
-					tnext = bbextentt;
+				tnext = (int)( tdivz * z ) + st->tadjust;
+				if( tnext > st->bbextentt )
+					tnext = st->bbextentt;
 				else if( tnext < 8 )
 					tnext = 8; // guard against round-off error on <0 steps
 
@@ -644,7 +644,7 @@ void D_DrawSpans16( espan_t *pspan )
 			{
 				do
 				{
-					*pdest++ = *( pbase + ( s >> 16 ) + ( t >> 16 ) * cachewidth );
+					*pdest++ = *( pbase + ( s >> 16 ) + ( t >> 16 ) * st->cachewidth );
 					s += sstep;
 					t += tstep;
 				}
@@ -672,7 +672,7 @@ void D_DrawSpans16( espan_t *pspan )
 					iditht = iditht ? iditht - 1 : iditht;
 
 
-					*pdest++ = *( pbase + idiths + iditht * cachewidth );
+					*pdest++ = *( pbase + idiths + iditht * st->cachewidth );
 					s += sstep;
 					t += tstep;
 				}
@@ -687,6 +687,43 @@ void D_DrawSpans16( espan_t *pspan )
 	while(( pspan = pspan->pnext ) != NULL );
 }
 
+/*
+=============
+D_GetSpanState
+=============
+*/
+static void D_GetSpanState( spanstate_t *st )
+{
+	st->cacheblock = cacheblock;
+	st->cachewidth = cachewidth;
+	st->sdivzstepu = d_sdivzstepu;
+	st->tdivzstepu = d_tdivzstepu;
+	st->zistepu = d_zistepu;
+	st->sdivzstepv = d_sdivzstepv;
+	st->tdivzstepv = d_tdivzstepv;
+	st->zistepv = d_zistepv;
+	st->sdivzorigin = d_sdivzorigin;
+	st->tdivzorigin = d_tdivzorigin;
+	st->ziorigin = d_ziorigin;
+	st->sadjust = sadjust;
+	st->tadjust = tadjust;
+	st->bbextents = bbextents;
+	st->bbextentt = bbextentt;
+}
+
+/*
+=============
+D_DrawSpans16
+=============
+*/
+void D_DrawSpans16( espan_t *pspan )
+{
+	spanstate_t st;
+
+	D_GetSpanState( &st );
+	D_DrawSpans16State( &st, pspan );
+}
+
 
 /*
 =============
@@ -1303,10 +1340,10 @@ void D_AddSpans16( espan_t *pspan )
 
 /*
 =============
-D_DrawZSpans
+D_DrawZSpansState
 =============
 */
-void D_DrawZSpans( espan_t *pspan )
+static void D_DrawZSpansState( const spanstate_t *st, espan_t *pspan )
 {
 	int      count, doublecount, izistep;
 	int      izi;
@@ -1317,7 +1354,7 @@ void D_DrawZSpans( espan_t *pspan )
 
 // FIXME: check for clamping/range problems
 // we count on FP exceptions being turned off to avoid range problems
-	izistep = (int)( d_zistepu * 0x8000 * 0x10000 );
+	izistep = (int)( st->zistepu * 0x8000 * 0x10000 );
 
 	do
 	{
@@ -1329,7 +1366,7 @@ void D_DrawZSpans( espan_t *pspan )
 		du = (float)pspan->u;
 		dv = (float)pspan->v;
 
-		zi = d_ziorigin + dv * d_zistepv + du * d_zistepu;
+		zi = st->ziorigin + dv * st->zistepv + du * st->zistepu;
 		// we count on FP exceptions being turned off to avoid range problems
 		izi = (int)( zi * 0x8000 * 0x10000 );
 
@@ -1361,3 +1398,198 @@ void D_DrawZSpans( espan_t *pspan )
 	while(( pspan = pspan->pnext ) != NULL );
 }
 
+/*
+=============
+D_DrawZSpans
+=============
+*/
+void D_DrawZSpans( espan_t *pspan )
+{
+	spanstate_t st;
+
+	st.zistepu = d_zistepu;
+	st.zistepv = d_zistepv;
+	st.ziorigin = d_ziorigin;
+	D_DrawZSpansState( &st, pspan );
+}
+
+
+/*
+==============================================================================
+
+DEFERRED SPANS
+
+The edge scanner guarantees that spans never overlap, so solid surface
+spans can be queued together with a copy of their gradients and filled
+later by job threads, each of them owning a band of screen rows. Queued
+spans are copied to lists of their band, so every job only walks its own
+spans. Every pixel is written by the same code from the same inputs, so
+the picture doesn't depend on number of threads.
+
+Queue is flushed when it's full, at the end of D_DrawSurfaces and when
+a cache block that queued spans read from is about to be evicted or
+rebuilt, see d_deferseq.
+
+==============================================================================
+*/
+#define MAX_DEFERRED_SURFS    2048
+#define MAX_SPAN_BANDS        128
+#define MIN_SPAN_BAND_HEIGHT  8
+#define SPAN_BANDS_PER_THREAD 4 // uneven bands are balanced between threads
+
+typedef struct bandsurf_s
+{
+	int               surf;  // index of gradients in d_deferred.surfs
+	espan_t           *spans;
+	struct bandsurf_s *next;
+} bandsurf_t;
+
+static struct
+{
+	spanstate_t    surfs[MAX_DEFERRED_SURFS];
+	int            numsurfs;
+	espan_t        spans[MAXSPANS];
+	int            numspans;
+	bandsurf_t     bandsurfs[MAXSPANS]; // every one has at least one span
+	int            numbandsurfs;
+	bandsurf_t     *bands[MAX_SPAN_BANDS];
+	int            numbands;
+	int            bandheight;
+} d_deferred;
+
+uint d_deferseq = 1; // cache blocks read by queued spans are marked with it
+
+/*
+=============
+D_BeginDeferredSpans
+
+returns false if spans should be filled immediately
+=============
+*/
+qboolean D_BeginDeferredSpans( void )
+{
+	int threads;
+
+	d_deferred.numsurfs = 0;
+	d_deferred.numbands = 0;
+
+	if( !sw_threads.value || RI.vrect.height <= MIN_SPAN_BAND_HEIGHT )
+		return false;
+
+	threads = gEngfuncs.COM_NumJobThreads();
+	if( threads <= 1 )
+		return false;
+
+	threads = Q_min( threads, MAX_SPAN_BANDS / SPAN_BANDS_PER_THREAD );
+
+	d_deferred.bandheight = ( RI.vrect.height + threads * SPAN_BANDS_PER_THREAD - 1 ) / ( threads * SPAN_BANDS_PER_THREAD );
+	d_deferred.bandheight = Q_max( d_deferred.bandheight, MIN_SPAN_BAND_HEIGHT );
+	d_deferred.numbands = ( RI.vrect.height + d_deferred.bandheight - 1 ) / d_deferred.bandheight;
+
+	return true;
+}
+
+/*
+=============
+D_DeferSpans
+
+queue spans of current surface, which uses cache, span
+list can be reused as soon as this returns
+=============
+*/
+void D_DeferSpans( espan_t *pspans, surfcache_t *cache )
+{
+	espan_t *span;
+	int     surf, count;
+
+	for( count = 0, span = pspans; span; span = span->pnext )
+		count++;
+
+	if( d_deferred.numsurfs == MAX_DEFERRED_SURFS || d_deferred.numspans + count > MAXSPANS )
+		D_FlushDeferredSpans();
+
+	surf = d_deferred.numsurfs++;
+	D_GetSpanState( &d_deferred.surfs[surf] );
+	cache->deferseq = d_deferseq;
+
+	for( span = pspans; span; span = span->pnext )
+	{
+		int        band = ( span->v - RI.vrect.y ) / d_deferred.bandheight;
+		espan_t    *copy = &d_deferred.spans[d_deferred.numspans++];
+		bandsurf_t *bs;
+
+		band = bound( 0, band, d_deferred.numbands - 1 );
+		bs = d_deferred.bands[band];
+
+		// spans of this surface already started a list in this band
+		if( !bs || bs->surf != surf )
+		{
+			bs = &d_deferred.bandsurfs[d_deferred.numbandsurfs++];
+			bs->surf = surf;
+			bs->spans = NULL;
+			bs->next = d_deferred.bands[band];
+			d_deferred.bands[band] = bs;
+		}
+
+		*copy = *span;
+		copy->pnext = bs->spans;
+		bs->spans = copy;
+	}
+}
+
+/*
+=============
+D_DeferredSpansJob
+=============
+*/
+static void D_DeferredSpansJob( void *ctx, int start, int end )
+{
+	bandsurf_t *bs;
+	int        i;
+
+	for( i = start; i < end; i++ )
+	{
+		for( bs = d_deferred.bands[i]; bs; bs = bs->next )
+		{
+			const spanstate_t *state = &d_deferred.surfs[bs->surf];
+
+			D_DrawSpans16State( state, bs->spans );
+			D_DrawZSpansState( state, bs->spans );
+		}
+	}
+}
+
+/*
+=============
+D_FlushDeferredSpans
+
+fill everything that was queued
+=============
+*/
+void D_FlushDeferredSpans( void )
+{
+	if( !d_deferred.numsurfs )
+		return;
+
+	gEngfuncs.COM_ParallelFor( d_deferred.numbands, 1, D_DeferredSpansJob, NULL );
+
+	memset( d_deferred.bands, 0, sizeof( d_deferred.bands[0] ) * d_deferred.numbands );
+	d_deferred.numsurfs = 0;
+	d_deferred.numspans = 0;
+	d_deferred.numbandsurfs = 0;
+
+	// nothing reads cache blocks marked so far
+	if( !++d_deferseq )
+		d_deferseq = 1;
+}
+
+/*
+=============
+D_EndDeferredSpans
+=============
+*/
+void D_EndDeferredSpans( void )
+{
+	D_FlushDeferredSpans();
+	d_deferred.numbands = 0;
+}
@@ -24,29 +24,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 drawsurf_t r_drawsurf;
 
-uint       lightleft, sourcesstep, blocksize, sourcetstep;
-uint       lightdelta, lightdeltastep;
-uint       lightright, lightleftstep, lightrightstep, blockdivshift;
-unsigned   blockdivmask;
-void       *prowdestbase;
-pixel_t    *pbasesource;
-int        surfrowbytes;                        // used by ASM files
-unsigned   *r_lightptr;
-int        r_stepback;
-int        r_lightwidth;
-int        r_numhblocks, r_numvblocks;
-pixel_t    *r_source, *r_sourcemax;
-
-void R_DrawSurfaceBlock8_mip0( void );
-void R_DrawSurfaceBlock8_mip1( void );
-void R_DrawSurfaceBlock8_mip2( void );
-void R_DrawSurfaceBlock8_mip3( void );
-void R_DrawSurfaceBlock8_Generic( void );
-void R_DrawSurfaceBlock8_World( void );
-
-static float    worldlux_s, worldlux_t;
-
-static void     (*surfmiptable[4])( void ) = {
+static void R_DrawSurfaceBlock8_mip0( drawsurf_t *ds );
+static void R_DrawSurfaceBlock8_mip1( drawsurf_t *ds );
+static void R_DrawSurfaceBlock8_mip2( drawsurf_t *ds );
+static void R_DrawSurfaceBlock8_mip3( drawsurf_t *ds );
+static void R_DrawSurfaceBlock8_Generic( drawsurf_t *ds );
+static void R_DrawSurfaceBlock8_World( drawsurf_t *ds );
+
+static void     (*surfmiptable[4])( drawsurf_t *ds ) = {
 	R_DrawSurfaceBlock8_mip0,
 	R_DrawSurfaceBlock8_mip1,
 	R_DrawSurfaceBlock8_mip2,
@@ -56,22 +41,18 @@ static void     (*surfmiptable[4])( void ) = {
 // void R_BuildLightMap (void);
 extern unsigned blocklights[10240]; // allow some very large lightmaps
 
-float           surfscale;
 qboolean        r_cache_thrash;         // set if surface cache is thrashing
 
-int sc_size;
-surfcache_t     *sc_rover, *sc_base;
-
 static int      rtable[MOD_FRAMES][MOD_FRAMES];
 
-static void R_BuildLightMap( void );
 /*
 ===============
 R_AddDynamicLights
 ===============
 */
-static void R_AddDynamicLights( const msurface_t *surf )
+static void R_AddDynamicLights( drawsurf_t *ds )
 {
+	const msurface_t   *surf = ds->surf;
 	const mextrasurf_t *info = surf->info;
 	int        lnum, smax, tmax;
 	int        sample_frac = 1.0;
@@ -111,8 +92,8 @@ static void R_AddDynamicLights( const msurface_t *surf )
 		dl = &tr.dlights[lnum];
 
 		// transform light origin to local bmodel space
-		if( !tr.modelviewIdentity )
-			Matrix4x4_VectorITransform( RI.objectMatrix, dl->origin, origin_l );
+		if( !ds->identity )
+			Matrix4x4_VectorITransform( ds->objectmatrix, dl->origin, origin_l );
 		else
 			VectorCopy( dl->origin, origin_l );
 
@@ -163,7 +144,7 @@ static void R_AddDynamicLights( const msurface_t *surf )
 
 				if( dist < minlight )
 				{
-					blocklights[( s + ( t * smax ))] += ((int)(( rad - dist ) * 256 ) * monolight ) / 256;
+					ds->blocklights[( s + ( t * smax ))] += ((int)(( rad - dist ) * 256 ) * monolight ) / 256;
 				}
 			}
 		}
@@ -179,10 +160,10 @@ Combine and scale multiple lightmaps into the floating
 format in r_blocklights
 =================
 */
-static void R_BuildLightMap( void )
+static void R_BuildLightMap( drawsurf_t *ds )
 {
 	int                map, t, i;
-	const msurface_t   *surf = r_drawsurf.surf;
+	const msurface_t   *surf = ds->surf;
 	const mextrasurf_t *info = surf->info;
 	const int          sample_size = gEngfuncs.Mod_SampleSizeForFace( surf );
 	int                smax = ( info->lightextents[0] / sample_size ) + 1;
@@ -193,11 +174,11 @@ static void R_BuildLightMap( void )
 	{
 		smax = ( info->lightextents[0] * 3 / sample_size ) + 1;
 		size = smax * tmax;
-		memset( blocklights, 0xff, sizeof( uint ) * size );
+		memset( ds->blocklights, 0xff, sizeof( uint ) * size );
 		return;
 	}
 
-	memset( blocklights, 0, sizeof( uint ) * size );
+	memset( ds->blocklights, 0, sizeof( uint ) * size );
 
 	// add all the lightmaps
 	for( map = 0; map < MAXLIGHTMAPS && surf->samples; map++ )
@@ -212,20 +193,20 @@ static void R_BuildLightMap( void )
 		scale = tr.lightstylevalue[surf->styles[map]];
 
 		for( i = 0; i < size; i++ )
-			blocklights[i] += ( lm[i].r + lm[i].g + lm[i].b ) * scale;
+			ds->blocklights[i] += ( lm[i].r + lm[i].g + lm[i].b ) * scale;
 	}
 
 	// add all the dynamic lights
 	if( surf->dlightframe == tr.framecount )
-		R_AddDynamicLights( surf );
+		R_AddDynamicLights( ds );
 
 	// bound, invert, and shift
 	for( i = 0; i < size; i++ )
 	{
-		if( blocklights[i] < 65280 )
-			t = LightToTexGamma( blocklights[i] >> 6 ) << 6;
+		if( ds->blocklights[i] < 65280 )
+			t = LightToTexGamma( ds->blocklights[i] >> 6 ) << 6;
 		else
-			t = (int)blocklights[i];
+			t = (int)ds->blocklights[i];
 
 		t = bound( 0, t, 65535 * 3 );
 		t = t / 2048 / 3; // (255*256 - t) >> (8 - VID_CBITS);
@@ -234,7 +215,7 @@ static void R_BuildLightMap( void )
 		// t = (1 << 6);
 		t = t << 8;
 
-		blocklights[i] = t;
+		ds->blocklights[i] = t;
 	}
 }
 
@@ -363,7 +344,7 @@ static texture_t *R_TextureAnimation( msurface_t *s )
 R_DrawSurface
 ===============
 */
-void R_DrawSurface( void )
+static void R_DrawSurface( drawsurf_t *ds )
 {
 	pixel_t *basetptr;
 	int     smax, tmax, twidth;
@@ -371,13 +352,13 @@ void R_DrawSurface( void )
 	int     soffset, basetoffset, texwidth;
 	int     horzblockstep;
 	pixel_t *pcolumndest;
-	void    (*pblockdrawer)( void );
+	void    (*pblockdrawer)( drawsurf_t *ds );
 	image_t *mt;
 	uint    sample_size, sample_bits, sample_pot;
+	int     blockdivshift, numhblocks;
+	pixel_t *source;
 
-	surfrowbytes = r_drawsurf.rowbytes;
-
-	sample_size = LM_SAMPLE_SIZE_AUTO( r_drawsurf.surf );
+	sample_size = LM_SAMPLE_SIZE_AUTO( ds->surf );
 	if( sample_size == 16 )
 		sample_bits = 4, sample_pot = sample_size;
 	else
@@ -393,78 +374,74 @@ void R_DrawSurface( void )
 		else
 			sample_pot = 1 << sample_bits;
 	}
-	mt = r_drawsurf.image;
+	mt = ds->image;
 
-	r_source = mt->pixels[r_drawsurf.surfmip];
+	source = mt->pixels[ds->surfmip];
 
 // the fractional light values should range from 0 to (VID_GRADES - 1) << 16
 // from a source range of 0 - 255
 
-	texwidth = mt->width >> r_drawsurf.surfmip;
+	texwidth = mt->width >> ds->surfmip;
 
-	blocksize = sample_pot >> r_drawsurf.surfmip;
-	blockdivshift = sample_bits - r_drawsurf.surfmip;
-	blockdivmask = ( 1 << blockdivshift ) - 1;
+	ds->blocksize = sample_pot >> ds->surfmip;
+	blockdivshift = sample_bits - ds->surfmip;
 
 	if( sample_size == 16 )
-		r_lightwidth = ( r_drawsurf.surf->info->lightextents[0] >> 4 ) + 1;
+		ds->lightwidth = ( ds->surf->info->lightextents[0] >> 4 ) + 1;
 	else
-		r_lightwidth = ( r_drawsurf.surf->info->lightextents[0] / sample_size ) + 1;
+		ds->lightwidth = ( ds->surf->info->lightextents[0] / sample_size ) + 1;
 
-	r_numhblocks = r_drawsurf.surfwidth >> blockdivshift;
-	r_numvblocks = r_drawsurf.surfheight >> blockdivshift;
+	numhblocks = ds->surfwidth >> blockdivshift;
+	ds->numvblocks = ds->surfheight >> blockdivshift;
 
 
 // ==============================
 
 	if( sample_size == 16 )
-		pblockdrawer = surfmiptable[r_drawsurf.surfmip];
+		pblockdrawer = surfmiptable[ds->surfmip];
 	else
 		pblockdrawer = R_DrawSurfaceBlock8_Generic;
 
 // TODO: only needs to be set when there is a display settings change
-	horzblockstep = blocksize;
+	horzblockstep = ds->blocksize;
 
-	smax = mt->width >> r_drawsurf.surfmip;
+	smax = mt->width >> ds->surfmip;
 	twidth = texwidth;
-	tmax = mt->height >> r_drawsurf.surfmip;
-	sourcetstep = texwidth;
-	r_stepback = tmax * twidth;
+	tmax = mt->height >> ds->surfmip;
+	ds->sourcetstep = texwidth;
+	ds->stepback = tmax * twidth;
 
-	r_sourcemax = r_source + ( tmax * smax );
+	ds->sourcemax = source + ( tmax * smax );
 
 	// glitchy and slow way to draw some lightmap
-	if( r_drawsurf.surf->texinfo->flags & TEX_WORLD_LUXELS )
+	if( ds->surf->texinfo->flags & TEX_WORLD_LUXELS )
 	{
-		worldlux_s = r_drawsurf.surf->extents[0] / r_drawsurf.surf->info->lightextents[0];
-		worldlux_t = r_drawsurf.surf->extents[1] / r_drawsurf.surf->info->lightextents[1];
-		if( worldlux_s == 0 )
-			worldlux_s = 1;
-		if( worldlux_t == 0 )
-			worldlux_t = 1;
-
-		soffset = r_drawsurf.surf->texturemins[0];
-		basetoffset = r_drawsurf.surf->texturemins[1];
-		// soffset =  r_drawsurf.surf->info->lightmapmins[0] * worldlux_s;
-		// basetoffset = r_drawsurf.surf->info->lightmapmins[1] * worldlux_t;
+		ds->worldlux_s = ds->surf->extents[0] / ds->surf->info->lightextents[0];
+		if( ds->worldlux_s == 0 )
+			ds->worldlux_s = 1;
+
+		soffset = ds->surf->texturemins[0];
+		basetoffset = ds->surf->texturemins[1];
+		// soffset =  ds->surf->info->lightmapmins[0] * worldlux_s;
+		// basetoffset = ds->surf->info->lightmapmins[1] * worldlux_t;
 		// << 16 components are to guarantee positive values for %
-		soffset = (( soffset >> r_drawsurf.surfmip ) + ( smax << 16 )) % smax;
-		basetptr = &r_source[(((( basetoffset >> r_drawsurf.surfmip )
+		soffset = (( soffset >> ds->surfmip ) + ( smax << 16 )) % smax;
+		basetptr = &source[(((( basetoffset >> ds->surfmip )
 					+ ( tmax << 16 )) % tmax ) * twidth )];
 
-		pcolumndest = r_drawsurf.surfdat;
+		pcolumndest = ds->surfdat;
 
-		for( u = 0; u < r_numhblocks; u++ )
+		for( u = 0; u < numhblocks; u++ )
 		{
-			r_lightptr = blocklights + (int)( u / ( worldlux_s + 0.5f ));
+			ds->lightptr = ds->blocklights + (int)( u / ( ds->worldlux_s + 0.5f ));
 
-			prowdestbase = pcolumndest;
+			ds->rowdestbase = pcolumndest;
 
-			pbasesource = basetptr + soffset;
+			ds->basesource = basetptr + soffset;
 
-			R_DrawSurfaceBlock8_World();
+			R_DrawSurfaceBlock8_World( ds );
 
-			soffset = soffset + blocksize;
+			soffset = soffset + ds->blocksize;
 			if( soffset >= smax )
 				soffset = 0;
 
@@ -473,27 +450,27 @@ void R_DrawSurface( void )
 		return;
 	}
 
-	soffset = r_drawsurf.surf->info->lightmapmins[0];
-	basetoffset = r_drawsurf.surf->info->lightmapmins[1];
+	soffset = ds->surf->info->lightmapmins[0];
+	basetoffset = ds->surf->info->lightmapmins[1];
 
 // << 16 components are to guarantee positive values for %
-	soffset = (( soffset >> r_drawsurf.surfmip ) + ( smax << 16 )) % smax;
-	basetptr = &r_source[(((( basetoffset >> r_drawsurf.surfmip )
+	soffset = (( soffset >> ds->surfmip ) + ( smax << 16 )) % smax;
+	basetptr = &source[(((( basetoffset >> ds->surfmip )
 				+ ( tmax << 16 )) % tmax ) * twidth )];
 
-	pcolumndest = r_drawsurf.surfdat;
+	pcolumndest = ds->surfdat;
 
-	for( u = 0; u < r_numhblocks; u++ )
+	for( u = 0; u < numhblocks; u++ )
 	{
-		r_lightptr = blocklights + u;
+		ds->lightptr = ds->blocklights + u;
 
-		prowdestbase = pcolumndest;
+		ds->rowdestbase = pcolumndest;
 
-		pbasesource = basetptr + soffset;
+		ds->basesource = basetptr + soffset;
 
-		( *pblockdrawer )();
+		( *pblockdrawer )( ds );
 
-		soffset = soffset + blocksize;
+		soffset = soffset + ds->blocksize;
 		if( soffset >= smax )
 			soffset = 0;
 
@@ -515,36 +492,37 @@ R_DrawSurfaceBlock8_World
 Does not draw lightmap correclty, but scale it correctly. Better than nothing
 ================
 */
-void R_DrawSurfaceBlock8_World( void )
+static void R_DrawSurfaceBlock8_World( drawsurf_t *ds )
 {
 	int     v, i, b;
 	uint    lightstep, lighttemp, light;
+	uint    lightleft, lightright, lightleftstep, lightrightstep;
+	uint    *lightptr = ds->lightptr;
 	pixel_t pix, *psource, *prowdest;
 	int     lightpos = 0;
 
-	psource = pbasesource;
-	prowdest = prowdestbase;
+	psource = ds->basesource;
+	prowdest = ds->rowdestbase;
 
-	for( v = 0; v < r_numvblocks; v++ )
+	for( v = 0; v < ds->numvblocks; v++ )
 	{
-		// FIXME: make these locals?
 		// FIXME: use delta rather than both right and left, like ASM?
-		lightleft = r_lightptr[( lightpos / r_lightwidth ) * r_lightwidth];
-		lightright = r_lightptr[( lightpos / r_lightwidth ) * r_lightwidth + 1];
-		lightpos += r_lightwidth / worldlux_s;
-		lightleftstep = ( r_lightptr[( lightpos / r_lightwidth ) * r_lightwidth] - lightleft ) >> ( 4 - r_drawsurf.surfmip );
-		lightrightstep = ( r_lightptr[( lightpos / r_lightwidth ) * r_lightwidth + 1] - lightright ) >> ( 4 - r_drawsurf.surfmip );
+		lightleft = lightptr[( lightpos / ds->lightwidth ) * ds->lightwidth];
+		lightright = lightptr[( lightpos / ds->lightwidth ) * ds->lightwidth + 1];
+		lightpos += ds->lightwidth / ds->worldlux_s;
+		lightleftstep = ( lightptr[( lightpos / ds->lightwidth ) * ds->lightwidth] - lightleft ) >> ( 4 - ds->surfmip );
+		lightrightstep = ( lightptr[( lightpos / ds->lightwidth ) * ds->lightwidth + 1] - lightright ) >> ( 4 - ds->surfmip );
 
-		for( i = 0; i < blocksize; i++ )
+		for( i = 0; i < ds->blocksize; i++ )
 		{
 			lighttemp = lightleft - lightright;
-			lightstep = lighttemp >> ( 4 - r_drawsurf.surfmip );
+			lightstep = lighttemp >> ( 4 - ds->surfmip );
 
 			light = lightright;
 
-			for( b = blocksize - 1; b >= 0; b-- )
+			for( b = ds->blocksize - 1; b >= 0; b-- )
 			{
-				// pix = psource[(uint)(b * worldlux_s)];
+				// pix = psource[(uint)(b * ds->worldlux_s)];
 				pix = psource[b];
 				prowdest[b] = BLEND_LM( pix, light );
 				if( pix == TRANSPARENT_COLOR )
@@ -554,14 +532,14 @@ void R_DrawSurfaceBlock8_World( void )
 				light += lightstep;
 			}
 
-			psource += sourcetstep;
+			psource += ds->sourcetstep;
 			lightright += lightrightstep;
 			lightleft += lightleftstep;
-			prowdest += surfrowbytes;
+			prowdest += ds->rowbytes;
 		}
 
-		if( psource >= r_sourcemax )
-			psource -= r_stepback;
+		if( psource >= ds->sourcemax )
+			psource -= ds->stepback;
 	}
 }
 
@@ -571,33 +549,34 @@ void R_DrawSurfaceBlock8_World( void )
 R_DrawSurfaceBlock8_Generic
 ================
 */
-void R_DrawSurfaceBlock8_Generic( void )
+static void R_DrawSurfaceBlock8_Generic( drawsurf_t *ds )
 {
 	int     v, i, b;
 	uint    lightstep, lighttemp, light;
+	uint    lightleft, lightright, lightleftstep, lightrightstep;
+	uint    *lightptr = ds->lightptr;
 	pixel_t pix, *psource, *prowdest;
 
-	psource = pbasesource;
-	prowdest = prowdestbase;
+	psource = ds->basesource;
+	prowdest = ds->rowdestbase;
 
-	for( v = 0; v < r_numvblocks; v++ )
+	for( v = 0; v < ds->numvblocks; v++ )
 	{
-		// FIXME: make these locals?
 		// FIXME: use delta rather than both right and left, like ASM?
-		lightleft = r_lightptr[0];
-		lightright = r_lightptr[1];
-		r_lightptr += r_lightwidth;
-		lightleftstep = ( r_lightptr[0] - lightleft ) >> ( 4 - r_drawsurf.surfmip );
-		lightrightstep = ( r_lightptr[1] - lightright ) >> ( 4 - r_drawsurf.surfmip );
+		lightleft = lightptr[0];
+		lightright = lightptr[1];
+		lightptr += ds->lightwidth;
+		lightleftstep = ( lightptr[0] - lightleft ) >> ( 4 - ds->surfmip );
+		lightrightstep = ( lightptr[1] - lightright ) >> ( 4 - ds->surfmip );
 
-		for( i = 0; i < blocksize; i++ )
+		for( i = 0; i < ds->blocksize; i++ )
 		{
 			lighttemp = lightleft - lightright;
-			lightstep = lighttemp >> ( 4 - r_drawsurf.surfmip );
+			lightstep = lighttemp >> ( 4 - ds->surfmip );
 
 			light = lightright;
 
-			for( b = blocksize - 1; b >= 0; b-- )
+			for( b = ds->blocksize - 1; b >= 0; b-- )
 			{
 				pix = psource[b];
 				prowdest[b] = BLEND_LM( pix, light );
@@ -608,14 +587,14 @@ void R_DrawSurfaceBlock8_Generic( void )
 				light += lightstep;
 			}
 
-			psource += sourcetstep;
+			psource += ds->sourcetstep;
 			lightright += lightrightstep;
 			lightleft += lightleftstep;
-			prowdest += surfrowbytes;
+			prowdest += ds->rowbytes;
 		}
 
-		if( psource >= r_sourcemax )
-			psource -= r_stepback;
+		if( psource >= ds->sourcemax )
+			psource -= ds->stepback;
 	}
 }
 
@@ -625,24 +604,25 @@ void R_DrawSurfaceBlock8_Generic( void )
 R_DrawSurfaceBlock8_mip0
 ================
 */
-void R_DrawSurfaceBlock8_mip0( void )
+static void R_DrawSurfaceBlock8_mip0( drawsurf_t *ds )
 {
 	int     v, i, b;
 	uint    lightstep, lighttemp, light;
+	uint    lightleft, lightright, lightleftstep, lightrightstep;
+	uint    *lightptr = ds->lightptr;
 	pixel_t pix, *psource, *prowdest;
 
-	psource = pbasesource;
-	prowdest = prowdestbase;
+	psource = ds->basesource;
+	prowdest = ds->rowdestbase;
 
-	for( v = 0; v < r_numvblocks; v++ )
+	for( v = 0; v < ds->numvblocks; v++ )
 	{
-		// FIXME: make these locals?
 		// FIXME: use delta rather than both right and left, like ASM?
-		lightleft = r_lightptr[0];
-		lightright = r_lightptr[1];
-		r_lightptr += r_lightwidth;
-		lightleftstep = ( r_lightptr[0] - lightleft ) >> 4;
-		lightrightstep = ( r_lightptr[1] - lightright ) >> 4;
+		lightleft = lightptr[0];
+		lightright = lightptr[1];
+		lightptr += ds->lightwidth;
+		lightleftstep = ( lightptr[0] - lightleft ) >> 4;
+		lightrightstep = ( lightptr[1] - lightright ) >> 4;
 
 		for( i = 0; i < 16; i++ )
 		{
@@ -664,14 +644,14 @@ void R_DrawSurfaceBlock8_mip0( void )
 				light += lightstep;
 			}
 
-			psource += sourcetstep;
+			psource += ds->sourcetstep;
 			lightright += lightrightstep;
 			lightleft += lightleftstep;
-			prowdest += surfrowbytes;
+			prowdest += ds->rowbytes;
 		}
 
-		if( psource >= r_sourcemax )
-			psource -= r_stepback;
+		if( psource >= ds->sourcemax )
+			psource -= ds->stepback;
 	}
 }
 
@@ -681,24 +661,25 @@ void R_DrawSurfaceBlock8_mip0( void )
 R_DrawSurfaceBlock8_mip1
 ================
 */
-void R_DrawSurfaceBlock8_mip1( void )
+static void R_DrawSurfaceBlock8_mip1( drawsurf_t *ds )
 {
 	int     v, i, b;
 	uint    lightstep, lighttemp, light;
+	uint    lightleft, lightright, lightleftstep, lightrightstep;
+	uint    *lightptr = ds->lightptr;
 	pixel_t pix, *psource, *prowdest;
 
-	psource = pbasesource;
-	prowdest = prowdestbase;
+	psource = ds->basesource;
+	prowdest = ds->rowdestbase;
 
-	for( v = 0; v < r_numvblocks; v++ )
+	for( v = 0; v < ds->numvblocks; v++ )
 	{
-		// FIXME: make these locals?
 		// FIXME: use delta rather than both right and left, like ASM?
-		lightleft = r_lightptr[0];
-		lightright = r_lightptr[1];
-		r_lightptr += r_lightwidth;
-		lightleftstep = ( r_lightptr[0] - lightleft ) >> 3;
-		lightrightstep = ( r_lightptr[1] - lightright ) >> 3;
+		lightleft = lightptr[0];
+		lightright = lightptr[1];
+		lightptr += ds->lightwidth;
+		lightleftstep = ( lightptr[0] - lightleft ) >> 3;
+		lightrightstep = ( lightptr[1] - lightright ) >> 3;
 
 		for( i = 0; i < 8; i++ )
 		{
@@ -716,14 +697,14 @@ void R_DrawSurfaceBlock8_mip1( void )
 				light += lightstep;
 			}
 
-			psource += sourcetstep;
+			psource += ds->sourcetstep;
 			lightright += lightrightstep;
 			lightleft += lightleftstep;
-			prowdest += surfrowbytes;
+			prowdest += ds->rowbytes;
 		}
 
-		if( psource >= r_sourcemax )
-			psource -= r_stepback;
+		if( psource >= ds->sourcemax )
+			psource -= ds->stepback;
 	}
 }
 
@@ -733,24 +714,25 @@ void R_DrawSurfaceBlock8_mip1( void )
 R_DrawSurfaceBlock8_mip2
 ================
 */
-void R_DrawSurfaceBlock8_mip2( void )
+static void R_DrawSurfaceBlock8_mip2( drawsurf_t *ds )
 {
 	int     v, i, b;
 	uint    lightstep, lighttemp, light;
+	uint    lightleft, lightright, lightleftstep, lightrightstep;
+	uint    *lightptr = ds->lightptr;
 	pixel_t pix, *psource, *prowdest;
 
-	psource = pbasesource;
-	prowdest = prowdestbase;
+	psource = ds->basesource;
+	prowdest = ds->rowdestbase;
 
-	for( v = 0; v < r_numvblocks; v++ )
+	for( v = 0; v < ds->numvblocks; v++ )
 	{
-		// FIXME: make these locals?
 		// FIXME: use delta rather than both right and left, like ASM?
-		lightleft = r_lightptr[0];
-		lightright = r_lightptr[1];
-		r_lightptr += r_lightwidth;
-		lightleftstep = ( r_lightptr[0] - lightleft ) >> 2;
-		lightrightstep = ( r_lightptr[1] - lightright ) >> 2;
+		lightleft = lightptr[0];
+		lightright = lightptr[1];
+		lightptr += ds->lightwidth;
+		lightleftstep = ( lightptr[0] - lightleft ) >> 2;
+		lightrightstep = ( lightptr[1] - lightright ) >> 2;
 
 		for( i = 0; i < 4; i++ )
 		{
@@ -768,14 +750,14 @@ void R_DrawSurfaceBlock8_mip2( void )
 				light += lightstep;
 			}
 
-			psource += sourcetstep;
+			psource += ds->sourcetstep;
 			lightright += lightrightstep;
 			lightleft += lightleftstep;
-			prowdest += surfrowbytes;
+			prowdest += ds->rowbytes;
 		}
 
-		if( psource >= r_sourcemax )
-			psource -= r_stepback;
+		if( psource >= ds->sourcemax )
+			psource -= ds->stepback;
 	}
 }
 
@@ -785,24 +767,25 @@ void R_DrawSurfaceBlock8_mip2( void )
 R_DrawSurfaceBlock8_mip3
 ================
 */
-void R_DrawSurfaceBlock8_mip3( void )
+static void R_DrawSurfaceBlock8_mip3( drawsurf_t *ds )
 {
 	int     v, i, b;
 	uint    lightstep, lighttemp, light;
+	uint    lightleft, lightright, lightleftstep, lightrightstep;
+	uint    *lightptr = ds->lightptr;
 	pixel_t pix, *psource, *prowdest;
 
-	psource = pbasesource;
-	prowdest = prowdestbase;
+	psource = ds->basesource;
+	prowdest = ds->rowdestbase;
 
-	for( v = 0; v < r_numvblocks; v++ )
+	for( v = 0; v < ds->numvblocks; v++ )
 	{
-		// FIXME: make these locals?
 		// FIXME: use delta rather than both right and left, like ASM?
-		lightleft = r_lightptr[0];
-		lightright = r_lightptr[1];
-		r_lightptr += r_lightwidth;
-		lightleftstep = ( r_lightptr[0] - lightleft ) >> 1;
-		lightrightstep = ( r_lightptr[1] - lightright ) >> 1;
+		lightleft = lightptr[0];
+		lightright = lightptr[1];
+		lightptr += ds->lightwidth;
+		lightleftstep = ( lightptr[0] - lightleft ) >> 1;
+		lightrightstep = ( lightptr[1] - lightright ) >> 1;
 
 		for( i = 0; i < 2; i++ )
 		{
@@ -820,18 +803,277 @@ void R_DrawSurfaceBlock8_mip3( void )
 				light += lightstep;
 			}
 
-			psource += sourcetstep;
+			psource += ds->sourcetstep;
 			lightright += lightrightstep;
 			lightleft += lightleftstep;
-			prowdest += surfrowbytes;
+			prowdest += ds->rowbytes;
 		}
 
-		if( psource >= r_sourcemax )
-			psource -= r_stepback;
+		if( psource >= ds->sourcemax )
+			psource -= ds->stepback;
+	}
+}
+
+/*
+==============================================================================
+
+SURFACE CACHE
+
+Cache memory is split into power of two blocks, every size class has
+its own free list and freed blocks are merged back with their buddies.
+Surface takes the smallest block it fits in, and the tail of that block
+is returned to free lists as smaller blocks right away, so no more than
+1 << SC_MIN_ORDER bytes are wasted per surface.
+Cached surfaces are kept in LRU order, if there is no free block of
+needed size least recently used surfaces are evicted until there is one,
+so surfaces that are still in view survive cache overflow.
+
+==============================================================================
+*/
+#define SC_MIN_ORDER 8  // smallest block, must fit surfcache_t
+#define SC_MAX_ORDER 28 // same as D_SCAlloc size limit
+#define SC_FREE      0x80
+
+static struct
+{
+	byte        *base;
+	byte        *state;                       // SC_FREE|order at start of every free block
+	int         size;
+	int         maxorder;                     // biggest block
+	int         used;                         // bytes in allocated blocks
+	int         buildseq;
+	surfcache_t *freelist[SC_MAX_ORDER + 1];
+	surfcache_t lru;                          // next is the most recently used
+} sc;
+
+/*
+=================
+D_SCPushFree
+=================
+*/
+static void D_SCPushFree( int offset, int order )
+{
+	surfcache_t *block = (surfcache_t *)( sc.base + offset );
+
+	block->owner = NULL;
+	block->order = order;
+	block->prev = NULL;
+	block->next = sc.freelist[order];
+	if( block->next )
+		block->next->prev = block;
+	sc.freelist[order] = block;
+	sc.state[offset >> SC_MIN_ORDER] = SC_FREE | order;
+}
+
+/*
+=================
+D_SCUnlinkFree
+=================
+*/
+static void D_SCUnlinkFree( surfcache_t *block )
+{
+	if( block->prev )
+		block->prev->next = block->next;
+	else
+		sc.freelist[block->order] = block->next;
+
+	if( block->next )
+		block->next->prev = block->prev;
+
+	sc.state[((byte *)block - sc.base ) >> SC_MIN_ORDER] = 0;
+}
+
+/*
+=================
+D_SCReset
+
+marks whole cache memory as free
+=================
+*/
+static void D_SCReset( void )
+{
+	int offset = 0, order;
+
+	memset( sc.freelist, 0, sizeof( sc.freelist ));
+	memset( sc.state, 0, sc.size >> SC_MIN_ORDER );
+	sc.lru.next = sc.lru.prev = &sc.lru;
+	sc.used = 0;
+
+	// cover memory with biggest possible blocks, every block
+	// ends up aligned to its size relative to the base
+	for( order = sc.maxorder; order >= SC_MIN_ORDER; order-- )
+	{
+		while( sc.size - offset >= ( 1 << order ))
+		{
+			D_SCPushFree( offset, order );
+			offset += 1 << order;
+		}
+	}
+}
+
+/*
+=================
+D_SCTakeBlock
+
+returns free block of given size class, splitting bigger ones if needed
+=================
+*/
+static surfcache_t *D_SCTakeBlock( int order )
+{
+	surfcache_t *block;
+	int         i;
+
+	for( i = order; i <= sc.maxorder && !sc.freelist[i]; i++ );
+
+	if( i > sc.maxorder )
+		return NULL;
+
+	block = sc.freelist[i];
+	D_SCUnlinkFree( block );
+
+	// return upper halves back to free lists
+	while( i > order )
+	{
+		i--;
+		D_SCPushFree(((byte *)block - sc.base ) + ( 1 << i ), i );
+	}
+
+	block->order = order;
+	return block;
+}
+
+/*
+=================
+D_SCLargestPiece
+
+returns order of the biggest block that can start at offset
+inside of the region of given size, offset is aligned to it
+=================
+*/
+static int D_SCLargestPiece( int offset, int size )
+{
+	int order = SC_MIN_ORDER;
+
+	while( order < sc.maxorder && !( offset & ( 1 << order )) && ( 2 << order ) <= size )
+		order++;
+
+	return order;
+}
+
+/*
+=================
+D_SCTrimBlock
+
+returns memory past size bytes of just taken block back to free lists,
+buddies of these pieces are in use, so they can't be merged
+=================
+*/
+static void D_SCTrimBlock( surfcache_t *block, int size )
+{
+	int offset = (byte *)block - sc.base;
+	int end = offset + ( 1 << block->order );
+
+	for( offset += size; offset < end; )
+	{
+		int order = D_SCLargestPiece( offset, end - offset );
+
+		D_SCPushFree( offset, order );
+		offset += 1 << order;
+	}
+}
+
+/*
+=================
+D_SCReleaseBlock
+=================
+*/
+static void D_SCReleaseBlock( int offset, int order )
+{
+	// blocks of maximum size are never merged, see D_SCReset
+	while( order < sc.maxorder )
+	{
+		int buddy = offset ^ ( 1 << order );
+
+		if( buddy + ( 1 << order ) > sc.size )
+			break;
+
+		if( sc.state[buddy >> SC_MIN_ORDER] != ( SC_FREE | order ))
+			break;
+
+		D_SCUnlinkFree((surfcache_t *)( sc.base + buddy ));
+		offset = Q_min( offset, buddy );
+		order++;
 	}
+
+	D_SCPushFree( offset, order );
+}
+
+/*
+=================
+D_SCRelease
+
+returns memory of a surface back to free lists piece by piece
+=================
+*/
+static void D_SCRelease( surfcache_t *cache )
+{
+	int offset = (byte *)cache - sc.base;
+	int end = offset + cache->size;
+
+	while( offset < end )
+	{
+		int order = D_SCLargestPiece( offset, end - offset );
+
+		D_SCReleaseBlock( offset, order );
+		offset += 1 << order;
+	}
+}
+
+/*
+=================
+D_SCTouch
+
+moves cache to the head of LRU list
+=================
+*/
+static void D_SCTouch( surfcache_t *cache )
+{
+	cache->lastframe = tr.framecount;
+
+	if( sc.lru.next == cache )
+		return;
+
+	cache->prev->next = cache->next;
+	cache->next->prev = cache->prev;
+	cache->next = sc.lru.next;
+	cache->prev = &sc.lru;
+	sc.lru.next->prev = cache;
+	sc.lru.next = cache;
+}
+
+/*
+=================
+D_SCEvict
+=================
+*/
+static void D_SCEvict( surfcache_t *cache )
+{
+	// block is going to be reused, fill spans that still read it
+	if( cache->deferseq == d_deferseq )
+		D_FlushDeferredSpans();
+
+	cache->prev->next = cache->next;
+	cache->next->prev = cache->prev;
+
+	if( cache->owner )
+		*cache->owner = NULL;
+
+	sc.used -= cache->size;
+	r_stats.c_surfcache_evicts++;
+
+	D_SCRelease( cache );
 }
 
-// ============================================================================
 /*
 ================
 R_InitCaches
@@ -862,18 +1104,24 @@ void R_InitCaches( void )
 
 	gEngfuncs.Con_Printf( "%s surface cache\n", Q_memprint( size ));
 
-	sc_size = size;
-	if( sc_base )
+	if( sc.base )
 	{
 		D_FlushCaches(  );
-		Mem_Free( sc_base );
+		Mem_Free( sc.base );
+		Mem_Free( sc.state );
+	}
+
+	sc.size = size;
+	sc.base = Mem_Calloc( r_temppool, size );
+	sc.state = Mem_Calloc( r_temppool, size >> SC_MIN_ORDER );
+
+	for( sc.maxorder = SC_MIN_ORDER; sc.maxorder < SC_MAX_ORDER; sc.maxorder++ )
+	{
+		if(( 2 << sc.maxorder ) > size )
+			break;
 	}
-	sc_base = (surfcache_t *)Mem_Calloc( r_temppool, size );
-	sc_rover = sc_base;
 
-	sc_base->next = NULL;
-	sc_base->owner = NULL;
-	sc_base->size = sc_size;
+	D_SCReset();
 }
 
 
@@ -886,31 +1134,36 @@ void D_FlushCaches( void )
 {
 	surfcache_t *c;
 
+	if( !sc.base )
+		return;
+
+	D_FlushDeferredSpans();
+
 	// if newmap, surfaces already freed
 	if( !tr.map_unload )
 	{
-		for( c = sc_base; c; c = c->next )
+		for( c = sc.lru.next; c != &sc.lru; c = c->next )
 		{
 			if( c->owner )
 				*c->owner = NULL;
 		}
 	}
 
-	sc_rover = sc_base;
-	sc_base->next = NULL;
-	sc_base->owner = NULL;
-	sc_base->size = sc_size;
+	D_SCReset();
 }
 
 /*
 =================
 D_SCAlloc
+
+returns NULL if it can't be done without evicting
+surfaces used in this frame and thrash is not allowed
 =================
 */
-static surfcache_t     *D_SCAlloc( int width, int size )
+static surfcache_t     *D_SCAlloc( int width, int size, qboolean thrash )
 {
 	surfcache_t *new;
-	qboolean    wrapped_this_time;
+	int         order, blocksize;
 
 	if(( width < 0 ))// || (width > 256))
 		gEngfuncs.Host_Error( "%s: bad cache width %d\n", __func__, width );
@@ -918,79 +1171,73 @@ static surfcache_t     *D_SCAlloc( int width, int size )
 	if(( size <= 0 ) || ( size > 0x10000000 ))
 		gEngfuncs.Host_Error( "%s: bad cache size %d\n", __func__, size );
 
-	size = (int)&((surfcache_t *)0 )->data[size];
-	size = ( size + 3 ) & ~3;
-	if( size > sc_size )
-		gEngfuncs.Host_Error( "%s: %i > cache size of %i", __func__, size, sc_size );
+	size += sizeof( *new ) - sizeof( new->data );
+	blocksize = ( size + ( 1 << SC_MIN_ORDER ) - 1 ) & ~(( 1 << SC_MIN_ORDER ) - 1 );
 
-// if there is not size bytes after the rover, reset to the start
-	wrapped_this_time = false;
-
-	if( !sc_rover || (byte *)sc_rover - (byte *)sc_base > sc_size - size )
-	{
-		if( sc_rover )
-		{
-			wrapped_this_time = true;
-		}
-		sc_rover = sc_base;
-	}
+	for( order = SC_MIN_ORDER; ( 1 << order ) < size; order++ );
 
-// colect and free surfcache_t blocks until the rover block is large enough
-	new = sc_rover;
-	if( sc_rover->owner )
-		*sc_rover->owner = NULL;
+	if( order > sc.maxorder )
+		gEngfuncs.Host_Error( "%s: %i > cache size of %i", __func__, size, sc.size );
 
-	while( new->size < size )
+// evict least recently used surfaces until block of this size is freed
+	while( !( new = D_SCTakeBlock( order )))
 	{
-		// free another
-		sc_rover = sc_rover->next;
-		if( !sc_rover )
+		surfcache_t *lru = sc.lru.prev;
+
+		if( lru == &sc.lru )
 			gEngfuncs.Host_Error( "%s: hit the end of memory", __func__ );
-		if( sc_rover->owner )
-			*sc_rover->owner = NULL;
 
-		new->size += sc_rover->size;
-		new->next = sc_rover->next;
-	}
+		if( lru->lastframe == tr.framecount )
+		{
+			if( !thrash )
+				return NULL;
 
-// create a fragment out of any leftovers
-	if( new->size - size > 256 )
-	{
-		sc_rover = (surfcache_t *)((byte *)new + size );
-		sc_rover->size = new->size - size;
-		sc_rover->next = new->next;
-		sc_rover->width = 0;
-		sc_rover->owner = NULL;
-		new->next = sc_rover;
-		new->size = size;
+			r_cache_thrash = true;
+		}
+
+		D_SCEvict( lru );
 	}
-	else
-		sc_rover = new->next;
 
+	D_SCTrimBlock( new, blocksize );
+
+	new->size = blocksize;
 	new->width = width;
 // DEBUG
 	if( width > 0 )
 		new->height = ( size - sizeof( *new ) + sizeof( new->data )) / width;
 
 	new->owner = NULL; // should be set properly after return
-
-	if( d_roverwrapped )
-	{
-		if( wrapped_this_time || ( sc_rover >= d_initial_rover ))
-			r_cache_thrash = true;
-	}
-	else if( wrapped_this_time )
-	{
-		d_roverwrapped = true;
-	}
+	new->buildseq = sc.buildseq - 1; // wasn't built by job threads
+	new->deferseq = d_deferseq - 1; // isn't read by queued spans
+	new->lastframe = tr.framecount;
+	new->prev = &sc.lru;
+	new->next = sc.lru.next;
+	sc.lru.next->prev = new;
+	sc.lru.next = new;
+	sc.used += new->size;
 
 	return new;
 }
 
+/*
+=================
+D_SurfaceCacheUsage
+
+returns bytes used by cached surfaces
+=================
+*/
+int D_SurfaceCacheUsage( int *total )
+{
+	if( total )
+		*total = sc.size;
+
+	return sc.used;
+}
+
 // =============================================================================
-static void R_DrawSurfaceDecals( void )
+static void R_DrawSurfaceDecals( drawsurf_t *ds )
 {
-	msurface_t *fa = r_drawsurf.surf;
+	msurface_t *fa = ds->surf;
 	decal_t    *p;
 
 	for( p = fa->pdecals; p; p = p->pnext )
@@ -1021,10 +1268,10 @@ static void R_DrawSurfaceDecals( void )
 		x = DotProduct( p->position, textureU ) + textureU[3] - fa->texturemins[0] - w / 2;
 		y = DotProduct( p->position, textureV ) + textureV[3] - fa->texturemins[1] - h / 2;
 
-		x = x >> r_drawsurf.surfmip;
-		y = y >> r_drawsurf.surfmip;
-		w = w >> r_drawsurf.surfmip;
-		h = h >> r_drawsurf.surfmip;
+		x = x >> ds->surfmip;
+		y = y >> ds->surfmip;
+		w = w >> ds->surfmip;
+		h = h >> ds->surfmip;
 
 		if( w < 1 || h < 1 )
 			continue;
@@ -1034,15 +1281,15 @@ static void R_DrawSurfaceDecals( void )
 			s1 += ( -x ) * ( s2 - s1 ) / w;
 			x = 0;
 		}
-		if( x + w > r_drawsurf.surfwidth )
+		if( x + w > ds->surfwidth )
 		{
-			s2 -= ( x + w - r_drawsurf.surfwidth ) * ( s2 - s1 ) / w;
-			w = r_drawsurf.surfwidth - x;
+			s2 -= ( x + w - ds->surfwidth ) * ( s2 - s1 ) / w;
+			w = ds->surfwidth - x;
 		}
-		if( y + h > r_drawsurf.surfheight )
+		if( y + h > ds->surfheight )
 		{
-			t2 -= ( y + h - r_drawsurf.surfheight ) * ( t2 - t1 ) / h;
-			h = r_drawsurf.surfheight - y;
+			t2 -= ( y + h - ds->surfheight ) * ( t2 - t1 ) / h;
+			h = ds->surfheight - y;
 		}
 
 		if( s1 < 0 )
@@ -1076,7 +1323,7 @@ static void R_DrawSurfaceDecals( void )
 		else
 			skip = 0;
 
-		dest = ((pixel_t *)r_drawsurf.surfdat ) + y * r_drawsurf.rowbytes + x;
+		dest = ((pixel_t *)ds->surfdat ) + y * ds->rowbytes + x;
 
 		for( v = 0; v < height; v++ )
 		{
@@ -1118,7 +1365,7 @@ static void R_DrawSurfaceDecals( void )
 
 				}
 			}
-			dest += r_drawsurf.rowbytes;
+			dest += ds->rowbytes;
 		}
 	}
 
@@ -1126,17 +1373,23 @@ static void R_DrawSurfaceDecals( void )
 
 /*
 ================
-D_CacheSurface
+D_PrepareSurface
+
+sets up drawsurf if cache has to be rebuilt, immediate is set when
+surface is going to be drawn right away, otherwise it returns NULL
+instead of evicting surfaces that were used in this frame
 ================
 */
-surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
+static surfcache_t *D_PrepareSurface( drawsurf_t *ds, msurface_t *surface, int miplevel, qboolean immediate, qboolean *rebuild )
 {
 	surfcache_t *cache;
 	int         maps;
+
+	*rebuild = false;
 //
 // if the surface is animating or flashing, flush the cache
 //
-	r_drawsurf.image = R_GetTexture( R_TextureAnimation( surface )->gl_texturenum );
+	ds->image = R_GetTexture( R_TextureAnimation( surface )->gl_texturenum );
 
 	// does not support conveyors with world luxels now
 	if( surface->texinfo->flags & TEX_WORLD_LUXELS )
@@ -1146,13 +1399,13 @@ surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
 	{
 		if( miplevel >= 1 )
 		{
-			surface->extents[0] = surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( r_drawsurf.surf ) * 2;
-			surface->info->lightmapmins[0] = -surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( r_drawsurf.surf );
+			surface->extents[0] = surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( surface ) * 2;
+			surface->info->lightmapmins[0] = -surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( surface );
 		}
 		else
 		{
-			surface->extents[0] = surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( r_drawsurf.surf );
-			surface->info->lightmapmins[0] = -surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( r_drawsurf.surf ) / 2;
+			surface->extents[0] = surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( surface );
+			surface->info->lightmapmins[0] = -surface->info->lightextents[0] * LM_SAMPLE_SIZE_AUTO( surface ) / 2;
 		}
 	}
 	/// todo: port this
@@ -1166,6 +1419,10 @@ surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
 //
 	cache = CACHESPOT( surface )[miplevel];
 
+	// already built by job threads for this batch of spans
+	if( cache && cache->buildseq == sc.buildseq )
+		return cache;
+
 	// check for lightmap modification
 	for( maps = 0; maps < MAXLIGHTMAPS && surface->styles[maps] != 255; maps++ )
 	{
@@ -1177,12 +1434,18 @@ surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
 
 
 	if( cache && !cache->dlight && surface->dlightframe != tr.framecount
-	    && cache->image == r_drawsurf.image
-	    && cache->lightadj[0] == r_drawsurf.lightadj[0]
-	    && cache->lightadj[1] == r_drawsurf.lightadj[1]
-	    && cache->lightadj[2] == r_drawsurf.lightadj[2]
-	    && cache->lightadj[3] == r_drawsurf.lightadj[3] )
+	    && cache->image == ds->image
+	    && cache->lightadj[0] == ds->lightadj[0]
+	    && cache->lightadj[1] == ds->lightadj[1]
+	    && cache->lightadj[2] == ds->lightadj[2]
+	    && cache->lightadj[3] == ds->lightadj[3] )
+	{
+		// count hits only once, when surface is drawn
+		if( immediate )
+			r_stats.c_surfcache_hits++;
+		D_SCTouch( cache );
 		return cache;
+	}
 
 	if( surface->dlightframe == tr.framecount )
 	{
@@ -1194,24 +1457,28 @@ surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
 				CACHESPOT( surface )[i]->image = NULL;
 		}
 	}
+	// queued spans may still read the cache that is going to be rebuilt,
+	// blocks that are evicted for a new one are checked by D_SCEvict
+	if( cache && cache->deferseq == d_deferseq )
+		D_FlushDeferredSpans();
+
 //
 // determine shape of surface
 //
-	surfscale = 1.0 / ( 1 << miplevel );
-	r_drawsurf.surfmip = miplevel;
+	ds->surfmip = miplevel;
 	if( surface->flags & SURF_CONVEYOR )
-		r_drawsurf.surfwidth = surface->extents[0] >> miplevel;
+		ds->surfwidth = surface->extents[0] >> miplevel;
 	else
-		r_drawsurf.surfwidth = surface->info->lightextents[0] >> miplevel;
-	r_drawsurf.rowbytes = r_drawsurf.surfwidth;
-	r_drawsurf.surfheight = surface->info->lightextents[1] >> miplevel;
+		ds->surfwidth = surface->info->lightextents[0] >> miplevel;
+	ds->rowbytes = ds->surfwidth;
+	ds->surfheight = surface->info->lightextents[1] >> miplevel;
 
 	// use texture space if world luxels used
 	if( surface->texinfo->flags & TEX_WORLD_LUXELS )
 	{
-		r_drawsurf.surfwidth = surface->extents[0] >> miplevel;
-		r_drawsurf.rowbytes = r_drawsurf.surfwidth;
-		r_drawsurf.surfheight = surface->extents[1] >> miplevel;
+		ds->surfwidth = surface->extents[0] >> miplevel;
+		ds->rowbytes = ds->surfwidth;
+		ds->surfheight = surface->extents[1] >> miplevel;
 	}
 
 
@@ -1220,44 +1487,174 @@ surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
 //
 	if( !cache ) // if a texture just animated, don't reallocate it
 	{
-		cache = D_SCAlloc( r_drawsurf.surfwidth,
-				   r_drawsurf.surfwidth * r_drawsurf.surfheight * 2 );
+		cache = D_SCAlloc( ds->surfwidth, ds->surfwidth * ds->surfheight * 2, immediate );
+		if( !cache )
+			return NULL;
+
 		CACHESPOT( surface )[miplevel] = cache;
 		cache->owner = &CACHESPOT( surface )[miplevel];
-		cache->mipscale = surfscale;
+		cache->mipscale = 1.0f / ( 1 << miplevel );
 	}
+	else
+		D_SCTouch( cache );
 
 	if( surface->dlightframe == tr.framecount )
 		cache->dlight = 1;
 	else
 		cache->dlight = 0;
 
-	r_drawsurf.surfdat = (pixel_t *)cache->data;
+	ds->surfdat = (pixel_t *)cache->data;
 
-	cache->image = r_drawsurf.image;
-	cache->lightadj[0] = r_drawsurf.lightadj[0];
-	cache->lightadj[1] = r_drawsurf.lightadj[1];
-	cache->lightadj[2] = r_drawsurf.lightadj[2];
-	cache->lightadj[3] = r_drawsurf.lightadj[3];
+	cache->image = ds->image;
+	cache->lightadj[0] = ds->lightadj[0];
+	cache->lightadj[1] = ds->lightadj[1];
+	cache->lightadj[2] = ds->lightadj[2];
+	cache->lightadj[3] = ds->lightadj[3];
 	for( maps = 0; maps < MAXLIGHTMAPS && surface->styles[maps] != 255; maps++ )
 	{
 		surface->cached_light[maps] = tr.lightstylevalue[surface->styles[maps]];
 	}
-//
-// draw and light the surface texture
-//
-	r_drawsurf.surf = surface;
 
-	// c_surf++;
+	ds->surf = surface;
+	ds->identity = tr.modelviewIdentity;
+	if( !ds->identity )
+		Matrix4x4_Copy( ds->objectmatrix, RI.objectMatrix );
+
+	r_stats.c_surfcache_misses++;
+	*rebuild = true;
+
+	return cache;
+}
 
+/*
+================
+D_BuildSurface
+
+draw and light the surface texture
+================
+*/
+static void D_BuildSurface( drawsurf_t *ds )
+{
 	// calculate the lightings
-	R_BuildLightMap( );
+	R_BuildLightMap( ds );
 
 	// rasterize the surface into the cache
-	R_DrawSurface();
-	R_DrawSurfaceDecals();
+	R_DrawSurface( ds );
+	R_DrawSurfaceDecals( ds );
+}
+
+/*
+================
+D_CacheSurface
+================
+*/
+surfcache_t *D_CacheSurface( msurface_t *surface, int miplevel )
+{
+	surfcache_t *cache;
+	qboolean    rebuild;
+
+	cache = D_PrepareSurface( &r_drawsurf, surface, miplevel, true, &rebuild );
+
+	if( rebuild )
+	{
+		r_drawsurf.blocklights = blocklights;
+		D_BuildSurface( &r_drawsurf );
+	}
 
 	return cache;
 }
 
+/*
+==============================================================================
+
+SURFACE BUILD JOBS
+
+Before spans are drawn, surfaces with missing or outdated cache get their
+memory allocated in advance and are rebuilt by job threads, every one of
+them with own lightmap buffer. Queueing stops when cache would start
+thrashing, remaining surfaces are rebuilt by D_CacheSurface as usual.
+
+==============================================================================
+*/
+#define MAX_SURFACE_BUILDS 256
+
+static struct
+{
+	drawsurf_t surfs[MAX_SURFACE_BUILDS];
+	int        count;
+} sc_builds;
+
+/*
+================
+D_QueueSurfaceBuild
+
+returns false if cache is full of surfaces used in this frame
+================
+*/
+qboolean D_QueueSurfaceBuild( msurface_t *surface, int miplevel )
+{
+	surfcache_t *cache;
+	qboolean    rebuild;
+
+	if( sc_builds.count == MAX_SURFACE_BUILDS )
+		D_BuildQueuedSurfaces();
+
+	cache = D_PrepareSurface( &sc_builds.surfs[sc_builds.count], surface, miplevel, false, &rebuild );
+	if( !cache )
+		return false;
+
+	if( rebuild )
+	{
+		cache->buildseq = sc.buildseq;
+		sc_builds.count++;
+	}
+
+	return true;
+}
+
+/*
+================
+D_SurfaceBuildJob
+================
+*/
+static void D_SurfaceBuildJob( void *ctx, int start, int end )
+{
+	unsigned lights[ARRAYSIZE( blocklights )];
+	int      i;
+
+	for( i = start; i < end; i++ )
+	{
+		drawsurf_t *ds = &sc_builds.surfs[i];
+
+		ds->blocklights = lights;
+		D_BuildSurface( ds );
+	}
+}
 
+/*
+================
+D_BuildQueuedSurfaces
+================
+*/
+void D_BuildQueuedSurfaces( void )
+{
+	if( !sc_builds.count )
+		return;
+
+	gEngfuncs.COM_ParallelFor( sc_builds.count, 1, D_SurfaceBuildJob, NULL );
+	r_stats.c_surfcache_jobs += sc_builds.count;
+	sc_builds.count = 0;
+}
+
+/*
+================
+D_EndSurfaceBuilds
+
+called when queued surfaces were drawn, so they can be rebuilt again
+================
+*/
+void D_EndSurfaceBuilds( void )
+{
+	D_BuildQueuedSurfaces();
+	sc.buildseq++;
+}
@@ -51,7 +51,7 @@ static color24 gTracerColors[] =
 ================
 CL_DrawParticles
 
-update particle color, position, free expired and draw it
+draw particles, engine updates them after that
 ================
 */
 void CL_DrawParticles( double frametime, particle_t *cl_active_particles, float partsize )
@@ -114,8 +114,6 @@ void CL_DrawParticles( double frametime, particle_t *cl_active_particles, float
 			TriTexCoord2f( 1.0f, 1.0f );
 			TriVertex3f( p->org[0] - right[0] - up[0], p->org[1] - right[1] - up[1], p->org[2] - right[2] - up[2] );
 		}
-
-		gEngine.CL_ThinkParticle( frametime, p );
 	}
 
 	const vec4_t color = { 1, 1, 1, 1 }; // pColor->r / 255.f, pColor->g / 255.f, pColor->b / 255.f, 1.f };